@@ -26,8 +26,10 @@
 
 #include "mlir/Support/LogicalResult.h"
 #include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/Optional.h"
 #include "llvm/ADT/SmallVector.h"
+#include <memory>
 
 namespace mlir {
 
@@ -35,6 +37,7 @@ class AffineApplyOp;
 class AffineForOp;
 class AffineValueMap;
 class FlatAffineConstraints;
+class Function;
 class Operation;
 class Value;
 
@@ -104,6 +107,86 @@ bool checkMemrefAccessDependence(
     unsigned loopDepth, FlatAffineConstraints *dependenceConstraints,
     llvm::SmallVector<DependenceComponent, 2> *dependenceComponents,
     bool allowRAR = false);
+
+/// A check for a dependence from the load or store 'src' to the load or store
+/// 'dst' at 'loopDepth', optionally computing its direction vector.
+struct DependenceQuery {
+  DependenceQuery(Operation *src, Operation *dst, unsigned loopDepth,
+                  bool withComponents = false, bool allowRAR = false)
+      : src(src), dst(dst), loopDepth(loopDepth),
+        withComponents(withComponents), allowRAR(allowRAR) {}
+
+  Operation *src, *dst;
+  unsigned loopDepth;
+  bool withComponents, allowRAR;
+};
+
+/// Memoizes the dependence checks between the memref accesses of a function.
+/// The composed access function and the iteration domain of a load or store
+/// are computed once, the first time it is queried, along with a constant
+/// bounding box of the elements it accesses. Pairs of accesses to different
+/// memrefs or with disjoint bounding boxes are answered without building a
+/// dependence constraint system, and all the answers are cached.
+///
+/// This is a function analysis that passes get with
+/// 'getAnalysis<AffineDependenceGraph>()', but it may also be constructed
+/// locally to share work between the dependence checks of a utility. The
+/// answers are only valid as long as the queried operations and their loop
+/// nests aren't modified.
+class AffineDependenceGraph {
+public:
+  /// Constructs the analysis of 'function'. Its accesses are analyzed lazily,
+  /// as they are queried.
+  explicit AffineDependenceGraph(Function *function = nullptr);
+  ~AffineDependenceGraph();
+
+  /// Returns whether there may be a dependence from the load or store 'src' to
+  /// the load or store 'dst' at 'loopDepth', as checkMemrefAccessDependence
+  /// does. If there is one, its direction vector is returned in
+  /// 'dependenceComponents' when it is non-null.
+  bool hasDependence(
+      Operation *src, Operation *dst, unsigned loopDepth,
+      llvm::SmallVector<DependenceComponent, 2> *dependenceComponents = nullptr,
+      bool allowRAR = false);
+
+  /// Answers 'queries' and caches the answers, so that the hasDependence
+  /// calls for them don't check anything. The checks are independent and are
+  /// run on multiple threads if multithreading is enabled; the answers are
+  /// the same as those of running them one after the other.
+  void computeDependences(llvm::ArrayRef<DependenceQuery> queries);
+
+private:
+  struct AccessInfo;
+
+  /// A cached answer, with the direction vector if it was requested.
+  struct DependenceInfo {
+    bool hasDependence;
+    bool hasComponents;
+    llvm::SmallVector<DependenceComponent, 2> components;
+  };
+
+  /// The cache key of a query: (src, dst) and 2 * loopDepth + allowRAR.
+  using DependenceKey =
+      std::pair<std::pair<Operation *, Operation *>, unsigned>;
+  static DependenceKey getKey(Operation *src, Operation *dst,
+                              unsigned loopDepth, bool allowRAR) {
+    return {{src, dst}, 2 * loopDepth + allowRAR};
+  }
+
+  /// Returns the information about the access 'op', computing it if needed.
+  AccessInfo &getAccessInfo(Operation *op);
+
+  /// Checks for a dependence between the accesses 'srcInfo' and 'dstInfo',
+  /// storing the answer in 'result'. This only reads the IR if the ancestors
+  /// of the accesses are ordered in their blocks.
+  static void computeDependence(const AccessInfo &srcInfo,
+                                const AccessInfo &dstInfo, unsigned loopDepth,
+                                bool withComponents, bool allowRAR,
+                                DependenceInfo &result);
+
+  llvm::DenseMap<Operation *, std::unique_ptr<AccessInfo>> accessInfos;
+  llvm::DenseMap<DependenceKey, DependenceInfo> dependences;
+};
 } // end namespace mlir
 
 #endif // MLIR_ANALYSIS_AFFINE_ANALYSIS_H
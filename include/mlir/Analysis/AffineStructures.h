@@ -22,6 +22,7 @@
 #ifndef MLIR_ANALYSIS_AFFINE_STRUCTURES_H
 #define MLIR_ANALYSIS_AFFINE_STRUCTURES_H
 
+#include "mlir/Analysis/Matrix.h"
 #include "mlir/IR/AffineExpr.h"
 #include "mlir/IR/OpDefinition.h"
 #include "mlir/Support/LogicalResult.h"
@@ -211,14 +212,10 @@ private:
 /// Inequality: c_0*x_0 + c_1*x_1 + .... + c_{n-1}*x_{n-1} == 0
 /// Equality: c_0*x_0 + c_1*x_1 + .... + c_{n-1}*x_{n-1} >= 0
 ///
-/// FlatAffineConstraints stores coefficients in a contiguous buffer (one buffer
-/// for equalities and one for inequalities). The size of each buffer is
-/// numReservedCols * number of inequalities (or equalities). The reserved size
-/// is numReservedCols * numReservedInequalities (or numReservedEqualities). A
-/// coefficient (r, c) lives at the location numReservedCols * r + c in the
-/// buffer. The extra space between getNumCols() and numReservedCols exists to
-/// prevent frequent movement of data when adding columns, especially at the
-/// end.
+/// FlatAffineConstraints stores coefficients in two row-major matrices, one for
+/// equalities and one for inequalities, with one row per constraint. Their rows
+/// have reserved space beyond getNumCols(), which prevents frequent movement of
+/// data when adding columns, especially at the end. See Matrix.
 ///
 /// The identifiers x_0, x_1, ... appear in the order: dimensional identifiers,
 /// symbolic identifiers, and local identifiers.  The local identifiers
@@ -243,12 +240,13 @@ public:
                         unsigned numReservedCols, unsigned numDims = 0,
                         unsigned numSymbols = 0, unsigned numLocals = 0,
                         ArrayRef<Optional<Value *>> idArgs = {})
-      : numReservedCols(numReservedCols), numDims(numDims),
-        numSymbols(numSymbols) {
+      : equalities(0, numDims + numSymbols + numLocals + 1,
+                   numReservedEqualities, numReservedCols),
+        inequalities(0, numDims + numSymbols + numLocals + 1,
+                     numReservedInequalities, numReservedCols),
+        numDims(numDims), numSymbols(numSymbols) {
     assert(numReservedCols >= numDims + numSymbols + 1);
     assert(idArgs.empty() || idArgs.size() == numDims + numSymbols + numLocals);
-    equalities.reserve(numReservedCols * numReservedEqualities);
-    inequalities.reserve(numReservedCols * numReservedInequalities);
     numIds = numDims + numSymbols + numLocals;
     ids.reserve(numReservedCols);
     if (idArgs.empty())
@@ -262,9 +260,9 @@ public:
   FlatAffineConstraints(unsigned numDims = 0, unsigned numSymbols = 0,
                         unsigned numLocals = 0,
                         ArrayRef<Optional<Value *>> idArgs = {})
-      : numReservedCols(numDims + numSymbols + numLocals + 1), numDims(numDims),
-        numSymbols(numSymbols) {
-    assert(numReservedCols >= numDims + numSymbols + 1);
+      : equalities(0, numDims + numSymbols + numLocals + 1),
+        inequalities(0, numDims + numSymbols + numLocals + 1),
+        numDims(numDims), numSymbols(numSymbols) {
     assert(idArgs.empty() || idArgs.size() == numDims + numSymbols + numLocals);
     numIds = numDims + numSymbols + numLocals;
     ids.reserve(numIds);
@@ -310,12 +308,25 @@ public:
   /// intersection with no simplification of any sort attempted.
   void append(const FlatAffineConstraints &other);
 
+  /// The decision procedures available to check for emptiness.
+  enum class EmptinessCheck {
+    /// Gaussian and Fourier-Motzkin elimination of all identifiers. This is
+    /// exact on the rational set but may blow up on large systems, in which
+    /// case the system is conservatively deemed non-empty.
+    FourierMotzkin,
+    /// A simplex tableau with branch and bound, which is exact on the integer
+    /// set. Falls back to FourierMotzkin when the search exceeds its budget or
+    /// its coefficients overflow.
+    Simplex
+  };
+
   // Checks for emptiness by performing variable elimination on all identifiers,
   // running the GCD test on each equality constraint, and checking for invalid
   // constraints.
   // Returns true if the GCD test fails for any equality, or if any invalid
   // constraints are discovered on any row. Returns false otherwise.
-  bool isEmpty() const;
+  // 'check' selects the procedure used after the GCD test.
+  bool isEmpty(EmptinessCheck check = EmptinessCheck::FourierMotzkin) const;
 
   // Runs the GCD test on all equality constraints. Returns 'true' if this test
   // fails on any equality. Returns 'false' otherwise.
@@ -328,50 +339,39 @@ public:
 
   /// Returns the value at the specified equality row and column.
   inline int64_t atEq(unsigned i, unsigned j) const {
-    return equalities[i * numReservedCols + j];
-  }
-  inline int64_t &atEq(unsigned i, unsigned j) {
-    return equalities[i * numReservedCols + j];
+    return equalities(i, j);
   }
+  inline int64_t &atEq(unsigned i, unsigned j) { return equalities(i, j); }
 
   inline int64_t atIneq(unsigned i, unsigned j) const {
-    return inequalities[i * numReservedCols + j];
+    return inequalities(i, j);
   }
 
-  inline int64_t &atIneq(unsigned i, unsigned j) {
-    return inequalities[i * numReservedCols + j];
-  }
+  inline int64_t &atIneq(unsigned i, unsigned j) { return inequalities(i, j); }
 
   /// Returns the number of columns in the constraint system.
   inline unsigned getNumCols() const { return numIds + 1; }
 
-  inline unsigned getNumEqualities() const {
-    assert(equalities.size() % numReservedCols == 0 &&
-           "inconsistent equality buffer size");
-    return equalities.size() / numReservedCols;
-  }
+  inline unsigned getNumEqualities() const { return equalities.getNumRows(); }
 
   inline unsigned getNumInequalities() const {
-    assert(inequalities.size() % numReservedCols == 0 &&
-           "inconsistent inequality buffer size");
-    return inequalities.size() / numReservedCols;
+    return inequalities.getNumRows();
   }
 
   inline unsigned getNumReservedEqualities() const {
-    return equalities.capacity() / numReservedCols;
+    return equalities.getNumReservedRows();
   }
 
   inline unsigned getNumReservedInequalities() const {
-    return inequalities.capacity() / numReservedCols;
+    return inequalities.getNumReservedRows();
   }
 
   inline ArrayRef<int64_t> getEquality(unsigned idx) const {
-    return ArrayRef<int64_t>(&equalities[idx * numReservedCols], getNumCols());
+    return equalities.getRow(idx);
   }
 
   inline ArrayRef<int64_t> getInequality(unsigned idx) const {
-    return ArrayRef<int64_t>(&inequalities[idx * numReservedCols],
-                             getNumCols());
+    return inequalities.getRow(idx);
   }
 
   AffineExpr toAffineExpr(unsigned idx, MLIRContext *context);
@@ -655,8 +655,10 @@ public:
   void removeTrivialRedundancy();
 
   /// A more expensive check to detect redundant inequalities thatn
-  /// removeTrivialRedundancy.
-  void removeRedundantInequalities();
+  /// removeTrivialRedundancy. An inequality is redundant if the system is
+  /// empty once it is replaced by its complement, as decided by 'check'.
+  void removeRedundantInequalities(
+      EmptinessCheck check = EmptinessCheck::FourierMotzkin);
 
   // Removes all equalities and inequalities.
   void clearConstraints();
@@ -698,7 +700,9 @@ private:
   /// equality involving that identifier. If the result of the elimination is
   /// integer exact, *isResultIntegerExact is set to true. If 'darkShadow' is
   /// set to true, a potential under approximation (subset) of the rational
-  /// shadow / exact integer shadow is computed.
+  /// shadow / exact integer shadow is computed. Constraints whose coefficients
+  /// overflow int64_t even after normalization are dropped (or make the dark
+  /// shadow empty), so that the result stays sound.
   // See implementation comments for more details.
   void FourierMotzkinEliminate(unsigned pos, bool darkShadow = false,
                                bool *isResultIntegerExact = nullptr);
@@ -720,14 +724,10 @@ private:
   void removeIdRange(unsigned idStart, unsigned idLimit);
 
   /// Coefficients of affine equalities (in == 0 form).
-  SmallVector<int64_t, 64> equalities;
+  Matrix equalities;
 
   /// Coefficients of affine inequalities (in >= 0 form).
-  SmallVector<int64_t, 64> inequalities;
-
-  /// Number of columns reserved. Actual ones in used are returned by
-  /// getNumCols().
-  unsigned numReservedCols;
+  Matrix inequalities;
 
   /// Total number of identifiers.
   unsigned numIds;
@@ -745,6 +745,10 @@ private:
   /// None.
   SmallVector<Optional<Value *>, 8> ids;
 
+  /// Whether elimination dropped constraints whose coefficients overflowed
+  /// int64_t, making this system an over-approximation of the original one.
+  bool hasDroppedConstraints = false;
+
   /// A parameter that controls detection of an unrealistic number of
   /// constraints. If the number of constraints is this many times the number of
   /// variables, we consider such a system out of line with the intended use
@@ -43,6 +43,24 @@ public:
   /// Recalculate the dominance info for the provided function.
   void recalculate(Function *function);
 
+  /// Recalculate the dominance info of a single region, e.g. after it was
+  /// populated or restructured, leaving that of the other regions untouched.
+  void recalculate(Region *region);
+
+  /// Incrementally update the dominance info after an edge from block 'from'
+  /// to block 'to' of the same region was inserted into the CFG. 'to' may be
+  /// a block that was previously unreachable or new to the region.
+  void insertEdge(Block *from, Block *to);
+
+  /// Incrementally update the dominance info after an edge from block 'from'
+  /// to block 'to' was deleted from the CFG.
+  void deleteEdge(Block *from, Block *to);
+
+  /// Update the dominance info after 'block' was split by Block::splitBlock
+  /// into itself and 'newBlock', and then terminated with a branch to
+  /// 'newBlock', which took over the successors of 'block'.
+  void splitBlock(Block *block, Block *newBlock);
+
   /// Get the root dominance node of the given region.
   DominanceInfoNode *getRootNode(Region *region) {
     assert(dominanceInfos.count(region) != 0);
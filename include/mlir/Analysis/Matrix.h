@@ -0,0 +1,167 @@
+//===- Matrix.h - Dense matrix of int64_t coefficients ----------*- C++ -*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This header declares a dense row-major matrix of int64_t, used to store the
+// coefficients of the constraints of FlatAffineConstraints.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_ANALYSIS_MATRIX_H
+#define MLIR_ANALYSIS_MATRIX_H
+
+#include "mlir/Support/LLVM.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/MathExtras.h"
+
+namespace mlir {
+
+/// A dense matrix of int64_t, stored row-major in a single buffer.
+///
+/// The rows are padded to a multiple of kRowAlignment entries, so that they
+/// all start at the same offset modulo the vector width. The padding entries
+/// are always zero.
+///
+/// The row stride is grown geometrically when columns are inserted, which
+/// makes adding columns one at a time amortized linear in the size of the
+/// matrix rather than quadratic. Columns are moved a row segment at a time.
+class Matrix {
+public:
+  /// The number of entries that rows are padded to a multiple of: 32 bytes,
+  /// the width of AVX registers.
+  constexpr static unsigned kRowAlignment = 4;
+
+  /// Creates a zero matrix of 'rows' x 'columns', reserving memory for
+  /// 'reservedRows' rows of 'reservedColumns' columns.
+  Matrix(unsigned rows = 0, unsigned columns = 0, unsigned reservedRows = 0,
+         unsigned reservedColumns = 0);
+
+  /// Accessors for the entry at 'row', 'column'.
+  int64_t &at(unsigned row, unsigned column) {
+    assert(row < numRows && column < numColumns && "out of bounds access");
+    return data[row * rowStride + column];
+  }
+  int64_t at(unsigned row, unsigned column) const {
+    assert(row < numRows && column < numColumns && "out of bounds access");
+    return data[row * rowStride + column];
+  }
+  int64_t &operator()(unsigned row, unsigned column) {
+    return at(row, column);
+  }
+  int64_t operator()(unsigned row, unsigned column) const {
+    return at(row, column);
+  }
+
+  unsigned getNumRows() const { return numRows; }
+  unsigned getNumColumns() const { return numColumns; }
+
+  /// Returns the number of rows that fit in the buffer without reallocation.
+  unsigned getNumReservedRows() const { return data.capacity() / rowStride; }
+
+  /// Returns the number of columns that fit in a row without moving rows.
+  unsigned getNumReservedColumns() const { return rowStride; }
+
+  /// Returns the entries of 'row', without the padding.
+  ArrayRef<int64_t> getRow(unsigned row) const {
+    return {&data[row * rowStride], numColumns};
+  }
+  MutableArrayRef<int64_t> getRow(unsigned row) {
+    return {&data[row * rowStride], numColumns};
+  }
+
+  /// Reserves memory for 'rows' rows.
+  void reserveRows(unsigned rows);
+
+  /// Appends a zero row and returns its position.
+  unsigned appendExtraRow();
+
+  /// Appends a row with the entries of 'row' and returns its position.
+  unsigned appendRow(ArrayRef<int64_t> row);
+
+  /// Removes the row at 'pos', moving the following rows up.
+  void removeRow(unsigned pos);
+
+  /// Resizes the matrix to 'newNumRows' rows, dropping the last rows or
+  /// appending zero rows.
+  void resizeVertically(unsigned newNumRows);
+
+  /// Overwrites row 'dest' with row 'src'.
+  void copyRow(unsigned src, unsigned dest);
+
+  /// Inserts 'count' zero columns before column 'pos'.
+  void insertColumns(unsigned pos, unsigned count);
+
+  /// Removes the columns in [pos, pos + count).
+  void removeColumns(unsigned pos, unsigned count);
+
+  /// Resizes the matrix to 'newNumColumns' columns, dropping the last columns
+  /// or appending zero columns.
+  void resizeHorizontally(unsigned newNumColumns);
+
+  /// Removes all the rows, keeping the columns and the reserved memory.
+  void clearRows() {
+    numRows = 0;
+    data.clear();
+  }
+
+  void print(raw_ostream &os) const;
+  void dump() const;
+
+private:
+  /// Returns the smallest row stride that fits 'columns' columns.
+  static unsigned getPaddedStride(unsigned columns) {
+    return llvm::alignTo(std::max(columns, 1u), kRowAlignment);
+  }
+
+  /// Changes the row stride to 'newStride', moving the rows in place.
+  void setRowStride(unsigned newStride);
+
+  unsigned numRows, numColumns;
+
+  /// The distance between the starts of consecutive rows in 'data'.
+  unsigned rowStride;
+
+  /// The rows of the matrix with their padding, stored contiguously.
+  SmallVector<int64_t, 64> data;
+};
+
+//===----------------------------------------------------------------------===//
+// Row operations.
+//
+// These are written without divisions or branches in their loops so that they
+// can be vectorized.
+//===----------------------------------------------------------------------===//
+
+/// Returns the gcd of the absolute values of the entries of 'row', which is
+/// zero if they are all zero.
+uint64_t getGCDOfAbsValues(ArrayRef<int64_t> row);
+
+/// Divides the entries of 'row' by 'divisor', which must be positive and
+/// divide all of them. 'divisor' may be 2^63, the gcd of a row whose nonzero
+/// entries are all INT64_MIN.
+void divideExactly(MutableArrayRef<int64_t> row, uint64_t divisor);
+
+/// Sets 'result' to 'lhsMultiplier * lhs + rhsMultiplier * rhs'. Returns false
+/// without modifying 'result' if this may overflow int64_t. 'result' may alias
+/// 'lhs' or 'rhs'.
+bool combineRows(int64_t lhsMultiplier, ArrayRef<int64_t> lhs,
+                 int64_t rhsMultiplier, ArrayRef<int64_t> rhs,
+                 MutableArrayRef<int64_t> result);
+
+} // end namespace mlir
+
+#endif // MLIR_ANALYSIS_MATRIX_H
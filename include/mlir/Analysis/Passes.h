@@ -38,6 +38,10 @@ FunctionPassBase *createMemRefDependenceCheckPass();
 /// Creates a pass to test parallelism detection; emits note for parallel loops.
 FunctionPassBase *createParallelismDetectionTestPass();
 
+/// Creates a pass to compare the emptiness checks of FlatAffineConstraints on
+/// the constraint systems of memref accesses.
+FunctionPassBase *createEmptinessCheckTestPass();
+
 } // end namespace mlir
 
 #endif // MLIR_ANALYSIS_PASSES_H
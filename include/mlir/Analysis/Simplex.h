@@ -0,0 +1,154 @@
+//===- Simplex.h - Simplex based emptiness checks ---------------*- C++ -*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This header declares a simplex tableau over integer coefficients that
+// decides the emptiness of the integer set of a FlatAffineConstraints.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_ANALYSIS_SIMPLEX_H
+#define MLIR_ANALYSIS_SIMPLEX_H
+
+#include "mlir/Support/LLVM.h"
+#include "llvm/ADT/SmallVector.h"
+#include <vector>
+
+namespace mlir {
+
+class FlatAffineConstraints;
+
+/// A simplex tableau holding the constraints of a FlatAffineConstraints.
+///
+/// Every identifier and every constraint of the system is an unknown of the
+/// tableau. Each unknown is either a column, in which case its value in the
+/// current sample point is zero, or a row, in which case it is an affine
+/// function of the column unknowns:
+///
+///   row = (constant + sum_c coeff_c * column_c) / denominator
+///
+/// with a positive denominator, so that all arithmetic is exact on integers.
+/// The unknowns of the constraints are restricted to be non-negative while the
+/// identifiers are unrestricted. Constraints are added one at a time and the
+/// sample point is immediately moved so that it satisfies them, using pivots
+/// chosen by Bland's rule; if a constraint can't be satisfied, the rational
+/// set, and thus the integer set, is empty.
+///
+/// Some reasoning on integers happens before the tableau is built: the
+/// identifiers with a unit coefficient in an equality are substituted away,
+/// and the constant of every inequality is rounded down to a multiple of the
+/// gcd of its coefficients.
+///
+/// Integer emptiness is decided by branch and bound on the identifiers whose
+/// sample value is fractional. Since the integer set may be unbounded, the
+/// search is cut off after a given number of subproblems. The coefficients of
+/// the tableau are 64-bit integers; if any computation overflows, the result
+/// is unknown rather than wrong.
+class Simplex {
+public:
+  /// The outcome of an emptiness check.
+  enum class Result { Empty, NonEmpty, Unknown };
+
+  /// Builds a tableau holding the constraints of 'cst'.
+  explicit Simplex(const FlatAffineConstraints &cst);
+
+  /// Returns whether the tableau has no rational solution. Thanks to the
+  /// reasoning on integers of the construction, this may also be the case of
+  /// systems that only have rational solutions.
+  Result isRationalEmpty() const;
+
+  /// Returns whether the system has no integer solution, exploring at most
+  /// 'maxNodes' subproblems of the branch and bound search.
+  Result isIntegerEmpty(unsigned maxNodes = kDefaultMaxNodes) const;
+
+  /// The default budget of subproblems of isIntegerEmpty.
+  constexpr static unsigned kDefaultMaxNodes = 256;
+
+private:
+  /// An identifier or a constraint of the system.
+  struct Unknown {
+    /// Whether the unknown is a row of the tableau, or otherwise a column.
+    bool isRow;
+    /// Whether the unknown is restricted to be non-negative.
+    bool restricted;
+    /// The index of the row or the column of the unknown.
+    unsigned pos;
+  };
+
+  /// Add the restricted unknown 'coeffs[0..n-1] * ids + coeffs[n]', where n is
+  /// the number of identifiers, and move the sample point to satisfy it. The
+  /// inequality is tightened on integers first.
+  void addInequality(ArrayRef<int64_t> coeffs);
+
+  /// Move the sample point so that the restricted row 'row' is non-negative,
+  /// keeping the other restricted unknowns non-negative. Returns false if
+  /// this is impossible.
+  bool restoreRow(unsigned row);
+
+  /// Swap the unknowns of row 'row' and column 'col', which must have a
+  /// non-zero coefficient in that row.
+  void pivot(unsigned row, unsigned col);
+
+  /// Divide the row 'row' by the gcd of its entries.
+  void normalizeRow(unsigned row);
+
+  /// Recursive implementation of isIntegerEmpty, decrementing 'budget' for
+  /// every subproblem that gets split.
+  Result branchAndBound(unsigned &budget) const;
+
+  /// Accessors for the entries of a row.
+  int64_t &denominator(unsigned row) { return tableau[row * rowStride]; }
+  int64_t denominator(unsigned row) const { return tableau[row * rowStride]; }
+  int64_t &constant(unsigned row) { return tableau[row * rowStride + 1]; }
+  int64_t constant(unsigned row) const {
+    return tableau[row * rowStride + 1];
+  }
+  int64_t &coefficient(unsigned row, unsigned col) {
+    return tableau[row * rowStride + 2 + col];
+  }
+
+  /// Arithmetic on tableau entries that records overflows.
+  int64_t add(int64_t lhs, int64_t rhs);
+  int64_t mul(int64_t lhs, int64_t rhs);
+
+  /// The number of identifiers of the system, which is also the number of
+  /// columns of the tableau.
+  unsigned numIds;
+
+  /// The number of entries of a row: the denominator, the constant, and one
+  /// coefficient per column.
+  unsigned rowStride;
+
+  /// The rows of the tableau, stored contiguously.
+  std::vector<int64_t> tableau;
+
+  /// The unknowns, starting with the identifiers of the system.
+  SmallVector<Unknown, 16> unknowns;
+
+  /// The unknown of each row and of each column.
+  SmallVector<unsigned, 16> rowUnknown, colUnknown;
+
+  /// Whether the rational set was found to be empty.
+  bool empty = false;
+
+  /// Whether a computation on the tableau overflowed, in which case it no
+  /// longer describes the system.
+  bool overflow = false;
+};
+
+} // end namespace mlir
+
+#endif // MLIR_ANALYSIS_SIMPLEX_H
@@ -35,6 +35,7 @@
 
 namespace mlir {
 
+class AffineDependenceGraph;
 class AffineForOp;
 class Block;
 class FlatAffineConstraints;
@@ -235,8 +236,11 @@ unsigned getNumCommonSurroundingLoops(Operation &A, Operation &B);
 Optional<int64_t> getMemoryFootprintBytes(AffineForOp forOp,
                                           int memorySpace = -1);
 
-/// Returns true if `forOp' is a parallel loop.
-bool isLoopParallel(AffineForOp forOp);
+/// Returns true if `forOp' is a parallel loop. If 'depGraph' is non-null, the
+/// dependences are checked with it so that they may be shared with other
+/// queries.
+bool isLoopParallel(AffineForOp forOp,
+                    AffineDependenceGraph *depGraph = nullptr);
 
 } // end namespace mlir
 
@@ -0,0 +1,95 @@
+//===- Bytecode.h - MLIR binary bytecode format -----------------*- C++ -*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file defines the interface to the binary bytecode format of MLIR
+// modules, a compact alternative to the textual form that is much faster to
+// read. The bytecode holds tables of the strings, types, attributes and
+// locations of a module, which the operations refer to by index. The body of
+// each function is stored separately, so that it can be materialized lazily.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_BYTECODE_BYTECODE_H
+#define MLIR_BYTECODE_BYTECODE_H
+
+#include "mlir/Support/LLVM.h"
+#include "mlir/Support/LogicalResult.h"
+#include <memory>
+
+namespace llvm {
+class MemoryBuffer;
+} // end namespace llvm
+
+namespace mlir {
+class Function;
+class MLIRContext;
+class Module;
+
+namespace detail {
+class BytecodeReaderImpl;
+} // end namespace detail
+
+/// Returns true if the given buffer holds a module in the bytecode format.
+bool isBytecode(StringRef buffer);
+
+/// Write the given module to the given stream in the bytecode format.
+void writeBytecode(Module *module, raw_ostream &os);
+
+/// A reader of modules in the bytecode format. The reader may leave the bodies
+/// of functions unmaterialized until they are requested, in which case it must
+/// outlive the module until all of the needed bodies are materialized.
+class BytecodeReader {
+public:
+  /// Create a reader of the bytecode held in the given buffer. Buffers from
+  /// llvm::MemoryBuffer::getFile are memory mapped, so only the parts of the
+  /// file that are actually used are read from disk.
+  BytecodeReader(std::unique_ptr<llvm::MemoryBuffer> buffer,
+                 MLIRContext *context);
+  ~BytecodeReader();
+
+  /// Read the module held in the buffer. If 'lazy' is set, the functions of
+  /// the module are created without their bodies, which are materialized on
+  /// request. On failure, an error is emitted through the context and null is
+  /// returned.
+  Module *readModule(bool lazy = false);
+
+  /// Returns true if the body of the given function hasn't been materialized
+  /// yet.
+  bool isMaterializable(Function *function);
+
+  /// Materialize the body of the given function if it hasn't been yet.
+  LogicalResult materialize(Function *function);
+
+  /// Materialize the bodies of all of the functions of the module.
+  LogicalResult materializeAll();
+
+private:
+  std::unique_ptr<detail::BytecodeReaderImpl> impl;
+};
+
+/// Read a module in the bytecode format from the given buffer, materializing
+/// all of its functions. On failure, an error is emitted through the context
+/// and null is returned.
+Module *parseBytecode(const llvm::MemoryBuffer &buffer, MLIRContext *context);
+
+/// Read a module in the bytecode format from the given file. On failure, an
+/// error is emitted through the context and null is returned.
+Module *parseBytecodeFile(StringRef filename, MLIRContext *context);
+
+} // end namespace mlir
+
+#endif // MLIR_BYTECODE_BYTECODE_H
@@ -202,6 +202,11 @@ public:
   /// Recomputes the ordering of child operations within the block.
   void recomputeInstOrder();
 
+  /// Assigns an order index to 'op' if it was inserted since the ordering of
+  /// the block was computed, renumbering as few of its neighbors as possible.
+  /// The ordering of the block must be valid.
+  void updateInstOrder(Operation *op);
+
   //===--------------------------------------------------------------------===//
   // Terminator management
   //===--------------------------------------------------------------------===//
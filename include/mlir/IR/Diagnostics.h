@@ -0,0 +1,61 @@
+//===- Diagnostics.h - MLIR Diagnostic Utilities ----------------*- C++ -*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file defines utilities for emitting diagnostics through an MLIRContext.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_IR_DIAGNOSTICS_H
+#define MLIR_IR_DIAGNOSTICS_H
+
+#include "mlir/Support/LLVM.h"
+#include <memory>
+
+namespace mlir {
+class MLIRContext;
+
+namespace detail {
+struct ParallelDiagnosticHandlerImpl;
+} // end namespace detail
+
+/// This class is a utility diagnostic handler for use when multi-threading some
+/// part of the compiler where diagnostics may be emitted. While it is alive,
+/// the diagnostics emitted to the context are held and tagged with an order id
+/// set by the emitting thread, e.g. the position of the function the thread is
+/// processing within its module. When the handler is destroyed, the held
+/// diagnostics are emitted to the previous handler sorted by their order id,
+/// giving the same ordering as a single-threaded execution. If the process
+/// crashes, any held diagnostics are dumped as part of the stack trace.
+class ParallelDiagnosticHandler {
+public:
+  explicit ParallelDiagnosticHandler(MLIRContext &ctx);
+  ~ParallelDiagnosticHandler();
+
+  /// Set the order id for the current thread. Diagnostics emitted on this
+  /// thread are ordered by this id until it is set again.
+  void setOrderIDForThread(size_t orderID);
+
+private:
+  ParallelDiagnosticHandler(const ParallelDiagnosticHandler &) = delete;
+  void operator=(const ParallelDiagnosticHandler &) = delete;
+
+  std::unique_ptr<detail::ParallelDiagnosticHandlerImpl> impl;
+};
+
+} // end namespace mlir
+
+#endif // MLIR_IR_DIAGNOSTICS_H
@@ -19,6 +19,7 @@
 #define MLIR_IR_MLIRCONTEXT_H
 
 #include "mlir/Support/LLVM.h"
+#include "llvm/ADT/StringRef.h"
 #include <functional>
 #include <memory>
 #include <vector>
@@ -28,6 +29,7 @@ class AbstractOperation;
 class MLIRContextImpl;
 class Location;
 class Dialect;
+class FrozenRewritePatternList;
 
 /// MLIRContext is the top-level object for a collection of MLIR modules.  It
 /// holds immortal uniqued objects like types, and the tables used to unique
@@ -54,6 +56,58 @@ public:
   /// directly.
   std::vector<AbstractOperation *> getRegisteredOperations();
 
+  /// Return the canonicalization patterns of all registered operations as a
+  /// frozen pattern list. The list is built lazily on first use and cached
+  /// until a new operation is registered. It is immutable, and may be shared
+  /// between threads.
+  std::shared_ptr<const FrozenRewritePatternList> getCanonicalizationPatterns();
+
+  /// The memory held by one of the allocators backing the uniqued storage of
+  /// this context, e.g. for attributes or types.
+  struct AllocatorMemoryUsage {
+    /// The kind of storage held by the allocator.
+    StringRef name;
+
+    /// The number of bytes held by each of the arenas of the allocator. Most
+    /// allocators have a separate arena for each thread that allocated from it.
+    std::vector<size_t> arenaMemory;
+  };
+
+  /// Return the memory usage of the allocators backing the uniqued storage of
+  /// this context.
+  std::vector<AllocatorMemoryUsage> getAllocatorMemoryUsage();
+
+  /// Statistics about one of the hash tables used to unique storage in this
+  /// context, e.g. for integer attributes or affine maps.
+  struct UniquerStatistics {
+    /// The kind of storage uniqued by the table.
+    StringRef name;
+
+    /// The number of uniqued instances held by the table.
+    size_t numEntries = 0;
+
+    /// The number of buckets allocated by the table.
+    size_t numBuckets = 0;
+
+    /// The number of bytes held by the buckets of the table. This does not
+    /// include the uniqued storage, which is held by the allocators.
+    size_t tableMemory = 0;
+
+    /// Return the fraction of the buckets of the table that are in use.
+    double getLoadFactor() const {
+      return numBuckets ? double(numEntries) / numBuckets : 0.0;
+    }
+  };
+
+  /// Return statistics about the hash tables used to unique storage in this
+  /// context.
+  std::vector<UniquerStatistics> getUniquerStatistics();
+
+  /// Print the memory usage of the allocators backing the uniqued storage of
+  /// this context, along with statistics about the uniquing tables, to the
+  /// given stream.
+  void printMemoryUsage(raw_ostream &os);
+
   /// This is the interpretation of a diagnostic that is emitted to the
   /// diagnostic handler below.
   enum class DiagnosticKind { Note, Warning, Error };
@@ -145,8 +145,9 @@ public:
   /// Given an operation 'other' that is within the same parent block, return
   /// whether the current operation is before 'other' in the operation list
   /// of the parent block.
-  /// Note: This function has an average complexity of O(1), but worst case may
-  /// take O(N) where N is the number of operations within the parent block.
+  /// Note: This function has an amortized complexity of O(1) after insertions
+  /// into the parent block, but worst case may take O(N) where N is the number
+  /// of operations within the parent block.
   bool isBeforeInBlock(Operation *other);
 
   void print(raw_ostream &os);
@@ -457,7 +458,7 @@ private:
             const NamedAttributeList &attributes, MLIRContext *context);
 
   // Operations are deleted through the destroy() member because they are
-  // allocated with malloc.
+  // allocated with malloc or from an OperationArena.
   ~Operation();
 
   /// Returns the operand storage object.
@@ -475,11 +476,23 @@ private:
   /// or derived from.
   Location location;
 
+  /// The order index of an operation that was inserted into a block with a
+  /// valid ordering, until it is assigned one.
+  static const unsigned kInvalidOrderIndex = ~0U;
+
+  /// Returns true if this operation has an order index within its block.
+  bool hasValidOrder() { return orderIndex != kInvalidOrderIndex; }
+
   /// Relative order of this operation in its parent block. Used for
   /// O(1) local dominance checks between operations.
   mutable unsigned orderIndex = 0;
 
-  const unsigned numResults, numSuccs, numRegions;
+  const unsigned numResults, numSuccs;
+  const unsigned numRegions : 31;
+
+  /// True if this operation was allocated from an OperationArena instead of
+  /// with malloc.
+  bool isArenaAllocated : 1;
 
   /// This holds the name of the operation.
   OperationName name;
@@ -0,0 +1,125 @@
+//===- OperationArena.h - Arena allocation for operations -------*- C++ -*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file defines an arena that operations may be allocated from, as an
+// alternative to allocating each operation separately with malloc.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_IR_OPERATIONARENA_H
+#define MLIR_IR_OPERATIONARENA_H
+
+#include "mlir/Support/LLVM.h"
+#include "llvm/Support/Allocator.h"
+
+namespace mlir {
+class Function;
+class Module;
+
+/// An arena that operations are allocated from in slabs, instead of with a
+/// separate malloc for each operation. Allocation from an arena is opt-in: an
+/// OperationArena::Scope makes all operations created on the current thread,
+/// while the scope is active, come from the given arena. The memory of erased
+/// operations is recycled for new operations of a similar size, and the bodies
+/// of functions and modules may be destroyed in bulk with 'destroyBody'.
+///
+/// The arena must outlive all of the operations allocated from it, so it is
+/// typically kept alongside the function or module that holds them. Like the
+/// scope that selects it, an arena has a single owner and isn't thread-safe:
+/// the operations allocated from it must only be created and destroyed by one
+/// thread at a time.
+class OperationArena {
+public:
+  OperationArena() = default;
+  OperationArena(const OperationArena &) = delete;
+  OperationArena &operator=(const OperationArena &) = delete;
+  ~OperationArena();
+
+  /// An RAII object that makes the operations created on the current thread
+  /// allocate from an arena for the duration of its lifetime. Scopes may be
+  /// nested, in which case the innermost one wins.
+  class Scope {
+  public:
+    explicit Scope(OperationArena &arena);
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+    ~Scope();
+
+  private:
+    /// The arena that was active before this scope.
+    OperationArena *previousArena;
+  };
+
+  /// Returns the arena that operations created on the current thread are
+  /// allocated from, or null if operations are allocated with malloc.
+  static OperationArena *getCurrentArena();
+
+  /// Allocate a block of memory of the given size, suitably aligned for an
+  /// operation.
+  void *allocate(size_t size);
+
+  /// Return the given block of memory, previously returned by 'allocate' on
+  /// any arena, to the arena it was allocated from.
+  static void deallocate(void *ptr);
+
+  /// Destroy all of the operations in the body of the given function, or of
+  /// the functions of the given module, leaving them external. The uses of the
+  /// operations are dropped and their destructors run, but the memory of the
+  /// ones allocated from this arena isn't recycled one operation at a time.
+  /// Instead, the slabs of the arena are released at once if no operation
+  /// allocated from it remains alive elsewhere, and kept until the arena is
+  /// destroyed otherwise.
+  void destroyBody(Function &function);
+  void destroyBody(Module &module);
+
+  /// Returns the number of allocations that have not been deallocated.
+  size_t getNumLiveAllocations() const { return numLiveAllocations; }
+
+  /// Returns the total number of bytes held by the arena.
+  size_t getTotalMemory() const { return allocator.getTotalMemory(); }
+
+private:
+  /// Allocations up to kMaxSmallSize bytes are rounded up to a multiple of
+  /// kSmallSizeGranularity, and larger ones to a power of two. Each of the
+  /// resulting sizes has a separate size class.
+  static constexpr size_t kSmallSizeGranularity = 16;
+  static constexpr size_t kMaxSmallSize = 1024;
+  static constexpr size_t kNumSmallSizeClasses =
+      kMaxSmallSize / kSmallSizeGranularity + 1;
+  static constexpr size_t kNumSizeClasses = kNumSmallSizeClasses + 64;
+
+  /// Release the slabs of the arena, after a bulk destruction, if no operation
+  /// allocated from it remains alive.
+  void releaseIfEmpty();
+
+  /// The slabs that memory is allocated from.
+  llvm::BumpPtrAllocator allocator;
+
+  /// The heads of the intrusive lists of deallocated blocks of each size class.
+  void *freeLists[kNumSizeClasses] = {};
+
+  /// The number of allocations that have not been deallocated.
+  size_t numLiveAllocations = 0;
+
+  /// True while operations are destroyed in bulk, in which case their memory
+  /// isn't put on the free lists.
+  bool destroyingInBulk = false;
+};
+
+} // end namespace mlir
+
+#endif // MLIR_IR_OPERATIONARENA_H
@@ -19,9 +19,11 @@
 #define MLIR_PATTERNMATCHER_H
 
 #include "mlir/IR/Builders.h"
+#include "llvm/ADT/DenseMap.h"
 
 namespace mlir {
 
+class Module;
 class PatternRewriter;
 
 //===----------------------------------------------------------------------===//
@@ -84,6 +86,11 @@ using PatternMatchResult = Optional<std::unique_ptr<PatternState>>;
 // Pattern class
 //===----------------------------------------------------------------------===//
 
+/// This class acts as a special tag that makes the desire to match "any"
+/// operation type explicit. This helps to avoid unnecessary usages of this
+/// feature, and ensures that the user is making a conscious decision.
+struct MatchAnyOpTypeTag {};
+
 /// Instances of Pattern can be matched against SSA IR.  These matches get used
 /// in ways dependent on their subclasses and the driver doing the matching.
 /// For example, RewritePatterns implement a rewrite from one matched pattern
@@ -98,8 +105,9 @@ public:
   PatternBenefit getBenefit() const { return benefit; }
 
   /// Return the root node that this pattern matches.  Patterns that can
-  /// match multiple root types are instantiated once per root.
-  OperationName getRootKind() const { return rootKind; }
+  /// match multiple root types are either instantiated once per root, or are
+  /// root-agnostic (see MatchAnyOpTypeTag) in which case this returns None.
+  Optional<OperationName> getRootKind() const { return rootKind; }
 
   //===--------------------------------------------------------------------===//
   // Implementation hooks for patterns to implement.
@@ -131,8 +139,14 @@ protected:
   /// also specify the benefit of the pattern matching.
   Pattern(StringRef rootName, PatternBenefit benefit, MLIRContext *context);
 
+  /// Construct a pattern that may match any operation type. The tag is used
+  /// to make the intent of matching against any root explicit.
+  Pattern(PatternBenefit benefit, MatchAnyOpTypeTag);
+
 private:
-  const OperationName rootKind;
+  /// The root operation of the pattern, or None if the pattern matches any
+  /// operation.
+  const Optional<OperationName> rootKind;
   const PatternBenefit benefit;
 
   virtual void anchor();
@@ -190,6 +204,10 @@ protected:
   RewritePattern(StringRef rootName, PatternBenefit benefit,
                  MLIRContext *context)
       : Pattern(rootName, benefit, context) {}
+
+  /// Construct a rewrite pattern that may match any operation type.
+  RewritePattern(PatternBenefit benefit, MatchAnyOpTypeTag tag)
+      : Pattern(benefit, tag) {}
 };
 
 //===----------------------------------------------------------------------===//
@@ -320,10 +338,45 @@ private:
 /// This is a vector that owns the patterns inside of it.
 using OwningRewritePatternList = std::vector<std::unique_ptr<RewritePattern>>;
 
+/// This class holds an immutable set of rewrite patterns, organized into a
+/// dispatch table keyed by the root operation name. Once constructed, the list
+/// may be shared between any number of pattern matchers, including matchers
+/// running concurrently on different threads.
+class FrozenRewritePatternList {
+public:
+  /// Freeze the given set of patterns, taking ownership of them.
+  explicit FrozenRewritePatternList(OwningRewritePatternList &&patterns);
+
+  /// Return the patterns that may apply to an operation of the given kind:
+  /// those rooted at the kind merged with the root-agnostic patterns, sorted
+  /// by decreasing benefit.
+  ArrayRef<RewritePattern *> getMatchingPatterns(OperationName opName) const;
+
+  /// Return the total number of patterns held by this list.
+  size_t size() const { return patterns.size(); }
+
+private:
+  FrozenRewritePatternList(const FrozenRewritePatternList &) = delete;
+  void operator=(const FrozenRewritePatternList &) = delete;
+
+  /// The patterns owned by this list, sorted by decreasing benefit.
+  OwningRewritePatternList patterns;
+
+  /// The dispatch table from root operation name to applicable patterns.
+  DenseMap<OperationName, SmallVector<RewritePattern *, 4>> opPatterns;
+
+  /// The patterns that may match any operation, sorted by decreasing benefit.
+  SmallVector<RewritePattern *, 4> anyOpPatterns;
+};
+
 /// This class manages optimization and execution of a group of rewrite
 /// patterns, providing an API for finding and applying, the best match against
 /// a given node.
 ///
+/// The patterns are organized into a dispatch table keyed by the root
+/// operation name, so that matching an operation only considers the patterns
+/// that may apply to it: those rooted at the operation kind, merged with any
+/// root-agnostic patterns.
 class RewritePatternMatcher {
 public:
   /// Create a RewritePatternMatcher with the specified set of patterns and
@@ -331,8 +384,32 @@ public:
   explicit RewritePatternMatcher(OwningRewritePatternList &&patterns,
                                  PatternRewriter &rewriter);
 
-  /// Try to match the given operation to a pattern and rewrite it.
-  void matchAndRewrite(Operation *op);
+  /// Create a RewritePatternMatcher that applies patterns from the given
+  /// frozen pattern list, which may be shared with other matchers.
+  explicit RewritePatternMatcher(
+      std::shared_ptr<const FrozenRewritePatternList> patterns,
+      PatternRewriter &rewriter);
+
+  /// Try to match the given operation to a pattern and rewrite it. Returns
+  /// true if a pattern was successfully applied.
+  bool matchAndRewrite(Operation *op);
+
+  /// Statistics collected for the patterns applied to a single operation kind.
+  struct OpStatistics {
+    /// The number of pattern match attempts on operations of this kind.
+    unsigned numPatternsTried = 0;
+
+    /// The number of pattern applications that succeeded on operations of
+    /// this kind.
+    unsigned numPatternsSucceeded = 0;
+  };
+
+  /// Return the statistics collected for the given operation kind.
+  OpStatistics getStatistics(OperationName opName) const;
+
+  /// Print the statistics for every operation kind that this matcher attempted
+  /// to match, sorted by operation name.
+  void printStatistics(raw_ostream &os) const;
 
 private:
   RewritePatternMatcher(const RewritePatternMatcher &) = delete;
@@ -340,7 +417,11 @@ private:
 
   /// The group of patterns that are matched for optimization through this
   /// matcher.
-  OwningRewritePatternList patterns;
+  std::shared_ptr<const FrozenRewritePatternList> patterns;
+
+  /// The statistics collected by this matcher, keyed by operation kind. These
+  /// are kept per matcher so that the pattern list itself stays immutable.
+  DenseMap<OperationName, OpStatistics> opStatistics;
 
   /// The rewriter used when applying matched patterns.
   PatternRewriter &rewriter;
@@ -351,6 +432,40 @@ private:
 ///
 void applyPatternsGreedily(Function &fn, OwningRewritePatternList &&patterns);
 
+/// The result of greedily applying patterns to a function or module.
+struct GreedyRewriteResult {
+  /// Returns true if the rewrite converged for every function, i.e. no more
+  /// patterns applied before the iteration limit was reached.
+  bool converged() const { return nonConvergedFunctions.empty(); }
+
+  /// The total number of operations processed from the worklists.
+  unsigned numIterations = 0;
+
+  /// The functions for which the iteration limit was reached before the
+  /// rewrite converged, in the order they appear within their module.
+  std::vector<Function *> nonConvergedFunctions;
+};
+
+/// Rewrite the specified function by greedily applying the patterns from the
+/// given frozen pattern list. The list is not modified, and may be shared
+/// between concurrent invocations. At most 'maxIterations' operations are
+/// processed from the worklist, or an unlimited number if it is zero.
+GreedyRewriteResult
+applyPatternsGreedily(Function &fn,
+                      std::shared_ptr<const FrozenRewritePatternList> patterns,
+                      unsigned maxIterations = 0);
+
+/// Rewrite all of the non-external functions within the specified module by
+/// greedily applying the patterns from the given frozen pattern list. The
+/// functions are rewritten in parallel, and any diagnostics emitted are
+/// reported in the order of the functions within the module. At most
+/// 'maxIterations' operations are processed for each function, or an unlimited
+/// number if it is zero.
+GreedyRewriteResult
+applyPatternsGreedily(Module &module,
+                      std::shared_ptr<const FrozenRewritePatternList> patterns,
+                      unsigned maxIterations = 0);
+
 } // end namespace mlir
 
 #endif // MLIR_PATTERN_MATCH_H
@@ -138,6 +138,9 @@ public:
     return allocator.Allocate(size, alignment);
   }
 
+  /// Return the total number of bytes held by this allocator.
+  size_t getTotalMemory() const { return allocator.getTotalMemory(); }
+
 private:
   /// The raw allocator for type storage objects.
   llvm::BumpPtrAllocator allocator;
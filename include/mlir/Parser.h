@@ -29,8 +29,10 @@ class StringRef;
 } // end namespace llvm
 
 namespace mlir {
+class Attribute;
 class Module;
 class MLIRContext;
+class Type;
 
 /// This parses the file specified by the indicated SourceMgr and returns an
 /// MLIR module if it was valid.  If not, the error message is emitted through
@@ -47,6 +49,17 @@ Module *parseSourceFile(llvm::StringRef filename, MLIRContext *context);
 /// context, and a null pointer is returned.
 Module *parseSourceString(llvm::StringRef moduleStr, MLIRContext *context);
 
+/// This parses a single type from the given string. If the string isn't a
+/// valid type, an error is emitted through the context and a null type is
+/// returned.
+Type parseType(llvm::StringRef typeStr, MLIRContext *context);
+
+/// This parses a single attribute from the given string. If the string isn't a
+/// valid attribute, an error is emitted through the context and a null
+/// attribute is returned. Function references can't be resolved outside of a
+/// module, and are reported as errors.
+Attribute parseAttribute(llvm::StringRef attrStr, MLIRContext *context);
+
 } // end namespace mlir
 
 #endif // MLIR_PARSER_H
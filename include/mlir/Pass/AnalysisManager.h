@@ -22,8 +22,10 @@
 #include "mlir/Pass/PassInstrumentation.h"
 #include "mlir/Support/LLVM.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Support/TypeName.h"
+#include <atomic>
 
 namespace mlir {
 /// A special type used by analyses to provide an address that identifies a
@@ -35,6 +37,48 @@ struct AnalysisID {
   }
 };
 
+/// A utility class used by analyses to declare the other analyses that they
+/// depend upon. An analysis declares its dependencies by providing a static
+/// method:
+///
+///   static void getDependentAnalyses(AnalysisDependencies &deps) {
+///     deps.add<DominanceInfo>();
+///   }
+///
+/// A cached analysis is invalidated whenever any of its cached dependencies is
+/// invalidated, even if the analysis itself was marked as preserved. A
+/// dependency that isn't cached, e.g. because it was never computed, is
+/// considered valid: an analysis that computes a dependency without querying
+/// the analysis manager must not be marked as preserved when it is stale.
+class AnalysisDependencies {
+public:
+  /// Add the given analyses as dependencies.
+  template <typename... AnalysesT> void add() {
+    using expander = int[];
+    (void)expander{0, (ids.push_back(AnalysisID::getID<AnalysesT>()), 0)...};
+  }
+
+  /// Returns the identifiers of the dependencies.
+  ArrayRef<const AnalysisID *> getIDs() const { return ids; }
+
+private:
+  SmallVector<const AnalysisID *, 2> ids;
+};
+
+/// Counters for the analysis queries and invalidations of an analysis manager,
+/// including the analysis managers of its functions. The counters may be
+/// updated concurrently by function pipelines running on different threads.
+struct AnalysisStatistics {
+  /// The number of analysis queries that were served from the cache.
+  std::atomic<unsigned> numHits{0};
+
+  /// The number of analysis queries that computed the analysis.
+  std::atomic<unsigned> numMisses{0};
+
+  /// The number of cached analyses that were invalidated.
+  std::atomic<unsigned> numInvalidations{0};
+};
+
 //===----------------------------------------------------------------------===//
 // Analysis Preservation and Concept Modeling
 //===----------------------------------------------------------------------===//
@@ -84,13 +128,28 @@ private:
 /// The abstract polymorphic base class representing an analysis.
 struct AnalysisConcept {
   virtual ~AnalysisConcept() = default;
+
+  /// The analyses that this analysis depends upon.
+  AnalysisDependencies dependencies;
 };
 
+/// Utility to collect the dependencies of an analysis that provides a
+/// 'getDependentAnalyses' method.
+template <typename AnalysisT>
+auto getAnalysisDependencies(AnalysisDependencies &deps, int)
+    -> decltype(AnalysisT::getDependentAnalyses(deps)) {
+  return AnalysisT::getDependentAnalyses(deps);
+}
+template <typename AnalysisT>
+void getAnalysisDependencies(AnalysisDependencies &deps, long) {}
+
 /// A derived analysis model used to hold a specific analysis object.
 template <typename AnalysisT> struct AnalysisModel : public AnalysisConcept {
   template <typename... Args>
   explicit AnalysisModel(Args &&... args)
-      : analysis(std::forward<Args>(args)...) {}
+      : analysis(std::forward<Args>(args)...) {
+    getAnalysisDependencies<AnalysisT>(dependencies, 0);
+  }
 
   AnalysisT analysis;
 };
@@ -111,7 +170,7 @@ template <typename IRUnitT> class AnalysisMap {
   }
 
 public:
-  explicit AnalysisMap(IRUnitT *ir) : ir(ir) {}
+  AnalysisMap(IRUnitT *ir, AnalysisStatistics &stats) : ir(ir), stats(&stats) {}
 
   /// Get an analysis for the current IR unit, computing it if necessary.
   template <typename AnalysisT> AnalysisT &getAnalysis(PassInstrumentor *pi) {
@@ -124,6 +183,7 @@ public:
     // If we don't have a cached analysis for this function, compute it directly
     // and add it to the cache.
     if (wasInserted) {
+      ++stats->numMisses;
       if (pi)
         pi->runBeforeAnalysis(getAnalysisName<AnalysisT>(), id, ir);
 
@@ -131,6 +191,8 @@ public:
 
       if (pi)
         pi->runAfterAnalysis(getAnalysisName<AnalysisT>(), id, ir);
+    } else {
+      ++stats->numHits;
     }
     return static_cast<AnalysisModel<AnalysisT> &>(*it->second).analysis;
   }
@@ -148,23 +210,52 @@ public:
   IRUnitT *getIRUnit() { return ir; }
   const IRUnitT *getIRUnit() const { return ir; }
 
+  /// Returns the number of cached analyses.
+  size_t size() const { return analyses.size(); }
+
   /// Clear any held analyses.
   void clear() { analyses.clear(); }
 
   /// Invalidate any cached analyses based upon the given set of preserved
-  /// analyses.
+  /// analyses. Analyses that depend upon an invalidated analysis are also
+  /// invalidated.
   void invalidate(const detail::PreservedAnalyses &pa) {
     // Remove any analyses not marked as preserved.
+    unsigned numAnalyses = analyses.size();
+    SmallPtrSet<const AnalysisID *, 4> erasedIDs;
     for (auto it = analyses.begin(), e = analyses.end(); it != e;) {
       auto curIt = it++;
-      if (!pa.isPreserved(curIt->first))
+      if (pa.isPreserved(curIt->first))
+        continue;
+      erasedIDs.insert(curIt->first);
+      analyses.erase(curIt);
+    }
+
+    // Remove any analyses with a dependency that was removed, until no more
+    // analyses are removed.
+    for (bool changed = !erasedIDs.empty(); changed;) {
+      changed = false;
+      for (auto it = analyses.begin(), e = analyses.end(); it != e;) {
+        auto curIt = it++;
+        auto deps = curIt->second->dependencies.getIDs();
+        if (llvm::none_of(deps, [&](const AnalysisID *id) {
+              return erasedIDs.count(id);
+            }))
+          continue;
+        erasedIDs.insert(curIt->first);
         analyses.erase(curIt);
+        changed = true;
+      }
     }
+    stats->numInvalidations += numAnalyses - analyses.size();
   }
 
 private:
   IRUnitT *ir;
   ConceptMap analyses;
+
+  /// The statistics of the owning analysis manager.
+  AnalysisStatistics *stats;
 };
 
 } // namespace detail
@@ -229,7 +320,7 @@ private:
 class ModuleAnalysisManager {
 public:
   ModuleAnalysisManager(Module *module, PassInstrumentor *passInstrumentor)
-      : moduleAnalyses(module), passInstrumentor(passInstrumentor) {}
+      : moduleAnalyses(module, stats), passInstrumentor(passInstrumentor) {}
   ModuleAnalysisManager(const ModuleAnalysisManager &) = delete;
   ModuleAnalysisManager &operator=(const ModuleAnalysisManager &) = delete;
 
@@ -265,14 +356,25 @@ public:
   /// Create an analysis slice for the given child function.
   FunctionAnalysisManager slice(Function *function);
 
-  /// Invalidate any non preserved analyses.
-  void invalidate(const detail::PreservedAnalyses &pa);
+  /// Invalidate any non preserved analyses. If 'changedFunctions' is provided,
+  /// only the analyses of the given functions, and of the module, are
+  /// invalidated. Otherwise, the analyses of all functions are invalidated.
+  void invalidate(const detail::PreservedAnalyses &pa,
+                  const SmallPtrSetImpl<Function *> *changedFunctions =
+                      nullptr);
 
   /// Returns a pass instrumentation object for the current module. This value
   /// may be null.
   PassInstrumentor *getPassInstrumentor() const { return passInstrumentor; }
 
+  /// Returns the query and invalidation counters of this analysis manager.
+  const AnalysisStatistics &getStatistics() const { return stats; }
+
 private:
+  /// The query and invalidation counters of this analysis manager, shared with
+  /// the analysis maps of the module and its functions.
+  AnalysisStatistics stats;
+
   /// The cached analyses for functions within the current module.
   llvm::DenseMap<Function *, detail::AnalysisMap<Function>> functionAnalyses;
 
@@ -82,6 +82,10 @@ struct PassExecutionState {
 
   /// The set of preserved analyses for the current execution.
   detail::PreservedAnalyses preservedAnalyses;
+
+  /// The set of functions changed by the current execution of a module pass, or
+  /// None if the pass did not report the functions that it changed.
+  llvm::Optional<llvm::SmallPtrSet<Function *, 4>> changedFunctions;
 };
 } // namespace detail
 
@@ -284,6 +288,23 @@ struct ModulePass : public detail::PassModel<Module, T, ModulePassBase> {
     return this->getAnalysisManager()
         .template getCachedFunctionAnalysis<AnalysisT>(f);
   }
+
+  /// Mark the given function as changed by this pass. Once a pass reports the
+  /// functions that it changed, the analyses of all other functions are kept,
+  /// regardless of the analyses marked as preserved.
+  void markFunctionChanged(Function *f) {
+    markAllFunctionsUnchanged();
+    this->getPassState().changedFunctions->insert(f);
+  }
+
+  /// Mark that this pass did not change any function, beyond those marked with
+  /// 'markFunctionChanged'. The analyses of the module are still invalidated
+  /// based upon the analyses marked as preserved.
+  void markAllFunctionsUnchanged() {
+    auto &changedFunctions = this->getPassState().changedFunctions;
+    if (!changedFunctions)
+      changedFunctions.emplace();
+  }
 };
 } // end namespace mlir
 
@@ -36,6 +36,7 @@ class PassInstrumentor;
 namespace detail {
 class PassExecutor;
 class ModulePassExecutor;
+class WorkStealingExecutor;
 } // end namespace detail
 
 /// An enum describing the different display modes for the pass timing
@@ -49,6 +50,11 @@ enum class PassTimingDisplayMode {
   // mirrors the internal pass pipeline that is being executed in the pass
   // manager.
   Pipeline,
+
+  // In this mode the results are exported as a JSON document in the Chrome
+  // trace-event format, with an event for each execution of a pass or analysis
+  // on an IR unit, on the thread that executed it.
+  ChromeTrace,
 };
 
 /// The main pass manager and pipeline builder.
@@ -79,6 +85,17 @@ public:
   /// executor if necessary.
   void addPass(FunctionPassBase *pass);
 
+  //===--------------------------------------------------------------------===//
+  // Multithreading
+  //===--------------------------------------------------------------------===//
+
+  /// Set the number of threads used to run function pipelines in parallel,
+  /// when multithreading is enabled. If 'numThreads' is zero, the hardware
+  /// concurrency of the host is used. The functions of a module are dispatched
+  /// onto the threads largest first, and idle threads steal the remaining
+  /// functions of the busy ones.
+  void setNumThreads(unsigned numThreads);
+
   //===--------------------------------------------------------------------===//
   // Instrumentations
   //===--------------------------------------------------------------------===//
@@ -113,6 +130,9 @@ private:
   /// The top level module pass executor.
   std::unique_ptr<detail::ModulePassExecutor> mpe;
 
+  /// The executor used to run function pipelines across multiple threads.
+  std::unique_ptr<detail::WorkStealingExecutor> threadExecutor;
+
   /// Flag that specifies if the IR should be verified after each pass has run.
   bool verifyPasses : 1;
 
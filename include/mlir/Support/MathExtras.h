@@ -24,6 +24,7 @@
 
 #include "mlir/Support/LLVM.h"
 #include "llvm/ADT/APInt.h"
+#include "llvm/Support/MathExtras.h"
 
 namespace mlir {
 
@@ -52,6 +53,26 @@ inline int64_t mod(int64_t lhs, int64_t rhs) {
   return lhs % rhs < 0 ? lhs % rhs + rhs : lhs % rhs;
 }
 
+/// Sets 'result' to 'lhs + rhs', returning true if this overflows.
+inline bool addOverflow(int64_t lhs, int64_t rhs, int64_t &result) {
+#if __has_builtin(__builtin_add_overflow)
+  return __builtin_add_overflow(lhs, rhs, &result);
+#else
+  return llvm::AddOverflow(lhs, rhs, result);
+#endif
+}
+
+/// Sets 'result' to 'lhs * rhs', returning true if this overflows. Unlike
+/// llvm::MulOverflow, this doesn't divide when the compiler has a builtin,
+/// which keeps checked arithmetic cheap enough for inner loops.
+inline bool mulOverflow(int64_t lhs, int64_t rhs, int64_t &result) {
+#if __has_builtin(__builtin_mul_overflow)
+  return __builtin_mul_overflow(lhs, rhs, &result);
+#else
+  return llvm::MulOverflow(lhs, rhs, result);
+#endif
+}
+
 /// Returns the least common multiple of 'a' and 'b'.
 inline int64_t lcm(int64_t a, int64_t b) {
   uint64_t x = std::abs(a);
@@ -42,6 +42,9 @@ FunctionPassBase *createCanonicalizerPass();
 /// Creates a pass to perform common sub expression elimination.
 FunctionPassBase *createCSEPass();
 
+/// Creates a pass to hoist loop invariant operations out of affine.for loops.
+FunctionPassBase *createLoopInvariantCodeMotionPass();
+
 /// Creates a pass to vectorize loops, operations and data types using a
 /// target-independent, n-D super-vector abstraction.
 FunctionPassBase *
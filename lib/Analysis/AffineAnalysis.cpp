@@ -32,8 +32,12 @@
 #include "mlir/Support/MathExtras.h"
 #include "mlir/Support/STLExtras.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Parallel.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
+#include <atomic>
 
 #define DEBUG_TYPE "affine-analysis"
 
@@ -677,6 +681,71 @@ void MemRefAccess::getAccessMap(AffineValueMap *accessMap) const {
   accessMap->reset(map, operands);
 }
 
+// Checks for a dependence between 'srcAccess' and 'dstAccess' at 'loopDepth',
+// given their composed access functions and iteration domains. This is the
+// part of the dependence check that is specific to the pair of accesses.
+static bool checkAccessDependence(
+    const MemRefAccess &srcAccess, const AffineValueMap &srcAccessMap,
+    const FlatAffineConstraints &srcDomain, const MemRefAccess &dstAccess,
+    const AffineValueMap &dstAccessMap, const FlatAffineConstraints &dstDomain,
+    unsigned loopDepth, FlatAffineConstraints *dependenceConstraints,
+    llvm::SmallVector<DependenceComponent, 2> *dependenceComponents,
+    bool allowRAR) {
+  // Return 'false' if loopDepth > numCommonLoops and if the ancestor operation
+  // operation of 'srcAccess' does not properly dominate the ancestor
+  // operation of 'dstAccess' in the same common operation block.
+  // Note: this check is skipped if 'allowRAR' is true, because because RAR
+  // deps can exist irrespective of lexicographic ordering b/w src and dst.
+  unsigned numCommonLoops = getNumCommonLoops(srcDomain, dstDomain);
+  assert(loopDepth <= numCommonLoops + 1);
+  if (!allowRAR && loopDepth > numCommonLoops &&
+      !srcAppearsBeforeDstInAncestralBlock(srcAccess, dstAccess, srcDomain,
+                                           numCommonLoops)) {
+    return false;
+  }
+  // Build dim and symbol position maps for each access from access operand
+  // Value to position in merged contstraint system.
+  ValuePositionMap valuePosMap;
+  buildDimAndSymbolPositionMaps(srcDomain, dstDomain, srcAccessMap,
+                                dstAccessMap, &valuePosMap,
+                                dependenceConstraints);
+
+  initDependenceConstraints(srcDomain, dstDomain, srcAccessMap, dstAccessMap,
+                            valuePosMap, dependenceConstraints);
+
+  assert(valuePosMap.getNumDims() ==
+         srcDomain.getNumDimIds() + dstDomain.getNumDimIds());
+
+  // Create memref access constraint by equating src/dst access functions.
+  // Note that this check is conservative, and will fail in the future when
+  // local variables for mod/div exprs are supported.
+  if (failed(addMemRefAccessConstraints(srcAccessMap, dstAccessMap, valuePosMap,
+                                        dependenceConstraints)))
+    return true;
+
+  // Add 'src' happens before 'dst' ordering constraints.
+  addOrderingConstraints(srcDomain, dstDomain, loopDepth,
+                         dependenceConstraints);
+  // Add src and dst domain constraints.
+  addDomainConstraints(srcDomain, dstDomain, valuePosMap,
+                       dependenceConstraints);
+
+  // Return false if the solution space is empty: no dependence.
+  if (dependenceConstraints->isEmpty()) {
+    return false;
+  }
+
+  // Compute dependence direction vector and return true.
+  if (dependenceComponents != nullptr) {
+    computeDirectionVector(srcDomain, dstDomain, loopDepth,
+                           dependenceConstraints, dependenceComponents);
+  }
+
+  LLVM_DEBUG(llvm::dbgs() << "Dependence polyhedron:\n");
+  LLVM_DEBUG(dependenceConstraints->dump());
+  return true;
+}
+
 // Builds a flat affine constraint system to check if there exists a dependence
 // between memref accesses 'srcAccess' and 'dstAccess'.
 // Returns 'false' if the accesses can be definitively shown not to access the
@@ -798,57 +867,319 @@ bool mlir::checkMemrefAccessDependence(
   if (failed(getInstIndexSet(dstAccess.opInst, &dstDomain)))
     return false;
 
-  // Return 'false' if loopDepth > numCommonLoops and if the ancestor operation
-  // operation of 'srcAccess' does not properly dominate the ancestor
-  // operation of 'dstAccess' in the same common operation block.
-  // Note: this check is skipped if 'allowRAR' is true, because because RAR
-  // deps can exist irrespective of lexicographic ordering b/w src and dst.
-  unsigned numCommonLoops = getNumCommonLoops(srcDomain, dstDomain);
-  assert(loopDepth <= numCommonLoops + 1);
-  if (!allowRAR && loopDepth > numCommonLoops &&
-      !srcAppearsBeforeDstInAncestralBlock(srcAccess, dstAccess, srcDomain,
-                                           numCommonLoops)) {
-    return false;
+  return checkAccessDependence(srcAccess, srcAccessMap, srcDomain, dstAccess,
+                               dstAccessMap, dstDomain, loopDepth,
+                               dependenceConstraints, dependenceComponents,
+                               allowRAR);
+}
+
+//===----------------------------------------------------------------------===//
+// AffineDependenceGraph
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// A closed interval [lb, ub] of int64_t values.
+using ConstantRange = std::pair<int64_t, int64_t>;
+} // end anonymous namespace
+
+// Returns the constant range of the values 'value' may take: the iteration
+// range of a loop IV with constant bounds or a constant index. Returns None
+// otherwise.
+static Optional<ConstantRange> getConstantRange(Value *value) {
+  if (auto forOp = getForInductionVarOwner(value)) {
+    if (!forOp.hasConstantBounds())
+      return llvm::None;
+    int64_t lb = forOp.getConstantLowerBound();
+    int64_t ub = forOp.getConstantUpperBound();
+    // Leave empty loops to the polyhedral test.
+    if (ub <= lb)
+      return llvm::None;
+    return ConstantRange(lb, ub - 1);
   }
-  // Build dim and symbol position maps for each access from access operand
-  // Value to position in merged contstraint system.
-  ValuePositionMap valuePosMap;
-  buildDimAndSymbolPositionMaps(srcDomain, dstDomain, srcAccessMap,
-                                dstAccessMap, &valuePosMap,
-                                dependenceConstraints);
+  if (auto *op = value->getDefiningOp())
+    if (auto constOp = op->dyn_cast<ConstantIndexOp>())
+      return ConstantRange(constOp.getValue(), constOp.getValue());
+  return llvm::None;
+}
 
-  initDependenceConstraints(srcDomain, dstDomain, srcAccessMap, dstAccessMap,
-                            valuePosMap, dependenceConstraints);
+// Returns a constant range containing the values of 'expr' when its operands
+// range over 'operandRanges' (dims followed by symbols). Returns None if
+// such a range can't be computed with interval arithmetic without overflow.
+static Optional<ConstantRange>
+getConstantRange(AffineExpr expr,
+                 ArrayRef<Optional<ConstantRange>> operandRanges,
+                 unsigned numDims) {
+  switch (expr.getKind()) {
+  case AffineExprKind::Constant: {
+    int64_t value = expr.cast<AffineConstantExpr>().getValue();
+    return ConstantRange(value, value);
+  }
+  case AffineExprKind::DimId:
+    return operandRanges[expr.cast<AffineDimExpr>().getPosition()];
+  case AffineExprKind::SymbolId:
+    return operandRanges[numDims +
+                         expr.cast<AffineSymbolExpr>().getPosition()];
+  default:
+    break;
+  }
 
-  assert(valuePosMap.getNumDims() ==
-         srcDomain.getNumDimIds() + dstDomain.getNumDimIds());
+  auto binExpr = expr.cast<AffineBinaryOpExpr>();
+  auto lhs = getConstantRange(binExpr.getLHS(), operandRanges, numDims);
+  auto rhs = getConstantRange(binExpr.getRHS(), operandRanges, numDims);
+  if (!lhs || !rhs)
+    return llvm::None;
+  int64_t lhsLb = lhs->first, lhsUb = lhs->second;
+  int64_t rhsLb = rhs->first, rhsUb = rhs->second;
+
+  switch (expr.getKind()) {
+  case AffineExprKind::Add: {
+    int64_t lb, ub;
+    if (addOverflow(lhsLb, rhsLb, lb) || addOverflow(lhsUb, rhsUb, ub))
+      return llvm::None;
+    return ConstantRange(lb, ub);
+  }
+  case AffineExprKind::Mul: {
+    int64_t products[4];
+    if (mulOverflow(lhsLb, rhsLb, products[0]) ||
+        mulOverflow(lhsLb, rhsUb, products[1]) ||
+        mulOverflow(lhsUb, rhsLb, products[2]) ||
+        mulOverflow(lhsUb, rhsUb, products[3]))
+      return llvm::None;
+    return ConstantRange(*std::min_element(products, products + 4),
+                         *std::max_element(products, products + 4));
+  }
+  default:
+    break;
+  }
 
-  // Create memref access constraint by equating src/dst access functions.
-  // Note that this check is conservative, and will fail in the future when
-  // local variables for mod/div exprs are supported.
-  if (failed(addMemRefAccessConstraints(srcAccessMap, dstAccessMap, valuePosMap,
-                                        dependenceConstraints)))
-    return true;
+  // The remaining expressions are only handled with a positive constant
+  // divisor, for which floordiv and ceildiv are non-decreasing.
+  if (rhsLb != rhsUb || rhsLb <= 0)
+    return llvm::None;
+  switch (expr.getKind()) {
+  case AffineExprKind::FloorDiv:
+    return ConstantRange(floorDiv(lhsLb, rhsLb), floorDiv(lhsUb, rhsLb));
+  case AffineExprKind::CeilDiv:
+    return ConstantRange(ceilDiv(lhsLb, rhsLb), ceilDiv(lhsUb, rhsLb));
+  case AffineExprKind::Mod:
+    return ConstantRange(0, rhsLb - 1);
+  default:
+    llvm_unreachable("unexpected affine expression kind");
+  }
+}
 
-  // Add 'src' happens before 'dst' ordering constraints.
-  addOrderingConstraints(srcDomain, dstDomain, loopDepth,
-                         dependenceConstraints);
-  // Add src and dst domain constraints.
-  addDomainConstraints(srcDomain, dstDomain, valuePosMap,
-                       dependenceConstraints);
+/// The information about a memref access that doesn't depend on the access it
+/// is checked against.
+struct AffineDependenceGraph::AccessInfo {
+  explicit AccessInfo(Operation *op) : access(op) {
+    access.getAccessMap(&accessMap);
+    hasDomain = succeeded(getInstIndexSet(op, &domain));
+
+    // Bound each subscript by interval arithmetic over the loop ranges.
+    SmallVector<Optional<ConstantRange>, 8> operandRanges;
+    for (auto *operand : accessMap.getOperands())
+      operandRanges.push_back(getConstantRange(operand));
+    AffineMap map = accessMap.getAffineMap();
+    for (auto result : map.getResults())
+      boundingBox.push_back(
+          getConstantRange(result, operandRanges, map.getNumDims()));
+  }
 
-  // Return false if the solution space is empty: no dependence.
-  if (dependenceConstraints->isEmpty()) {
+  MemRefAccess access;
+  /// The composed access function.
+  AffineValueMap accessMap;
+  /// The iteration domain, which is only valid if 'hasDomain' is true.
+  FlatAffineConstraints domain;
+  bool hasDomain;
+  /// A range for each subscript of the access, if it has a constant one.
+  SmallVector<Optional<ConstantRange>, 4> boundingBox;
+};
+
+AffineDependenceGraph::AffineDependenceGraph(Function *function) {}
+
+AffineDependenceGraph::~AffineDependenceGraph() {}
+
+AffineDependenceGraph::AccessInfo &
+AffineDependenceGraph::getAccessInfo(Operation *op) {
+  auto &info = accessInfos[op];
+  if (!info)
+    info = llvm::make_unique<AccessInfo>(op);
+  return *info;
+}
+
+// Returns true if the constant bounding boxes of the elements accessed by
+// 'src' and 'dst' are disjoint along some dimension.
+static bool haveDisjointBoundingBoxes(
+    ArrayRef<Optional<ConstantRange>> srcBoundingBox,
+    ArrayRef<Optional<ConstantRange>> dstBoundingBox) {
+  for (unsigned i = 0, e = srcBoundingBox.size(); i < e; ++i) {
+    const auto &srcRange = srcBoundingBox[i], &dstRange = dstBoundingBox[i];
+    if (srcRange && dstRange && (srcRange->second < dstRange->first ||
+                                 dstRange->second < srcRange->first))
+      return true;
+  }
+  return false;
+}
+
+// Returns the memref accessed by the load or store 'op'.
+static Value *getAccessedMemRef(Operation *op) {
+  if (auto loadOp = op->dyn_cast<LoadOp>())
+    return loadOp.getMemRef();
+  return op->cast<StoreOp>().getMemRef();
+}
+
+// Returns true if the dependence from 'src' to 'dst' needs to be checked on
+// the accessed elements, i.e. they access the same memref and at least one of
+// them is a store, unless read-after-read dependences are allowed.
+static bool needsElementCheck(Operation *src, Operation *dst, bool allowRAR) {
+  if (getAccessedMemRef(src) != getAccessedMemRef(dst))
     return false;
+  return allowRAR || src->isa<StoreOp>() || dst->isa<StoreOp>();
+}
+
+void AffineDependenceGraph::computeDependence(const AccessInfo &srcInfo,
+                                              const AccessInfo &dstInfo,
+                                              unsigned loopDepth,
+                                              bool withComponents,
+                                              bool allowRAR,
+                                              DependenceInfo &result) {
+  result.hasComponents = withComponents;
+  if (!srcInfo.hasDomain || !dstInfo.hasDomain ||
+      haveDisjointBoundingBoxes(srcInfo.boundingBox, dstInfo.boundingBox)) {
+    result.hasDependence = false;
+    return;
   }
 
-  // Compute dependence direction vector and return true.
-  if (dependenceComponents != nullptr) {
-    computeDirectionVector(srcDomain, dstDomain, loopDepth,
-                           dependenceConstraints, dependenceComponents);
+  FlatAffineConstraints dependenceConstraints;
+  result.hasDependence = checkAccessDependence(
+      srcInfo.access, srcInfo.accessMap, srcInfo.domain, dstInfo.access,
+      dstInfo.accessMap, dstInfo.domain, loopDepth, &dependenceConstraints,
+      withComponents ? &result.components : nullptr, allowRAR);
+}
+
+bool AffineDependenceGraph::hasDependence(
+    Operation *src, Operation *dst, unsigned loopDepth,
+    llvm::SmallVector<DependenceComponent, 2> *dependenceComponents,
+    bool allowRAR) {
+  // Answer the cheap checks of checkMemrefAccessDependence directly.
+  if (!needsElementCheck(src, dst, allowRAR))
+    return false;
+
+  auto key = getKey(src, dst, loopDepth, allowRAR);
+  auto it = dependences.find(key);
+  if (it == dependences.end() ||
+      (dependenceComponents && !it->second.hasComponents)) {
+    auto &srcInfo = getAccessInfo(src);
+    auto &dstInfo = getAccessInfo(dst);
+    it = dependences.try_emplace(key).first;
+    computeDependence(srcInfo, dstInfo, loopDepth,
+                      dependenceComponents != nullptr, allowRAR, it->second);
   }
+  if (it->second.hasDependence && dependenceComponents)
+    *dependenceComponents = it->second.components;
+  return it->second.hasDependence;
+}
 
-  LLVM_DEBUG(llvm::dbgs() << "Dependence polyhedron:\n");
-  LLVM_DEBUG(dependenceConstraints->dump());
-  return true;
+// Calls 'func' on each index in [0, numItems), on multiple threads if
+// multithreading is enabled. The indices are handed out to the threads one at
+// a time, as the cost of the items may vary a lot.
+template <typename FuncT>
+static void parallelForEachIndex(size_t numItems, FuncT &&func) {
+  if (!llvm::llvm_is_multithreaded()) {
+    for (size_t i = 0; i < numItems; ++i)
+      func(i);
+    return;
+  }
+
+  std::atomic<size_t> itemIt(0);
+  std::vector<char> workers(
+      std::min<size_t>(llvm::hardware_concurrency(), numItems));
+  llvm::parallel::for_each(
+      llvm::parallel::par, workers.begin(), workers.end(), [&](char &) {
+        for (auto e = numItems;;) {
+          // Get the next available item index.
+          size_t nextID = itemIt++;
+          if (nextID >= e)
+            break;
+          func(nextID);
+        }
+      });
+}
+
+// Orders 'op' and its ancestors within their blocks, so that comparing their
+// positions with isBeforeInBlock only reads the IR.
+static void orderAncestors(Operation *op) {
+  for (; op; op = op->getParentOp()) {
+    Block *block = op->getBlock();
+    if (!block->isInstOrderValid())
+      block->recomputeInstOrder();
+    else
+      block->updateInstOrder(op);
+  }
+}
+
+void AffineDependenceGraph::computeDependences(
+    ArrayRef<DependenceQuery> queries) {
+  // Select the queries that aren't answered yet, merging the duplicates.
+  struct PendingQuery {
+    Operation *src, *dst;
+    unsigned loopDepth;
+    bool withComponents, allowRAR;
+    DependenceInfo *result;
+  };
+  std::vector<PendingQuery> pending;
+  llvm::DenseMap<DependenceKey, unsigned> pendingIndices;
+  for (const auto &query : queries) {
+    if (!needsElementCheck(query.src, query.dst, query.allowRAR))
+      continue;
+    auto key = getKey(query.src, query.dst, query.loopDepth, query.allowRAR);
+    auto it = dependences.find(key);
+    if (it != dependences.end() &&
+        (!query.withComponents || it->second.hasComponents))
+      continue;
+    auto inserted = pendingIndices.try_emplace(key, pending.size());
+    if (inserted.second)
+      pending.push_back({query.src, query.dst, query.loopDepth,
+                         query.withComponents, query.allowRAR, nullptr});
+    else
+      pending[inserted.first->second].withComponents |= query.withComponents;
+  }
+  if (pending.empty())
+    return;
+
+  // Order the accesses in their blocks, and create the cache entries of the
+  // accesses and of the answers up front: the threads then only read the IR
+  // and write to distinct entries, so the answers don't depend on the order
+  // in which they are computed.
+  llvm::SmallPtrSet<Operation *, 8> orderedOps;
+  SmallVector<Operation *, 8> newOps;
+  for (const auto &query : pending) {
+    for (auto *op : {query.src, query.dst}) {
+      if (!orderedOps.insert(op).second)
+        continue;
+      orderAncestors(op);
+      if (accessInfos.try_emplace(op).second)
+        newOps.push_back(op);
+    }
+    dependences.try_emplace(
+        getKey(query.src, query.dst, query.loopDepth, query.allowRAR));
+  }
+  // The maps don't grow anymore, so the addresses of their entries are stable.
+  std::vector<std::unique_ptr<AccessInfo> *> newAccessInfos;
+  for (auto *op : newOps)
+    newAccessInfos.push_back(&accessInfos.find(op)->second);
+  for (auto &query : pending) {
+    auto key = getKey(query.src, query.dst, query.loopDepth, query.allowRAR);
+    query.result = &dependences.find(key)->second;
+  }
+
+  parallelForEachIndex(newOps.size(), [&](size_t i) {
+    *newAccessInfos[i] = llvm::make_unique<AccessInfo>(newOps[i]);
+  });
+  parallelForEachIndex(pending.size(), [&](size_t i) {
+    const auto &query = pending[i];
+    computeDependence(*accessInfos.find(query.src)->second,
+                      *accessInfos.find(query.dst)->second, query.loopDepth,
+                      query.withComponents, query.allowRAR, *query.result);
+  });
 }
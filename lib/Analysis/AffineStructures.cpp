@@ -21,12 +21,14 @@
 
 #include "mlir/Analysis/AffineStructures.h"
 #include "mlir/AffineOps/AffineOps.h"
+#include "mlir/Analysis/Simplex.h"
 #include "mlir/IR/AffineExprVisitor.h"
 #include "mlir/IR/AffineMap.h"
 #include "mlir/IR/IntegerSet.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/StandardOps/Ops.h"
 #include "mlir/Support/MathExtras.h"
+#include "llvm/ADT/APInt.h"
 #include "llvm/ADT/DenseSet.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/Support/Debug.h"
@@ -283,29 +285,11 @@ AffineValueMap::~AffineValueMap() {}
 
 // Copy constructor.
 FlatAffineConstraints::FlatAffineConstraints(
-    const FlatAffineConstraints &other) {
-  numReservedCols = other.numReservedCols;
-  numDims = other.getNumDimIds();
-  numSymbols = other.getNumSymbolIds();
-  numIds = other.getNumIds();
-
-  auto otherIds = other.getIds();
-  ids.reserve(numReservedCols);
-  ids.append(otherIds.begin(), otherIds.end());
-
-  unsigned numReservedEqualities = other.getNumReservedEqualities();
-  unsigned numReservedInequalities = other.getNumReservedInequalities();
-
-  equalities.reserve(numReservedEqualities * numReservedCols);
-  inequalities.reserve(numReservedInequalities * numReservedCols);
-
-  for (unsigned r = 0, e = other.getNumInequalities(); r < e; r++) {
-    addInequality(other.getInequality(r));
-  }
-  for (unsigned r = 0, e = other.getNumEqualities(); r < e; r++) {
-    addEquality(other.getEquality(r));
-  }
-}
+    const FlatAffineConstraints &other)
+    : equalities(other.equalities), inequalities(other.inequalities),
+      numIds(other.getNumIds()), numDims(other.getNumDimIds()),
+      numSymbols(other.getNumSymbolIds()), ids(other.ids),
+      hasDroppedConstraints(other.hasDroppedConstraints) {}
 
 // Clones this object.
 std::unique_ptr<FlatAffineConstraints> FlatAffineConstraints::clone() const {
@@ -314,11 +298,10 @@ std::unique_ptr<FlatAffineConstraints> FlatAffineConstraints::clone() const {
 
 // Construct from an IntegerSet.
 FlatAffineConstraints::FlatAffineConstraints(IntegerSet set)
-    : numReservedCols(set.getNumOperands() + 1),
+    : equalities(0, set.getNumOperands() + 1, set.getNumEqualities()),
+      inequalities(0, set.getNumOperands() + 1, set.getNumInequalities()),
       numIds(set.getNumDims() + set.getNumSymbols()), numDims(set.getNumDims()),
       numSymbols(set.getNumSymbols()) {
-  equalities.reserve(set.getNumEqualities() * numReservedCols);
-  inequalities.reserve(set.getNumInequalities() * numReservedCols);
   ids.resize(numIds, None);
 
   // Flatten expressions and add them to the constraint system.
@@ -354,17 +337,18 @@ void FlatAffineConstraints::reset(unsigned numReservedInequalities,
                                   ArrayRef<Value *> idArgs) {
   assert(newNumReservedCols >= newNumDims + newNumSymbols + newNumLocals + 1 &&
          "minimum 1 column");
-  numReservedCols = newNumReservedCols;
   numDims = newNumDims;
   numSymbols = newNumSymbols;
   numIds = numDims + numSymbols + newNumLocals;
   assert(idArgs.empty() || idArgs.size() == numIds);
 
   clearConstraints();
+  equalities.resizeHorizontally(getNumCols());
+  inequalities.resizeHorizontally(getNumCols());
   if (numReservedEqualities >= 1)
-    equalities.reserve(newNumReservedCols * numReservedEqualities);
+    equalities.reserveRows(numReservedEqualities);
   if (numReservedInequalities >= 1)
-    inequalities.reserve(newNumReservedCols * numReservedInequalities);
+    inequalities.reserveRows(numReservedInequalities);
   if (idArgs.empty()) {
     ids.resize(numIds, None);
   } else {
@@ -384,10 +368,8 @@ void FlatAffineConstraints::append(const FlatAffineConstraints &other) {
   assert(other.getNumDimIds() == getNumDimIds());
   assert(other.getNumSymbolIds() == getNumSymbolIds());
 
-  inequalities.reserve(inequalities.size() +
-                       other.getNumInequalities() * numReservedCols);
-  equalities.reserve(equalities.size() +
-                     other.getNumEqualities() * numReservedCols);
+  inequalities.reserveRows(getNumInequalities() + other.getNumInequalities());
+  equalities.reserveRows(getNumEqualities() + other.getNumEqualities());
 
   for (unsigned r = 0, e = other.getNumInequalities(); r < e; r++) {
     addInequality(other.getInequality(r));
@@ -420,15 +402,6 @@ void FlatAffineConstraints::addId(IdKind kind, unsigned pos, Value *id) {
     assert(pos <= getNumLocalIds());
   }
 
-  unsigned oldNumReservedCols = numReservedCols;
-
-  // Check if a resize is necessary.
-  if (getNumCols() + 1 > numReservedCols) {
-    equalities.resize(getNumEqualities() * (getNumCols() + 1));
-    inequalities.resize(getNumInequalities() * (getNumCols() + 1));
-    numReservedCols++;
-  }
-
   unsigned absolutePos;
 
   if (kind == IdKind::Dimension) {
@@ -442,35 +415,9 @@ void FlatAffineConstraints::addId(IdKind kind, unsigned pos, Value *id) {
   }
   numIds++;
 
-  // Note that getNumCols() now will already return the new size, which will be
-  // at least one.
-  int numInequalities = static_cast<int>(getNumInequalities());
-  int numEqualities = static_cast<int>(getNumEqualities());
-  int numCols = static_cast<int>(getNumCols());
-  for (int r = numInequalities - 1; r >= 0; r--) {
-    for (int c = numCols - 2; c >= 0; c--) {
-      if (c < absolutePos)
-        atIneq(r, c) = inequalities[r * oldNumReservedCols + c];
-      else
-        atIneq(r, c + 1) = inequalities[r * oldNumReservedCols + c];
-    }
-    atIneq(r, absolutePos) = 0;
-  }
-
-  for (int r = numEqualities - 1; r >= 0; r--) {
-    for (int c = numCols - 2; c >= 0; c--) {
-      // All values in column absolutePositions < absolutePos have the same
-      // coordinates in the 2-d view of the coefficient buffer.
-      if (c < absolutePos)
-        atEq(r, c) = equalities[r * oldNumReservedCols + c];
-      else
-        // Those at absolutePosition >= absolutePos, get a shifted
-        // absolutePosition.
-        atEq(r, c + 1) = equalities[r * oldNumReservedCols + c];
-    }
-    // Initialize added dimension to zero.
-    atEq(r, absolutePos) = 0;
-  }
+  // Initialize added dimension to zero.
+  inequalities.insertColumns(absolutePos, 1);
+  equalities.insertColumns(absolutePos, 1);
 
   // If an 'id' is provided, insert it; otherwise use None.
   if (id) {
@@ -815,21 +762,12 @@ findConstraintWithNonZeroAt(const FlatAffineConstraints &constraints,
 template <bool isEq>
 static void normalizeConstraintByGCD(FlatAffineConstraints *constraints,
                                      unsigned rowIdx) {
-  auto at = [&](unsigned colIdx) -> int64_t {
-    return isEq ? constraints->atEq(rowIdx, colIdx)
-                : constraints->atIneq(rowIdx, colIdx);
-  };
-  uint64_t gcd = std::abs(at(0));
-  for (unsigned j = 1, e = constraints->getNumCols(); j < e; ++j) {
-    gcd = llvm::GreatestCommonDivisor64(gcd, std::abs(at(j)));
-  }
-  if (gcd > 0 && gcd != 1) {
-    for (unsigned j = 0, e = constraints->getNumCols(); j < e; ++j) {
-      int64_t v = at(j) / static_cast<int64_t>(gcd);
-      isEq ? constraints->atEq(rowIdx, j) = v
-           : constraints->atIneq(rowIdx, j) = v;
-    }
-  }
+  MutableArrayRef<int64_t> row(isEq ? &constraints->atEq(rowIdx, 0)
+                                    : &constraints->atIneq(rowIdx, 0),
+                               constraints->getNumCols());
+  uint64_t gcd = getGCDOfAbsValues(row);
+  if (gcd > 1)
+    divideExactly(row, gcd);
 }
 
 void FlatAffineConstraints::normalizeConstraintsByGCD() {
@@ -842,9 +780,9 @@ void FlatAffineConstraints::normalizeConstraintsByGCD() {
 }
 
 bool FlatAffineConstraints::hasConsistentState() const {
-  if (inequalities.size() != getNumInequalities() * numReservedCols)
+  if (inequalities.getNumColumns() != getNumCols())
     return false;
-  if (equalities.size() != getNumEqualities() * numReservedCols)
+  if (equalities.getNumColumns() != getNumCols())
     return false;
   if (ids.size() != getNumIds())
     return false;
@@ -890,64 +828,92 @@ bool FlatAffineConstraints::hasInvalidConstraint() const {
   return check(/*isEq=*/false);
 }
 
+// Computes the constraint 'lhsMultiplier * lhs + rhsMultiplier * rhs' into
+// 'result', which may alias 'lhs' or 'rhs'. The common case, where the
+// magnitudes of the coefficients show that nothing can overflow, is computed
+// directly; otherwise, it is computed on int64_t with overflow checks. On
+// overflow, the constraint is recomputed on wider integers and divided by the
+// gcd of its coefficients, which preserves its set of solutions whether it is
+// an equality or an inequality; this often brings it back in the range of
+// int64_t. Returns failure if it doesn't, in which case 'result' is the
+// trivially true constraint: callers thus drop constraints rather than silently
+// wrapping around, which makes the system an over-approximation.
+static LogicalResult combineConstraints(int64_t lhsMultiplier,
+                                        ArrayRef<int64_t> lhs,
+                                        int64_t rhsMultiplier,
+                                        ArrayRef<int64_t> rhs,
+                                        MutableArrayRef<int64_t> result) {
+  assert(lhs.size() == rhs.size() && lhs.size() == result.size() &&
+         "mismatched constraint sizes");
+  if (combineRows(lhsMultiplier, lhs, rhsMultiplier, rhs, result))
+    return success();
+
+  SmallVector<int64_t, 8> checked(lhs.size());
+  bool overflow = false;
+  for (unsigned j = 0, e = lhs.size(); j < e; ++j) {
+    int64_t lhsTerm, rhsTerm;
+    overflow |= mulOverflow(lhsMultiplier, lhs[j], lhsTerm);
+    overflow |= mulOverflow(rhsMultiplier, rhs[j], rhsTerm);
+    overflow |= addOverflow(lhsTerm, rhsTerm, checked[j]);
+  }
+  if (!overflow) {
+    std::copy(checked.begin(), checked.end(), result.begin());
+    return success();
+  }
+
+  // A sum of two products of int64_t fits in 129 bits.
+  const unsigned kWideBitWidth = 130;
+  SmallVector<APInt, 8> wide;
+  wide.reserve(lhs.size());
+  APInt gcd(kWideBitWidth, 0);
+  for (unsigned j = 0, e = lhs.size(); j < e; ++j) {
+    wide.push_back(APInt(kWideBitWidth, lhsMultiplier, /*isSigned=*/true) *
+                       APInt(kWideBitWidth, lhs[j], /*isSigned=*/true) +
+                   APInt(kWideBitWidth, rhsMultiplier, /*isSigned=*/true) *
+                       APInt(kWideBitWidth, rhs[j], /*isSigned=*/true));
+    gcd = llvm::APIntOps::GreatestCommonDivisor(gcd, wide.back().abs());
+  }
+  for (unsigned j = 0, e = lhs.size(); j < e; ++j) {
+    APInt value = gcd.getBoolValue() ? wide[j].sdiv(gcd) : wide[j];
+    if (!value.isSignedIntN(64)) {
+      LLVM_DEBUG(llvm::dbgs() << "Dropping a constraint overflowing int64_t\n");
+      std::fill(result.begin(), result.end(), 0);
+      return failure();
+    }
+    result[j] = value.getSExtValue();
+  }
+  return success();
+}
+
 // Eliminate identifier from constraint at 'rowIdx' based on coefficient at
-// pivotRow, pivotCol. Columns in range [elimColStart, pivotCol) will not be
-// updated as they have already been eliminated.
-static void eliminateFromConstraint(FlatAffineConstraints *constraints,
-                                    unsigned rowIdx, unsigned pivotRow,
-                                    unsigned pivotCol, unsigned elimColStart,
-                                    bool isEq) {
+// pivotRow, pivotCol. The whole row is updated in place: columns that have
+// already been eliminated are zero in both rows. Returns failure if the
+// constraint overflowed and was dropped.
+static LogicalResult
+eliminateFromConstraint(FlatAffineConstraints *constraints, unsigned rowIdx,
+                        unsigned pivotRow, unsigned pivotCol, bool isEq) {
   // Skip if equality 'rowIdx' if same as 'pivotRow'.
   if (isEq && rowIdx == pivotRow)
-    return;
-  auto at = [&](unsigned i, unsigned j) -> int64_t {
-    return isEq ? constraints->atEq(i, j) : constraints->atIneq(i, j);
-  };
-  int64_t leadCoeff = at(rowIdx, pivotCol);
+    return success();
+  MutableArrayRef<int64_t> row(isEq ? &constraints->atEq(rowIdx, 0)
+                                    : &constraints->atIneq(rowIdx, 0),
+                               constraints->getNumCols());
+  int64_t leadCoeff = row[pivotCol];
   // Skip if leading coefficient at 'rowIdx' is already zero.
   if (leadCoeff == 0)
-    return;
+    return success();
   int64_t pivotCoeff = constraints->atEq(pivotRow, pivotCol);
-  int64_t sign = (leadCoeff * pivotCoeff > 0) ? -1 : 1;
-  int64_t lcm = mlir::lcm(pivotCoeff, leadCoeff);
-  int64_t pivotMultiplier = sign * (lcm / std::abs(pivotCoeff));
-  int64_t rowMultiplier = lcm / std::abs(leadCoeff);
-
-  unsigned numCols = constraints->getNumCols();
-  for (unsigned j = 0; j < numCols; ++j) {
-    // Skip updating column 'j' if it was just eliminated.
-    if (j >= elimColStart && j < pivotCol)
-      continue;
-    int64_t v = pivotMultiplier * constraints->atEq(pivotRow, j) +
-                rowMultiplier * at(rowIdx, j);
-    isEq ? constraints->atEq(rowIdx, j) = v
-         : constraints->atIneq(rowIdx, j) = v;
-  }
-}
-
-// Remove coefficients in column range [colStart, colLimit) in place.
-// This removes in data in the specified column range, and copies any
-// remaining valid data into place.
-static void shiftColumnsToLeft(FlatAffineConstraints *constraints,
-                               unsigned colStart, unsigned colLimit,
-                               bool isEq) {
-  assert(colStart >= 0 && colLimit <= constraints->getNumIds());
-  if (colLimit <= colStart)
-    return;
+  int64_t sign = ((leadCoeff > 0) == (pivotCoeff > 0)) ? -1 : 1;
+  // These are lcm(pivotCoeff, leadCoeff) / |pivotCoeff| and
+  // lcm(pivotCoeff, leadCoeff) / |leadCoeff|, without computing the lcm.
+  int64_t gcd = llvm::GreatestCommonDivisor64(std::abs(pivotCoeff),
+                                              std::abs(leadCoeff));
+  int64_t pivotMultiplier = sign * (std::abs(leadCoeff) / gcd);
+  int64_t rowMultiplier = std::abs(pivotCoeff) / gcd;
 
-  unsigned numCols = constraints->getNumCols();
-  unsigned numRows = isEq ? constraints->getNumEqualities()
-                          : constraints->getNumInequalities();
-  unsigned numToEliminate = colLimit - colStart;
-  for (unsigned r = 0, e = numRows; r < e; ++r) {
-    for (unsigned c = colLimit; c < numCols; ++c) {
-      if (isEq) {
-        constraints->atEq(r, c - numToEliminate) = constraints->atEq(r, c);
-      } else {
-        constraints->atIneq(r, c - numToEliminate) = constraints->atIneq(r, c);
-      }
-    }
-  }
+  return combineConstraints(pivotMultiplier,
+                            constraints->getEquality(pivotRow), rowMultiplier,
+                            row, row);
 }
 
 // Removes identifiers in column range [idStart, idLimit), and copies any
@@ -961,12 +927,11 @@ void FlatAffineConstraints::removeIdRange(unsigned idStart, unsigned idLimit) {
   // We are going to be removing one or more identifiers from the range.
   assert(idStart < numIds && "invalid idStart position");
 
-  // TODO(andydavis) Make 'removeIdRange' a lambda called from here.
   // Remove eliminated identifiers from equalities.
-  shiftColumnsToLeft(this, idStart, idLimit, /*isEq=*/true);
+  equalities.removeColumns(idStart, idLimit - idStart);
 
   // Remove eliminated identifiers from inequalities.
-  shiftColumnsToLeft(this, idStart, idLimit, /*isEq=*/false);
+  inequalities.removeColumns(idStart, idLimit - idStart);
 
   // Update members numDims, numSymbols and numIds.
   unsigned numDimsEliminated = 0;
@@ -989,8 +954,6 @@ void FlatAffineConstraints::removeIdRange(unsigned idStart, unsigned idLimit) {
   numIds = numIds - numColsEliminated;
 
   ids.erase(ids.begin() + idStart, ids.begin() + idLimit);
-
-  // No resize necessary. numReservedCols remains the same.
 }
 
 /// Returns the position of the identifier that has the minimum <number of lower
@@ -1027,14 +990,127 @@ static unsigned getBestIdToEliminate(const FlatAffineConstraints &cst,
   return minLoc;
 }
 
+// Checks for emptiness of 'cst' by Fourier-Motzkin elimination on wide
+// integers. This is the slow path of isEmpty, for systems whose coefficients
+// overflow int64_t during elimination. Equalities are split into pairs of
+// inequalities, and inequalities are GCD tightened after each elimination.
+// Constraints overflowing even the wide integers are dropped, and elimination
+// gives up once there are 'maxNumConstraints' constraints: the system is then
+// conservatively deemed non-empty.
+static bool isEmptyOnWideIntegers(const FlatAffineConstraints &cst,
+                                  unsigned maxNumConstraints) {
+  const unsigned kWideBitWidth = 256;
+  using WideConstraint = SmallVector<APInt, 8>;
+  unsigned numIds = cst.getNumIds();
+
+  // Normalizes 'ineq' by the gcd of its coefficients, rounding its constant
+  // down. Returns false if it is trivially true or invalid, setting 'invalid'
+  // in the latter case.
+  bool invalid = false;
+  auto normalize = [&](WideConstraint &ineq) {
+    APInt gcd(kWideBitWidth, 0);
+    for (unsigned j = 0; j < numIds; ++j)
+      gcd = llvm::APIntOps::GreatestCommonDivisor(gcd, ineq[j].abs());
+    if (!gcd.getBoolValue()) {
+      invalid |= ineq[numIds].isNegative();
+      return false;
+    }
+    for (unsigned j = 0; j < numIds; ++j)
+      ineq[j] = ineq[j].sdiv(gcd);
+    ineq[numIds] = llvm::APIntOps::RoundingSDiv(ineq[numIds], gcd,
+                                                APInt::Rounding::DOWN);
+    return true;
+  };
+
+  std::vector<WideConstraint> ineqs;
+  auto addConstraint = [&](ArrayRef<int64_t> coeffs, bool negate) {
+    WideConstraint ineq;
+    for (int64_t coeff : coeffs)
+      ineq.push_back(APInt(kWideBitWidth, negate ? -coeff : coeff,
+                           /*isSigned=*/true));
+    if (normalize(ineq))
+      ineqs.push_back(std::move(ineq));
+  };
+  for (unsigned r = 0, e = cst.getNumEqualities(); r < e; ++r) {
+    addConstraint(cst.getEquality(r), /*negate=*/false);
+    addConstraint(cst.getEquality(r), /*negate=*/true);
+  }
+  for (unsigned r = 0, e = cst.getNumInequalities(); r < e; ++r)
+    addConstraint(cst.getInequality(r), /*negate=*/false);
+
+  SmallVector<bool, 8> eliminated(numIds, false);
+  for (unsigned i = 0; i < numIds && !invalid; ++i) {
+    // Eliminate the identifier with the fewest pairs of bounds.
+    unsigned pos = numIds;
+    uint64_t minNumPairs = 0;
+    for (unsigned j = 0; j < numIds; ++j) {
+      if (eliminated[j])
+        continue;
+      uint64_t numLbs = 0, numUbs = 0;
+      for (auto &ineq : ineqs) {
+        numLbs += ineq[j].isStrictlyPositive();
+        numUbs += ineq[j].isNegative();
+      }
+      if (pos == numIds || numLbs * numUbs < minNumPairs) {
+        pos = j;
+        minNumPairs = numLbs * numUbs;
+      }
+    }
+    eliminated[pos] = true;
+
+    std::vector<WideConstraint> newIneqs;
+    for (auto &ineq : ineqs)
+      if (ineq[pos].isNullValue())
+        newIneqs.push_back(ineq);
+    for (auto &lb : ineqs) {
+      if (!lb[pos].isStrictlyPositive())
+        continue;
+      for (auto &ub : ineqs) {
+        if (!ub[pos].isNegative())
+          continue;
+        APInt lbCoeff = lb[pos], ubCoeff = -ub[pos];
+        APInt gcd = llvm::APIntOps::GreatestCommonDivisor(lbCoeff, ubCoeff);
+        APInt lbMultiplier = ubCoeff.sdiv(gcd);
+        APInt ubMultiplier = lbCoeff.sdiv(gcd);
+        WideConstraint ineq;
+        bool overflow = false;
+        for (unsigned j = 0; j <= numIds && !overflow; ++j)
+          ineq.push_back(lb[j].smul_ov(lbMultiplier, overflow)
+                             .sadd_ov(ub[j].smul_ov(ubMultiplier, overflow),
+                                      overflow));
+        if (!overflow && normalize(ineq))
+          newIneqs.push_back(std::move(ineq));
+      }
+    }
+    if (newIneqs.size() >= maxNumConstraints) {
+      LLVM_DEBUG(llvm::dbgs() << "FM constraint explosion detected\n");
+      return false;
+    }
+    ineqs = std::move(newIneqs);
+  }
+  return invalid;
+}
+
 // Checks for emptiness of the set by eliminating identifiers successively and
 // using the GCD test (on all equality constraints) and checking for trivially
 // invalid constraints. Returns 'true' if the constraint system is found to be
 // empty; false otherwise.
-bool FlatAffineConstraints::isEmpty() const {
+bool FlatAffineConstraints::isEmpty(EmptinessCheck check) const {
   if (isEmptyByGCDTest() || hasInvalidConstraint())
     return true;
 
+  if (check == EmptinessCheck::Simplex) {
+    switch (Simplex(*this).isIntegerEmpty()) {
+    case Simplex::Result::Empty:
+      return true;
+    case Simplex::Result::NonEmpty:
+      return false;
+    case Simplex::Result::Unknown:
+      LLVM_DEBUG(llvm::dbgs() << "Simplex inconclusive, falling back to FM\n");
+      break;
+    }
+  }
+
   // First, eliminate as many identifiers as possible using Gaussian
   // elimination.
   FlatAffineConstraints tmpCst(*this);
@@ -1069,6 +1145,14 @@ bool FlatAffineConstraints::isEmpty() const {
     if (tmpCst.hasInvalidConstraint())
       return true;
   }
+
+  // Constraints that overflowed were dropped, so the system may still be
+  // empty. Redo the elimination on wider integers.
+  if (tmpCst.hasDroppedConstraints) {
+    LLVM_DEBUG(llvm::dbgs() << "Overflow detected, rechecking emptiness on "
+                               "wide integers\n");
+    return isEmptyOnWideIntegers(*this, kExplosionFactor * getNumIds());
+  }
   return false;
 }
 
@@ -1091,11 +1175,10 @@ bool FlatAffineConstraints::isEmptyByGCDTest() const {
   assert(hasConsistentState());
   unsigned numCols = getNumCols();
   for (unsigned i = 0, e = getNumEqualities(); i < e; ++i) {
-    uint64_t gcd = std::abs(atEq(i, 0));
-    for (unsigned j = 1; j < numCols - 1; ++j) {
-      gcd = llvm::GreatestCommonDivisor64(gcd, std::abs(atEq(i, j)));
-    }
-    int64_t v = std::abs(atEq(i, numCols - 1));
+    uint64_t gcd = getGCDOfAbsValues(getEquality(i).drop_back());
+    // The absolute value of the constant term, which may be 2^63.
+    int64_t c = atEq(i, numCols - 1);
+    uint64_t v = c < 0 ? -static_cast<uint64_t>(c) : c;
     if (gcd > 0 && (v % gcd != 0)) {
       return true;
     }
@@ -1114,16 +1197,14 @@ bool FlatAffineConstraints::isEmptyByGCDTest() const {
 void FlatAffineConstraints::GCDTightenInequalities() {
   unsigned numCols = getNumCols();
   for (unsigned i = 0, e = getNumInequalities(); i < e; ++i) {
-    uint64_t gcd = std::abs(atIneq(i, 0));
-    for (unsigned j = 1; j < numCols - 1; ++j) {
-      gcd = llvm::GreatestCommonDivisor64(gcd, std::abs(atIneq(i, j)));
-    }
-    if (gcd > 0 && gcd != 1) {
+    MutableArrayRef<int64_t> coeffs(&atIneq(i, 0), numCols - 1);
+    uint64_t gcd = getGCDOfAbsValues(coeffs);
+    // A gcd of 2^63 doesn't fit the signed division of the constant term.
+    if (gcd > 1 && gcd <= uint64_t(std::numeric_limits<int64_t>::max())) {
       int64_t gcdI = static_cast<int64_t>(gcd);
       // Tighten the constant term and normalize the constraint by the GCD.
       atIneq(i, numCols - 1) = mlir::floorDiv(atIneq(i, numCols - 1), gcdI);
-      for (unsigned j = 0, e = numCols - 1; j < e; ++j)
-        atIneq(i, j) /= gcdI;
+      divideExactly(coeffs, gcdI);
     }
   }
 }
@@ -1159,15 +1240,17 @@ unsigned FlatAffineConstraints::gaussianEliminateIds(unsigned posStart,
 
     // Eliminate identifier at 'pivotCol' from each equality row.
     for (unsigned i = 0, e = getNumEqualities(); i < e; ++i) {
-      eliminateFromConstraint(this, i, pivotRow, pivotCol, posStart,
-                              /*isEq=*/true);
+      if (failed(eliminateFromConstraint(this, i, pivotRow, pivotCol,
+                                         /*isEq=*/true)))
+        hasDroppedConstraints = true;
       normalizeConstraintByGCD</*isEq=*/true>(this, i);
     }
 
     // Eliminate identifier at 'pivotCol' from each inequality row.
     for (unsigned i = 0, e = getNumInequalities(); i < e; ++i) {
-      eliminateFromConstraint(this, i, pivotRow, pivotCol, posStart,
-                              /*isEq=*/false);
+      if (failed(eliminateFromConstraint(this, i, pivotRow, pivotCol,
+                                         /*isEq=*/false)))
+        hasDroppedConstraints = true;
       normalizeConstraintByGCD</*isEq=*/false>(this, i);
     }
     removeEquality(pivotRow);
@@ -1378,8 +1461,10 @@ static inline void negateInequality(FlatAffineConstraints *cst, unsigned r) {
 }
 
 // A more complex check to eliminate redundant inequalities. Uses FourierMotzkin
-// to check if a constraint is redundant.
-void FlatAffineConstraints::removeRedundantInequalities() {
+// or the simplex, as selected by 'check', to check if a constraint is
+// redundant.
+void FlatAffineConstraints::removeRedundantInequalities(
+    EmptinessCheck check) {
   SmallVector<bool, 32> redun(getNumInequalities(), false);
   // To check if an inequality is redundant, we replace the inequality by its
   // complement (for eg., i - 1 >= 0 by i <= 0), and check if the resulting
@@ -1389,7 +1474,7 @@ void FlatAffineConstraints::removeRedundantInequalities() {
     // Change the inequality to its complement.
     negateInequality(&tmpCst, r);
     tmpCst.atIneq(r, tmpCst.getNumCols() - 1)--;
-    if (tmpCst.isEmpty()) {
+    if (tmpCst.isEmpty(check)) {
       redun[r] = true;
       // Zero fill the redundant inequality.
       fillInequality(this, r, /*val=*/0);
@@ -1402,19 +1487,12 @@ void FlatAffineConstraints::removeRedundantInequalities() {
   }
 
   // Scan to get rid of all rows marked redundant, in-place.
-  auto copyRow = [&](unsigned src, unsigned dest) {
-    if (src == dest)
-      return;
-    for (unsigned c = 0, e = getNumCols(); c < e; c++) {
-      atIneq(dest, c) = atIneq(src, c);
-    }
-  };
   unsigned pos = 0;
   for (unsigned r = 0, e = getNumInequalities(); r < e; r++) {
     if (!redun[r])
-      copyRow(r, pos++);
+      inequalities.copyRow(r, pos++);
   }
-  inequalities.resize(numReservedCols * pos);
+  inequalities.resizeVertically(pos);
 }
 
 std::pair<AffineMap, AffineMap> FlatAffineConstraints::getLowerAndUpperBound(
@@ -1769,60 +1847,43 @@ LogicalResult FlatAffineConstraints::addSliceBounds(
 
 void FlatAffineConstraints::addEquality(ArrayRef<int64_t> eq) {
   assert(eq.size() == getNumCols());
-  unsigned offset = equalities.size();
-  equalities.resize(equalities.size() + numReservedCols);
-  std::copy(eq.begin(), eq.end(), equalities.begin() + offset);
+  equalities.appendRow(eq);
 }
 
 void FlatAffineConstraints::addInequality(ArrayRef<int64_t> inEq) {
   assert(inEq.size() == getNumCols());
-  unsigned offset = inequalities.size();
-  inequalities.resize(inequalities.size() + numReservedCols);
-  std::copy(inEq.begin(), inEq.end(), inequalities.begin() + offset);
+  inequalities.appendRow(inEq);
 }
 
 void FlatAffineConstraints::addConstantLowerBound(unsigned pos, int64_t lb) {
   assert(pos < getNumCols());
-  unsigned offset = inequalities.size();
-  inequalities.resize(inequalities.size() + numReservedCols);
-  std::fill(inequalities.begin() + offset,
-            inequalities.begin() + offset + getNumCols(), 0);
-  inequalities[offset + pos] = 1;
-  inequalities[offset + getNumCols() - 1] = -lb;
+  unsigned row = inequalities.appendExtraRow();
+  inequalities(row, pos) = 1;
+  inequalities(row, getNumCols() - 1) = -lb;
 }
 
 void FlatAffineConstraints::addConstantUpperBound(unsigned pos, int64_t ub) {
   assert(pos < getNumCols());
-  unsigned offset = inequalities.size();
-  inequalities.resize(inequalities.size() + numReservedCols);
-  std::fill(inequalities.begin() + offset,
-            inequalities.begin() + offset + getNumCols(), 0);
-  inequalities[offset + pos] = -1;
-  inequalities[offset + getNumCols() - 1] = ub;
+  unsigned row = inequalities.appendExtraRow();
+  inequalities(row, pos) = -1;
+  inequalities(row, getNumCols() - 1) = ub;
 }
 
 void FlatAffineConstraints::addConstantLowerBound(ArrayRef<int64_t> expr,
                                                   int64_t lb) {
   assert(expr.size() == getNumCols());
-  unsigned offset = inequalities.size();
-  inequalities.resize(inequalities.size() + numReservedCols);
-  std::fill(inequalities.begin() + offset,
-            inequalities.begin() + offset + getNumCols(), 0);
-  std::copy(expr.begin(), expr.end(), inequalities.begin() + offset);
-  inequalities[offset + getNumCols() - 1] += -lb;
+  unsigned row = inequalities.appendRow(expr);
+  inequalities(row, getNumCols() - 1) += -lb;
 }
 
 void FlatAffineConstraints::addConstantUpperBound(ArrayRef<int64_t> expr,
                                                   int64_t ub) {
   assert(expr.size() == getNumCols());
-  unsigned offset = inequalities.size();
-  inequalities.resize(inequalities.size() + numReservedCols);
-  std::fill(inequalities.begin() + offset,
-            inequalities.begin() + offset + getNumCols(), 0);
+  unsigned row = inequalities.appendExtraRow();
   for (unsigned i = 0, e = getNumCols(); i < e; i++) {
-    inequalities[offset + i] = -expr[i];
+    inequalities(row, i) = -expr[i];
   }
-  inequalities[offset + getNumCols() - 1] += ub;
+  inequalities(row, getNumCols() - 1) += ub;
 }
 
 /// Adds a new local identifier as the floordiv of an affine function of other
@@ -1881,12 +1942,9 @@ void FlatAffineConstraints::setDimSymbolSeparation(unsigned newSymbolCount) {
 
 /// Sets the specified identifer to a constant value.
 void FlatAffineConstraints::setIdToConstant(unsigned pos, int64_t val) {
-  unsigned offset = equalities.size();
-  equalities.resize(equalities.size() + numReservedCols);
-  std::fill(equalities.begin() + offset,
-            equalities.begin() + offset + getNumCols(), 0);
-  equalities[offset + pos] = 1;
-  equalities[offset + getNumCols() - 1] = -val;
+  unsigned row = equalities.appendExtraRow();
+  equalities(row, pos) = 1;
+  equalities(row, getNumCols() - 1) = -val;
 }
 
 /// Sets the specified identifer to a constant value; asserts if the id is not
@@ -1900,15 +1958,8 @@ void FlatAffineConstraints::setIdToConstant(Value &id, int64_t val) {
 }
 
 void FlatAffineConstraints::removeEquality(unsigned pos) {
-  unsigned numEqualities = getNumEqualities();
-  assert(pos < numEqualities);
-  unsigned outputIndex = pos * numReservedCols;
-  unsigned inputIndex = (pos + 1) * numReservedCols;
-  unsigned numElemsToCopy = (numEqualities - pos - 1) * numReservedCols;
-  std::copy(equalities.begin() + inputIndex,
-            equalities.begin() + inputIndex + numElemsToCopy,
-            equalities.begin() + outputIndex);
-  equalities.resize(equalities.size() - numReservedCols);
+  assert(pos < getNumEqualities());
+  equalities.removeRow(pos);
 }
 
 /// Finds an equality that equates the specified identifier to a constant.
@@ -2264,8 +2315,7 @@ void FlatAffineConstraints::removeTrivialRedundancy() {
   // Detect and mark redundant constraints.
   SmallVector<bool, 256> redunIneq(getNumInequalities(), false);
   for (unsigned r = 0, e = getNumInequalities(); r < e; r++) {
-    int64_t *rowStart = inequalities.data() + numReservedCols * r;
-    auto row = ArrayRef<int64_t>(rowStart, getNumCols());
+    auto row = getInequality(r);
     if (isTriviallyValid(r) || !rowSet.insert(row).second) {
       redunIneq[r] = true;
       continue;
@@ -2276,7 +2326,7 @@ void FlatAffineConstraints::removeTrivialRedundancy() {
     // (eg: among i - 16j - 5 >= 0, i - 16j - 1 >=0, i - 16j - 7 >= 0, the
     // former two are redundant).
     int64_t constTerm = atIneq(r, getNumCols() - 1);
-    auto rowWithoutConstTerm = ArrayRef<int64_t>(rowStart, getNumCols() - 1);
+    auto rowWithoutConstTerm = row.drop_back();
     const auto &ret =
         rowsWithoutConstTerm.insert({rowWithoutConstTerm, {r, constTerm}});
     if (!ret.second) {
@@ -2293,21 +2343,13 @@ void FlatAffineConstraints::removeTrivialRedundancy() {
     }
   }
 
-  auto copyRow = [&](unsigned src, unsigned dest) {
-    if (src == dest)
-      return;
-    for (unsigned c = 0, e = getNumCols(); c < e; c++) {
-      atIneq(dest, c) = atIneq(src, c);
-    }
-  };
-
   // Scan to get rid of all rows marked redundant, in-place.
   unsigned pos = 0;
   for (unsigned r = 0, e = getNumInequalities(); r < e; r++) {
     if (!redunIneq[r])
-      copyRow(r, pos++);
+      inequalities.copyRow(r, pos++);
   }
-  inequalities.resize(numReservedCols * pos);
+  inequalities.resizeVertically(pos);
 
   // TODO(bondhugula): consider doing this for equalities as well, but probably
   // not worth the savings.
@@ -2468,9 +2510,10 @@ void FlatAffineConstraints::FourierMotzkinEliminate(
       /*numLocals=*/getNumIds() - 1 - newNumDims - newNumSymbols, newIds);
 
   assert(newFac.getIds().size() == newFac.getNumIds());
+  newFac.hasDroppedConstraints = hasDroppedConstraints;
 
   // This will be used to check if the elimination was integer exact.
-  unsigned lcmProducts = 1;
+  bool allLcmsAreOne = true;
 
   // Let x be the variable we are eliminating.
   // For each lower bound, lb <= c_l*x, and each upper bound c_u*x <= ub, (note
@@ -2484,27 +2527,37 @@ void FlatAffineConstraints::FourierMotzkinEliminate(
   // integer exact.
   for (auto ubPos : ubIndices) {
     for (auto lbPos : lbIndices) {
-      SmallVector<int64_t, 4> ineq;
-      ineq.reserve(newFac.getNumCols());
+      SmallVector<int64_t, 4> ineq(getNumCols());
       int64_t lbCoeff = atIneq(lbPos, pos);
       // Note that in the comments above, ubCoeff is the negation of the
       // coefficient in the canonical form as the view taken here is that of the
       // term being moved to the other size of '>='.
       int64_t ubCoeff = -atIneq(ubPos, pos);
-      // TODO(bondhugula): refactor this loop to avoid all branches inside.
-      for (unsigned l = 0, e = getNumCols(); l < e; l++) {
-        if (l == pos)
-          continue;
-        assert(lbCoeff >= 1 && ubCoeff >= 1 && "bounds wrongly identified");
-        int64_t lcm = mlir::lcm(lbCoeff, ubCoeff);
-        ineq.push_back(atIneq(ubPos, l) * (lcm / ubCoeff) +
-                       atIneq(lbPos, l) * (lcm / lbCoeff));
-        lcmProducts *= lcm;
-      }
+      assert(lbCoeff >= 1 && ubCoeff >= 1 && "bounds wrongly identified");
+      // lcm(c_l, c_u) / c_u and lcm(c_l, c_u) / c_l.
+      int64_t gcd = llvm::GreatestCommonDivisor64(lbCoeff, ubCoeff);
+      allLcmsAreOne &= lbCoeff == 1 && ubCoeff == 1;
+      // The combination cancels out the coefficients at 'pos'.
+      bool fits = succeeded(combineConstraints(
+          lbCoeff / gcd, getInequality(ubPos), ubCoeff / gcd,
+          getInequality(lbPos), ineq));
+      ineq.erase(ineq.begin() + pos);
       if (darkShadow) {
         // The dark shadow is a convex subset of the exact integer shadow. If
-        // there is a point here, it proves the existence of a solution.
-        ineq[ineq.size() - 1] += lbCoeff * ubCoeff - lbCoeff - ubCoeff + 1;
+        // there is a point here, it proves the existence of a solution. It
+        // must thus be made empty if the constraint doesn't fit.
+        int64_t shift;
+        if (!fits || mulOverflow(lbCoeff, ubCoeff, shift) ||
+            addOverflow(ineq.back(), shift - lbCoeff - ubCoeff + 1,
+                        ineq.back())) {
+          std::fill(ineq.begin(), ineq.end(), 0);
+          ineq.back() = -1;
+        }
+      } else if (!fits) {
+        // Dropping the constraint over-approximates the shadow, so the
+        // result can't be integer exact anymore.
+        allLcmsAreOne = false;
+        newFac.hasDroppedConstraints = true;
       }
       // TODO: we need to have a way to add inequalities in-place in
       // FlatAffineConstraints instead of creating and copying over.
@@ -2512,7 +2565,7 @@ void FlatAffineConstraints::FourierMotzkinEliminate(
     }
   }
 
-  if (lcmProducts == 1 && isResultIntegerExact)
+  if (allLcmsAreOne && isResultIntegerExact)
     *isResultIntegerExact = 1;
 
   // Copy over the constraints not involving this variable.
@@ -2644,8 +2697,8 @@ bool FlatAffineConstraints::isRangeOneToOne(unsigned start,
 }
 
 void FlatAffineConstraints::clearConstraints() {
-  equalities.clear();
-  inequalities.clear();
+  equalities.clearRows();
+  inequalities.clearRows();
 }
 
 namespace {
@@ -40,24 +40,95 @@ void DominanceInfoBase<IsPostDom>::recalculate(Function *function) {
   dominanceInfos.clear();
 
   // Build the top level function dominance.
-  auto functionDominance = llvm::make_unique<base>();
-  functionDominance->recalculate(function->getBody());
-  dominanceInfos.try_emplace(&function->getBody(),
-                             std::move(functionDominance));
+  recalculate(&function->getBody());
 
   /// Build the dominance for each of the operation regions.
   function->walk([&](Operation *op) {
-    for (auto &region : op->getRegions()) {
-      // Don't compute dominance if the region is empty.
-      if (region.empty())
-        continue;
-      auto opDominance = llvm::make_unique<base>();
-      opDominance->recalculate(region);
-      dominanceInfos.try_emplace(&region, std::move(opDominance));
-    }
+    for (auto &region : op->getRegions())
+      recalculate(&region);
   });
 }
 
+/// Recalculate the dominance info of a single region.
+template <bool IsPostDom>
+void DominanceInfoBase<IsPostDom>::recalculate(Region *region) {
+  // Don't compute dominance if the region is empty.
+  if (region->empty()) {
+    dominanceInfos.erase(region);
+    return;
+  }
+
+  auto &regionDominance = dominanceInfos[region];
+  if (!regionDominance)
+    regionDominance = llvm::make_unique<base>();
+  regionDominance->recalculate(*region);
+}
+
+/// Incrementally update the dominance info after an edge was inserted.
+template <bool IsPostDom>
+void DominanceInfoBase<IsPostDom>::insertEdge(Block *from, Block *to) {
+  auto *region = from->getParent();
+  assert(region == to->getParent() && "expected blocks of the same region");
+
+  // If the region had no blocks when the dominance was computed, build it.
+  auto it = dominanceInfos.find(region);
+  if (it == dominanceInfos.end())
+    return recalculate(region);
+  it->second->insertEdge(from, to);
+}
+
+/// Incrementally update the dominance info after an edge was deleted.
+template <bool IsPostDom>
+void DominanceInfoBase<IsPostDom>::deleteEdge(Block *from, Block *to) {
+  auto *region = from->getParent();
+  assert(region == to->getParent() && "expected blocks of the same region");
+
+  auto it = dominanceInfos.find(region);
+  if (it == dominanceInfos.end())
+    return recalculate(region);
+  it->second->deleteEdge(from, to);
+}
+
+/// Update the dominance info after 'block' was split into itself and
+/// 'newBlock'.
+template <bool IsPostDom>
+void DominanceInfoBase<IsPostDom>::splitBlock(Block *block, Block *newBlock) {
+  auto *region = block->getParent();
+  assert(region == newBlock->getParent() &&
+         "expected blocks of the same region");
+  auto it = dominanceInfos.find(region);
+  if (it == dominanceInfos.end())
+    return recalculate(region);
+  auto &tree = *it->second;
+
+  // If 'block' is unreachable, then so is 'newBlock'.
+  auto *node = tree.getNode(block);
+  if (!node)
+    return;
+
+  if (!IsPostDom) {
+    // Every path through 'block' now continues to 'newBlock', so 'newBlock'
+    // becomes the immediate dominator of the blocks that 'block' immediately
+    // dominated.
+    SmallVector<Block *, 4> children;
+    for (auto *child : *node)
+      children.push_back(child->getBlock());
+    tree.addNewBlock(newBlock, block);
+    for (auto *child : children)
+      tree.changeImmediateDominator(child, newBlock);
+    return;
+  }
+
+  // 'newBlock' takes the place of 'block' in the postdominator tree, and
+  // becomes the immediate postdominator of 'block'. If 'block' was an exit of
+  // the region, the exits changed, so recalculate instead.
+  auto *postDomBlock = node->getIDom()->getBlock();
+  if (!postDomBlock)
+    return recalculate(region);
+  tree.addNewBlock(newBlock, postDomBlock);
+  tree.changeImmediateDominator(block, newBlock);
+}
+
 /// Return true if the specified block A properly dominates block B.
 template <bool IsPostDom>
 bool DominanceInfoBase<IsPostDom>::properlyDominates(Block *a, Block *b) {
@@ -0,0 +1,203 @@
+//===- Matrix.cpp - Dense matrix of int64_t coefficients ------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/Analysis/Matrix.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace mlir;
+
+constexpr unsigned Matrix::kRowAlignment;
+
+Matrix::Matrix(unsigned rows, unsigned columns, unsigned reservedRows,
+               unsigned reservedColumns)
+    : numRows(rows), numColumns(columns),
+      rowStride(getPaddedStride(std::max(columns, reservedColumns))) {
+  data.reserve(std::max(rows, reservedRows) * rowStride);
+  data.resize(rows * rowStride, 0);
+}
+
+void Matrix::reserveRows(unsigned rows) { data.reserve(rows * rowStride); }
+
+unsigned Matrix::appendExtraRow() {
+  data.resize(data.size() + rowStride, 0);
+  return numRows++;
+}
+
+unsigned Matrix::appendRow(ArrayRef<int64_t> row) {
+  assert(row.size() == numColumns && "incorrect row size");
+  unsigned pos = appendExtraRow();
+  std::copy(row.begin(), row.end(), data.data() + pos * rowStride);
+  return pos;
+}
+
+void Matrix::removeRow(unsigned pos) {
+  assert(pos < numRows && "invalid row position");
+  data.erase(data.begin() + pos * rowStride,
+             data.begin() + (pos + 1) * rowStride);
+  --numRows;
+}
+
+void Matrix::resizeVertically(unsigned newNumRows) {
+  numRows = newNumRows;
+  data.resize(numRows * rowStride, 0);
+}
+
+void Matrix::copyRow(unsigned src, unsigned dest) {
+  if (src == dest)
+    return;
+  std::copy_n(data.data() + src * rowStride, rowStride,
+              data.data() + dest * rowStride);
+}
+
+void Matrix::setRowStride(unsigned newStride) {
+  if (newStride == rowStride)
+    return;
+  unsigned numToMove = std::min(rowStride, newStride);
+  if (newStride > rowStride) {
+    // Move the rows down starting from the last one, so that no row gets
+    // overwritten before being moved.
+    data.resize(numRows * newStride, 0);
+    for (int r = numRows - 1; r >= 1; --r) {
+      auto *src = data.data() + r * rowStride;
+      auto *dest = data.data() + r * newStride;
+      std::copy_backward(src, src + numToMove, dest + numToMove);
+      std::fill(dest + numToMove, dest + newStride, 0);
+    }
+    if (numRows != 0)
+      std::fill(data.data() + numToMove, data.data() + newStride, 0);
+  } else {
+    for (unsigned r = 1; r < numRows; ++r)
+      std::copy_n(data.data() + r * rowStride, numToMove,
+                  data.data() + r * newStride);
+    data.resize(numRows * newStride);
+  }
+  rowStride = newStride;
+}
+
+void Matrix::insertColumns(unsigned pos, unsigned count) {
+  assert(pos <= numColumns && "invalid column position");
+  if (count == 0)
+    return;
+  unsigned newNumColumns = numColumns + count;
+  if (newNumColumns > rowStride)
+    setRowStride(getPaddedStride(std::max(newNumColumns, 2 * rowStride)));
+  for (unsigned r = 0; r < numRows; ++r) {
+    auto *row = data.data() + r * rowStride;
+    std::copy_backward(row + pos, row + numColumns, row + newNumColumns);
+    std::fill(row + pos, row + pos + count, 0);
+  }
+  numColumns = newNumColumns;
+}
+
+void Matrix::removeColumns(unsigned pos, unsigned count) {
+  assert(pos + count <= numColumns && "invalid column range");
+  if (count == 0)
+    return;
+  for (unsigned r = 0; r < numRows; ++r) {
+    auto *row = data.data() + r * rowStride;
+    std::copy(row + pos + count, row + numColumns, row + pos);
+    // Keep the padding zero.
+    std::fill(row + numColumns - count, row + numColumns, 0);
+  }
+  numColumns -= count;
+}
+
+void Matrix::resizeHorizontally(unsigned newNumColumns) {
+  if (newNumColumns < numColumns)
+    removeColumns(newNumColumns, numColumns - newNumColumns);
+  else
+    insertColumns(numColumns, newNumColumns - numColumns);
+}
+
+void Matrix::print(raw_ostream &os) const {
+  for (unsigned r = 0; r < numRows; ++r) {
+    for (unsigned c = 0; c < numColumns; ++c)
+      os << at(r, c) << ' ';
+    os << '\n';
+  }
+}
+
+void Matrix::dump() const { print(llvm::errs()); }
+
+//===----------------------------------------------------------------------===//
+// Row operations.
+//===----------------------------------------------------------------------===//
+
+/// Returns the absolute value of 'value', which doesn't overflow for INT64_MIN.
+static uint64_t absValue(int64_t value) {
+  return value < 0 ? -static_cast<uint64_t>(value) : value;
+}
+
+uint64_t mlir::getGCDOfAbsValues(ArrayRef<int64_t> row) {
+  uint64_t gcd = 0;
+  for (int64_t value : row) {
+    if (value == 0)
+      continue;
+    gcd = llvm::GreatestCommonDivisor64(gcd, absValue(value));
+    // Most constraints have a unit coefficient.
+    if (gcd == 1)
+      break;
+  }
+  return gcd;
+}
+
+void mlir::divideExactly(MutableArrayRef<int64_t> row, uint64_t divisor) {
+  assert(divisor > 0 && "expected a positive divisor");
+  if (divisor == 1)
+    return;
+  // Write the divisor as 2^shift * odd. Since the division is exact, it is an
+  // arithmetic shift followed by a multiplication by the inverse of 'odd'
+  // modulo 2^64, which is much cheaper than an integer division.
+  unsigned shift = llvm::countTrailingZeros(divisor);
+  uint64_t odd = divisor >> shift;
+  // Newton's iteration doubles the number of correct low bits of the inverse,
+  // starting from 3 since odd * odd = 1 modulo 8.
+  uint64_t inverse = odd;
+  for (unsigned i = 0; i < 5; ++i)
+    inverse *= 2 - odd * inverse;
+  for (int64_t &value : row)
+    value = static_cast<int64_t>(static_cast<uint64_t>(value >> shift) *
+                                 inverse);
+}
+
+bool mlir::combineRows(int64_t lhsMultiplier, ArrayRef<int64_t> lhs,
+                       int64_t rhsMultiplier, ArrayRef<int64_t> rhs,
+                       MutableArrayRef<int64_t> result) {
+  assert(lhs.size() == rhs.size() && lhs.size() == result.size() &&
+         "mismatched row sizes");
+  // Bound the magnitudes of the rows without branches: 'value ^ (value >> 63)'
+  // is 'value' if it is non-negative and |value| - 1 otherwise, so all the
+  // magnitudes are at most 2^w, where w is the bit width of the or of these.
+  uint64_t lhsBits = 0, rhsBits = 0;
+  for (unsigned i = 0, e = lhs.size(); i < e; ++i) {
+    lhsBits |= static_cast<uint64_t>(lhs[i] ^ (lhs[i] >> 63));
+    rhsBits |= static_cast<uint64_t>(rhs[i] ^ (rhs[i] >> 63));
+  }
+  // Then |multiplier * value| < 2^(w + bit width of |multiplier|), and the sum
+  // of two products below 2^62 fits.
+  auto bitWidth = [](uint64_t value) {
+    return 64 - llvm::countLeadingZeros(value);
+  };
+  if (bitWidth(absValue(lhsMultiplier)) + bitWidth(lhsBits) > 62 ||
+      bitWidth(absValue(rhsMultiplier)) + bitWidth(rhsBits) > 62)
+    return false;
+
+  for (unsigned i = 0, e = lhs.size(); i < e; ++i)
+    result[i] = lhsMultiplier * lhs[i] + rhsMultiplier * rhs[i];
+  return true;
+}
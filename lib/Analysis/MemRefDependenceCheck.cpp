@@ -79,22 +79,32 @@ getDirectionVectorStr(bool ret, unsigned numCommonLoops, unsigned loopNestDepth,
 // "source" access and all subsequent "destination" accesses in
 // 'loadsAndStores'. Emits the result of the dependence check as a note with
 // the source access.
-static void checkDependences(ArrayRef<Operation *> loadsAndStores) {
+static void checkDependences(ArrayRef<Operation *> loadsAndStores,
+                             AffineDependenceGraph &depGraph) {
+  // Run the checks up front, in parallel.
+  std::vector<DependenceQuery> queries;
+  for (auto *srcOpInst : loadsAndStores) {
+    for (auto *dstOpInst : loadsAndStores) {
+      unsigned numCommonLoops =
+          getNumCommonSurroundingLoops(*srcOpInst, *dstOpInst);
+      for (unsigned d = 1; d <= numCommonLoops + 1; ++d)
+        queries.emplace_back(srcOpInst, dstOpInst, d,
+                             /*withComponents=*/true);
+    }
+  }
+  depGraph.computeDependences(queries);
+
   for (unsigned i = 0, e = loadsAndStores.size(); i < e; ++i) {
     auto *srcOpInst = loadsAndStores[i];
-    MemRefAccess srcAccess(srcOpInst);
     for (unsigned j = 0; j < e; ++j) {
       auto *dstOpInst = loadsAndStores[j];
-      MemRefAccess dstAccess(dstOpInst);
 
       unsigned numCommonLoops =
           getNumCommonSurroundingLoops(*srcOpInst, *dstOpInst);
       for (unsigned d = 1; d <= numCommonLoops + 1; ++d) {
-        FlatAffineConstraints dependenceConstraints;
         llvm::SmallVector<DependenceComponent, 2> dependenceComponents;
-        bool ret = checkMemrefAccessDependence(srcAccess, dstAccess, d,
-                                               &dependenceConstraints,
-                                               &dependenceComponents);
+        bool ret = depGraph.hasDependence(srcOpInst, dstOpInst, d,
+                                          &dependenceComponents);
         // TODO(andydavis) Print dependence type (i.e. RAW, etc) and print
         // distance vectors as: ([2, 3], [0, 10]). Also, shorten distance
         // vectors from ([1, 1], [3, 3]) to (1, 3).
@@ -118,7 +128,9 @@ void MemRefDependenceCheck::runOnFunction() {
       loadsAndStores.push_back(op);
   });
 
-  checkDependences(loadsAndStores);
+  checkDependences(loadsAndStores, getAnalysis<AffineDependenceGraph>());
+  // Only notes were emitted.
+  markAllAnalysesPreserved();
 }
 
 static PassRegistration<MemRefDependenceCheck>
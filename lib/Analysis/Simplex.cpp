@@ -0,0 +1,315 @@
+//===- Simplex.cpp - Simplex based emptiness checks -----------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements a simplex tableau deciding the emptiness of the integer
+// set of a FlatAffineConstraints.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Analysis/Simplex.h"
+#include "mlir/Analysis/AffineStructures.h"
+#include "mlir/Support/MathExtras.h"
+
+using namespace mlir;
+
+constexpr unsigned Simplex::kDefaultMaxNodes;
+
+Simplex::Simplex(const FlatAffineConstraints &cst)
+    : numIds(cst.getNumIds()), rowStride(cst.getNumIds() + 2) {
+  unsigned numRows = 2 * cst.getNumEqualities() + cst.getNumInequalities();
+  tableau.reserve(numRows * rowStride);
+  unknowns.reserve(numIds + numRows);
+  rowUnknown.reserve(numRows);
+  for (unsigned id = 0; id < numIds; ++id) {
+    unknowns.push_back({/*isRow=*/false, /*restricted=*/false, id});
+    colUnknown.push_back(id);
+  }
+
+  SmallVector<SmallVector<int64_t, 8>, 4> eqs, ineqs;
+  for (unsigned r = 0, e = cst.getNumEqualities(); r < e; ++r)
+    eqs.emplace_back(cst.getEquality(r).begin(), cst.getEquality(r).end());
+  for (unsigned r = 0, e = cst.getNumInequalities(); r < e; ++r)
+    ineqs.emplace_back(cst.getInequality(r).begin(),
+                       cst.getInequality(r).end());
+
+  // An identifier with a unit coefficient in an equality is an integer affine
+  // function of the other identifiers. Substituting it in the other
+  // constraints and dropping the equality is thus exact on integers, unlike
+  // the rational view of the tableau, and lets the gcd tightening of the
+  // inequalities below see through it.
+  for (unsigned r = 0; r < eqs.size();) {
+    auto &eq = eqs[r];
+    auto *unit =
+        llvm::find_if(ArrayRef<int64_t>(eq).drop_back(),
+                      [](int64_t coeff) { return std::abs(coeff) == 1; });
+    if (unit == eq.end() - 1) {
+      ++r;
+      continue;
+    }
+    unsigned id = unit - eq.begin();
+    auto substitute = [&](SmallVectorImpl<int64_t> &row) {
+      int64_t factor = mul(row[id], eq[id]);
+      if (factor == 0)
+        return;
+      for (unsigned c = 0; c <= numIds; ++c)
+        row[c] = add(row[c], mul(-factor, eq[c]));
+    };
+    for (unsigned other = 0; other < eqs.size(); ++other)
+      if (other != r)
+        substitute(eqs[other]);
+    for (auto &ineq : ineqs)
+      substitute(ineq);
+    eqs.erase(eqs.begin() + r);
+  }
+
+  // An equality is the conjunction of two inequalities.
+  SmallVector<int64_t, 8> negated(numIds + 1);
+  for (auto &eq : eqs) {
+    addInequality(eq);
+    for (unsigned c = 0; c <= numIds; ++c)
+      negated[c] = mul(eq[c], -1);
+    addInequality(negated);
+  }
+  for (auto &ineq : ineqs)
+    addInequality(ineq);
+}
+
+int64_t Simplex::add(int64_t lhs, int64_t rhs) {
+  int64_t result;
+  if (addOverflow(lhs, rhs, result))
+    overflow = true;
+  return result;
+}
+
+int64_t Simplex::mul(int64_t lhs, int64_t rhs) {
+  int64_t result;
+  if (mulOverflow(lhs, rhs, result))
+    overflow = true;
+  return result;
+}
+
+void Simplex::addInequality(ArrayRef<int64_t> coeffs) {
+  assert(coeffs.size() == numIds + 1 && "incorrect number of coefficients");
+  if (empty || overflow)
+    return;
+
+  // Since the identifiers are integers, the constant term can be rounded down
+  // to a multiple of the gcd of the coefficients.
+  uint64_t gcd = 0;
+  for (unsigned id = 0; id < numIds; ++id)
+    gcd = llvm::GreatestCommonDivisor64(gcd, std::abs(coeffs[id]));
+  if (gcd == 0) {
+    if (coeffs[numIds] < 0)
+      empty = true;
+    return;
+  }
+
+  unsigned row = rowUnknown.size();
+  tableau.resize(tableau.size() + rowStride, 0);
+  denominator(row) = 1;
+  constant(row) = floorDiv(coeffs[numIds], static_cast<int64_t>(gcd));
+
+  // Express the constraint in terms of the column unknowns, substituting the
+  // identifiers that are rows.
+  for (unsigned id = 0; id < numIds; ++id) {
+    if (coeffs[id] == 0)
+      continue;
+    int64_t coeff = coeffs[id] / static_cast<int64_t>(gcd);
+    const Unknown &u = unknowns[id];
+    if (!u.isRow) {
+      coefficient(row, u.pos) =
+          add(coefficient(row, u.pos), mul(coeff, denominator(row)));
+      continue;
+    }
+
+    // Bring the new row and the row of the identifier to a common denominator
+    // before adding the latter.
+    int64_t denGcd = llvm::GreatestCommonDivisor64(denominator(row),
+                                                   denominator(u.pos));
+    int64_t scale = denominator(u.pos) / denGcd;
+    int64_t idScale = mul(coeff, denominator(row) / denGcd);
+    denominator(row) = mul(denominator(row), scale);
+    constant(row) =
+        add(mul(constant(row), scale), mul(constant(u.pos), idScale));
+    for (unsigned col = 0; col < numIds; ++col)
+      coefficient(row, col) = add(mul(coefficient(row, col), scale),
+                                  mul(coefficient(u.pos, col), idScale));
+  }
+  normalizeRow(row);
+
+  unknowns.push_back({/*isRow=*/true, /*restricted=*/true, row});
+  rowUnknown.push_back(unknowns.size() - 1);
+  if (!restoreRow(row))
+    empty = true;
+}
+
+bool Simplex::restoreRow(unsigned row) {
+  assert(unknowns[rowUnknown[row]].restricted && "row is not restricted");
+  while (!overflow && constant(row) < 0) {
+    // Find a column moving which increases the row: any column with a
+    // non-zero coefficient if it is unrestricted, since it can move in both
+    // directions, and only those with a positive coefficient otherwise.
+    // Following Bland's rule, the column with the lowest unknown is picked,
+    // which guarantees that the pivots don't cycle.
+    unsigned col = numIds;
+    for (unsigned c = 0; c < numIds; ++c) {
+      int64_t coeff = coefficient(row, c);
+      if (coeff == 0 || (coeff < 0 && unknowns[colUnknown[c]].restricted))
+        continue;
+      if (col == numIds || colUnknown[c] < colUnknown[col])
+        col = c;
+    }
+    // The row is at its maximum and still negative.
+    if (col == numIds)
+      return false;
+    bool increasing = coefficient(row, col) > 0;
+
+    // Find the restricted row that first gets to zero as the column moves,
+    // which is the one to pivot with. The row being restored gets to zero
+    // after -constant / |coefficient|, and is preferred in case of ties.
+    unsigned pivotRow = row;
+    int64_t bestNum = -constant(row), bestDen = std::abs(coefficient(row, col));
+    for (unsigned r = 0, e = rowUnknown.size(); r < e; ++r) {
+      int64_t coeff = coefficient(r, col);
+      if (r == row || coeff == 0 || (coeff > 0) == increasing ||
+          !unknowns[rowUnknown[r]].restricted)
+        continue;
+      int64_t lhs = mul(constant(r), bestDen);
+      int64_t rhs = mul(bestNum, std::abs(coeff));
+      if (lhs < rhs || (lhs == rhs && pivotRow != row &&
+                        rowUnknown[r] < rowUnknown[pivotRow])) {
+        pivotRow = r;
+        bestNum = constant(r);
+        bestDen = std::abs(coeff);
+      }
+    }
+
+    pivot(pivotRow, col);
+    if (pivotRow == row)
+      return true;
+  }
+  return true;
+}
+
+void Simplex::pivot(unsigned row, unsigned col) {
+  unsigned rowUnk = rowUnknown[row], colUnk = colUnknown[col];
+  std::swap(rowUnknown[row], colUnknown[col]);
+  unknowns[rowUnk].isRow = false;
+  unknowns[rowUnk].pos = col;
+  unknowns[colUnk].isRow = true;
+  unknowns[colUnk].pos = row;
+
+  // The row 'R = (k + a * C + sum_j a_j * U_j) / d' becomes the row of the
+  // column unknown 'C = (-k + d * R - sum_j a_j * U_j) / a'.
+  int64_t a = coefficient(row, col);
+  assert(a != 0 && "pivot on a zero coefficient");
+  coefficient(row, col) = denominator(row);
+  denominator(row) = a;
+  constant(row) = mul(constant(row), -1);
+  for (unsigned c = 0; c < numIds; ++c)
+    if (c != col)
+      coefficient(row, c) = mul(coefficient(row, c), -1);
+  if (a < 0) {
+    for (unsigned i = row * rowStride, e = i + rowStride; i < e; ++i)
+      tableau[i] = mul(tableau[i], -1);
+  }
+  normalizeRow(row);
+
+  // Substitute the new row for the column unknown in all other rows.
+  for (unsigned r = 0, e = rowUnknown.size(); r < e; ++r) {
+    int64_t b = coefficient(r, col);
+    if (r == row || b == 0)
+      continue;
+    denominator(r) = mul(denominator(r), denominator(row));
+    constant(r) =
+        add(mul(constant(r), denominator(row)), mul(b, constant(row)));
+    for (unsigned c = 0; c < numIds; ++c) {
+      if (c == col)
+        coefficient(r, c) = mul(b, coefficient(row, c));
+      else
+        coefficient(r, c) = add(mul(coefficient(r, c), denominator(row)),
+                                mul(b, coefficient(row, c)));
+    }
+    normalizeRow(r);
+  }
+}
+
+void Simplex::normalizeRow(unsigned row) {
+  uint64_t gcd = 0;
+  for (unsigned i = row * rowStride, e = i + rowStride; i < e && gcd != 1; ++i)
+    gcd = llvm::GreatestCommonDivisor64(gcd, std::abs(tableau[i]));
+  if (gcd <= 1)
+    return;
+  for (unsigned i = row * rowStride, e = i + rowStride; i < e; ++i)
+    tableau[i] /= static_cast<int64_t>(gcd);
+}
+
+Simplex::Result Simplex::isRationalEmpty() const {
+  if (overflow)
+    return Result::Unknown;
+  return empty ? Result::Empty : Result::NonEmpty;
+}
+
+Simplex::Result Simplex::isIntegerEmpty(unsigned maxNodes) const {
+  return branchAndBound(maxNodes);
+}
+
+Simplex::Result Simplex::branchAndBound(unsigned &budget) const {
+  if (overflow)
+    return Result::Unknown;
+  if (empty)
+    return Result::Empty;
+
+  // The sample point is an integer solution unless an identifier has a
+  // fractional value. Column unknowns are zero.
+  for (unsigned id = 0; id < numIds; ++id) {
+    const Unknown &u = unknowns[id];
+    if (!u.isRow || constant(u.pos) % denominator(u.pos) == 0)
+      continue;
+    if (budget == 0)
+      return Result::Unknown;
+    --budget;
+
+    // Split the set into the parts where the identifier is at most and at
+    // least the integers surrounding its value.
+    int64_t bound = floorDiv(constant(u.pos), denominator(u.pos));
+    SmallVector<int64_t, 8> lowerPart(numIds + 1, 0);
+    SmallVector<int64_t, 8> upperPart(numIds + 1, 0);
+    lowerPart[id] = -1;
+    lowerPart[numIds] = bound;
+    upperPart[id] = 1;
+    upperPart[numIds] = -bound - 1;
+
+    // Explore the part closest to the value first.
+    int64_t fraction = constant(u.pos) - bound * denominator(u.pos);
+    if (fraction > denominator(u.pos) - fraction)
+      std::swap(lowerPart, upperPart);
+    Simplex first(*this);
+    first.addInequality(lowerPart);
+    Result firstResult = first.branchAndBound(budget);
+    if (firstResult == Result::NonEmpty)
+      return firstResult;
+
+    Simplex second(*this);
+    second.addInequality(upperPart);
+    Result secondResult = second.branchAndBound(budget);
+    if (secondResult != Result::Empty)
+      return secondResult;
+    return firstResult;
+  }
+  return Result::NonEmpty;
+}
@@ -0,0 +1,169 @@
+//===- TestEmptinessCheck.cpp - Test the emptiness checks -----------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements a pass that runs the emptiness checks of
+// FlatAffineConstraints on the constraint systems of the memref accesses of a
+// function, and compares the Fourier-Motzkin and simplex procedures.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/AffineOps/AffineOps.h"
+#include "mlir/Analysis/AffineAnalysis.h"
+#include "mlir/Analysis/AffineStructures.h"
+#include "mlir/Analysis/Passes.h"
+#include "mlir/Analysis/Utils.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/StandardOps/Ops.h"
+#include "llvm/Support/CommandLine.h"
+#include <chrono>
+
+using namespace mlir;
+
+static llvm::cl::opt<bool> clPrintTiming(
+    "test-emptiness-check-timing",
+    llvm::cl::desc("Report the time spent in each emptiness check"),
+    llvm::cl::init(false));
+
+namespace {
+
+/// Collects the constraint systems of the dependence checks between all pairs
+/// of memref accesses of a function, and of the memref regions they access,
+/// and checks them for emptiness with both Fourier-Motzkin elimination and the
+/// simplex. An error is emitted if elimination finds a system empty but the
+/// simplex, which is exact on integers, doesn't.
+struct TestEmptinessCheck : public FunctionPass<TestEmptinessCheck> {
+  void runOnFunction() override;
+
+  /// Check 'cst', the constraint system of a check involving 'op'.
+  void check(const FlatAffineConstraints &cst, Operation *op);
+
+  /// The number of systems checked, and found empty by each procedure.
+  unsigned numSystems, numEmptyFM, numEmptySimplex;
+
+  /// The time spent in each procedure.
+  std::chrono::nanoseconds timeFM, timeSimplex;
+};
+
+} // end anonymous namespace
+
+FunctionPassBase *mlir::createEmptinessCheckTestPass() {
+  return new TestEmptinessCheck();
+}
+
+void TestEmptinessCheck::check(const FlatAffineConstraints &cst,
+                               Operation *op) {
+  using EmptinessCheck = FlatAffineConstraints::EmptinessCheck;
+  using Clock = std::chrono::steady_clock;
+  ++numSystems;
+
+  auto start = Clock::now();
+  bool emptyFM = cst.isEmpty(EmptinessCheck::FourierMotzkin);
+  auto mid = Clock::now();
+  bool emptySimplex = cst.isEmpty(EmptinessCheck::Simplex);
+  timeFM += mid - start;
+  timeSimplex += Clock::now() - mid;
+  numEmptyFM += emptyFM;
+  numEmptySimplex += emptySimplex;
+
+  // Elimination is exact on the rational set, so it may only miss integer
+  // emptiness.
+  if (emptyFM && !emptySimplex) {
+    op->emitError("constraint system found empty by Fourier-Motzkin "
+                  "elimination but not by the simplex");
+    signalPassFailure();
+  }
+}
+
+/// Returns true if the constraint systems of the given load or store can be
+/// built: its memref isn't 0-d, its composed access function is affine, and
+/// its iteration domain has no local identifiers.
+static bool isSupportedAccess(Operation *op) {
+  MemRefAccess access(op);
+  if (access.getRank() == 0 ||
+      !llvm::all_of(access.indices, [](Value *index) {
+        return isValidDim(index) || isValidSymbol(index);
+      }))
+    return false;
+
+  AffineValueMap accessMap;
+  access.getAccessMap(&accessMap);
+  if (!llvm::all_of(accessMap.getAffineMap().getResults(),
+                    [](AffineExpr expr) { return expr.isPureAffine(); }))
+    return false;
+
+  SmallVector<AffineForOp, 4> loops;
+  getLoopIVs(*op, &loops);
+  FlatAffineConstraints domain;
+  return succeeded(getIndexSet(loops, &domain)) &&
+         domain.getNumLocalIds() == 0;
+}
+
+void TestEmptinessCheck::runOnFunction() {
+  numSystems = numEmptyFM = numEmptySimplex = 0;
+  timeFM = timeSimplex = std::chrono::nanoseconds(0);
+
+  SmallVector<Operation *, 8> loadsAndStores;
+  getFunction().walk([&](Operation *op) {
+    if ((op->isa<LoadOp>() || op->isa<StoreOp>()) && isSupportedAccess(op))
+      loadsAndStores.push_back(op);
+  });
+
+  for (auto *srcOp : loadsAndStores) {
+    // The region accessed over the whole function.
+    MemRefRegion region(srcOp->getLoc());
+    if (succeeded(region.compute(srcOp, /*loopDepth=*/0)))
+      check(*region.getConstraints(), srcOp);
+
+    // The dependences to every access, including read-after-read ones. Checks
+    // that are answered without building a system leave it empty.
+    MemRefAccess srcAccess(srcOp);
+    for (auto *dstOp : loadsAndStores) {
+      MemRefAccess dstAccess(dstOp);
+      unsigned numCommonLoops = getNumCommonSurroundingLoops(*srcOp, *dstOp);
+      for (unsigned d = 1; d <= numCommonLoops + 1; ++d) {
+        FlatAffineConstraints cst;
+        checkMemrefAccessDependence(srcAccess, dstAccess, d, &cst,
+                                    /*dependenceComponents=*/nullptr,
+                                    /*allowRAR=*/true);
+        if (cst.getNumConstraints() != 0)
+          check(cst, srcOp);
+      }
+    }
+  }
+
+  if (numSystems == 0)
+    return markAllAnalysesPreserved();
+  std::string message;
+  llvm::raw_string_ostream os(message);
+  os << numSystems << " constraint systems, " << numEmptyFM
+     << " empty by Fourier-Motzkin, " << numEmptySimplex
+     << " empty by the simplex";
+  if (clPrintTiming) {
+    using std::chrono::microseconds;
+    os << " (" << std::chrono::duration_cast<microseconds>(timeFM).count()
+       << " us vs "
+       << std::chrono::duration_cast<microseconds>(timeSimplex).count()
+       << " us)";
+  }
+  getFunction().emitNote(os.str());
+  markAllAnalysesPreserved();
+}
+
+static PassRegistration<TestEmptinessCheck>
+    pass("test-emptiness-check",
+         "Compare the emptiness checks of FlatAffineConstraints on the "
+         "constraint systems of memref accesses");
@@ -20,6 +20,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "mlir/AffineOps/AffineOps.h"
+#include "mlir/Analysis/AffineAnalysis.h"
 #include "mlir/Analysis/Passes.h"
 #include "mlir/Analysis/Utils.h"
 #include "mlir/IR/Builders.h"
@@ -45,8 +46,9 @@ FunctionPassBase *mlir::createParallelismDetectionTestPass() {
 void TestParallelismDetection::runOnFunction() {
   Function &f = getFunction();
   FuncBuilder b(f);
+  auto &depGraph = getAnalysis<AffineDependenceGraph>();
   f.walk<AffineForOp>([&](AffineForOp forOp) {
-    if (isLoopParallel(forOp))
+    if (isLoopParallel(forOp, &depGraph))
       forOp.emitNote("parallel loop");
   });
 }
@@ -29,6 +29,7 @@
 #include "mlir/StandardOps/Ops.h"
 #include "llvm/ADT/DenseMap.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 
 #define DEBUG_TYPE "analysis-utils"
@@ -737,15 +738,17 @@ Optional<int64_t> mlir::getMemoryFootprintBytes(AffineForOp forOp,
 /// at 'forOp'.
 void mlir::getSequentialLoops(
     AffineForOp forOp, llvm::SmallDenseSet<Value *, 8> *sequentialLoops) {
+  // The loops of the nest check dependences between the same accesses.
+  AffineDependenceGraph depGraph;
   forOp.getOperation()->walk([&](Operation *op) {
     if (auto innerFor = op->dyn_cast<AffineForOp>())
-      if (!isLoopParallel(innerFor))
+      if (!isLoopParallel(innerFor, &depGraph))
         sequentialLoops->insert(innerFor.getInductionVar());
   });
 }
 
 /// Returns true if 'forOp' is parallel.
-bool mlir::isLoopParallel(AffineForOp forOp) {
+bool mlir::isLoopParallel(AffineForOp forOp, AffineDependenceGraph *depGraph) {
   // Collect all load and store ops in loop nest rooted at 'forOp'.
   SmallVector<Operation *, 8> loadAndStoreOpInsts;
   forOp.getOperation()->walk([&](Operation *opInst) {
@@ -757,16 +760,22 @@ bool mlir::isLoopParallel(AffineForOp forOp) {
   unsigned depth = getNestingDepth(*forOp.getOperation()) + 1;
 
   // Check dependences between all pairs of ops in 'loadAndStoreOpInsts'.
-  for (auto *srcOpInst : loadAndStoreOpInsts) {
-    MemRefAccess srcAccess(srcOpInst);
-    for (auto *dstOpInst : loadAndStoreOpInsts) {
-      MemRefAccess dstAccess(dstOpInst);
-      FlatAffineConstraints dependenceConstraints;
-      if (checkMemrefAccessDependence(srcAccess, dstAccess, depth,
-                                      &dependenceConstraints,
-                                      /*dependenceComponents=*/nullptr))
-        return false;
-    }
+  AffineDependenceGraph localDepGraph;
+  if (!depGraph)
+    depGraph = &localDepGraph;
+
+  // Run the checks up front, in parallel, when threading is enabled. Otherwise
+  // run them one at a time, stopping at the first dependence.
+  if (llvm::llvm_is_multithreaded()) {
+    std::vector<DependenceQuery> queries;
+    for (auto *srcOpInst : loadAndStoreOpInsts)
+      for (auto *dstOpInst : loadAndStoreOpInsts)
+        queries.emplace_back(srcOpInst, dstOpInst, depth);
+    depGraph->computeDependences(queries);
   }
+  for (auto *srcOpInst : loadAndStoreOpInsts)
+    for (auto *dstOpInst : loadAndStoreOpInsts)
+      if (depGraph->hasDependence(srcOpInst, dstOpInst, depth))
+        return false;
   return true;
 }
@@ -0,0 +1,120 @@
+//===- BytecodeDetail.h - MLIR bytecode encoding details --------*- C++ -*-===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file defines the constants shared by the bytecode reader and writer.
+//
+// All integers are encoded as unsigned LEB128 varints, and all blobs as a
+// varint size followed by the bytes. A bytecode file is laid out as:
+//
+//   bytecode ::= magic version string-section type-section attribute-section
+//                location-section function-section function-attr-section
+//                function-bodies
+//
+//   string-section    ::= count blob*
+//   type-section      ::= count string-id*
+//   attribute-section ::= count blob*     (an attribute entry each)
+//   location-section  ::= count blob*     (a location entry each)
+//   function-section  ::= count (name-id type-id loc-id body-offset body-size)*
+//   function-attr-section ::= (attr-list attr-list*)*  (the function, then
+//                                                       each argument)
+//   attr-list         ::= count (string-id attr-id)*
+//
+// Attribute and location entries start with one of the codes below, and may
+// only refer to entries that precede them. Types, and attributes without a
+// dedicated encoding, are stored as their textual form.
+//
+// A function body holds the number of values defined in the function followed
+// by its region:
+//
+//   region    ::= count block*
+//   block     ::= count type-id* count operation*    (arguments, operations)
+//   operation ::= name-id loc-id flags count type-id* (results)
+//                 count operand*                        (operands)
+//                 count (block-id count operand*)*      (successors)
+//                 attr-list count region*               (regions)
+//   operand   ::= value-id type-id?
+//
+// Values are numbered in the order they are defined: block arguments when
+// their block starts, and operation results before the regions of their
+// operation. An operand referring to a value that isn't defined yet carries
+// the type of the value. Successors refer to blocks by their index in the
+// enclosing region.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef MLIR_BYTECODE_BYTECODEDETAIL_H_
+#define MLIR_BYTECODE_BYTECODEDETAIL_H_
+
+#include <cstdint>
+
+namespace mlir {
+namespace detail {
+namespace bytecode {
+
+/// The magic number at the start of every bytecode file.
+static const char kMagic[] = {'M', 'L', 'I', 'R', 'b', 'c'};
+
+/// The version of the encoding, which is bumped for every incompatible change.
+static const uint64_t kVersion = 1;
+
+/// The codes of attribute entries.
+enum class AttributeCode : uint8_t {
+  /// The textual form of the attribute: string-id.
+  Text,
+  /// bool: byte.
+  Bool,
+  /// integer: type-id count word*.
+  Integer,
+  /// float, with the bits of its value: type-id count word*.
+  Float,
+  /// string: string-id.
+  String,
+  /// type: type-id.
+  Type,
+  /// array: count attr-id*.
+  Array,
+  /// function reference: function-id.
+  Function,
+  /// dense elements, with their raw packed storage: type-id blob.
+  DenseElements,
+};
+
+/// The codes of location entries.
+enum class LocationCode : uint8_t {
+  /// unknown.
+  Unknown,
+  /// file-line-col: string-id line column.
+  FileLineCol,
+  /// name: string-id.
+  Name,
+  /// call-site: loc-id loc-id.
+  CallSite,
+  /// fused: count loc-id* (attr-id + 1, or 0 if there is no metadata).
+  Fused,
+};
+
+/// The flags of an operation.
+enum OperationFlags : uint8_t {
+  /// The operation has a resizable operand list.
+  ResizableOperandList = 1 << 0,
+};
+
+} // end namespace bytecode
+} // end namespace detail
+} // end namespace mlir
+
+#endif // MLIR_BYTECODE_BYTECODEDETAIL_H_
@@ -0,0 +1,864 @@
+//===- BytecodeReader.cpp - MLIR bytecode reader --------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements the reader of the binary bytecode format.
+//
+//===----------------------------------------------------------------------===//
+
+#include "BytecodeDetail.h"
+#include "mlir/Bytecode/Bytecode.h"
+#include "mlir/IR/Attributes.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/Location.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Module.h"
+#include "mlir/IR/StandardTypes.h"
+#include "mlir/Parser.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+using namespace mlir;
+using namespace mlir::detail;
+using namespace mlir::detail::bytecode;
+
+/// Returns true if the given buffer holds a module in the bytecode format.
+bool mlir::isBytecode(StringRef buffer) {
+  return buffer.startswith(StringRef(kMagic, sizeof(kMagic)));
+}
+
+namespace {
+/// This class decodes the varints and blobs of a range of bytecode, emitting
+/// an error if the range is malformed.
+class EncodingReader {
+public:
+  EncodingReader(StringRef data, MLIRContext *context)
+      : data(data), context(context) {}
+
+  /// Returns true if the whole range has been read.
+  bool empty() const { return data.empty(); }
+
+  /// Returns the remaining bytes of the range.
+  StringRef getRemaining() const { return data; }
+
+  /// Emit an error about malformed bytecode.
+  LogicalResult emitError(const Twine &message) {
+    context->emitError(UnknownLoc::get(context),
+                       "malformed bytecode: " + message);
+    return failure();
+  }
+
+  LogicalResult parseByte(uint8_t &result) {
+    if (data.empty())
+      return emitError("unexpected end of data");
+    result = data.front();
+    data = data.drop_front();
+    return success();
+  }
+
+  LogicalResult parseVarInt(uint64_t &result) {
+    const char *error = nullptr;
+    unsigned size = 0;
+    auto *bytes = reinterpret_cast<const uint8_t *>(data.data());
+    result = llvm::decodeULEB128(bytes, &size, bytes + data.size(), &error);
+    if (error)
+      return emitError(error);
+    data = data.drop_front(size);
+    return success();
+  }
+
+  /// Parse a varint that must be less than the given bound.
+  LogicalResult parseIndex(uint64_t &result, uint64_t bound,
+                           StringRef entityName) {
+    if (failed(parseVarInt(result)))
+      return failure();
+    if (result >= bound)
+      return emitError("invalid " + entityName + " index " + Twine(result));
+    return success();
+  }
+
+  /// Parse the number of entries of a list. Every entry takes at least one
+  /// byte, which bounds the count by the size of the remaining data.
+  LogicalResult parseCount(uint64_t &result) {
+    if (failed(parseVarInt(result)))
+      return failure();
+    if (result > data.size())
+      return emitError("invalid count " + Twine(result));
+    return success();
+  }
+
+  LogicalResult parseBytes(uint64_t size, StringRef &result) {
+    if (size > data.size())
+      return emitError("unexpected end of data");
+    result = data.take_front(size);
+    data = data.drop_front(size);
+    return success();
+  }
+
+  LogicalResult parseBlob(StringRef &result) {
+    uint64_t size;
+    if (failed(parseVarInt(size)))
+      return failure();
+    return parseBytes(size, result);
+  }
+
+private:
+  StringRef data;
+  MLIRContext *context;
+};
+
+class FunctionBodyReader;
+} // end anonymous namespace
+
+//===----------------------------------------------------------------------===//
+// BytecodeReaderImpl
+//===----------------------------------------------------------------------===//
+
+namespace mlir {
+namespace detail {
+class BytecodeReaderImpl {
+public:
+  BytecodeReaderImpl(std::unique_ptr<llvm::MemoryBuffer> buffer,
+                     MLIRContext *context)
+      : buffer(std::move(buffer)), context(context) {}
+
+  Module *readModule(bool lazy);
+  LogicalResult materialize(Function *function);
+  LogicalResult materializeAll();
+
+  /// The bodies of the functions that haven't been materialized yet.
+  llvm::DenseMap<Function *, StringRef> pendingBodies;
+
+private:
+  /// Parse the sections of the bytecode in front of the function bodies.
+  LogicalResult parseTables(EncodingReader &reader);
+
+  /// Return the entity with the given index, decoding it if necessary.
+  LogicalResult getType(EncodingReader &reader, Type &result);
+  LogicalResult getAttribute(EncodingReader &reader, Attribute &result);
+  LogicalResult getLocation(EncodingReader &reader, Optional<Location> &result);
+  LogicalResult getString(EncodingReader &reader, StringRef &result);
+  LogicalResult getAttribute(uint64_t index, Attribute &result);
+  LogicalResult getLocation(uint64_t index, Optional<Location> &result);
+
+  /// Parse a list of named attributes.
+  LogicalResult parseAttributeList(EncodingReader &reader,
+                                   SmallVectorImpl<NamedAttribute> &attrs);
+
+  /// The buffer holding the bytecode.
+  std::unique_ptr<llvm::MemoryBuffer> buffer;
+
+  MLIRContext *context;
+
+  /// The string table.
+  std::vector<StringRef> strings;
+
+  /// The string ids of the types, and the decoded types.
+  std::vector<uint64_t> typeStringIds;
+  std::vector<Type> types;
+
+  /// The encoded and decoded entries of the attribute and location tables.
+  std::vector<StringRef> attributeEntries, locationEntries;
+  std::vector<Attribute> attributes;
+  std::vector<const void *> locations;
+
+  /// The functions of the module, in the order of the function table.
+  std::vector<Function *> functions;
+
+  /// The range of the function bodies.
+  StringRef bodies;
+
+  friend class ::FunctionBodyReader;
+};
+} // end namespace detail
+} // end namespace mlir
+
+LogicalResult BytecodeReaderImpl::getString(EncodingReader &reader,
+                                            StringRef &result) {
+  uint64_t index;
+  if (failed(reader.parseIndex(index, strings.size(), "string")))
+    return failure();
+  result = strings[index];
+  return success();
+}
+
+LogicalResult BytecodeReaderImpl::getType(EncodingReader &reader,
+                                          Type &result) {
+  uint64_t index;
+  if (failed(reader.parseIndex(index, types.size(), "type")))
+    return failure();
+  if (!types[index]) {
+    types[index] = parseType(strings[typeStringIds[index]], context);
+    if (!types[index])
+      return failure();
+  }
+  result = types[index];
+  return success();
+}
+
+LogicalResult BytecodeReaderImpl::getAttribute(EncodingReader &reader,
+                                               Attribute &result) {
+  uint64_t index;
+  if (failed(reader.parseIndex(index, attributes.size(), "attribute")))
+    return failure();
+  return getAttribute(index, result);
+}
+
+LogicalResult BytecodeReaderImpl::getAttribute(uint64_t index,
+                                               Attribute &result) {
+  if ((result = attributes[index]))
+    return success();
+
+  // Decode the entry. Attributes may only refer to attributes that precede
+  // them, which rules out cycles.
+  EncodingReader reader(attributeEntries[index], context);
+  uint8_t code;
+  if (failed(reader.parseByte(code)))
+    return failure();
+  switch (AttributeCode(code)) {
+  case AttributeCode::Text: {
+    StringRef text;
+    if (failed(getString(reader, text)))
+      return failure();
+    result = parseAttribute(text, context);
+    if (!result)
+      return failure();
+    break;
+  }
+  case AttributeCode::Bool: {
+    uint8_t value;
+    if (failed(reader.parseByte(value)))
+      return failure();
+    result = BoolAttr::get(value != 0, context);
+    break;
+  }
+  case AttributeCode::Integer:
+  case AttributeCode::Float: {
+    Type type;
+    uint64_t numWords;
+    if (failed(getType(reader, type)) || failed(reader.parseVarInt(numWords)))
+      return failure();
+
+    // BF16 values are stored with double semantics, and so use 64 bits.
+    if (!type.isIntOrIndexOrFloat())
+      return reader.emitError("invalid type of scalar attribute");
+    unsigned bitWidth = type.isIndex() || type.isBF16()
+                            ? 64
+                            : type.getIntOrFloatBitWidth();
+    if (numWords != APInt::getNumWords(bitWidth))
+      return reader.emitError("invalid width of scalar attribute");
+
+    SmallVector<uint64_t, 2> words(numWords);
+    for (auto &word : words)
+      if (failed(reader.parseVarInt(word)))
+        return failure();
+    APInt value(bitWidth, words);
+
+    if (AttributeCode(code) == AttributeCode::Integer) {
+      if (!type.isIntOrIndex())
+        return reader.emitError("invalid type of integer attribute");
+      result = IntegerAttr::get(type, value);
+    } else {
+      auto floatType = type.dyn_cast<FloatType>();
+      if (!floatType)
+        return reader.emitError("invalid type of float attribute");
+      result = FloatAttr::get(type, APFloat(floatType.getFloatSemantics(),
+                                            value));
+    }
+    break;
+  }
+  case AttributeCode::String: {
+    StringRef value;
+    if (failed(getString(reader, value)))
+      return failure();
+    result = StringAttr::get(value, context);
+    break;
+  }
+  case AttributeCode::Type: {
+    Type type;
+    if (failed(getType(reader, type)))
+      return failure();
+    result = TypeAttr::get(type, context);
+    break;
+  }
+  case AttributeCode::Array: {
+    uint64_t numElements;
+    if (failed(reader.parseCount(numElements)))
+      return failure();
+    SmallVector<Attribute, 8> elements;
+    for (uint64_t i = 0; i != numElements; ++i) {
+      uint64_t elementIndex;
+      Attribute element;
+      if (failed(reader.parseIndex(elementIndex, index, "attribute")) ||
+          failed(getAttribute(elementIndex, element)))
+        return failure();
+      elements.push_back(element);
+    }
+    result = ArrayAttr::get(elements, context);
+    break;
+  }
+  case AttributeCode::Function: {
+    uint64_t functionIndex;
+    if (failed(reader.parseIndex(functionIndex, functions.size(), "function")))
+      return failure();
+    result = FunctionAttr::get(functions[functionIndex], context);
+    break;
+  }
+  case AttributeCode::DenseElements: {
+    Type type;
+    StringRef rawData;
+    if (failed(getType(reader, type)) || failed(reader.parseBlob(rawData)))
+      return failure();
+
+    // Check that the data has the size of the storage of the attribute.
+    auto elementsType = type.dyn_cast<VectorOrTensorType>();
+    if (!elementsType || !elementsType.hasStaticShape())
+      return reader.emitError("invalid type of dense elements attribute");
+    auto elementType = elementsType.getElementType();
+    if (!elementType.isa<IntegerType>() && !elementType.isa<FloatType>())
+      return reader.emitError("invalid type of dense elements attribute");
+    size_t bitWidth =
+        elementType.isBF16() ? 64 : elementType.getIntOrFloatBitWidth();
+    size_t numBits = bitWidth * elementsType.getNumElements();
+    if (rawData.size() != APInt::getNumWords(numBits) * APInt::APINT_WORD_SIZE)
+      return reader.emitError("invalid size of dense elements attribute");
+    result = DenseElementsAttr::get(
+        elementsType, ArrayRef<char>(rawData.data(), rawData.size()));
+    break;
+  }
+  default:
+    return reader.emitError("unknown attribute code " + Twine(code));
+  }
+
+  attributes[index] = result;
+  return success();
+}
+
+LogicalResult BytecodeReaderImpl::getLocation(EncodingReader &reader,
+                                              Optional<Location> &result) {
+  uint64_t index;
+  if (failed(reader.parseIndex(index, locations.size(), "location")))
+    return failure();
+  return getLocation(index, result);
+}
+
+LogicalResult BytecodeReaderImpl::getLocation(uint64_t index,
+                                              Optional<Location> &result) {
+  if (locations[index]) {
+    result = Location::getFromOpaquePointer(locations[index]);
+    return success();
+  }
+
+  // Decode the entry. Locations may only refer to locations that precede
+  // them, which rules out cycles.
+  EncodingReader reader(locationEntries[index], context);
+  auto parseNestedLocation = [&](Optional<Location> &nested) {
+    uint64_t nestedIndex;
+    if (failed(reader.parseIndex(nestedIndex, index, "location")))
+      return failure();
+    return getLocation(nestedIndex, nested);
+  };
+
+  uint8_t code;
+  if (failed(reader.parseByte(code)))
+    return failure();
+  switch (LocationCode(code)) {
+  case LocationCode::Unknown:
+    result = UnknownLoc::get(context);
+    break;
+  case LocationCode::FileLineCol: {
+    StringRef filename;
+    uint64_t line, column;
+    if (failed(getString(reader, filename)) ||
+        failed(reader.parseVarInt(line)) || failed(reader.parseVarInt(column)))
+      return failure();
+    result = FileLineColLoc::get(UniquedFilename::get(filename, context), line,
+                                 column, context);
+    break;
+  }
+  case LocationCode::Name: {
+    StringRef name;
+    if (failed(getString(reader, name)))
+      return failure();
+    result = NameLoc::get(Identifier::get(name, context), context);
+    break;
+  }
+  case LocationCode::CallSite: {
+    Optional<Location> callee, caller;
+    if (failed(parseNestedLocation(callee)) ||
+        failed(parseNestedLocation(caller)))
+      return failure();
+    result = CallSiteLoc::get(*callee, *caller, context);
+    break;
+  }
+  case LocationCode::Fused: {
+    uint64_t numLocations, metadataIndex;
+    if (failed(reader.parseCount(numLocations)))
+      return failure();
+    SmallVector<Location, 4> fusedLocs;
+    for (uint64_t i = 0; i != numLocations; ++i) {
+      Optional<Location> fused;
+      if (failed(parseNestedLocation(fused)))
+        return failure();
+      fusedLocs.push_back(*fused);
+    }
+
+    // The metadata index is offset by one, with zero meaning no metadata.
+    Attribute metadata;
+    if (failed(reader.parseIndex(metadataIndex, attributes.size() + 1,
+                                 "attribute")) ||
+        (metadataIndex && failed(getAttribute(metadataIndex - 1, metadata))))
+      return failure();
+    result = FusedLoc::get(fusedLocs, metadata, context);
+    break;
+  }
+  default:
+    return reader.emitError("unknown location code " + Twine(code));
+  }
+
+  locations[index] = result->getAsOpaquePointer();
+  return success();
+}
+
+LogicalResult BytecodeReaderImpl::parseAttributeList(
+    EncodingReader &reader, SmallVectorImpl<NamedAttribute> &attrs) {
+  uint64_t numAttrs;
+  if (failed(reader.parseCount(numAttrs)))
+    return failure();
+  for (uint64_t i = 0; i != numAttrs; ++i) {
+    StringRef name;
+    Attribute attr;
+    if (failed(getString(reader, name)) || failed(getAttribute(reader, attr)))
+      return failure();
+    attrs.push_back({Identifier::get(name, context), attr});
+  }
+  return success();
+}
+
+LogicalResult BytecodeReaderImpl::parseTables(EncodingReader &reader) {
+  StringRef magic;
+  uint64_t version;
+  if (failed(reader.parseBytes(sizeof(kMagic), magic)) ||
+      !isBytecode(magic) || failed(reader.parseVarInt(version)))
+    return reader.emitError("invalid header");
+  if (version != kVersion)
+    return reader.emitError("unsupported version " + Twine(version) +
+                            ", expected version " + Twine(kVersion));
+
+  // The string table.
+  uint64_t count;
+  if (failed(reader.parseCount(count)))
+    return failure();
+  strings.resize(count);
+  for (auto &str : strings)
+    if (failed(reader.parseBlob(str)))
+      return failure();
+
+  // The type table, whose types are parsed when they are first used.
+  if (failed(reader.parseCount(count)))
+    return failure();
+  typeStringIds.resize(count);
+  types.resize(count);
+  for (auto &stringId : typeStringIds)
+    if (failed(reader.parseIndex(stringId, strings.size(), "string")))
+      return failure();
+
+  // The attribute and location tables, whose entries are also decoded when
+  // they are first used.
+  if (failed(reader.parseCount(count)))
+    return failure();
+  attributeEntries.resize(count);
+  attributes.resize(count);
+  for (auto &entry : attributeEntries)
+    if (failed(reader.parseBlob(entry)))
+      return failure();
+
+  if (failed(reader.parseCount(count)))
+    return failure();
+  locationEntries.resize(count);
+  locations.resize(count);
+  for (auto &entry : locationEntries)
+    if (failed(reader.parseBlob(entry)))
+      return failure();
+  return success();
+}
+
+Module *BytecodeReaderImpl::readModule(bool lazy) {
+  EncodingReader reader(buffer->getBuffer(), context);
+  if (failed(parseTables(reader)))
+    return nullptr;
+
+  // Create the functions of the module, with their bodies left for later.
+  std::unique_ptr<Module> module(new Module(context));
+  uint64_t numFunctions;
+  if (failed(reader.parseCount(numFunctions)))
+    return nullptr;
+  SmallVector<std::pair<uint64_t, uint64_t>, 8> bodyRanges;
+  for (uint64_t i = 0; i != numFunctions; ++i) {
+    StringRef name;
+    Type type;
+    Optional<Location> loc;
+    uint64_t bodyOffset, bodySize;
+    if (failed(getString(reader, name)) || failed(getType(reader, type)) ||
+        failed(getLocation(reader, loc)) ||
+        failed(reader.parseVarInt(bodyOffset)) ||
+        failed(reader.parseVarInt(bodySize)))
+      return nullptr;
+
+    auto fnType = type.dyn_cast<FunctionType>();
+    if (!fnType)
+      return (reader.emitError("invalid type of function"), nullptr);
+    auto *function = new Function(*loc, name, fnType);
+    module->getFunctions().push_back(function);
+    if (function->getName() != name)
+      return (reader.emitError("redefinition of function named '" + name +
+                               "'"),
+              nullptr);
+    functions.push_back(function);
+    bodyRanges.push_back({bodyOffset, bodySize});
+  }
+
+  // Now that all of the functions exist, the attributes referring to them can
+  // be decoded.
+  for (auto *function : functions) {
+    SmallVector<NamedAttribute, 4> attrs;
+    if (failed(parseAttributeList(reader, attrs)))
+      return nullptr;
+    function->setAttrs(attrs);
+    for (unsigned i = 0, e = function->getNumArguments(); i != e; ++i) {
+      attrs.clear();
+      if (failed(parseAttributeList(reader, attrs)))
+        return nullptr;
+      function->setArgAttrs(i, attrs);
+    }
+  }
+
+  // The rest of the bytecode holds the function bodies.
+  bodies = reader.getRemaining();
+  for (unsigned i = 0, e = functions.size(); i != e; ++i) {
+    auto range = bodyRanges[i];
+    if (range.first > bodies.size() ||
+        range.second > bodies.size() - range.first)
+      return (reader.emitError("invalid range of function body"), nullptr);
+    if (range.second != 0)
+      pendingBodies[functions[i]] = bodies.substr(range.first, range.second);
+  }
+
+  if (lazy)
+    return module.release();
+
+  // The bodies are verified as they are materialized, which leaves the
+  // external functions to verify.
+  if (failed(materializeAll()))
+    return nullptr;
+  for (auto *function : functions)
+    if (function->isExternal() && failed(function->verify()))
+      return nullptr;
+  return module.release();
+}
+
+//===----------------------------------------------------------------------===//
+// FunctionBodyReader
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// This class reads the body of a single function.
+class FunctionBodyReader {
+public:
+  FunctionBodyReader(BytecodeReaderImpl &impl, StringRef body)
+      : impl(impl), reader(body, impl.context), context(impl.context) {}
+  ~FunctionBodyReader();
+
+  LogicalResult read(Function *function);
+
+private:
+  LogicalResult readRegion(Region &region);
+  LogicalResult readOperation(Block *block, ArrayRef<Block *> regionBlocks);
+  LogicalResult readOperand(SmallVectorImpl<Value *> &operands);
+
+  /// Define the next value of the function.
+  LogicalResult defineValue(Value *value);
+
+  BytecodeReaderImpl &impl;
+  EncodingReader reader;
+  MLIRContext *context;
+
+  /// The values of the function, indexed by their number, and the number of
+  /// values defined so far.
+  std::vector<Value *> values;
+  unsigned numDefinedValues = 0;
+
+  /// The placeholders of values that are used before they are defined.
+  llvm::DenseMap<Value *, unsigned> forwardRefPlaceholders;
+
+  /// The operation names read so far, indexed by string id.
+  llvm::DenseMap<const char *, OperationName> opNames;
+};
+} // end anonymous namespace
+
+FunctionBodyReader::~FunctionBodyReader() {
+  // Drop the placeholders of any values that were never defined.
+  for (auto &placeholder : forwardRefPlaceholders) {
+    placeholder.first->dropAllUses();
+    placeholder.first->getDefiningOp()->destroy();
+  }
+}
+
+LogicalResult FunctionBodyReader::read(Function *function) {
+  uint64_t numValues;
+  if (failed(reader.parseCount(numValues)))
+    return failure();
+  values.resize(numValues);
+
+  if (failed(readRegion(function->getBody())))
+    return failure();
+  if (!reader.empty())
+    return reader.emitError("unexpected data after function body");
+  if (!forwardRefPlaceholders.empty())
+    return reader.emitError("use of undefined value");
+  return success();
+}
+
+LogicalResult FunctionBodyReader::defineValue(Value *value) {
+  if (numDefinedValues == values.size())
+    return reader.emitError("too many values defined");
+
+  // If the value was used before, replace the placeholder.
+  Value *&entry = values[numDefinedValues++];
+  if (entry) {
+    forwardRefPlaceholders.erase(entry);
+    entry->replaceAllUsesWith(value);
+    entry->getDefiningOp()->destroy();
+  }
+  entry = value;
+  return success();
+}
+
+LogicalResult FunctionBodyReader::readRegion(Region &region) {
+  // Create all of the blocks up front, so that successors can refer to them.
+  uint64_t numBlocks;
+  if (failed(reader.parseCount(numBlocks)))
+    return failure();
+  SmallVector<Block *, 4> blocks;
+  for (uint64_t i = 0; i != numBlocks; ++i) {
+    blocks.push_back(new Block());
+    region.push_back(blocks.back());
+  }
+
+  for (auto *block : blocks) {
+    uint64_t numArgs, numOps;
+    if (failed(reader.parseCount(numArgs)))
+      return failure();
+    for (uint64_t i = 0; i != numArgs; ++i) {
+      Type type;
+      if (failed(impl.getType(reader, type)) ||
+          failed(defineValue(block->addArgument(type))))
+        return failure();
+    }
+
+    if (failed(reader.parseCount(numOps)))
+      return failure();
+    for (uint64_t i = 0; i != numOps; ++i)
+      if (failed(readOperation(block, blocks)))
+        return failure();
+  }
+  return success();
+}
+
+LogicalResult
+FunctionBodyReader::readOperation(Block *block,
+                                  ArrayRef<Block *> regionBlocks) {
+  StringRef name;
+  Optional<Location> loc;
+  uint8_t flags;
+  if (failed(impl.getString(reader, name)) ||
+      failed(impl.getLocation(reader, loc)) || failed(reader.parseByte(flags)))
+    return failure();
+
+  // Results.
+  uint64_t numResults;
+  if (failed(reader.parseCount(numResults)))
+    return failure();
+  SmallVector<Type, 4> resultTypes(numResults);
+  for (auto &type : resultTypes)
+    if (failed(impl.getType(reader, type)))
+      return failure();
+
+  // Operands and successors. The operand lists of the successors are separated
+  // by null operands.
+  uint64_t numOperands, numSuccessors;
+  SmallVector<Value *, 8> operands;
+  if (failed(reader.parseCount(numOperands)))
+    return failure();
+  for (uint64_t i = 0; i != numOperands; ++i)
+    if (failed(readOperand(operands)))
+      return failure();
+
+  if (failed(reader.parseCount(numSuccessors)))
+    return failure();
+  SmallVector<Block *, 2> successors;
+  for (uint64_t i = 0; i != numSuccessors; ++i) {
+    uint64_t blockIndex, numSuccOperands;
+    if (failed(reader.parseIndex(blockIndex, regionBlocks.size(), "block")) ||
+        failed(reader.parseCount(numSuccOperands)))
+      return failure();
+    successors.push_back(regionBlocks[blockIndex]);
+    operands.push_back(nullptr);
+    for (uint64_t j = 0; j != numSuccOperands; ++j)
+      if (failed(readOperand(operands)))
+        return failure();
+  }
+
+  // Attributes and regions.
+  SmallVector<NamedAttribute, 4> attrs;
+  uint64_t numRegions;
+  if (failed(impl.parseAttributeList(reader, attrs)) ||
+      failed(reader.parseCount(numRegions)))
+    return failure();
+
+  // Create the operation, and then define its results and read its regions.
+  auto it = opNames.find(name.data());
+  if (it == opNames.end())
+    it = opNames.insert({name.data(), OperationName(name, context)}).first;
+  auto *op = Operation::create(
+      *loc, it->second, operands, resultTypes, attrs, successors, numRegions,
+      /*resizableOperandList=*/flags & OperationFlags::ResizableOperandList,
+      context);
+  block->push_back(op);
+
+  for (auto *result : op->getResults())
+    if (failed(defineValue(result)))
+      return failure();
+  for (auto &region : op->getRegions())
+    if (failed(readRegion(region)))
+      return failure();
+  return success();
+}
+
+LogicalResult
+FunctionBodyReader::readOperand(SmallVectorImpl<Value *> &operands) {
+  uint64_t valueIndex;
+  if (failed(reader.parseIndex(valueIndex, values.size(), "value")))
+    return failure();
+
+  // Values that are defined, or have a placeholder already, can be used
+  // directly.
+  if (valueIndex < numDefinedValues || values[valueIndex]) {
+    if (valueIndex >= numDefinedValues) {
+      // The writer still provides the type of the value.
+      Type type;
+      if (failed(impl.getType(reader, type)))
+        return failure();
+    }
+    operands.push_back(values[valueIndex]);
+    return success();
+  }
+
+  // Otherwise, create a placeholder of the given type that is replaced when
+  // the value is defined.
+  Type type;
+  if (failed(impl.getType(reader, type)))
+    return failure();
+  auto *placeholder = Operation::create(
+      UnknownLoc::get(context), OperationName("placeholder", context),
+      /*operands=*/{}, type, ArrayRef<NamedAttribute>(), /*successors=*/{},
+      /*numRegions=*/0, /*resizableOperandList=*/false, context);
+  values[valueIndex] = placeholder->getResult(0);
+  forwardRefPlaceholders[values[valueIndex]] = valueIndex;
+  operands.push_back(values[valueIndex]);
+  return success();
+}
+
+//===----------------------------------------------------------------------===//
+// Materialization
+//===----------------------------------------------------------------------===//
+
+LogicalResult BytecodeReaderImpl::materialize(Function *function) {
+  auto it = pendingBodies.find(function);
+  if (it == pendingBodies.end())
+    return success();
+  StringRef body = it->second;
+  pendingBodies.erase(it);
+
+  // Bodies materialized lazily aren't covered by the verification of the
+  // module, so verify each body as it is read.
+  if (succeeded(FunctionBodyReader(*this, body).read(function)) &&
+      succeeded(function->verify()))
+    return success();
+
+  // Drop the partially read, or invalid, body.
+  for (auto &block : function->getBody())
+    block.dropAllReferences();
+  function->getBlocks().clear();
+  return failure();
+}
+
+LogicalResult BytecodeReaderImpl::materializeAll() {
+  for (auto *function : functions)
+    if (failed(materialize(function)))
+      return failure();
+  return success();
+}
+
+//===----------------------------------------------------------------------===//
+// BytecodeReader
+//===----------------------------------------------------------------------===//
+
+BytecodeReader::BytecodeReader(std::unique_ptr<llvm::MemoryBuffer> buffer,
+                               MLIRContext *context)
+    : impl(new BytecodeReaderImpl(std::move(buffer), context)) {}
+BytecodeReader::~BytecodeReader() {}
+
+/// Read the module held in the buffer.
+Module *BytecodeReader::readModule(bool lazy) { return impl->readModule(lazy); }
+
+/// Returns true if the body of the given function hasn't been materialized
+/// yet.
+bool BytecodeReader::isMaterializable(Function *function) {
+  return impl->pendingBodies.count(function);
+}
+
+/// Materialize the body of the given function if it hasn't been yet.
+LogicalResult BytecodeReader::materialize(Function *function) {
+  return impl->materialize(function);
+}
+
+/// Materialize the bodies of all of the functions of the module.
+LogicalResult BytecodeReader::materializeAll() {
+  return impl->materializeAll();
+}
+
+/// Read a module in the bytecode format from the given buffer.
+Module *mlir::parseBytecode(const llvm::MemoryBuffer &buffer,
+                            MLIRContext *context) {
+  auto bufferRef = llvm::MemoryBuffer::getMemBuffer(
+      buffer.getBuffer(), buffer.getBufferIdentifier(),
+      /*RequiresNullTerminator=*/false);
+  return BytecodeReader(std::move(bufferRef), context).readModule();
+}
+
+/// Read a module in the bytecode format from the given file.
+Module *mlir::parseBytecodeFile(StringRef filename, MLIRContext *context) {
+  auto fileOrErr = llvm::MemoryBuffer::getFileOrSTDIN(
+      filename, /*FileSize=*/-1, /*RequiresNullTerminator=*/false);
+  if (std::error_code error = fileOrErr.getError()) {
+    context->emitError(UnknownLoc::get(context),
+                       "Could not open input file " + filename);
+    return nullptr;
+  }
+  return BytecodeReader(std::move(*fileOrErr), context).readModule();
+}
@@ -0,0 +1,51 @@
+//===- BytecodeTranslation.cpp - Translations to and from bytecode --------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file registers the translations between the textual form of MLIR and
+// the bytecode format.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/Bytecode/Bytecode.h"
+#include "mlir/IR/Module.h"
+#include "mlir/Support/FileUtilities.h"
+#include "mlir/Translation.h"
+#include "llvm/Support/ToolOutputFile.h"
+
+using namespace mlir;
+
+static TranslateFromMLIRRegistration
+    toBytecodeRegistration("mlir-to-bytecode",
+                           [](Module *module, StringRef outputFilename) {
+                             if (!module || failed(module->verify()))
+                               return true;
+
+                             auto file = openOutputFile(outputFilename);
+                             if (!file)
+                               return true;
+
+                             writeBytecode(module, file->os());
+                             file->keep();
+                             return false;
+                           });
+
+static TranslateToMLIRRegistration
+    fromBytecodeRegistration("bytecode-to-mlir",
+                             [](StringRef inputFilename, MLIRContext *context) {
+                               return std::unique_ptr<Module>(
+                                   parseBytecodeFile(inputFilename, context));
+                             });
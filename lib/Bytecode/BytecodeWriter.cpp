@@ -0,0 +1,439 @@
+//===- BytecodeWriter.cpp - MLIR bytecode writer --------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements the writer of the binary bytecode format.
+//
+//===----------------------------------------------------------------------===//
+
+#include "BytecodeDetail.h"
+#include "mlir/Bytecode/Bytecode.h"
+#include "mlir/IR/Attributes.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/Location.h"
+#include "mlir/IR/Module.h"
+#include "mlir/IR/StandardTypes.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace mlir;
+using namespace mlir::detail::bytecode;
+
+/// Emit an integer as a varint.
+static void emitVarInt(raw_ostream &os, uint64_t value) {
+  llvm::encodeULEB128(value, os);
+}
+
+/// Emit a blob of bytes, prefixed with its size.
+static void emitBlob(raw_ostream &os, StringRef blob) {
+  emitVarInt(os, blob.size());
+  os << blob;
+}
+
+/// Emit the words of an integer value.
+static void emitAPInt(raw_ostream &os, const APInt &value) {
+  emitVarInt(os, value.getNumWords());
+  for (unsigned i = 0, e = value.getNumWords(); i != e; ++i)
+    emitVarInt(os, value.getRawData()[i]);
+}
+
+namespace {
+/// This class writes a module in the bytecode format. The tables of strings,
+/// types, attributes and locations are filled while the functions are
+/// encoded, and are written out in front of them.
+class BytecodeWriter {
+public:
+  explicit BytecodeWriter(Module *module) : module(module) {}
+
+  void write(raw_ostream &os);
+
+private:
+  /// Return the index of the given entity in its table, adding it to the
+  /// table if necessary.
+  unsigned getStringId(StringRef str);
+  unsigned getTypeId(Type type);
+  unsigned getAttributeId(Attribute attr);
+  unsigned getLocationId(Location loc);
+
+  /// Emit a list of named attributes.
+  void emitAttributeList(raw_ostream &os, ArrayRef<NamedAttribute> attrs);
+
+  //===--------------------------------------------------------------------===//
+  // Function bodies
+  //===--------------------------------------------------------------------===//
+
+  /// Write the body of the given function.
+  void writeFunctionBody(Function *function, raw_ostream &os);
+
+  /// Number the values and blocks defined within the given region, in the
+  /// order in which they are written.
+  void numberValues(Region &region);
+
+  void writeRegion(Region &region, raw_ostream &os);
+  void writeOperation(Operation &op, raw_ostream &os);
+  void writeOperand(Value *value, raw_ostream &os);
+
+  /// The module being written.
+  Module *module;
+
+  /// The string table, along with the index of each string.
+  llvm::StringMap<unsigned> stringIds;
+  std::vector<StringRef> strings;
+
+  /// The type table, along with the index of each type.
+  llvm::DenseMap<Type, unsigned> typeIds;
+  std::vector<Type> types;
+
+  /// The encoded entries of the attribute and location tables, along with the
+  /// index of each attribute and location.
+  llvm::DenseMap<Attribute, unsigned> attributeIds;
+  std::vector<std::string> attributes;
+  llvm::DenseMap<const void *, unsigned> locationIds;
+  std::vector<std::string> locations;
+
+  /// The index of each function of the module.
+  llvm::DenseMap<Function *, unsigned> functionIds;
+
+  /// The numbering of the values and blocks of the function being written,
+  /// and the number of values that have been written so far.
+  llvm::DenseMap<Value *, unsigned> valueIds;
+  llvm::DenseMap<Block *, unsigned> blockIds;
+  unsigned numValues = 0, numWrittenValues = 0;
+};
+} // end anonymous namespace
+
+unsigned BytecodeWriter::getStringId(StringRef str) {
+  auto it = stringIds.insert({str, strings.size()});
+  if (it.second)
+    strings.push_back(it.first->getKey());
+  return it.first->second;
+}
+
+unsigned BytecodeWriter::getTypeId(Type type) {
+  auto it = typeIds.insert({type, types.size()});
+  if (it.second)
+    types.push_back(type);
+  return it.first->second;
+}
+
+unsigned BytecodeWriter::getAttributeId(Attribute attr) {
+  auto it = attributeIds.find(attr);
+  if (it != attributeIds.end())
+    return it->second;
+
+  // Encode the attribute. Any attributes or types it refers to are added to
+  // their tables first.
+  std::string entry;
+  llvm::raw_string_ostream os(entry);
+  switch (attr.getKind()) {
+  case Attribute::Kind::Bool:
+    os << char(AttributeCode::Bool) << char(attr.cast<BoolAttr>().getValue());
+    break;
+  case Attribute::Kind::Integer: {
+    auto intAttr = attr.cast<IntegerAttr>();
+    os << char(AttributeCode::Integer);
+    emitVarInt(os, getTypeId(intAttr.getType()));
+    emitAPInt(os, intAttr.getValue());
+    break;
+  }
+  case Attribute::Kind::Float: {
+    // Floats are encoded with the bits of their value, so that they round-trip
+    // exactly, including infinities and NaNs.
+    auto floatAttr = attr.cast<FloatAttr>();
+    os << char(AttributeCode::Float);
+    emitVarInt(os, getTypeId(floatAttr.getType()));
+    emitAPInt(os, floatAttr.getValue().bitcastToAPInt());
+    break;
+  }
+  case Attribute::Kind::String:
+    os << char(AttributeCode::String);
+    emitVarInt(os, getStringId(attr.cast<StringAttr>().getValue()));
+    break;
+  case Attribute::Kind::Type:
+    os << char(AttributeCode::Type);
+    emitVarInt(os, getTypeId(attr.cast<TypeAttr>().getValue()));
+    break;
+  case Attribute::Kind::Array: {
+    auto elements = attr.cast<ArrayAttr>().getValue();
+    SmallVector<unsigned, 8> elementIds;
+    for (auto element : elements)
+      elementIds.push_back(getAttributeId(element));
+    os << char(AttributeCode::Array);
+    emitVarInt(os, elementIds.size());
+    for (unsigned elementId : elementIds)
+      emitVarInt(os, elementId);
+    break;
+  }
+  case Attribute::Kind::Function: {
+    auto *function = attr.cast<FunctionAttr>().getValue();
+    assert(functionIds.count(function) &&
+           "referenced function is not in the module");
+    os << char(AttributeCode::Function);
+    emitVarInt(os, functionIds[function]);
+    break;
+  }
+  case Attribute::Kind::DenseIntElements:
+  case Attribute::Kind::DenseFPElements: {
+    auto elementsAttr = attr.cast<DenseElementsAttr>();
+    os << char(AttributeCode::DenseElements);
+    emitVarInt(os, getTypeId(elementsAttr.getType()));
+    auto rawData = elementsAttr.getRawData();
+    emitBlob(os, StringRef(rawData.data(), rawData.size()));
+    break;
+  }
+  default: {
+    // Other attributes are stored in their textual form.
+    std::string text;
+    llvm::raw_string_ostream textOS(text);
+    attr.print(textOS);
+    os << char(AttributeCode::Text);
+    emitVarInt(os, getStringId(textOS.str()));
+    break;
+  }
+  }
+
+  attributes.push_back(std::move(os.str()));
+  return attributeIds[attr] = attributes.size() - 1;
+}
+
+unsigned BytecodeWriter::getLocationId(Location loc) {
+  auto it = locationIds.find(loc.getAsOpaquePointer());
+  if (it != locationIds.end())
+    return it->second;
+
+  std::string entry;
+  llvm::raw_string_ostream os(entry);
+  switch (loc.getKind()) {
+  case Location::Kind::Unknown:
+    os << char(LocationCode::Unknown);
+    break;
+  case Location::Kind::FileLineCol: {
+    auto fileLoc = loc.cast<FileLineColLoc>();
+    os << char(LocationCode::FileLineCol);
+    emitVarInt(os, getStringId(fileLoc.getFilename()));
+    emitVarInt(os, fileLoc.getLine());
+    emitVarInt(os, fileLoc.getColumn());
+    break;
+  }
+  case Location::Kind::Name:
+    os << char(LocationCode::Name);
+    emitVarInt(os, getStringId(loc.cast<NameLoc>().getName()));
+    break;
+  case Location::Kind::CallSite: {
+    auto callSiteLoc = loc.cast<CallSiteLoc>();
+    unsigned calleeId = getLocationId(callSiteLoc.getCallee());
+    unsigned callerId = getLocationId(callSiteLoc.getCaller());
+    os << char(LocationCode::CallSite);
+    emitVarInt(os, calleeId);
+    emitVarInt(os, callerId);
+    break;
+  }
+  case Location::Kind::FusedLocation: {
+    auto fusedLoc = loc.cast<FusedLoc>();
+    SmallVector<unsigned, 4> locIds;
+    for (auto fused : fusedLoc.getLocations())
+      locIds.push_back(getLocationId(fused));
+    auto metadata = fusedLoc.getMetadata();
+    unsigned metadataId = metadata ? getAttributeId(metadata) + 1 : 0;
+
+    os << char(LocationCode::Fused);
+    emitVarInt(os, locIds.size());
+    for (unsigned locId : locIds)
+      emitVarInt(os, locId);
+    emitVarInt(os, metadataId);
+    break;
+  }
+  }
+
+  locations.push_back(std::move(os.str()));
+  return locationIds[loc.getAsOpaquePointer()] = locations.size() - 1;
+}
+
+void BytecodeWriter::emitAttributeList(raw_ostream &os,
+                                       ArrayRef<NamedAttribute> attrs) {
+  emitVarInt(os, attrs.size());
+  for (auto &attr : attrs) {
+    emitVarInt(os, getStringId(attr.first));
+    emitVarInt(os, getAttributeId(attr.second));
+  }
+}
+
+//===----------------------------------------------------------------------===//
+// Function bodies
+//===----------------------------------------------------------------------===//
+
+void BytecodeWriter::writeFunctionBody(Function *function, raw_ostream &os) {
+  valueIds.clear();
+  blockIds.clear();
+  numValues = numWrittenValues = 0;
+  numberValues(function->getBody());
+
+  emitVarInt(os, numValues);
+  writeRegion(function->getBody(), os);
+  assert(numWrittenValues == numValues && "not all values were written");
+}
+
+void BytecodeWriter::numberValues(Region &region) {
+  unsigned blockId = 0;
+  for (auto &block : region) {
+    blockIds[&block] = blockId++;
+    for (auto *arg : block.getArguments())
+      valueIds[arg] = numValues++;
+    for (auto &op : block) {
+      for (auto *result : op.getResults())
+        valueIds[result] = numValues++;
+      for (auto &nestedRegion : op.getRegions())
+        numberValues(nestedRegion);
+    }
+  }
+}
+
+void BytecodeWriter::writeRegion(Region &region, raw_ostream &os) {
+  emitVarInt(os, region.getBlocks().size());
+  for (auto &block : region) {
+    emitVarInt(os, block.getNumArguments());
+    for (auto *arg : block.getArguments())
+      emitVarInt(os, getTypeId(arg->getType()));
+    numWrittenValues += block.getNumArguments();
+
+    emitVarInt(os, block.getOperations().size());
+    for (auto &op : block)
+      writeOperation(op, os);
+  }
+}
+
+void BytecodeWriter::writeOperation(Operation &op, raw_ostream &os) {
+  emitVarInt(os, getStringId(op.getName().getStringRef()));
+  emitVarInt(os, getLocationId(op.getLoc()));
+  uint8_t flags = 0;
+  if (op.hasResizableOperandsList())
+    flags |= OperationFlags::ResizableOperandList;
+  os << char(flags);
+
+  // Results.
+  emitVarInt(os, op.getNumResults());
+  for (auto *result : op.getResults())
+    emitVarInt(os, getTypeId(result->getType()));
+
+  // Operands and successors.
+  unsigned numOperands = op.getNumSuccessors() ? op.getSuccessorOperandIndex(0)
+                                                : op.getNumOperands();
+  emitVarInt(os, numOperands);
+  for (unsigned i = 0; i != numOperands; ++i)
+    writeOperand(op.getOperand(i), os);
+
+  emitVarInt(os, op.getNumSuccessors());
+  for (unsigned i = 0, e = op.getNumSuccessors(); i != e; ++i) {
+    emitVarInt(os, blockIds[op.getSuccessor(i)]);
+    auto succOperands = op.getSuccessorOperands(i);
+    emitVarInt(os, llvm::size(succOperands));
+    for (auto *operand : succOperands)
+      writeOperand(operand, os);
+  }
+
+  // The reader defines the results once it has created the operation, so they
+  // are considered written from here on.
+  numWrittenValues += op.getNumResults();
+
+  // Attributes and regions.
+  emitAttributeList(os, op.getAttrs());
+  emitVarInt(os, op.getNumRegions());
+  for (auto &region : op.getRegions())
+    writeRegion(region, os);
+}
+
+void BytecodeWriter::writeOperand(Value *value, raw_ostream &os) {
+  assert(valueIds.count(value) && "operand is not defined in the function");
+  unsigned valueId = valueIds[value];
+  emitVarInt(os, valueId);
+
+  // The reader needs the type of values that haven't been defined yet.
+  if (valueId >= numWrittenValues)
+    emitVarInt(os, getTypeId(value->getType()));
+}
+
+//===----------------------------------------------------------------------===//
+// Module
+//===----------------------------------------------------------------------===//
+
+void BytecodeWriter::write(raw_ostream &os) {
+  unsigned functionId = 0;
+  for (auto &function : *module)
+    functionIds[&function] = functionId++;
+
+  // Encode the function headers, attributes and bodies, which fills in the
+  // tables.
+  std::string functionSection, functionAttrSection, bodies;
+  llvm::raw_string_ostream functionOS(functionSection);
+  llvm::raw_string_ostream functionAttrOS(functionAttrSection);
+  llvm::raw_string_ostream bodyOS(bodies);
+  emitVarInt(functionOS, functionIds.size());
+  for (auto &function : *module) {
+    uint64_t bodyOffset = bodyOS.tell();
+    if (!function.isExternal())
+      writeFunctionBody(&function, bodyOS);
+
+    emitVarInt(functionOS, getStringId(function.getName()));
+    emitVarInt(functionOS, getTypeId(function.getType()));
+    emitVarInt(functionOS, getLocationId(function.getLoc()));
+    emitVarInt(functionOS, bodyOffset);
+    emitVarInt(functionOS, bodyOS.tell() - bodyOffset);
+
+    emitAttributeList(functionAttrOS, function.getAttrs());
+    for (unsigned i = 0, e = function.getNumArguments(); i != e; ++i)
+      emitAttributeList(functionAttrOS, function.getArgAttrs(i));
+  }
+
+  // The textual form of types may refer to strings that are not in the table
+  // yet, so print them before writing the string table.
+  std::vector<unsigned> typeStringIds;
+  typeStringIds.reserve(types.size());
+  for (auto type : types) {
+    std::string text;
+    llvm::raw_string_ostream textOS(text);
+    type.print(textOS);
+    typeStringIds.push_back(getStringId(textOS.str()));
+  }
+
+  // Write out the header and all of the sections.
+  os.write(kMagic, sizeof(kMagic));
+  emitVarInt(os, kVersion);
+
+  emitVarInt(os, strings.size());
+  for (auto str : strings)
+    emitBlob(os, str);
+
+  emitVarInt(os, typeStringIds.size());
+  for (unsigned stringId : typeStringIds)
+    emitVarInt(os, stringId);
+
+  emitVarInt(os, attributes.size());
+  for (auto &entry : attributes)
+    emitBlob(os, entry);
+
+  emitVarInt(os, locations.size());
+  for (auto &entry : locations)
+    emitBlob(os, entry);
+
+  os << functionOS.str() << functionAttrOS.str() << bodyOS.str();
+}
+
+/// Write the given module to the given stream in the bytecode format.
+void mlir::writeBytecode(Module *module, raw_ostream &os) {
+  BytecodeWriter(module).write(os);
+}
@@ -41,7 +41,10 @@
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/ADT/StringSet.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Regex.h"
+#include "llvm/Support/Threading.h"
+#include <atomic>
 using namespace mlir;
 
 void Identifier::print(raw_ostream &os) const { os << str(); }
@@ -77,6 +80,19 @@ static llvm::cl::opt<bool>
                        llvm::cl::desc("Print the generic op form"),
                        llvm::cl::init(false), llvm::cl::Hidden);
 
+// Print large dense elements attributes in the compact hexadecimal form, which
+// is also much faster to parse.
+static llvm::cl::opt<unsigned> printElementsAttrHexThreshold(
+    "mlir-print-elementsattrs-hex-threshold",
+    llvm::cl::desc("Print dense elements attributes with more than this many "
+                   "elements in hexadecimal form (0 disables the hex form)"),
+    llvm::cl::init(0));
+
+static llvm::cl::opt<bool> printFunctionsInParallel(
+    "mlir-print-functions-in-parallel",
+    llvm::cl::desc("Print the functions of a module on multiple threads"),
+    llvm::cl::init(false));
+
 namespace {
 class ModuleState {
 public:
@@ -294,6 +310,7 @@ public:
   }
 
   void print(Module *module);
+  void printFunctionsConcurrently(Module *module);
   void printFunctionReference(Function *func);
   void printAttributeAndType(Attribute attr) {
     printAttributeOptionalType(attr, /*includeType=*/true);
@@ -327,6 +344,7 @@ protected:
   void printTrailingLocation(Location loc);
   void printLocationInternal(Location loc, bool pretty = false);
   void printDenseElementsAttr(DenseElementsAttr attr);
+  void printDenseElementsAttrAsHex(DenseElementsAttr attr);
 
   /// This enum is used to represent the binding stength of the enclosing
   /// context that an AffineExprStorage is being printed in, so we can
@@ -488,10 +506,46 @@ void ModulePrinter::print(Module *module) {
     if (!alias.empty())
       os << '!' << alias << " = type " << type << '\n';
   }
+  if (printFunctionsInParallel && llvm::llvm_is_multithreaded())
+    return printFunctionsConcurrently(module);
   for (auto &fn : *module)
     print(&fn);
 }
 
+/// Print the functions of the module into separate buffers on multiple
+/// threads, and then write the buffers out in order. The module state is
+/// fully initialized up front and only read while printing, so the output is
+/// the same as that of printing the functions one after the other.
+void ModulePrinter::printFunctionsConcurrently(Module *module) {
+  std::vector<Function *> functions;
+  for (auto &fn : *module)
+    functions.push_back(&fn);
+
+  // An index for the next function to print, and the output of each function.
+  std::atomic<size_t> funcIt(0);
+  std::vector<std::string> buffers(functions.size());
+  std::vector<char> workers(
+      std::min<size_t>(llvm::hardware_concurrency(), functions.size()));
+  llvm::parallel::for_each(
+      llvm::parallel::par, workers.begin(), workers.end(), [&](char &) {
+        for (auto e = functions.size();;) {
+          // Get the next available function index.
+          size_t nextID = funcIt++;
+          if (nextID >= e)
+            break;
+
+          llvm::raw_string_ostream bufferOS(buffers[nextID]);
+          ModulePrinter(bufferOS, state).print(functions[nextID]);
+        }
+      });
+
+  // Write out each buffer, releasing its memory once it has been written.
+  for (auto &buffer : buffers) {
+    os << buffer;
+    std::string().swap(buffer);
+  }
+}
+
 /// Print a floating point value in a way that the parser will be able to
 /// round-trip losslessly.
 static void printFloatValue(const APFloat &apValue, raw_ostream &os) {
@@ -617,7 +671,11 @@ void ModulePrinter::printAttributeOptionalType(Attribute attr,
     os << "dense<";
     printType(eltsAttr.getType());
     os << ", ";
-    printDenseElementsAttr(eltsAttr);
+    if (printElementsAttrHexThreshold &&
+        eltsAttr.getType().getNumElements() > printElementsAttrHexThreshold)
+      printDenseElementsAttrAsHex(eltsAttr);
+    else
+      printDenseElementsAttr(eltsAttr);
     os << '>';
     break;
   }
@@ -649,17 +707,32 @@ void ModulePrinter::printDenseElementsAttr(DenseElementsAttr attr) {
   auto shape = type.getShape();
   auto rank = type.getRank();
 
-  SmallVector<Attribute, 16> elements;
-  attr.getValues(elements);
+  // Print the elements directly from the raw data, instead of materializing
+  // an attribute for each of them.
+  // FIXME(b/121118307): using 64 bits for BF16 because it is currently stored
+  // with double semantics.
+  auto elementType = type.getElementType();
+  size_t bitWidth =
+      elementType.isBF16() ? 64 : elementType.getIntOrFloatBitWidth();
+  const char *rawData = attr.getRawData().data();
+  auto printElement = [&](size_t index) {
+    APInt value =
+        DenseElementsAttr::readBits(rawData, index * bitWidth, bitWidth);
+    if (auto floatType = elementType.dyn_cast<FloatType>())
+      printFloatValue(APFloat(floatType.getFloatSemantics(), value), os);
+    else
+      value.print(os, /*isSigned=*/bitWidth != 1);
+  };
 
   // Special case for 0-d tensors;
   if (rank == 0) {
-    printAttribute(elements[0]);
+    printElement(0);
     return;
   }
 
   // Special case for degenerate tensors.
-  if (elements.empty()) {
+  auto numElements = type.getNumElements();
+  if (numElements == 0) {
     for (int i = 0; i < rank; ++i)
       os << '[';
     for (int i = 0; i < rank; ++i)
@@ -690,19 +763,34 @@ void ModulePrinter::printDenseElementsAttr(DenseElementsAttr attr) {
       }
   };
 
-  for (unsigned idx = 0, e = elements.size(); idx != e; ++idx) {
+  for (unsigned idx = 0, e = numElements; idx != e; ++idx) {
     if (idx != 0)
       os << ", ";
     while (openBrackets++ < rank)
       os << '[';
     openBrackets = rank;
-    printAttribute(elements[idx]);
+    printElement(idx);
     bumpCounter();
   }
   while (openBrackets-- > 0)
     os << ']';
 }
 
+/// Print the raw data of a dense elements attribute as a hex string. Only the
+/// bytes that hold elements are printed, not the padding of the storage.
+void ModulePrinter::printDenseElementsAttrAsHex(DenseElementsAttr attr) {
+  auto type = attr.getType();
+  auto elementType = type.getElementType();
+  size_t bitWidth =
+      elementType.isBF16() ? 64 : elementType.getIntOrFloatBitWidth();
+  size_t numBytes = llvm::alignTo(bitWidth * type.getNumElements(), 8) / 8;
+
+  os << "\"0x";
+  for (char c : attr.getRawData().take_front(numBytes))
+    os << llvm::hexdigit((c >> 4) & 0xF) << llvm::hexdigit(c & 0xF);
+  os << '"';
+}
+
 void ModulePrinter::printType(Type type) {
   // Check for an alias for this type.
   StringRef alias = state.getTypeAlias(type);
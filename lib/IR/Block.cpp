@@ -118,6 +118,9 @@ bool Block::verifyInstOrder() {
 
   Operation *prev = nullptr;
   for (auto &i : *this) {
+    // Operations inserted since the ordering was computed have no index yet.
+    if (!i.hasValidOrder())
+      continue;
     // The previous operation must have a smaller order index than the next as
     // it appears earlier in the list.
     if (prev && prev->orderIndex >= i.orderIndex)
@@ -127,15 +130,72 @@ bool Block::verifyInstOrder() {
   return false;
 }
 
+/// The distance between the order indices of consecutive operations when the
+/// block is renumbered, which leaves room for operations inserted later.
+static const unsigned kOrderStride = 8;
+
 /// Recomputes the ordering of child operations within the block.
 void Block::recomputeInstOrder() {
   parentValidInstOrderPair.setInt(true);
 
-  // TODO(riverriddle) Have non-congruent indices to reduce the number of times
-  // an insert invalidates the list.
   unsigned orderIndex = 0;
   for (auto &op : *this)
-    op.orderIndex = orderIndex++;
+    op.orderIndex = (orderIndex += kOrderStride);
+}
+
+/// Assigns an order index to 'op' if it was inserted since the ordering of the
+/// block was computed.
+void Block::updateInstOrder(Operation *op) {
+  assert(op->getBlock() == this && isInstOrderValid() &&
+         "expected an operation of a block with a valid ordering");
+  if (op->hasValidOrder())
+    return;
+
+  // Renumber the smallest window of operations around 'op' that the indices of
+  // its neighbors leave enough room for. The window grows by a doubling
+  // number of operations on each side, which keeps the amortized cost of
+  // renumbering logarithmic in the number of insertions.
+  auto begin = operations.begin(), end = operations.end();
+  iterator first(op), last = std::next(first);
+  unsigned count = 1;
+  for (unsigned growth = 1;; growth *= 2) {
+    // Operations without an index next to the window have to be part of it.
+    for (; first != begin && !std::prev(first)->hasValidOrder(); ++count)
+      --first;
+    for (; last != end && !last->hasValidOrder(); ++count)
+      ++last;
+
+    // The new indices must be above that of the operation before the window,
+    // and below that of the operation after it. Indices start above zero.
+    uint64_t lower = first == begin ? 0 : std::prev(first)->orderIndex;
+    uint64_t upper = last == end ? Operation::kInvalidOrderIndex
+                                 : last->orderIndex;
+
+    uint64_t step;
+    if (last == end && lower + uint64_t(count) * kOrderStride < upper) {
+      // At the end of the block, space the indices out by the stride.
+      step = kOrderStride;
+    } else if (upper - lower > 2 * uint64_t(count)) {
+      // Otherwise, spread them evenly if that leaves gaps between them.
+      step = (upper - lower) / (count + 1);
+    } else {
+      // Otherwise, grow the window.
+      if (first == begin && last == end)
+        break;
+      for (unsigned i = 0; i != growth && first != begin; ++i, ++count)
+        --first;
+      for (unsigned i = 0; i != growth && last != end; ++i, ++count)
+        ++last;
+      continue;
+    }
+
+    for (auto it = first; it != last; ++it)
+      it->orderIndex = lower += step;
+    return;
+  }
+
+  // The indices are exhausted, so renumber the whole block.
+  recomputeInstOrder();
 }
 
 Block *PredecessorIterator::operator*() const {
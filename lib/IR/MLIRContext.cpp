@@ -30,6 +30,7 @@
 #include "mlir/IR/Identifier.h"
 #include "mlir/IR/IntegerSet.h"
 #include "mlir/IR/Location.h"
+#include "mlir/IR/PatternMatch.h"
 #include "mlir/IR/Types.h"
 #include "mlir/Support/MathExtras.h"
 #include "mlir/Support/STLExtras.h"
@@ -37,7 +38,10 @@
 #include "llvm/ADT/SetVector.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Allocator.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/Mutex.h"
 #include "llvm/Support/RWMutex.h"
+#include "llvm/Support/ThreadLocal.h"
 #include "llvm/Support/raw_ostream.h"
 #include <memory>
 
@@ -99,6 +103,183 @@ safeGetOrCreate(ContainerTy &container, KeyT &&key,
   return result = constructorFn();
 }
 
+//===----------------------------------------------------------------------===//
+// Sharded uniquing
+//===----------------------------------------------------------------------===//
+
+/// Utility functions that compute the hash of a lookup key in the same way as
+/// the given uniquing container.
+template <typename ValueT, typename DenseInfoT, typename KeyT>
+static unsigned getUniquerHash(DenseSet<ValueT, DenseInfoT> *,
+                               const KeyT &key) {
+  return DenseInfoT::getHashValue(key);
+}
+template <typename KeyT, typename ValueT, typename KeyInfoT, typename BucketT,
+          typename LookupKeyT>
+static unsigned getUniquerHash(DenseMap<KeyT, ValueT, KeyInfoT, BucketT> *,
+                               const LookupKeyT &key) {
+  return KeyInfoT::getHashValue(key);
+}
+template <typename ValueT, typename AllocatorT>
+static unsigned getUniquerHash(StringMap<ValueT, AllocatorT> *,
+                               StringRef key) {
+  return hash_value(key);
+}
+
+/// Utility functions that accumulate the statistics of the given uniquing
+/// container into 'stats'.
+template <typename ValueT, typename DenseInfoT>
+static void addUniquerStatistics(const DenseSet<ValueT, DenseInfoT> &container,
+                                 MLIRContext::UniquerStatistics &stats) {
+  stats.numEntries += container.size();
+  stats.numBuckets += container.getMemorySize() / sizeof(ValueT);
+  stats.tableMemory += container.getMemorySize();
+}
+template <typename KeyT, typename ValueT, typename KeyInfoT, typename BucketT>
+static void
+addUniquerStatistics(const DenseMap<KeyT, ValueT, KeyInfoT, BucketT> &container,
+                     MLIRContext::UniquerStatistics &stats) {
+  stats.numEntries += container.size();
+  stats.numBuckets += container.getMemorySize() / sizeof(BucketT);
+  stats.tableMemory += container.getMemorySize();
+}
+template <typename ValueT, typename AllocatorT>
+static void addUniquerStatistics(const StringMap<ValueT, AllocatorT> &container,
+                                 MLIRContext::UniquerStatistics &stats) {
+  // Each bucket of a StringMap holds an entry pointer and the full hash value.
+  stats.numEntries += container.getNumItems();
+  stats.numBuckets += container.getNumBuckets();
+  stats.tableMemory += container.getNumBuckets() *
+                       (sizeof(llvm::StringMapEntryBase *) + sizeof(unsigned));
+}
+
+namespace {
+/// A uniquing table that is split into a number of shards, each guarded by its
+/// own reader-writer mutex. Instances are assigned to a shard by the hash of
+/// their lookup key, so that threads uniquing unrelated instances take
+/// different locks instead of all contending on the same one. The shards are
+/// allocated separately so that their mutexes don't share cache lines.
+template <typename ContainerT> class ShardedUniquer {
+public:
+  /// A single shard of the table.
+  struct Shard {
+    template <typename... Args> Shard(Args &... args) : container(args...) {}
+
+    /// The instances uniqued within this shard.
+    ContainerT container;
+
+    /// A mutex to keep access to the container thread-safe.
+    llvm::sys::SmartRWMutex<true> mutex;
+  };
+
+  /// Create the shards, passing the given arguments to the constructor of each
+  /// shard container.
+  template <typename... Args> ShardedUniquer(Args &... args) {
+    for (auto &shard : shards)
+      shard.reset(new Shard(args...));
+  }
+
+  /// Return the shard holding the instance for the given lookup key.
+  template <typename KeyT> Shard &getShard(const KeyT &key) {
+    uint32_t hash = getUniquerHash(static_cast<ContainerT *>(nullptr), key);
+
+    // The containers select a bucket with the low bits of the hash, so pick
+    // the shard with the high bits of a multiplicative hash to keep the two
+    // independent.
+    return *shards[(hash * 0x9E3779B1u) >> (32 - kLog2NumShards)];
+  }
+
+  /// Return the statistics of this table, accumulated over all of the shards.
+  MLIRContext::UniquerStatistics getStatistics(StringRef name) {
+    MLIRContext::UniquerStatistics stats;
+    stats.name = name;
+    for (auto &shard : shards) {
+      llvm::sys::SmartScopedReader<true> shardLock(shard->mutex);
+      addUniquerStatistics(shard->container, stats);
+    }
+    return stats;
+  }
+
+private:
+  /// The log2 of the number of shards.
+  static constexpr unsigned kLog2NumShards = 4;
+
+  std::unique_ptr<Shard> shards[1 << kLog2NumShards];
+};
+} // end anonymous namespace
+
+/// A utility function to safely get or create a uniqued instance within the
+/// given sharded set container.
+template <typename ValueT, typename DenseInfoT, typename KeyT,
+          typename ConstructorFn>
+static ValueT
+safeGetOrCreate(ShardedUniquer<DenseSet<ValueT, DenseInfoT>> &uniquer,
+                KeyT &&key, ConstructorFn &&constructorFn) {
+  auto &shard = uniquer.getShard(key);
+  return safeGetOrCreate(shard.container, key, shard.mutex, constructorFn);
+}
+
+/// A utility function to safely get or create a uniqued instance within the
+/// given sharded map container.
+template <typename ContainerTy, typename KeyT, typename ConstructorFn>
+static typename ContainerTy::mapped_type
+safeGetOrCreate(ShardedUniquer<ContainerTy> &uniquer, KeyT &&key,
+                ConstructorFn &&constructorFn) {
+  auto &shard = uniquer.getShard(key);
+  return safeGetOrCreate(shard.container, key, shard.mutex, constructorFn);
+}
+
+//===----------------------------------------------------------------------===//
+// Thread-local allocation
+//===----------------------------------------------------------------------===//
+
+namespace {
+/// An allocator that hands out a separate arena to each thread allocating from
+/// it, so that uniqued storage may be constructed on different threads without
+/// any synchronization. The arenas are owned by this allocator, and all of the
+/// memory is freed when it is destroyed.
+template <typename AllocatorT> class ThreadLocalAllocator {
+public:
+  /// Return the arena of the current thread, creating it if necessary.
+  AllocatorT &get() {
+    if (AllocatorT *arena = threadArena.get())
+      return *arena;
+
+    llvm::sys::SmartScopedLock<true> arenaLock(mutex);
+    arenas.emplace_back(new AllocatorT());
+    threadArena.set(arenas.back().get());
+    return *arenas.back();
+  }
+
+  /// Allocate memory from the arena of the current thread.
+  template <typename T> T *Allocate(size_t num = 1) {
+    return get().template Allocate<T>(num);
+  }
+  void *Allocate(size_t size, size_t alignment) {
+    return get().Allocate(size, alignment);
+  }
+
+  /// Return the number of bytes held by each of the arenas.
+  std::vector<size_t> getArenaMemory() {
+    llvm::sys::SmartScopedLock<true> arenaLock(mutex);
+    std::vector<size_t> arenaMemory;
+    for (auto &arena : arenas)
+      arenaMemory.push_back(arena->getTotalMemory());
+    return arenaMemory;
+  }
+
+private:
+  /// The arena of the current thread, or null if it hasn't allocated yet.
+  llvm::sys::ThreadLocal<AllocatorT> threadArena;
+
+  /// A mutex to keep the list of arenas thread-safe.
+  llvm::sys::SmartMutex<true> mutex;
+
+  /// The arenas of all of the threads that have allocated from this allocator.
+  std::vector<std::unique_ptr<AllocatorT>> arenas;
+};
+} // end anonymous namespace
+
 namespace {
 /// A builtin dialect to define types/etc that are necessary for the
 /// validity of the IR.
@@ -364,26 +545,27 @@ struct TypeUniquerImpl {
       llvm::function_ref<bool(const TypeStorage *)> isEqual,
       std::function<TypeStorage *(TypeStorageAllocator &)> constructorFn) {
     TypeLookupKey lookupKey{kind, hashValue, isEqual};
+    auto &shard = storageTypes.getShard(lookupKey);
 
     { // Check for an existing instance in read-only mode.
-      llvm::sys::SmartScopedReader<true> typeLock(typeMutex);
-      auto it = storageTypes.find_as(lookupKey);
-      if (it != storageTypes.end())
+      llvm::sys::SmartScopedReader<true> typeLock(shard.mutex);
+      auto it = shard.container.find_as(lookupKey);
+      if (it != shard.container.end())
         return it->storage;
     }
 
     // Aquire a writer-lock so that we can safely create the new type instance.
-    llvm::sys::SmartScopedWriter<true> typeLock(typeMutex);
+    llvm::sys::SmartScopedWriter<true> typeLock(shard.mutex);
 
     // Check for an existing instance again here, because another writer thread
     // may have already created one.
-    auto existing = storageTypes.insert_as({}, lookupKey);
+    auto existing = shard.container.insert_as({}, lookupKey);
     if (!existing.second)
       return existing.first->storage;
 
     // Otherwise, construct and initialize the derived storage for this type
     // instance.
-    TypeStorage *storage = constructorFn(allocator);
+    TypeStorage *storage = constructorFn(allocator.get());
     *existing.first = HashedStorageType{hashValue, storage};
     return storage;
   }
@@ -392,8 +574,8 @@ struct TypeUniquerImpl {
   TypeStorage *getOrCreate(
       unsigned kind,
       std::function<TypeStorage *(TypeStorageAllocator &)> constructorFn) {
-    return safeGetOrCreate(simpleTypes, kind, typeMutex,
-                           [&] { return constructorFn(allocator); });
+    return safeGetOrCreate(simpleTypes, kind,
+                           [&] { return constructorFn(allocator.get()); });
   }
 
   //===--------------------------------------------------------------------===//
@@ -431,16 +613,13 @@ struct TypeUniquerImpl {
 
   // Unique types with specific hashing or storage constraints.
   using StorageTypeSet = llvm::DenseSet<HashedStorageType, StorageKeyInfo>;
-  StorageTypeSet storageTypes;
+  ShardedUniquer<StorageTypeSet> storageTypes;
 
   // Unique types with just the kind.
-  DenseMap<unsigned, TypeStorage *> simpleTypes;
+  ShardedUniquer<DenseMap<unsigned, TypeStorage *>> simpleTypes;
 
   // Allocator to use when constructing derived type instances.
-  TypeStorageAllocator allocator;
-
-  // A mutex to keep type uniquing thread-safe.
-  llvm::sys::SmartRWMutex<true> typeMutex;
+  ThreadLocalAllocator<TypeStorageAllocator> allocator;
 };
 } // end anonymous namespace.
 
@@ -453,9 +632,12 @@ public:
   // Location uniquing
   //===--------------------------------------------------------------------===//
 
-  // Location allocator and mutex for thread safety.
-  llvm::BumpPtrAllocator locationAllocator;
-  llvm::sys::SmartRWMutex<true> locationMutex;
+  // Location allocator.
+  ThreadLocalAllocator<llvm::BumpPtrAllocator> locationAllocator;
+
+  // Filename allocator and mutex for thread safety.
+  llvm::BumpPtrAllocator filenameAllocator;
+  llvm::sys::SmartMutex<true> filenameMutex;
 
   /// The singleton for UnknownLoc.
   UnknownLocationStorage theUnknownLoc;
@@ -464,27 +646,29 @@ public:
   llvm::StringMap<char, llvm::BumpPtrAllocator &> filenames;
 
   /// FileLineColLoc uniquing.
-  DenseMap<std::tuple<const char *, unsigned, unsigned>,
-           FileLineColLocationStorage *>
+  ShardedUniquer<DenseMap<std::tuple<const char *, unsigned, unsigned>,
+                          FileLineColLocationStorage *>>
       fileLineColLocs;
 
   /// NameLocation uniquing.
-  DenseMap<const char *, NameLocationStorage *> nameLocs;
+  ShardedUniquer<DenseMap<const char *, NameLocationStorage *>> nameLocs;
 
   /// CallLocation uniquing.
-  DenseSet<CallSiteLocationStorage *, CallSiteLocationKeyInfo> callLocs;
+  ShardedUniquer<DenseSet<CallSiteLocationStorage *, CallSiteLocationKeyInfo>>
+      callLocs;
 
   /// FusedLoc uniquing.
   using FusedLocations = DenseSet<FusedLocationStorage *, FusedLocKeyInfo>;
-  FusedLocations fusedLocs;
+  ShardedUniquer<FusedLocations> fusedLocs;
 
   //===--------------------------------------------------------------------===//
   // Identifier uniquing
   //===--------------------------------------------------------------------===//
 
-  // Identifier allocator and mutex for thread safety.
+  // Identifier allocator and mutex for thread safety. The mutex guards the
+  // allocator, which is shared between the shards of the identifier table.
   llvm::BumpPtrAllocator identifierAllocator;
-  llvm::sys::SmartRWMutex<true> identifierMutex;
+  llvm::sys::SmartMutex<true> identifierMutex;
 
   //===--------------------------------------------------------------------===//
   // Other
@@ -509,28 +693,41 @@ public:
   /// This is a mapping from type identifier to Dialect for registered types.
   DenseMap<const TypeID *, Dialect *> registeredTypes;
 
+  /// The canonicalization patterns of the registered operations, or null if
+  /// they have not been built since the last operation was registered.
+  std::shared_ptr<const FrozenRewritePatternList> canonicalizationPatterns;
+
+  /// A counter that is bumped every time an operation is registered, used to
+  /// detect registrations that race with building the canonicalization
+  /// patterns.
+  unsigned registryGeneration = 0;
+
   /// These are identifiers uniqued into this MLIRContext.
-  llvm::StringMap<char, llvm::BumpPtrAllocator &> identifiers;
+  ShardedUniquer<llvm::StringMap<char, llvm::BumpPtrAllocator &>> identifiers;
 
   //===--------------------------------------------------------------------===//
   // Affine uniquing
   //===--------------------------------------------------------------------===//
 
-  // Affine allocator and mutex for thread safety.
-  llvm::BumpPtrAllocator affineAllocator;
+  // Affine allocator.
+  ThreadLocalAllocator<llvm::BumpPtrAllocator> affineAllocator;
+
+  // A mutex to keep the uniquing of dimensional and symbolic identifiers
+  // thread-safe.
   llvm::sys::SmartRWMutex<true> affineMutex;
 
   // Affine map uniquing.
   using AffineMapSet = DenseSet<AffineMap, AffineMapKeyInfo>;
-  AffineMapSet affineMaps;
+  ShardedUniquer<AffineMapSet> affineMaps;
 
   // Integer set uniquing.
   using IntegerSets = DenseSet<IntegerSet, IntegerSetKeyInfo>;
-  IntegerSets integerSets;
+  ShardedUniquer<IntegerSets> integerSets;
 
   // Affine binary op expression uniquing. Figure out uniquing of dimensional
   // or symbolic identifiers.
-  DenseMap<std::tuple<unsigned, AffineExpr, AffineExpr>, AffineExpr>
+  ShardedUniquer<
+      DenseMap<std::tuple<unsigned, AffineExpr, AffineExpr>, AffineExpr>>
       affineExprs;
 
   // Uniqui'ing of AffineDimExpr, AffineSymbolExpr's by their position.
@@ -538,7 +735,7 @@ public:
   std::vector<AffineSymbolExprStorage *> symbolExprs;
 
   // Uniqui'ing of AffineConstantExprStorage using constant value as key.
-  DenseMap<int64_t, AffineConstantExprStorage *> constExprs;
+  ShardedUniquer<DenseMap<int64_t, AffineConstantExprStorage *>> constExprs;
 
   //===--------------------------------------------------------------------===//
   // Type uniquing
@@ -549,38 +746,46 @@ public:
   // Attribute uniquing
   //===--------------------------------------------------------------------===//
 
-  // Attribute allocator and mutex for thread safety.
-  llvm::BumpPtrAllocator attributeAllocator;
+  // Attribute allocator.
+  ThreadLocalAllocator<llvm::BumpPtrAllocator> attributeAllocator;
+
+  // A mutex to keep the uniquing of boolean attributes thread-safe.
   llvm::sys::SmartRWMutex<true> attributeMutex;
 
   BoolAttributeStorage *boolAttrs[2] = {nullptr};
-  DenseSet<IntegerAttributeStorage *, IntegerAttrKeyInfo> integerAttrs;
-  DenseSet<FloatAttributeStorage *, FloatAttrKeyInfo> floatAttrs;
-  StringMap<StringAttributeStorage *> stringAttrs;
+  ShardedUniquer<DenseSet<IntegerAttributeStorage *, IntegerAttrKeyInfo>>
+      integerAttrs;
+  ShardedUniquer<DenseSet<FloatAttributeStorage *, FloatAttrKeyInfo>>
+      floatAttrs;
+  ShardedUniquer<StringMap<StringAttributeStorage *>> stringAttrs;
   using ArrayAttrSet = DenseSet<ArrayAttributeStorage *, ArrayAttrKeyInfo>;
-  ArrayAttrSet arrayAttrs;
-  DenseMap<AffineMap, AffineMapAttributeStorage *> affineMapAttrs;
-  DenseMap<IntegerSet, IntegerSetAttributeStorage *> integerSetAttrs;
-  DenseMap<Type, TypeAttributeStorage *> typeAttrs;
+  ShardedUniquer<ArrayAttrSet> arrayAttrs;
+  ShardedUniquer<DenseMap<AffineMap, AffineMapAttributeStorage *>>
+      affineMapAttrs;
+  ShardedUniquer<DenseMap<IntegerSet, IntegerSetAttributeStorage *>>
+      integerSetAttrs;
+  ShardedUniquer<DenseMap<Type, TypeAttributeStorage *>> typeAttrs;
   using AttributeListSet =
       DenseSet<AttributeListStorage *, AttributeListKeyInfo>;
-  AttributeListSet attributeLists;
-  DenseMap<Function *, FunctionAttributeStorage *> functionAttrs;
-  DenseMap<std::pair<Type, Attribute>, SplatElementsAttributeStorage *>
+  ShardedUniquer<AttributeListSet> attributeLists;
+  ShardedUniquer<DenseMap<Function *, FunctionAttributeStorage *>>
+      functionAttrs;
+  ShardedUniquer<
+      DenseMap<std::pair<Type, Attribute>, SplatElementsAttributeStorage *>>
       splatElementsAttrs;
   using DenseElementsAttrSet =
       DenseSet<DenseElementsAttributeStorage *, DenseElementsAttrInfo>;
-  DenseElementsAttrSet denseElementsAttrs;
+  ShardedUniquer<DenseElementsAttrSet> denseElementsAttrs;
   using OpaqueElementsAttrSet =
       DenseSet<OpaqueElementsAttributeStorage *, OpaqueElementsAttrInfo>;
-  OpaqueElementsAttrSet opaqueElementsAttrs;
-  DenseMap<std::tuple<Type, Attribute, Attribute>,
-           SparseElementsAttributeStorage *>
+  ShardedUniquer<OpaqueElementsAttrSet> opaqueElementsAttrs;
+  ShardedUniquer<DenseMap<std::tuple<Type, Attribute, Attribute>,
+                          SparseElementsAttributeStorage *>>
       sparseElementsAttrs;
 
 public:
   MLIRContextImpl()
-      : filenames(locationAllocator), identifiers(identifierAllocator) {}
+      : filenames(filenameAllocator), identifiers(identifierAllocator) {}
 };
 } // end namespace mlir
 
@@ -594,8 +799,9 @@ MLIRContext::~MLIRContext() {}
 /// Copy the specified array of elements into memory managed by the provided
 /// bump pointer allocator.  This assumes the elements are all PODs.
 template <typename T>
-static ArrayRef<T> copyArrayRefInto(llvm::BumpPtrAllocator &allocator,
-                                    ArrayRef<T> elements) {
+static ArrayRef<T>
+copyArrayRefInto(ThreadLocalAllocator<llvm::BumpPtrAllocator> &allocator,
+                 ArrayRef<T> elements) {
   auto result = allocator.Allocate<T>(elements.size());
   std::uninitialized_copy(elements.begin(), elements.end(), result);
   return ArrayRef<T>(result, elements.size());
@@ -741,6 +947,41 @@ std::vector<AbstractOperation *> MLIRContext::getRegisteredOperations() {
   return result;
 }
 
+/// Return the canonicalization patterns of all registered operations as a
+/// frozen pattern list, building and caching it if necessary.
+std::shared_ptr<const FrozenRewritePatternList>
+MLIRContext::getCanonicalizationPatterns() {
+  auto &impl = getImpl();
+
+  unsigned generation;
+  { // Check for a cached pattern list.
+    llvm::sys::SmartScopedReader<true> registryLock(impl.contextMutex);
+    if (impl.canonicalizationPatterns)
+      return impl.canonicalizationPatterns;
+    generation = impl.registryGeneration;
+  }
+
+  // Build the patterns without holding the lock, as pattern constructors
+  // query the operation registry.
+  OwningRewritePatternList patterns;
+  for (auto *op : getRegisteredOperations())
+    op->getCanonicalizationPatterns(patterns, this);
+  auto frozenPatterns =
+      std::make_shared<const FrozenRewritePatternList>(std::move(patterns));
+
+  llvm::sys::SmartScopedWriter<true> registryLock(impl.contextMutex);
+
+  // If another thread beat us to it, use its list so that everyone shares one.
+  if (impl.canonicalizationPatterns)
+    return impl.canonicalizationPatterns;
+
+  // Only cache the list if no operations were registered while it was being
+  // built, otherwise it may be missing their patterns.
+  if (impl.registryGeneration == generation)
+    impl.canonicalizationPatterns = frozenPatterns;
+  return frozenPatterns;
+}
+
 void Dialect::addOperation(AbstractOperation opInfo) {
   assert(opInfo.name.split('.').first == getNamespace() &&
          "op name doesn't start with dialect namespace");
@@ -754,6 +995,11 @@ void Dialect::addOperation(AbstractOperation opInfo) {
                  << "' is already registered.\n";
     abort();
   }
+
+  // Invalidate the cached canonicalization patterns, which don't include the
+  // patterns of the new operation.
+  ++impl.registryGeneration;
+  impl.canonicalizationPatterns.reset();
 }
 
 /// Register a dialect-specific type with the current context.
@@ -782,6 +1028,114 @@ const AbstractOperation *AbstractOperation::lookup(StringRef opName,
   return nullptr;
 }
 
+//===----------------------------------------------------------------------===//
+// Memory accounting
+//===----------------------------------------------------------------------===//
+
+/// Return the memory usage of the allocators backing the uniqued storage of
+/// this context.
+auto MLIRContext::getAllocatorMemoryUsage()
+    -> std::vector<AllocatorMemoryUsage> {
+  auto &impl = getImpl();
+  std::vector<AllocatorMemoryUsage> usage;
+  usage.push_back({"affine", impl.affineAllocator.getArenaMemory()});
+  usage.push_back({"attributes", impl.attributeAllocator.getArenaMemory()});
+  {
+    llvm::sys::SmartScopedLock<true> filenameLock(impl.filenameMutex);
+    usage.push_back({"filenames", {impl.filenameAllocator.getTotalMemory()}});
+  }
+  {
+    llvm::sys::SmartScopedLock<true> allocatorLock(impl.identifierMutex);
+    usage.push_back(
+        {"identifiers", {impl.identifierAllocator.getTotalMemory()}});
+  }
+  usage.push_back({"locations", impl.locationAllocator.getArenaMemory()});
+  usage.push_back({"types", impl.typeUniquer.allocator.getArenaMemory()});
+  return usage;
+}
+
+/// Return statistics about the hash tables used to unique storage in this
+/// context.
+auto MLIRContext::getUniquerStatistics() -> std::vector<UniquerStatistics> {
+  auto &impl = getImpl();
+  std::vector<UniquerStatistics> stats;
+
+  // Locations.
+  {
+    llvm::sys::SmartScopedLock<true> filenameLock(impl.filenameMutex);
+    UniquerStatistics filenameStats;
+    filenameStats.name = "filenames";
+    addUniquerStatistics(impl.filenames, filenameStats);
+    stats.push_back(filenameStats);
+  }
+  stats.push_back(impl.fileLineColLocs.getStatistics("file line col locs"));
+  stats.push_back(impl.nameLocs.getStatistics("name locs"));
+  stats.push_back(impl.callLocs.getStatistics("call site locs"));
+  stats.push_back(impl.fusedLocs.getStatistics("fused locs"));
+
+  // Identifiers.
+  stats.push_back(impl.identifiers.getStatistics("identifiers"));
+
+  // Affine constructs.
+  stats.push_back(impl.affineMaps.getStatistics("affine maps"));
+  stats.push_back(impl.integerSets.getStatistics("integer sets"));
+  stats.push_back(impl.affineExprs.getStatistics("affine binary exprs"));
+  stats.push_back(impl.constExprs.getStatistics("affine constant exprs"));
+
+  // Types.
+  stats.push_back(impl.typeUniquer.storageTypes.getStatistics("types"));
+  stats.push_back(impl.typeUniquer.simpleTypes.getStatistics("simple types"));
+
+  // Attributes.
+  stats.push_back(impl.integerAttrs.getStatistics("integer attrs"));
+  stats.push_back(impl.floatAttrs.getStatistics("float attrs"));
+  stats.push_back(impl.stringAttrs.getStatistics("string attrs"));
+  stats.push_back(impl.arrayAttrs.getStatistics("array attrs"));
+  stats.push_back(impl.affineMapAttrs.getStatistics("affine map attrs"));
+  stats.push_back(impl.integerSetAttrs.getStatistics("integer set attrs"));
+  stats.push_back(impl.typeAttrs.getStatistics("type attrs"));
+  stats.push_back(impl.attributeLists.getStatistics("attribute lists"));
+  stats.push_back(impl.functionAttrs.getStatistics("function attrs"));
+  stats.push_back(
+      impl.splatElementsAttrs.getStatistics("splat elements attrs"));
+  stats.push_back(
+      impl.denseElementsAttrs.getStatistics("dense elements attrs"));
+  stats.push_back(
+      impl.opaqueElementsAttrs.getStatistics("opaque elements attrs"));
+  stats.push_back(
+      impl.sparseElementsAttrs.getStatistics("sparse elements attrs"));
+  return stats;
+}
+
+/// Print the memory usage of the allocators backing the uniqued storage of
+/// this context, along with statistics about the uniquing tables, to the
+/// given stream.
+void MLIRContext::printMemoryUsage(raw_ostream &os) {
+  os << "Uniqued storage memory usage:\n";
+  for (auto &usage : getAllocatorMemoryUsage()) {
+    size_t totalMemory = 0;
+    for (size_t arenaMemory : usage.arenaMemory)
+      totalMemory += arenaMemory;
+
+    os << "  " << usage.name << ": " << totalMemory << " bytes in "
+       << usage.arenaMemory.size() << " arena(s)";
+    if (usage.arenaMemory.size() > 1) {
+      os << " (";
+      interleaveComma(usage.arenaMemory, os);
+      os << ")";
+    }
+    os << "\n";
+  }
+
+  os << "Uniquing table statistics:\n";
+  for (auto &stats : getUniquerStatistics()) {
+    os << "  " << stats.name << ": " << stats.numEntries << " entries, "
+       << stats.numBuckets << " buckets, " << stats.tableMemory
+       << " bytes, load factor " << llvm::format("%.2f", stats.getLoadFactor())
+       << "\n";
+  }
+}
+
 //===----------------------------------------------------------------------===//
 // Identifier uniquing
 //===----------------------------------------------------------------------===//
@@ -793,17 +1147,20 @@ Identifier Identifier::get(StringRef str, MLIRContext *context) {
          "Cannot create an identifier with a nul character");
 
   auto &impl = context->getImpl();
+  auto &shard = impl.identifiers.getShard(str);
 
   { // Check for an existing identifier in read-only mode.
-    llvm::sys::SmartScopedReader<true> contextLock(impl.identifierMutex);
-    auto it = impl.identifiers.find(str);
-    if (it != impl.identifiers.end())
+    llvm::sys::SmartScopedReader<true> identifierLock(shard.mutex);
+    auto it = shard.container.find(str);
+    if (it != shard.container.end())
       return Identifier(it->getKeyData());
   }
 
-  // Aquire a writer-lock so that we can safely create the new instance.
-  llvm::sys::SmartScopedWriter<true> contextLock(impl.identifierMutex);
-  auto it = impl.identifiers.insert({str, char()}).first;
+  // Aquire a writer-lock so that we can safely create the new instance, and
+  // lock the allocator that is shared with the other shards.
+  llvm::sys::SmartScopedWriter<true> identifierLock(shard.mutex);
+  llvm::sys::SmartScopedLock<true> allocatorLock(impl.identifierMutex);
+  auto it = shard.container.insert({str, char()}).first;
   return Identifier(it->getKeyData());
 }
 
@@ -818,8 +1175,8 @@ UnknownLoc UnknownLoc::get(MLIRContext *context) {
 UniquedFilename UniquedFilename::get(StringRef filename, MLIRContext *context) {
   auto &impl = context->getImpl();
 
-  // Aquire a writer-lock so that we can safely create the new instance.
-  llvm::sys::SmartScopedWriter<true> locationLock(impl.locationMutex);
+  // Aquire the lock so that we can safely create the new instance.
+  llvm::sys::SmartScopedLock<true> filenameLock(impl.filenameMutex);
   auto it = impl.filenames.insert({filename, char()}).first;
   return UniquedFilename(it->getKeyData());
 }
@@ -830,7 +1187,7 @@ FileLineColLoc FileLineColLoc::get(UniquedFilename filename, unsigned line,
 
   // Safely get or create a location instance.
   auto key = std::make_tuple(filename.data(), line, column);
-  return safeGetOrCreate(impl.fileLineColLocs, key, impl.locationMutex, [&] {
+  return safeGetOrCreate(impl.fileLineColLocs, key, [&] {
     return new (impl.locationAllocator.Allocate<FileLineColLocationStorage>())
         FileLineColLocationStorage(filename, line, column);
   });
@@ -840,7 +1197,7 @@ NameLoc NameLoc::get(Identifier name, MLIRContext *context) {
   auto &impl = context->getImpl();
 
   // Safely get or create a location instance.
-  return safeGetOrCreate(impl.nameLocs, name.data(), impl.locationMutex, [&] {
+  return safeGetOrCreate(impl.nameLocs, name.data(), [&] {
     return new (impl.locationAllocator.Allocate<NameLocationStorage>())
         NameLocationStorage(name);
   });
@@ -852,7 +1209,7 @@ CallSiteLoc CallSiteLoc::get(Location callee, Location caller,
 
   // Safely get or create a location instance.
   auto key = std::make_pair(callee, caller);
-  return safeGetOrCreate(impl.callLocs, key, impl.locationMutex, [&] {
+  return safeGetOrCreate(impl.callLocs, key, [&] {
     return new (impl.locationAllocator.Allocate<CallSiteLocationStorage>())
         CallSiteLocationStorage(callee, caller);
   });
@@ -905,7 +1262,7 @@ Location FusedLoc::get(ArrayRef<Location> locs, Attribute metadata,
 
   // Safely get or create a location instance.
   auto key = std::make_pair(locs, metadata);
-  return safeGetOrCreate(impl.fusedLocs, key, impl.locationMutex, [&] {
+  return safeGetOrCreate(impl.fusedLocs, key, [&] {
     auto byteSize =
         FusedLocationStorage::totalSizeToAlloc<Location>(locs.size());
     auto rawMem = impl.locationAllocator.Allocate(
@@ -982,7 +1339,7 @@ IntegerAttr IntegerAttr::get(Type type, const APInt &value) {
   IntegerAttrKeyInfo::KeyTy key({type, value});
 
   // Safely get or create an attribute instance.
-  return safeGetOrCreate(impl.integerAttrs, key, impl.attributeMutex, [&] {
+  return safeGetOrCreate(impl.integerAttrs, key, [&] {
     auto elements = ArrayRef<uint64_t>(value.getRawData(), value.getNumWords());
 
     auto byteSize =
@@ -1046,7 +1403,7 @@ FloatAttr FloatAttr::get(Type type, const APFloat &value) {
   FloatAttrKeyInfo::KeyTy key({type, value});
 
   // Safely get or create an attribute instance.
-  return safeGetOrCreate(impl.floatAttrs, key, impl.attributeMutex, [&] {
+  return safeGetOrCreate(impl.floatAttrs, key, [&] {
     const auto &apint = value.bitcastToAPInt();
     // Here one word's bitwidth equals to that of uint64_t.
     auto elements = ArrayRef<uint64_t>(apint.getRawData(), apint.getNumWords());
@@ -1065,21 +1422,22 @@ FloatAttr FloatAttr::get(Type type, const APFloat &value) {
 
 StringAttr StringAttr::get(StringRef bytes, MLIRContext *context) {
   auto &impl = context->getImpl();
+  auto &shard = impl.stringAttrs.getShard(bytes);
 
   { // Check for an existing instance in read-only mode.
-    llvm::sys::SmartScopedReader<true> attributeLock(impl.attributeMutex);
-    auto it = impl.stringAttrs.find(bytes);
-    if (it != impl.stringAttrs.end())
+    llvm::sys::SmartScopedReader<true> attributeLock(shard.mutex);
+    auto it = shard.container.find(bytes);
+    if (it != shard.container.end())
       return it->second;
   }
 
   // Aquire the mutex in write mode so that we can safely construct the new
   // instance.
-  llvm::sys::SmartScopedWriter<true> attributeLock(impl.attributeMutex);
+  llvm::sys::SmartScopedWriter<true> attributeLock(shard.mutex);
 
   // Check for an existing instance again here, because another writer thread
   // may have already created one.
-  auto it = impl.stringAttrs.insert({bytes, nullptr}).first;
+  auto it = shard.container.insert({bytes, nullptr}).first;
   if (it->second)
     return it->second;
 
@@ -1092,7 +1450,7 @@ ArrayAttr ArrayAttr::get(ArrayRef<Attribute> value, MLIRContext *context) {
   auto &impl = context->getImpl();
 
   // Safely get or create an attribute instance.
-  return safeGetOrCreate(impl.arrayAttrs, value, impl.attributeMutex, [&] {
+  return safeGetOrCreate(impl.arrayAttrs, value, [&] {
     auto *result = impl.attributeAllocator.Allocate<ArrayAttributeStorage>();
 
     // Copy the elements into the bump pointer.
@@ -1116,7 +1474,7 @@ AffineMapAttr AffineMapAttr::get(AffineMap value) {
   auto &impl = context->getImpl();
 
   // Safely get or create an attribute instance.
-  return safeGetOrCreate(impl.affineMapAttrs, value, impl.attributeMutex, [&] {
+  return safeGetOrCreate(impl.affineMapAttrs, value, [&] {
     auto result = impl.attributeAllocator.Allocate<AffineMapAttributeStorage>();
     return new (result) AffineMapAttributeStorage(value);
   });
@@ -1127,7 +1485,7 @@ IntegerSetAttr IntegerSetAttr::get(IntegerSet value) {
   auto &impl = context->getImpl();
 
   // Safely get or create an attribute instance.
-  return safeGetOrCreate(impl.integerSetAttrs, value, impl.attributeMutex, [&] {
+  return safeGetOrCreate(impl.integerSetAttrs, value, [&] {
     auto result =
         impl.attributeAllocator.Allocate<IntegerSetAttributeStorage>();
     return new (result) IntegerSetAttributeStorage(value);
@@ -1138,7 +1496,7 @@ TypeAttr TypeAttr::get(Type type, MLIRContext *context) {
   auto &impl = context->getImpl();
 
   // Safely get or create an attribute instance.
-  return safeGetOrCreate(impl.typeAttrs, type, impl.attributeMutex, [&] {
+  return safeGetOrCreate(impl.typeAttrs, type, [&] {
     auto result = impl.attributeAllocator.Allocate<TypeAttributeStorage>();
     return new (result) TypeAttributeStorage(type);
   });
@@ -1149,7 +1507,7 @@ FunctionAttr FunctionAttr::get(Function *value, MLIRContext *context) {
   auto &impl = context->getImpl();
 
   // Safely get or create an attribute instance.
-  return safeGetOrCreate(impl.functionAttrs, value, impl.attributeMutex, [&] {
+  return safeGetOrCreate(impl.functionAttrs, value, [&] {
     auto result = impl.attributeAllocator.Allocate<FunctionAttributeStorage>();
     return new (result) FunctionAttributeStorage(value);
   });
@@ -1162,10 +1520,11 @@ void FunctionAttr::dropFunctionReference(Function *value) {
 
   // Aquire the mutex in write mode so that we can safely remove the attribute
   // if it exists.
-  llvm::sys::SmartScopedWriter<true> attributeLock(impl.attributeMutex);
+  auto &shard = impl.functionAttrs.getShard(value);
+  llvm::sys::SmartScopedWriter<true> attributeLock(shard.mutex);
 
   // Check to see if there was an attribute referring to this function.
-  auto &functionAttrs = impl.functionAttrs;
+  auto &functionAttrs = shard.container;
 
   // If not, then we're done.
   auto it = functionAttrs.find(value);
@@ -1231,7 +1590,7 @@ AttributeListStorage *AttributeListStorage::get(ArrayRef<NamedAttribute> attrs,
   auto &impl = context->getImpl();
 
   // Safely get or create an attribute instance.
-  return safeGetOrCreate(impl.attributeLists, attrs, impl.attributeMutex, [&] {
+  return safeGetOrCreate(impl.attributeLists, attrs, [&] {
     auto byteSize =
         AttributeListStorage::totalSizeToAlloc<NamedAttribute>(attrs.size());
     auto rawMem =
@@ -1271,12 +1630,11 @@ SplatElementsAttr SplatElementsAttr::get(VectorOrTensorType type,
 
   // Safely get or create an attribute instance.
   std::pair<Type, Attribute> key(type, elt);
-  return safeGetOrCreate(
-      impl.splatElementsAttrs, key, impl.attributeMutex, [&] {
-        auto result =
-            impl.attributeAllocator.Allocate<SplatElementsAttributeStorage>();
-        return new (result) SplatElementsAttributeStorage(type, elt);
-      });
+  return safeGetOrCreate(impl.splatElementsAttrs, key, [&] {
+    auto result =
+        impl.attributeAllocator.Allocate<SplatElementsAttributeStorage>();
+    return new (result) SplatElementsAttributeStorage(type, elt);
+  });
 }
 
 DenseElementsAttr DenseElementsAttr::get(VectorOrTensorType type,
@@ -1290,35 +1648,33 @@ DenseElementsAttr DenseElementsAttr::get(VectorOrTensorType type,
   DenseElementsAttrInfo::KeyTy key({type, data});
 
   // Safely get or create an attribute instance.
-  return safeGetOrCreate(
-      impl.denseElementsAttrs, key, impl.attributeMutex, [&] {
-        Attribute::Kind kind;
-        switch (type.getElementType().getKind()) {
-        case StandardTypes::BF16:
-        case StandardTypes::F16:
-        case StandardTypes::F32:
-        case StandardTypes::F64:
-          kind = Attribute::Kind::DenseFPElements;
-          break;
-        case StandardTypes::Integer:
-          kind = Attribute::Kind::DenseIntElements;
-          break;
-        default:
-          llvm_unreachable("unexpected element type");
-        }
-
-        // If the data buffer is non-empty, we copy it into the context.
-        ArrayRef<char> copy;
-        if (!data.empty()) {
-          auto *rawCopy =
-              (char *)impl.attributeAllocator.Allocate(data.size(), 64);
-          std::uninitialized_copy(data.begin(), data.end(), rawCopy);
-          copy = {rawCopy, data.size()};
-        }
-        auto *result =
-            impl.attributeAllocator.Allocate<DenseElementsAttributeStorage>();
-        return new (result) DenseElementsAttributeStorage(kind, type, copy);
-      });
+  return safeGetOrCreate(impl.denseElementsAttrs, key, [&] {
+    Attribute::Kind kind;
+    switch (type.getElementType().getKind()) {
+    case StandardTypes::BF16:
+    case StandardTypes::F16:
+    case StandardTypes::F32:
+    case StandardTypes::F64:
+      kind = Attribute::Kind::DenseFPElements;
+      break;
+    case StandardTypes::Integer:
+      kind = Attribute::Kind::DenseIntElements;
+      break;
+    default:
+      llvm_unreachable("unexpected element type");
+    }
+
+    // If the data buffer is non-empty, we copy it into the context.
+    ArrayRef<char> copy;
+    if (!data.empty()) {
+      auto *rawCopy = (char *)impl.attributeAllocator.Allocate(data.size(), 64);
+      std::uninitialized_copy(data.begin(), data.end(), rawCopy);
+      copy = {rawCopy, data.size()};
+    }
+    auto *result =
+        impl.attributeAllocator.Allocate<DenseElementsAttributeStorage>();
+    return new (result) DenseElementsAttributeStorage(kind, type, copy);
+  });
 }
 
 DenseElementsAttr DenseElementsAttr::get(VectorOrTensorType type,
@@ -1371,17 +1727,15 @@ OpaqueElementsAttr OpaqueElementsAttr::get(Dialect *dialect,
   auto &impl = type.getContext()->getImpl();
   OpaqueElementsAttrInfo::KeyTy key(dialect, type, bytes);
 
-  return safeGetOrCreate(
-      impl.opaqueElementsAttrs, key, impl.attributeMutex, [&] {
-        auto *result =
-            impl.attributeAllocator.Allocate<OpaqueElementsAttributeStorage>();
+  return safeGetOrCreate(impl.opaqueElementsAttrs, key, [&] {
+    auto *result =
+        impl.attributeAllocator.Allocate<OpaqueElementsAttributeStorage>();
 
-        // TODO: Provide a way to avoid copying content of large opaque tensors
-        // This will likely require a new reference attribute kind.
-        bytes = bytes.copy(impl.attributeAllocator);
-        return new (result)
-            OpaqueElementsAttributeStorage(type, dialect, bytes);
-      });
+    // TODO: Provide a way to avoid copying content of large opaque tensors
+    // This will likely require a new reference attribute kind.
+    bytes = bytes.copy(impl.attributeAllocator);
+    return new (result) OpaqueElementsAttributeStorage(type, dialect, bytes);
+  });
 }
 
 SparseElementsAttr SparseElementsAttr::get(VectorOrTensorType type,
@@ -1394,12 +1748,11 @@ SparseElementsAttr SparseElementsAttr::get(VectorOrTensorType type,
   auto key = std::make_tuple(type, indices, values);
 
   // Safely get or create an attribute instance.
-  return safeGetOrCreate(
-      impl.sparseElementsAttrs, key, impl.attributeMutex, [&] {
-        return new (
-            impl.attributeAllocator.Allocate<SparseElementsAttributeStorage>())
-            SparseElementsAttributeStorage(type, indices, values);
-      });
+  return safeGetOrCreate(impl.sparseElementsAttrs, key, [&] {
+    return new (
+        impl.attributeAllocator.Allocate<SparseElementsAttributeStorage>())
+        SparseElementsAttributeStorage(type, indices, values);
+  });
 }
 
 //===----------------------------------------------------------------------===//
@@ -1418,7 +1771,7 @@ AffineMap AffineMap::get(unsigned dimCount, unsigned symbolCount,
   auto key = std::make_tuple(dimCount, symbolCount, results, rangeSizes);
 
   // Safely get or create an AffineMap instance.
-  return safeGetOrCreate(impl.affineMaps, key, impl.affineMutex, [&] {
+  return safeGetOrCreate(impl.affineMaps, key, [&] {
     auto *res = impl.affineAllocator.Allocate<detail::AffineMapStorage>();
 
     // Copy the results and range sizes into the bump pointer.
@@ -1635,11 +1988,12 @@ AffineExpr AffineBinaryOpExprStorage::get(AffineExprKind kind, AffineExpr lhs,
 
   // Check if we already have this affine expression, and return it if we do.
   auto keyValue = std::make_tuple((unsigned)kind, lhs, rhs);
+  auto &shard = impl.affineExprs.getShard(keyValue);
 
   { // Check for an existing instance in read-only mode.
-    llvm::sys::SmartScopedReader<true> affineLock(impl.affineMutex);
-    auto cached = impl.affineExprs.find(keyValue);
-    if (cached != impl.affineExprs.end())
+    llvm::sys::SmartScopedReader<true> affineLock(shard.mutex);
+    auto cached = shard.container.find(keyValue);
+    if (cached != shard.container.end())
       return cached->second;
   }
 
@@ -1670,11 +2024,11 @@ AffineExpr AffineBinaryOpExprStorage::get(AffineExprKind kind, AffineExpr lhs,
     return simplified;
 
   // Aquire a writer-lock so that we can safely create the new instance.
-  llvm::sys::SmartScopedWriter<true> affineLock(impl.affineMutex);
+  llvm::sys::SmartScopedWriter<true> affineLock(shard.mutex);
 
   // Check for an existing instance again here, because another writer thread
   // may have already created one.
-  auto &result = impl.affineExprs.insert({keyValue, nullptr}).first->second;
+  auto &result = shard.container.insert({keyValue, nullptr}).first->second;
   if (!result) {
     // An expression with these operands will already be in the
     // simplified/canonical form. Create and store it.
@@ -1750,7 +2104,7 @@ AffineExpr mlir::getAffineConstantExpr(int64_t constant, MLIRContext *context) {
   auto &impl = context->getImpl();
 
   // Safely get or create an AffineConstantExpr instance.
-  return safeGetOrCreate(impl.constExprs, constant, impl.affineMutex, [&] {
+  return safeGetOrCreate(impl.constExprs, constant, [&] {
     auto *result = impl.affineAllocator.Allocate<AffineConstantExprStorage>();
     return new (result) AffineConstantExprStorage{
         {AffineExprKind::Constant, context}, constant};
@@ -1789,12 +2143,9 @@ IntegerSet IntegerSet::get(unsigned dimCount, unsigned symbolCount,
   // threads may simulatenously access existing instances.
   if (constraints.size() < IntegerSet::kUniquingThreshold) {
     auto key = std::make_tuple(dimCount, symbolCount, constraints, eqFlags);
-    return safeGetOrCreate(impl.integerSets, key, impl.affineMutex,
-                           constructorFn);
+    return safeGetOrCreate(impl.integerSets, key, constructorFn);
   }
 
-  // Otherwise, aquire a writer-lock so that we can safely create the new
-  // instance.
-  llvm::sys::SmartScopedWriter<true> affineLock(impl.affineMutex);
+  // Otherwise, create a new instance.
   return constructorFn();
 }
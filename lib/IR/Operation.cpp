@@ -22,6 +22,7 @@
 #include "mlir/IR/MLIRContext.h"
 #include "mlir/IR/OpDefinition.h"
 #include "mlir/IR/OpImplementation.h"
+#include "mlir/IR/OperationArena.h"
 #include "mlir/IR/StandardTypes.h"
 #include <numeric>
 using namespace mlir;
@@ -132,12 +133,16 @@ Operation *Operation::create(Location location, OperationName name,
   byteSize += llvm::alignTo(detail::OperandStorage::additionalAllocSize(
                                 numOperands, resizableOperandList),
                             alignof(Operation));
-  void *rawMem = malloc(byteSize);
+
+  // Allocate from the arena of the current thread, if there is one.
+  OperationArena *arena = OperationArena::getCurrentArena();
+  void *rawMem = arena ? arena->allocate(byteSize) : malloc(byteSize);
 
   // Create the new Operation.
   auto op =
       ::new (rawMem) Operation(location, name, resultTypes.size(),
                                numSuccessors, numRegions, attributes, context);
+  op->isArenaAllocated = arena != nullptr;
 
   assert((numSuccessors == 0 || !op->isKnownNonTerminator()) &&
          "unexpected successors in a non-terminator operation");
@@ -218,10 +223,13 @@ Operation::Operation(Location location, OperationName name, unsigned numResults,
                      unsigned numSuccessors, unsigned numRegions,
                      const NamedAttributeList &attributes, MLIRContext *context)
     : location(location), numResults(numResults), numSuccs(numSuccessors),
-      numRegions(numRegions), name(name), attrs(attributes) {}
+      numRegions(numRegions), isArenaAllocated(false), name(name),
+      attrs(attributes) {
+  assert(numRegions == this->numRegions && "too many regions");
+}
 
 // Operations are deleted through the destroy() member because they are
-// allocated via malloc.
+// allocated via malloc or from an OperationArena.
 Operation::~Operation() {
   assert(block == nullptr && "operation destroyed but still in a block");
 
@@ -242,8 +250,12 @@ Operation::~Operation() {
 
 /// Destroy this operation or one of its subclasses.
 void Operation::destroy() {
+  bool fromArena = isArenaAllocated;
   this->~Operation();
-  free(this);
+  if (fromArena)
+    OperationArena::deallocate(this);
+  else
+    free(this);
 }
 
 /// Return the context this operation is associated with.
@@ -341,9 +353,14 @@ bool Operation::isBeforeInBlock(Operation *other) {
   assert(block && "Operations without parent blocks have no order.");
   assert(other && other->block == block &&
          "Expected other operation to have the same parent block.");
-  // Recompute the parent ordering if necessary.
-  if (!block->isInstOrderValid())
+  // Recompute the parent ordering if necessary, or order the operations that
+  // were inserted since it was computed.
+  if (!block->isInstOrderValid()) {
     block->recomputeInstOrder();
+  } else {
+    block->updateInstOrder(this);
+    block->updateInstOrder(other);
+  }
   return orderIndex < other->orderIndex;
 }
 
@@ -393,8 +410,9 @@ void llvm::ilist_traits<::mlir::Operation>::addNodeToList(Operation *op) {
   assert(!op->getBlock() && "already in a operation block!");
   op->block = getContainingBlock();
 
-  // Invalidate the block ordering.
-  op->block->invalidateInstOrder();
+  // If the block is ordered, the operation is ordered lazily when queried.
+  if (op->block->isInstOrderValid())
+    op->orderIndex = Operation::kInvalidOrderIndex;
 }
 
 /// This is a trait method invoked when a operation is removed from a block.
@@ -410,8 +428,12 @@ void llvm::ilist_traits<::mlir::Operation>::transferNodesFromList(
     ilist_traits<Operation> &otherList, op_iterator first, op_iterator last) {
   Block *curParent = getContainingBlock();
 
-  // Invalidate the ordering of the parent block.
-  curParent->invalidateInstOrder();
+  // If the parent block is ordered, the operations are ordered lazily when
+  // queried.
+  if (curParent->isInstOrderValid()) {
+    for (auto it = first; it != last; ++it)
+      it->orderIndex = Operation::kInvalidOrderIndex;
+  }
 
   // If we are transferring operations within the same block, the block
   // pointer doesn't need to be updated.
@@ -0,0 +1,135 @@
+//===- OperationArena.cpp - Arena allocation for operations ---------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/IR/OperationArena.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/Module.h"
+#include "llvm/Support/Compiler.h"
+#include "llvm/Support/MathExtras.h"
+#include <algorithm>
+#include <cstddef>
+
+using namespace mlir;
+
+/// The arena that operations created on the current thread are allocated
+/// from, if any.
+static LLVM_THREAD_LOCAL OperationArena *currentArena = nullptr;
+
+/// Each allocation is preceded by a header holding the arena it comes from and
+/// its size class, so that it can be recycled when deallocated. The header
+/// also keeps the allocation aligned to the alignment of the header.
+namespace {
+struct alignas(alignof(std::max_align_t)) AllocationHeader {
+  OperationArena *arena;
+  unsigned sizeClass;
+};
+} // end anonymous namespace
+
+OperationArena::~OperationArena() {
+  assert(numLiveAllocations == 0 &&
+         "operation arena destroyed while operations are still alive");
+}
+
+OperationArena::Scope::Scope(OperationArena &arena)
+    : previousArena(currentArena) {
+  currentArena = &arena;
+}
+
+OperationArena::Scope::~Scope() { currentArena = previousArena; }
+
+/// Returns the arena that operations created on the current thread are
+/// allocated from, or null if operations are allocated with malloc.
+OperationArena *OperationArena::getCurrentArena() { return currentArena; }
+
+/// Allocate a block of memory of the given size.
+void *OperationArena::allocate(size_t size) {
+  // Compute the size class of the allocation, and the size of its blocks.
+  unsigned sizeClass;
+  if (size <= kMaxSmallSize) {
+    // Leave room for the link of the free lists.
+    size = llvm::alignTo(std::max(size, sizeof(void *)), kSmallSizeGranularity);
+    sizeClass = size / kSmallSizeGranularity;
+  } else {
+    size = llvm::PowerOf2Ceil(size);
+    sizeClass = kNumSmallSizeClasses + llvm::Log2_64(size / kMaxSmallSize) - 1;
+  }
+  ++numLiveAllocations;
+
+  // Reuse a deallocated block of the same size class if there is one.
+  if (void *ptr = freeLists[sizeClass]) {
+    freeLists[sizeClass] = *reinterpret_cast<void **>(ptr);
+    return ptr;
+  }
+
+  // Otherwise, allocate a new block with room for the header.
+  auto *header = static_cast<AllocationHeader *>(allocator.Allocate(
+      sizeof(AllocationHeader) + size, alignof(AllocationHeader)));
+  header->arena = this;
+  header->sizeClass = sizeClass;
+  return header + 1;
+}
+
+/// Return the given block of memory to the arena it was allocated from.
+void OperationArena::deallocate(void *ptr) {
+  auto *header = static_cast<AllocationHeader *>(ptr) - 1;
+  OperationArena *arena = header->arena;
+  assert(arena->numLiveAllocations != 0 && "deallocating from an empty arena");
+  --arena->numLiveAllocations;
+
+  // Push the block onto the free list of its size class, unless the whole
+  // arena is about to be released.
+  if (arena->destroyingInBulk)
+    return;
+  *reinterpret_cast<void **>(ptr) = arena->freeLists[header->sizeClass];
+  arena->freeLists[header->sizeClass] = ptr;
+}
+
+/// Destroy the operations in the body of the given function, without
+/// recycling their memory.
+static void destroyOperations(Function &function) {
+  // Drop all of the uses first, so that the operations may be destroyed in any
+  // order.
+  for (auto &block : function)
+    block.dropAllReferences();
+  function.getBlocks().clear();
+}
+
+/// Destroy all of the operations in the body of the given function.
+void OperationArena::destroyBody(Function &function) {
+  destroyingInBulk = true;
+  destroyOperations(function);
+  releaseIfEmpty();
+}
+
+/// Destroy all of the operations in the bodies of the functions of the given
+/// module.
+void OperationArena::destroyBody(Module &module) {
+  destroyingInBulk = true;
+  for (auto &function : module)
+    destroyOperations(function);
+  releaseIfEmpty();
+}
+
+/// Release the slabs of the arena if no operation allocated from it remains
+/// alive.
+void OperationArena::releaseIfEmpty() {
+  destroyingInBulk = false;
+  if (numLiveAllocations != 0)
+    return;
+  allocator.Reset();
+  std::fill(std::begin(freeLists), std::end(freeLists), nullptr);
+}
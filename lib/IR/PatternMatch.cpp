@@ -18,6 +18,8 @@
 #include "mlir/IR/PatternMatch.h"
 #include "mlir/IR/Operation.h"
 #include "mlir/IR/Value.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/Support/raw_ostream.h"
 using namespace mlir;
 
 PatternBenefit::PatternBenefit(unsigned benefit) : representation(benefit) {
@@ -39,6 +41,9 @@ Pattern::Pattern(StringRef rootName, PatternBenefit benefit,
                  MLIRContext *context)
     : rootKind(OperationName(rootName, context)), benefit(benefit) {}
 
+Pattern::Pattern(PatternBenefit benefit, MatchAnyOpTypeTag)
+    : rootKind(llvm::None), benefit(benefit) {}
+
 // Out-of-line vtable anchor.
 void Pattern::anchor() {}
 
@@ -122,28 +127,102 @@ void PatternRewriter::updatedRootInPlace(
 // PatternMatcher implementation
 //===----------------------------------------------------------------------===//
 
-RewritePatternMatcher::RewritePatternMatcher(
-    OwningRewritePatternList &&patterns, PatternRewriter &rewriter)
-    : patterns(std::move(patterns)), rewriter(rewriter) {
+FrozenRewritePatternList::FrozenRewritePatternList(
+    OwningRewritePatternList &&patterns)
+    : patterns(std::move(patterns)) {
   // Sort the patterns by benefit to simplify the matching logic.
   std::stable_sort(this->patterns.begin(), this->patterns.end(),
                    [](const std::unique_ptr<RewritePattern> &l,
                       const std::unique_ptr<RewritePattern> &r) {
                      return r->getBenefit() < l->getBenefit();
                    });
+
+  // Create an entry for each of the root kinds up front, so that the
+  // root-agnostic patterns can be interleaved into them in benefit order below.
+  for (auto &pattern : this->patterns)
+    if (auto rootKind = pattern->getRootKind())
+      opPatterns.try_emplace(*rootKind);
+
+  // Distribute the patterns into the dispatch table. The patterns are already
+  // sorted, so appending in order keeps each entry sorted by benefit.
+  for (auto &pattern : this->patterns) {
+    // Patterns that are impossible to match are never dispatched.
+    if (pattern->getBenefit().isImpossibleToMatch())
+      continue;
+
+    if (auto rootKind = pattern->getRootKind()) {
+      opPatterns[*rootKind].push_back(pattern.get());
+      continue;
+    }
+
+    // Root-agnostic patterns apply to every operation kind.
+    anyOpPatterns.push_back(pattern.get());
+    for (auto &it : opPatterns)
+      it.second.push_back(pattern.get());
+  }
+}
+
+/// Return the patterns that may apply to an operation of the given kind.
+ArrayRef<RewritePattern *>
+FrozenRewritePatternList::getMatchingPatterns(OperationName opName) const {
+  auto it = opPatterns.find(opName);
+  if (it != opPatterns.end())
+    return it->second;
+  return anyOpPatterns;
 }
 
+RewritePatternMatcher::RewritePatternMatcher(
+    OwningRewritePatternList &&patterns, PatternRewriter &rewriter)
+    : RewritePatternMatcher(
+          std::make_shared<FrozenRewritePatternList>(std::move(patterns)),
+          rewriter) {}
+
+RewritePatternMatcher::RewritePatternMatcher(
+    std::shared_ptr<const FrozenRewritePatternList> patterns,
+    PatternRewriter &rewriter)
+    : patterns(std::move(patterns)), rewriter(rewriter) {}
+
 /// Try to match the given operation to a pattern and rewrite it.
-void RewritePatternMatcher::matchAndRewrite(Operation *op) {
-  for (auto &pattern : patterns) {
-    // Ignore patterns that are for the wrong root or are impossible to match.
-    if (pattern->getRootKind() != op->getName() ||
-        pattern->getBenefit().isImpossibleToMatch())
-      continue;
+bool RewritePatternMatcher::matchAndRewrite(Operation *op) {
+  OperationName opName = op->getName();
+  ArrayRef<RewritePattern *> opPatterns = patterns->getMatchingPatterns(opName);
+  if (opPatterns.empty())
+    return false;
+
+  OpStatistics &statistics = opStatistics[opName];
+  for (auto *pattern : opPatterns) {
+    ++statistics.numPatternsTried;
 
     // Try to match and rewrite this pattern. The patterns are sorted by
     // benefit, so if we match we can immediately rewrite and return.
-    if (pattern->matchAndRewrite(op, rewriter))
-      return;
+    if (pattern->matchAndRewrite(op, rewriter)) {
+      ++statistics.numPatternsSucceeded;
+      return true;
+    }
   }
+  return false;
+}
+
+/// Return the statistics collected for the given operation kind.
+auto RewritePatternMatcher::getStatistics(OperationName opName) const
+    -> OpStatistics {
+  auto it = opStatistics.find(opName);
+  return it == opStatistics.end() ? OpStatistics() : it->second;
+}
+
+/// Print the statistics for every operation kind that this matcher attempted
+/// to match, sorted by operation name.
+void RewritePatternMatcher::printStatistics(raw_ostream &os) const {
+  std::vector<std::pair<StringRef, OpStatistics>> opStats;
+  for (auto &it : opStatistics)
+    opStats.emplace_back(it.first.getStringRef(), it.second);
+  llvm::array_pod_sort(opStats.begin(), opStats.end(),
+                       [](const std::pair<StringRef, OpStatistics> *lhs,
+                          const std::pair<StringRef, OpStatistics> *rhs) {
+                         return lhs->first.compare(rhs->first);
+                       });
+
+  for (auto &it : opStats)
+    os << "  " << it.first << ": " << it.second.numPatternsTried
+       << " tried, " << it.second.numPatternsSucceeded << " succeeded\n";
 }
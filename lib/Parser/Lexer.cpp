@@ -23,6 +23,8 @@
 #include "mlir/IR/Location.h"
 #include "mlir/IR/MLIRContext.h"
 #include "llvm/Support/SourceMgr.h"
+#include <algorithm>
+#include <cstring>
 using namespace mlir;
 
 using llvm::SMLoc;
@@ -34,8 +36,30 @@ static bool isPunct(char c) {
   return c == '$' || c == '.' || c == '_' || c == '-';
 }
 
-Lexer::Lexer(const llvm::SourceMgr &sourceMgr, MLIRContext *context)
-    : sourceMgr(sourceMgr), context(context) {
+LineIndex::LineIndex(StringRef buffer) {
+  lineStarts.push_back(buffer.begin());
+  for (const char *ptr = buffer.begin(), *end = buffer.end();
+       (ptr = static_cast<const char *>(memchr(ptr, '\n', end - ptr)));)
+    lineStarts.push_back(++ptr);
+}
+
+/// Returns the line and column, both starting at 1, of the given position
+/// within the buffer.
+std::pair<unsigned, unsigned>
+LineIndex::getLineAndColumn(const char *ptr) const {
+  // Find the last line that starts at or before the position.
+  auto it = std::upper_bound(lineStarts.begin(), lineStarts.end(), ptr);
+  unsigned line = it - lineStarts.begin();
+  return {line, ptr - lineStarts[line - 1] + 1};
+}
+
+Lexer::Lexer(const llvm::SourceMgr &sourceMgr, const LineIndex &lineIndex,
+             MLIRContext *context)
+    : sourceMgr(sourceMgr), lineIndex(lineIndex), context(context),
+      filename(UniquedFilename::get(
+          sourceMgr.getMemoryBuffer(sourceMgr.getMainFileID())
+              ->getBufferIdentifier(),
+          context)) {
   auto bufferID = sourceMgr.getMainFileID();
   curBuffer = sourceMgr.getMemoryBuffer(bufferID)->getBuffer();
   curPtr = curBuffer.begin();
@@ -44,12 +68,7 @@ Lexer::Lexer(const llvm::SourceMgr &sourceMgr, MLIRContext *context)
 /// Encode the specified source location information into an attribute for
 /// attachment to the IR.
 Location Lexer::getEncodedSourceLocation(llvm::SMLoc loc) {
-  auto &sourceMgr = getSourceMgr();
-  unsigned mainFileID = sourceMgr.getMainFileID();
-  auto lineAndColumn = sourceMgr.getLineAndColumn(loc, mainFileID);
-  auto *buffer = sourceMgr.getMemoryBuffer(mainFileID);
-  auto filename = UniquedFilename::get(buffer->getBufferIdentifier(), context);
-
+  auto lineAndColumn = lineIndex.getLineAndColumn(loc.getPointer());
   return FileLineColLoc::get(filename, lineAndColumn.first,
                              lineAndColumn.second, context);
 }
@@ -180,6 +199,50 @@ Token Lexer::lexComment() {
   }
 }
 
+/// Skip over the rest of a brace-delimited block whose opening brace was the
+/// last token lexed. Comments and string literals are skipped as a whole, so
+/// that any braces within them are ignored.
+bool Lexer::skipBalancedBraces() {
+  const char *ptr = curPtr;
+  for (unsigned depth = 1; depth != 0;) {
+    switch (*ptr++) {
+    case '{':
+      ++depth;
+      break;
+    case '}':
+      --depth;
+      break;
+    case '"':
+      // Skip the string literal, along with any escaped characters. Malformed
+      // strings are left for the parser to diagnose.
+      for (; *ptr != '"'; ++ptr) {
+        if (*ptr == 0 || *ptr == '\n' || *ptr == '\v' || *ptr == '\f')
+          return false;
+        if (*ptr == '\\' && ptr[1] != 0)
+          ++ptr;
+      }
+      ++ptr;
+      break;
+    case '/':
+      // Skip the comment up to the end of the line.
+      if (*ptr == '/')
+        while (*ptr != 0 && *ptr != '\n' && *ptr != '\r')
+          ++ptr;
+      break;
+    case 0:
+      // If this is the end of the buffer, the braces are unbalanced.
+      if (ptr - 1 == curBuffer.end())
+        return false;
+      break;
+    default:
+      break;
+    }
+  }
+
+  curPtr = ptr;
+  return true;
+}
+
 /// Lex a bare identifier or keyword that starts with a letter.
 ///
 ///   bare-id ::= (letter|[_]) (letter|digit|[_$.])*
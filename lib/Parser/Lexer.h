@@ -22,16 +22,37 @@
 #ifndef MLIR_LIB_PARSER_LEXER_H
 #define MLIR_LIB_PARSER_LEXER_H
 
+#include "mlir/IR/Location.h"
 #include "mlir/Parser.h"
 #include "Token.h"
+#include <vector>
 
 namespace mlir {
-class Location;
+
+/// This class indexes the starts of the lines of a source buffer, so that
+/// positions within the buffer are resolved to a line and column in
+/// logarithmic time. The index is immutable once built, and may be shared by
+/// lexers running on different threads.
+class LineIndex {
+public:
+  explicit LineIndex(StringRef buffer);
+
+  /// Returns the line and column, both starting at 1, of the given position
+  /// within the buffer.
+  std::pair<unsigned, unsigned> getLineAndColumn(const char *ptr) const;
+
+private:
+  /// The position of the first character of each line.
+  std::vector<const char *> lineStarts;
+};
 
 /// This class breaks up the current file into a token stream.
 class Lexer {
 public:
-  explicit Lexer(const llvm::SourceMgr &sourceMgr, MLIRContext *context);
+  /// Create a lexer of the main buffer of the given source manager, whose
+  /// lines are indexed by 'lineIndex'.
+  Lexer(const llvm::SourceMgr &sourceMgr, const LineIndex &lineIndex,
+        MLIRContext *context);
 
   const llvm::SourceMgr &getSourceMgr() { return sourceMgr; }
 
@@ -45,6 +66,11 @@ public:
   /// at the designated point in the input.
   void resetPointer(const char *newPointer) { curPtr = newPointer; }
 
+  /// Skip over the rest of a brace-delimited block whose opening brace was the
+  /// last token lexed, without forming tokens. Returns false, leaving the
+  /// cursor unchanged, if the closing brace could not be found.
+  bool skipBalancedBraces();
+
 private:
   // Helpers.
   Token formToken(Token::Kind kind, const char *tokStart) {
@@ -62,8 +88,12 @@ private:
   Token lexString(const char *tokStart);
 
   const llvm::SourceMgr &sourceMgr;
+  const LineIndex &lineIndex;
   MLIRContext *context;
 
+  /// The name of the main buffer, as used in the locations it encodes.
+  UniquedFilename filename;
+
   StringRef curBuffer;
   const char *curPtr;
 
@@ -25,6 +25,7 @@
 #include "mlir/IR/AffineMap.h"
 #include "mlir/IR/Attributes.h"
 #include "mlir/IR/Builders.h"
+#include "mlir/IR/Diagnostics.h"
 #include "mlir/IR/IntegerSet.h"
 #include "mlir/IR/Location.h"
 #include "mlir/IR/MLIRContext.h"
@@ -35,11 +36,15 @@
 #include "mlir/Transforms/Utils.h"
 #include "llvm/ADT/APInt.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/SMLoc.h"
 #include "llvm/Support/SourceMgr.h"
 #include <algorithm>
+#include <atomic>
+#include <mutex>
 using namespace mlir;
 using llvm::MemoryBuffer;
 using llvm::SMLoc;
@@ -49,19 +54,24 @@ using llvm::SourceMgr;
 /// bool value.  Failure is "true" in a boolean context.
 enum ParseResult { ParseSuccess, ParseFailure };
 
+static llvm::cl::opt<bool> parseFunctionsInParallel(
+    "mlir-parse-functions-in-parallel",
+    llvm::cl::desc("Parse the bodies of functions on multiple threads"),
+    llvm::cl::init(false));
+
+static llvm::cl::opt<bool> skipIRLocations(
+    "mlir-parse-skip-locations",
+    llvm::cl::desc("Give the parsed IR unknown locations, unless specified "
+                   "explicitly, instead of the file locations of its source"),
+    llvm::cl::init(false));
+
 namespace {
 class Parser;
 
-/// This class refers to all of the state maintained globally by the parser,
-/// such as the current lexer position etc.  The Parser base class provides
-/// methods to access this.
-class ParserState {
-public:
-  ParserState(const llvm::SourceMgr &sourceMgr, Module *module)
-      : context(module->getContext()), module(module), lex(sourceMgr, context),
-        curToken(lex.lexToken()) {}
-
-  ~ParserState() {
+/// This class holds the symbols defined at the top level of a module, which
+/// are shared by all of the parsers of the module.
+struct SymbolState {
+  ~SymbolState() {
     // Destroy the forward references upon error.
     for (auto forwardRef : functionForwardRefs)
       delete forwardRef.second;
@@ -81,6 +91,45 @@ public:
   // temporary function used to represent them.
   llvm::DenseMap<Identifier, Function *> functionForwardRefs;
 
+  // This guards the forward references to functions, which may be created by
+  // function bodies that are parsed in parallel. The definitions above are
+  // only modified while no function bodies are being parsed.
+  std::mutex functionForwardRefMutex;
+};
+
+/// This class refers to all of the state maintained globally by the parser,
+/// such as the current lexer position etc.  The Parser base class provides
+/// methods to access this.
+class ParserState {
+public:
+  ParserState(const llvm::SourceMgr &sourceMgr, const LineIndex &lineIndex,
+              Module *module, SymbolState &symbols)
+      : lineIndex(lineIndex), symbols(symbols), context(module->getContext()),
+        module(module), lex(sourceMgr, lineIndex, context),
+        curToken(lex.lexToken()) {}
+
+  /// Move the parser to the token starting at the given position.
+  void resetToken(const char *tokPos) {
+    lex.resetPointer(tokPos);
+    curToken = lex.lexToken();
+  }
+
+  /// If the current token is a '{', skip over the tokens up to its matching
+  /// '}' and return true. Otherwise, or if the braces are unbalanced, return
+  /// false without moving.
+  bool skipBalancedBraces() {
+    if (curToken.isNot(Token::l_brace) || !lex.skipBalancedBraces())
+      return false;
+    curToken = lex.lexToken();
+    return true;
+  }
+
+  // The index of the lines of the source file.
+  const LineIndex &lineIndex;
+
+  // The symbols defined at the top level of the module.
+  SymbolState &symbols;
+
 private:
   ParserState(const ParserState &) = delete;
   void operator=(const ParserState &) = delete;
@@ -128,6 +177,15 @@ public:
     return state.lex.getEncodedSourceLocation(loc);
   }
 
+  /// Return the location to attach to the IR entity defined at the given
+  /// source location. This is unknown if file locations are being skipped,
+  /// which doesn't affect the locations of the diagnostics of the parser.
+  Location getIRLocation(llvm::SMLoc loc) {
+    if (skipIRLocations)
+      return UnknownLoc::get(getContext());
+    return getEncodedSourceLocation(loc);
+  }
+
   /// Emit an error and return failure.
   ParseResult emitError(const Twine &message) {
     return emitError(state.curToken.getLoc(), message);
@@ -209,6 +267,7 @@ public:
                                                   IntegerSet &set);
   DenseElementsAttr parseDenseElementsAttr(VectorOrTensorType type);
   DenseElementsAttr parseDenseElementsAttrAsTensor(Type eltType);
+  DenseElementsAttr parseDenseElementsAttrAsHex(VectorOrTensorType type);
   VectorOrTensorType parseVectorOrTensorType();
 
   // Location Parsing.
@@ -496,8 +555,8 @@ Type Parser::parseExtendedType() {
   // If there is not a '<' token, we are parsing a type alias.
   if (getToken().isNot(Token::less)) {
     // Check for an alias for this type.
-    auto aliasIt = state.typeAliasDefinitions.find(identifier);
-    if (aliasIt == state.typeAliasDefinitions.end())
+    auto aliasIt = state.symbols.typeAliasDefinitions.find(identifier);
+    if (aliasIt == state.symbols.typeAliasDefinitions.end())
       return (emitError("undefined type alias id '" + identifier + "'"),
               nullptr);
     return aliasIt->second;
@@ -769,7 +828,9 @@ public:
     return parseElement();
   }
 
-  ArrayRef<Attribute> getValues() const { return storage; }
+  /// Returns the raw data of the parsed elements, packed to the bitwidth of
+  /// the element type in the form expected by DenseElementsAttr.
+  ArrayRef<char> getRawData() const { return rawData; }
 
   ArrayRef<int64_t> getShape() const { return shape; }
 
@@ -780,6 +841,10 @@ private:
   /// parseElement([1]) -> Failure
   ParseResult parseElement();
 
+  /// Parse the value of a single integer or floating point element literal
+  /// into the bit representation of the element type.
+  ParseResult parseElementValue(APInt &value);
+
   /// Parse a list of either lists or elements, returning the dimensions of the
   /// parsed sub-tensors in dims. For example:
   ///   parseList([1, 2, 3]) -> Success, [3]
@@ -791,7 +856,12 @@ private:
   Parser &p;
   Type eltTy;
   SmallVector<int64_t, 4> shape;
-  std::vector<Attribute> storage;
+
+  /// The elements parsed so far, written directly into the packed storage of
+  /// the attribute. The elements are not uniqued as individual attributes, so
+  /// large literals don't leave millions of attributes behind in the context.
+  std::vector<char> rawData;
+  size_t numElements = 0;
 };
 } // namespace
 
@@ -800,43 +870,17 @@ ParseResult TensorLiteralParser::parseElement() {
   case Token::floatliteral:
   case Token::integer:
   case Token::minus: {
-    auto result = p.parseAttribute(eltTy);
-    if (!result)
-      return ParseResult::ParseFailure;
-    // check result matches the element type.
-    switch (eltTy.getKind()) {
-    case StandardTypes::BF16:
-    case StandardTypes::F16:
-    case StandardTypes::F32:
-    case StandardTypes::F64: {
-      // Bitcast the APFloat value to APInt and store the bit representation.
-      auto fpAttrResult = result.dyn_cast<FloatAttr>();
-      if (!fpAttrResult)
-        return p.emitError(
-            "expected tensor literal element with floating point type");
-      auto apInt = fpAttrResult.getValue().bitcastToAPInt();
-
-      // FIXME: using 64 bits and double semantics for BF16 because APFloat does
-      // not support BF16 directly.
-      size_t bitWidth = eltTy.isBF16() ? 64 : eltTy.getIntOrFloatBitWidth();
-      assert(apInt.getBitWidth() == bitWidth);
-      (void)bitWidth;
-      (void)apInt;
-      break;
-    }
-    case StandardTypes::Integer: {
-      if (!result.isa<IntegerAttr>())
-        return p.emitError("expected tensor literal element has integer type");
-      auto value = result.cast<IntegerAttr>().getValue();
-      if (value.getMinSignedBits() > eltTy.getIntOrFloatBitWidth())
-        return p.emitError("tensor literal element has more bits than that "
-                           "specified in the type");
-      break;
-    }
-    default:
-      return p.emitError("expected integer or float tensor element");
-    }
-    storage.push_back(result);
+    APInt value;
+    if (parseElementValue(value))
+      return ParseFailure;
+
+    // Append the value to the raw data, which is kept sized to a whole number
+    // of 64-bit words.
+    size_t bitWidth = value.getBitWidth();
+    size_t bitPos = numElements++ * bitWidth;
+    rawData.resize(APInt::getNumWords(bitPos + bitWidth) *
+                   APInt::APINT_WORD_SIZE);
+    DenseElementsAttr::writeBits(rawData.data(), bitPos, value);
     break;
   }
   default:
@@ -845,6 +889,59 @@ ParseResult TensorLiteralParser::parseElement() {
   return ParseSuccess;
 }
 
+/// Parse the value of a single integer or floating point element literal into
+/// the bit representation of the element type.
+ParseResult TensorLiteralParser::parseElementValue(APInt &value) {
+  bool isNegative = p.consumeIf(Token::minus);
+  Token token = p.getToken();
+  if (!token.isAny(Token::integer, Token::floatliteral))
+    return p.emitError("expected constant integer or floating point value");
+  p.consumeToken();
+
+  if (auto intType = eltTy.dyn_cast<IntegerType>()) {
+    if (token.is(Token::floatliteral))
+      return p.emitError(token.getLoc(),
+                         "floating point value not valid for specified type");
+
+    // Check that the value fits in the element type.
+    auto val = token.getUInt64IntegerValue();
+    if (!val.hasValue() ||
+        (isNegative ? (int64_t)-*val >= 0 : (int64_t)*val < 0))
+      return p.emitError(token.getLoc(),
+                         "integer constant out of range for attribute");
+    value = APInt(intType.getWidth(), *val, /*isSigned=*/isNegative);
+    if (value != *val)
+      return p.emitError(token.getLoc(),
+                         "integer constant out of range for attribute");
+    if (isNegative)
+      value = -value;
+    return ParseSuccess;
+  }
+
+  if (auto floatType = eltTy.dyn_cast<FloatType>()) {
+    if (token.is(Token::integer))
+      return p.emitError(token.getLoc(),
+                         "integer value not valid for specified type");
+    auto val = token.getFloatingPointValue();
+    if (!val.hasValue())
+      return p.emitError(token.getLoc(),
+                         "floating point value too large for attribute");
+
+    // FIXME: using 64 bits and double semantics for BF16 because APFloat does
+    // not support BF16 directly.
+    APFloat apVal(isNegative ? -*val : *val);
+    if (!floatType.isBF16() && !floatType.isF64()) {
+      bool unused;
+      apVal.convert(floatType.getFloatSemantics(),
+                    APFloat::rmNearestTiesToEven, &unused);
+    }
+    value = apVal.bitcastToAPInt();
+    return ParseSuccess;
+  }
+
+  return p.emitError("expected integer or float tensor element");
+}
+
 /// Parse a list of either lists or elements, returning the dimensions of the
 /// parsed sub-tensors in dims. For example:
 ///   parseList([1, 2, 3]) -> Success, [3]
@@ -904,7 +1001,8 @@ Function *Parser::resolveFunctionReference(StringRef nameStr, SMLoc nameLoc,
 
   // If not, get or create a forward reference to one.
   if (!function) {
-    auto &entry = state.functionForwardRefs[name];
+    std::lock_guard<std::mutex> lock(state.symbols.functionForwardRefMutex);
+    auto &entry = state.symbols.functionForwardRefs[name];
     if (!entry)
       entry = new Function(getEncodedSourceLocation(nameLoc), name, type,
                            /*attrs=*/{});
@@ -1259,13 +1357,13 @@ DenseElementsAttr Parser::parseDenseElementsAttrAsTensor(Type eltType) {
     return nullptr;
 
   auto type = builder.getTensorType(literalParser.getShape(), eltType);
-  return builder.getDenseElementsAttr(type, literalParser.getValues())
+  return builder.getDenseElementsAttr(type, literalParser.getRawData())
       .cast<DenseElementsAttr>();
 }
 
 /// Dense elements attribute.
 ///
-///   dense-attr-list ::= `[` attribute-value `]`
+///   dense-attr-list ::= `[` attribute-value `]` | hex-string-literal
 ///   attribute-value ::= integer-literal
 ///                     | float-literal
 ///                     | `[` (attribute-value (`,` attribute-value)*)? `]`
@@ -1275,6 +1373,9 @@ DenseElementsAttr Parser::parseDenseElementsAttrAsTensor(Type eltType) {
 /// match.
 DenseElementsAttr Parser::parseDenseElementsAttr(VectorOrTensorType type) {
   auto eltTy = type.getElementType();
+  if (getToken().is(Token::string))
+    return parseDenseElementsAttrAsHex(type);
+
   TensorLiteralParser literalParser(*this, eltTy);
   if (literalParser.parse())
     return nullptr;
@@ -1290,10 +1391,65 @@ DenseElementsAttr Parser::parseDenseElementsAttr(VectorOrTensorType type) {
     return (emitError(s.str()), nullptr);
   }
 
-  return builder.getDenseElementsAttr(type, literalParser.getValues())
+  return builder.getDenseElementsAttr(type, literalParser.getRawData())
       .cast<DenseElementsAttr>();
 }
 
+/// Dense elements attribute in hexadecimal form.
+///
+///   hex-string-literal ::= `"0x` hex-digit* `"`
+///
+/// The hex digits hold the raw storage of the attribute, i.e. the elements
+/// packed to the bitwidth of the element type, as printed by the AsmPrinter.
+DenseElementsAttr
+Parser::parseDenseElementsAttrAsHex(VectorOrTensorType type) {
+  auto eltTy = type.getElementType();
+  if (!eltTy.isa<IntegerType>() && !eltTy.isa<FloatType>())
+    return (emitError("expected integer or float tensor element"), nullptr);
+
+  // The hex digits don't contain escapes, so use the spelling of the token
+  // directly to avoid copying the data.
+  auto loc = getToken().getLoc();
+  StringRef hex = getTokenSpelling().drop_front().drop_back();
+  consumeToken(Token::string);
+  if (!hex.startswith("0x"))
+    return (emitError(loc, "hex elements literal should start with '0x'"),
+            nullptr);
+  hex = hex.drop_front(2);
+
+  // FIXME(b/121118307): using 64 bits for BF16 because it is currently stored
+  // with double semantics.
+  size_t bitWidth = eltTy.isBF16() ? 64 : eltTy.getIntOrFloatBitWidth();
+  size_t numBits = bitWidth * type.getNumElements();
+  size_t numBytes = llvm::alignTo(numBits, 8) / 8;
+  if (hex.size() != numBytes * 2)
+    return (emitError(loc, "expected " + Twine(numBytes) +
+                               " bytes of hex data for elements literal"),
+            nullptr);
+
+  // Decode the data into storage padded to a whole number of 64-bit words.
+  std::vector<char> rawData(APInt::getNumWords(numBits) *
+                            APInt::APINT_WORD_SIZE);
+  for (size_t i = 0; i != numBytes; ++i) {
+    unsigned hi = llvm::hexDigitValue(hex[2 * i]);
+    unsigned lo = llvm::hexDigitValue(hex[2 * i + 1]);
+    if (hi > 15 || lo > 15)
+      return (emitError(loc, "hex elements literal only contains hex digits"),
+              nullptr);
+    rawData[i] = static_cast<char>((hi << 4) | lo);
+  }
+
+  // Bits past the last element must be clear, as they are part of the uniqued
+  // storage of the attribute.
+  if (numBits % 8 &&
+      static_cast<unsigned char>(rawData[numBytes - 1]) >> (numBits % 8))
+    return (emitError(loc, "hex elements literal has bits set past the last "
+                           "element"),
+            nullptr);
+
+  return builder.getDenseElementsAttr(type, rawData).cast<DenseElementsAttr>();
+}
+
 /// Vector or tensor type for elements attribute.
 ///
 ///   vector-or-tensor-type ::= vector-type | tensor-type
@@ -2117,9 +2273,9 @@ IntegerSet Parser::parseIntegerSetReference() {
 
   // Parse integer set identifier and verify that it exists.
   StringRef id = getTokenSpelling().drop_front();
-  if (getState().integerSetDefinitions.count(id) > 0) {
+  if (getState().symbols.integerSetDefinitions.count(id) > 0) {
     consumeToken(Token::hash_identifier);
-    return getState().integerSetDefinitions[id];
+    return getState().symbols.integerSetDefinitions[id];
   }
 
   // The id isn't among any of the recorded definitions.
@@ -2139,9 +2295,9 @@ AffineMap Parser::parseAffineMapReference() {
 
   // Parse affine map identifier and verify that it exists.
   StringRef id = getTokenSpelling().drop_front();
-  if (getState().affineMapDefinitions.count(id) > 0) {
+  if (getState().symbols.affineMapDefinitions.count(id) > 0) {
     consumeToken(Token::hash_identifier);
-    return getState().affineMapDefinitions[id];
+    return getState().symbols.affineMapDefinitions[id];
   }
 
   // The id isn't among any of the recorded definitions.
@@ -2161,14 +2317,14 @@ ParseResult Parser::parseAffineMapOrIntegerSetReference(AffineMap &map,
   // Note that an id can't be in both affineMapDefinitions and
   // integerSetDefinitions since they use the same sigil '#'.
   StringRef id = getTokenSpelling().drop_front();
-  if (getState().affineMapDefinitions.count(id) > 0) {
+  if (getState().symbols.affineMapDefinitions.count(id) > 0) {
     consumeToken(Token::hash_identifier);
-    map = getState().affineMapDefinitions[id];
+    map = getState().symbols.affineMapDefinitions[id];
     return ParseSuccess;
   }
-  if (getState().integerSetDefinitions.count(id) > 0) {
+  if (getState().symbols.integerSetDefinitions.count(id) > 0) {
     consumeToken(Token::hash_identifier);
-    set = getState().integerSetDefinitions[id];
+    set = getState().symbols.integerSetDefinitions[id];
     return ParseSuccess;
   }
 
@@ -2928,7 +3084,7 @@ struct CleanupOpStateRegions {
 
 Operation *FunctionParser::parseGenericOperation() {
   // Get location information for the operation.
-  auto srcLocation = getEncodedSourceLocation(getToken().getLoc());
+  auto srcLocation = getIRLocation(getToken().getLoc());
 
   auto name = getToken().getStringValue();
   if (name.empty())
@@ -3363,7 +3519,7 @@ Operation *FunctionParser::parseCustomOperation() {
                                    opNameStr.c_str());
 
   // Get location information for the operation.
-  auto srcLocation = getEncodedSourceLocation(opLoc);
+  auto srcLocation = getIRLocation(opLoc);
 
   // Have the op implementation take a crack and parsing this.
   OperationState opState(builder.getContext(), srcLocation, opDefinition->name);
@@ -3462,6 +3618,29 @@ IntegerSet AffineParser::parseIntegerSetConstraints(unsigned numDims,
 // Top-level entity parsing.
 //===----------------------------------------------------------------------===//
 
+/// Parse the body of the given function, whose signature at the given
+/// location had the given argument names.
+static ParseResult parseFunctionBody(ParserState &state, Function *function,
+                                     ArrayRef<StringRef> argNames, SMLoc loc) {
+  // Create the parser.
+  auto parser = FunctionParser(state, function);
+
+  bool hadNamedArguments = !argNames.empty();
+
+  // Add the entry block and argument list.
+  function->addEntryBlock();
+
+  // Add definitions of the function arguments.
+  if (hadNamedArguments) {
+    for (unsigned i = 0, e = function->getNumArguments(); i != e; ++i) {
+      if (parser.addDefinition({argNames[i], 0, loc}, function->getArgument(i)))
+        return ParseFailure;
+    }
+  }
+
+  return parser.parseFunctionBody(hadNamedArguments);
+}
+
 namespace {
 /// This parser handles entities that are only valid at the top level of the
 /// file.
@@ -3474,6 +3653,22 @@ public:
 private:
   ParseResult finalizeModule();
 
+  /// A function body that was skipped over by the top-level parser, so that it
+  /// can be parsed in parallel with the other function bodies.
+  struct DeferredFunctionBody {
+    Function *function;
+    SmallVector<StringRef, 4> argNames;
+    SMLoc loc;
+    /// The range of the body in the source buffer.
+    StringRef body;
+    /// The index of the function among the top-level entities of the module,
+    /// which orders the diagnostics emitted while parsing the body.
+    size_t entityIndex;
+  };
+
+  /// Parse the deferred function bodies in parallel.
+  ParseResult parseDeferredFunctionBodies();
+
   ParseResult parseAffineStructureDef();
 
   ParseResult parseTypeAliasDef();
@@ -3487,6 +3682,17 @@ private:
       StringRef &name, FunctionType &type, SmallVectorImpl<StringRef> &argNames,
       SmallVectorImpl<SmallVector<NamedAttribute, 2>> &argAttrs);
   ParseResult parseFunc();
+
+  /// The function bodies that have yet to be parsed, if function bodies are
+  /// parsed in parallel.
+  std::vector<DeferredFunctionBody> deferredBodies;
+
+  /// The handler ordering the diagnostics by top-level entity, if function
+  /// bodies are parsed in parallel.
+  std::unique_ptr<ParallelDiagnosticHandler> diagHandler;
+
+  /// The index of the top-level entity being parsed.
+  size_t entityIndex = 0;
 };
 } // end anonymous namespace
 
@@ -3506,10 +3712,10 @@ ParseResult ModuleParser::parseAffineStructureDef() {
   StringRef affineStructureId = getTokenSpelling().drop_front();
 
   // Check for redefinitions.
-  if (getState().affineMapDefinitions.count(affineStructureId) > 0)
+  if (getState().symbols.affineMapDefinitions.count(affineStructureId) > 0)
     return emitError("redefinition of affine map id '" + affineStructureId +
                      "'");
-  if (getState().integerSetDefinitions.count(affineStructureId) > 0)
+  if (getState().symbols.integerSetDefinitions.count(affineStructureId) > 0)
     return emitError("redefinition of integer set id '" + affineStructureId +
                      "'");
 
@@ -3526,12 +3732,12 @@ ParseResult ModuleParser::parseAffineStructureDef() {
     return ParseFailure;
 
   if (map) {
-    getState().affineMapDefinitions[affineStructureId] = map;
+    getState().symbols.affineMapDefinitions[affineStructureId] = map;
     return ParseSuccess;
   }
 
   assert(set);
-  getState().integerSetDefinitions[affineStructureId] = set;
+  getState().symbols.integerSetDefinitions[affineStructureId] = set;
   return ParseSuccess;
 }
 
@@ -3545,7 +3751,7 @@ ParseResult ModuleParser::parseTypeAliasDef() {
   StringRef aliasName = getTokenSpelling().drop_front();
 
   // Check for redefinitions.
-  if (getState().typeAliasDefinitions.count(aliasName) > 0)
+  if (getState().symbols.typeAliasDefinitions.count(aliasName) > 0)
     return emitError("redefinition of type alias id '" + aliasName + "'");
 
   consumeToken(Token::exclamation_identifier);
@@ -3561,7 +3767,7 @@ ParseResult ModuleParser::parseTypeAliasDef() {
     return ParseFailure;
 
   // Register this alias with the parser state.
-  getState().typeAliasDefinitions.try_emplace(aliasName, aliasedType);
+  getState().symbols.typeAliasDefinitions.try_emplace(aliasName, aliasedType);
 
   return ParseSuccess;
 }
@@ -3679,7 +3885,7 @@ ParseResult ModuleParser::parseFunc() {
 
   // Okay, the function signature was parsed correctly, create the function now.
   auto *function =
-      new Function(getEncodedSourceLocation(loc), name, type, attrs);
+      new Function(getIRLocation(loc), name, type, attrs);
   getModule()->getFunctions().push_back(function);
 
   // Verify no name collision / redefinition.
@@ -3699,23 +3905,71 @@ ParseResult ModuleParser::parseFunc() {
   if (getToken().isNot(Token::l_brace))
     return ParseSuccess;
 
-  // Create the parser.
-  auto parser = FunctionParser(getState(), function);
-
-  bool hadNamedArguments = !argNames.empty();
-
-  // Add the entry block and argument list.
-  function->addEntryBlock();
-
-  // Add definitions of the function arguments.
-  if (hadNamedArguments) {
-    for (unsigned i = 0, e = function->getNumArguments(); i != e; ++i) {
-      if (parser.addDefinition({argNames[i], 0, loc}, function->getArgument(i)))
-        return ParseFailure;
+  // When parsing function bodies in parallel, skip over the body for now. A
+  // body whose braces are unbalanced is parsed right away to diagnose it.
+  if (diagHandler) {
+    const char *bodyStart = getToken().getLoc().getPointer();
+    if (getState().skipBalancedBraces()) {
+      const char *bodyEnd = getToken().getLoc().getPointer();
+      deferredBodies.push_back({function,
+                                {argNames.begin(), argNames.end()},
+                                loc,
+                                StringRef(bodyStart, bodyEnd - bodyStart),
+                                entityIndex});
+      return ParseSuccess;
     }
   }
 
-  return parser.parseFunctionBody(hadNamedArguments);
+  return parseFunctionBody(getState(), function, argNames, loc);
+}
+
+/// Parse the deferred function bodies, sharding them across multiple threads.
+/// The top-level symbols are not modified while the bodies are parsed, so
+/// they may be read without synchronization.
+ParseResult ModuleParser::parseDeferredFunctionBodies() {
+  if (deferredBodies.empty())
+    return ParseSuccess;
+  std::vector<DeferredFunctionBody> bodies;
+  bodies.swap(deferredBodies);
+
+  // Start with the largest bodies, so that the small ones fill in the tail.
+  std::stable_sort(bodies.begin(), bodies.end(),
+                   [](const DeferredFunctionBody &lhs,
+                      const DeferredFunctionBody &rhs) {
+                     return lhs.body.size() > rhs.body.size();
+                   });
+
+  auto &sourceMgr = getSourceMgr();
+  // An index for the next body to parse, and whether any of them failed.
+  std::atomic<size_t> bodyIt(0);
+  std::atomic<bool> parseFailed(false);
+  std::vector<char> workers(
+      std::min<size_t>(llvm::hardware_concurrency(), bodies.size()));
+  llvm::parallel::for_each(
+      llvm::parallel::par, workers.begin(), workers.end(), [&](char &) {
+        for (auto e = bodies.size();;) {
+          // Get the next available body.
+          size_t nextID = bodyIt++;
+          if (nextID >= e)
+            break;
+          auto &body = bodies[nextID];
+
+          // Order the diagnostics of the body by the position of its function
+          // within the module.
+          diagHandler->setOrderIDForThread(body.entityIndex);
+
+          ParserState state(sourceMgr, getState().lineIndex, getModule(),
+                            getState().symbols);
+          state.resetToken(body.body.data());
+          if (parseFunctionBody(state, body.function, body.argNames,
+                                body.loc))
+            parseFailed = true;
+        }
+      });
+
+  // Restore the order id of the top-level entity being parsed.
+  diagHandler->setOrderIDForThread(entityIndex);
+  return parseFailed ? ParseFailure : ParseSuccess;
 }
 
 /// Finish the end of module parsing - when the result is valid, do final
@@ -3724,7 +3978,7 @@ ParseResult ModuleParser::finalizeModule() {
 
   // Resolve all forward references, building a remapping table of attributes.
   DenseMap<Attribute, FunctionAttr> remappingTable;
-  for (auto forwardRef : getState().functionForwardRefs) {
+  for (auto forwardRef : getState().symbols.functionForwardRefs) {
     auto name = forwardRef.first;
 
     // Resolve the reference.
@@ -3749,43 +4003,64 @@ ParseResult ModuleParser::finalizeModule() {
 
   // Now that all references to the forward definition placeholders are
   // resolved, we can deallocate the placeholders.
-  for (auto forwardRef : getState().functionForwardRefs)
+  for (auto forwardRef : getState().symbols.functionForwardRefs)
     delete forwardRef.second;
-  getState().functionForwardRefs.clear();
+  getState().symbols.functionForwardRefs.clear();
   return ParseSuccess;
 }
 
 /// This is the top-level module parser.
 ParseResult ModuleParser::parseModule() {
-  while (1) {
+  // When function bodies are parsed in parallel, diagnostics are ordered by
+  // the top-level entity they were emitted for, regardless of the thread that
+  // emitted them.
+  if (parseFunctionsInParallel)
+    diagHandler.reset(new ParallelDiagnosticHandler(*getContext()));
+
+  // On failure, any deferred function bodies are still parsed so that their
+  // diagnostics precede the failing entity, as they would in a sequential
+  // parse.
+  auto failure = [&]() -> ParseResult {
+    parseDeferredFunctionBodies();
+    return ParseFailure;
+  };
+
+  for (;; ++entityIndex) {
+    if (diagHandler)
+      diagHandler->setOrderIDForThread(entityIndex);
+
     switch (getToken().getKind()) {
     default:
       emitError("expected a top level entity");
-      return ParseFailure;
+      return failure();
 
       // If we got to the end of the file, then we're done.
     case Token::eof:
+      if (parseDeferredFunctionBodies())
+        return ParseFailure;
       return finalizeModule();
 
     // If we got an error token, then the lexer already emitted an error, just
     // stop.  Someday we could introduce error recovery if there was demand
     // for it.
     case Token::error:
-      return ParseFailure;
+      return failure();
 
+    // Definitions are only visible to the functions after them, so the
+    // deferred function bodies are parsed before the definitions change.
     case Token::hash_identifier:
-      if (parseAffineStructureDef())
-        return ParseFailure;
+      if (parseDeferredFunctionBodies() || parseAffineStructureDef())
+        return failure();
       break;
 
     case Token::exclamation_identifier:
-      if (parseTypeAliasDef())
-        return ParseFailure;
+      if (parseDeferredFunctionBodies() || parseTypeAliasDef())
+        return failure();
       break;
 
     case Token::kw_func:
       if (parseFunc())
-        return ParseFailure;
+        return failure();
       break;
     }
   }
@@ -3802,7 +4077,10 @@ Module *mlir::parseSourceFile(const llvm::SourceMgr &sourceMgr,
   // This is the result module we are parsing into.
   std::unique_ptr<Module> module(new Module(context));
 
-  ParserState state(sourceMgr, module.get());
+  LineIndex lineIndex(
+      sourceMgr.getMemoryBuffer(sourceMgr.getMainFileID())->getBuffer());
+  SymbolState symbols;
+  ParserState state(sourceMgr, lineIndex, module.get(), symbols);
   if (ModuleParser(state).parseModule()) {
     return nullptr;
   }
@@ -3843,3 +4121,51 @@ Module *mlir::parseSourceString(StringRef moduleStr, MLIRContext *context) {
   sourceMgr.AddNewSourceBuffer(std::move(memBuffer), SMLoc());
   return parseSourceFile(sourceMgr, context);
 }
+
+/// Parse a single entity from the given string with the given parse function,
+/// checking that the whole string was consumed.
+template <typename T>
+static T parseSingleEntity(StringRef str, MLIRContext *context,
+                           llvm::function_ref<T(Parser &)> parseFn) {
+  SourceMgr sourceMgr;
+  sourceMgr.AddNewSourceBuffer(MemoryBuffer::getMemBufferCopy(str), SMLoc());
+
+  // The entity is parsed in the scope of an empty module.
+  Module module(context);
+  LineIndex lineIndex(
+      sourceMgr.getMemoryBuffer(sourceMgr.getMainFileID())->getBuffer());
+  SymbolState symbols;
+  ParserState state(sourceMgr, lineIndex, &module, symbols);
+  Parser parser(state);
+  T result = parseFn(parser);
+  if (!result)
+    return T();
+
+  if (parser.getToken().isNot(Token::eof))
+    return (parser.emitError("unexpected characters after the end of '" +
+                             str + "'"),
+            T());
+
+  if (!symbols.functionForwardRefs.empty()) {
+    auto name = symbols.functionForwardRefs.begin()->first;
+    return (parser.emitError("reference to undefined function '" +
+                             name.strref() + "'"),
+            T());
+  }
+  return result;
+}
+
+/// This parses a single type from the given string. If the string isn't a
+/// valid type, it emits diagnostics and returns null.
+Type mlir::parseType(StringRef typeStr, MLIRContext *context) {
+  return parseSingleEntity<Type>(
+      typeStr, context, [](Parser &parser) { return parser.parseType(); });
+}
+
+/// This parses a single attribute from the given string. If the string isn't a
+/// valid attribute, it emits diagnostics and returns null.
+Attribute mlir::parseAttribute(StringRef attrStr, MLIRContext *context) {
+  return parseSingleEntity<Attribute>(
+      attrStr, context,
+      [](Parser &parser) { return parser.parseAttribute(); });
+}
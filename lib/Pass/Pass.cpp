@@ -21,22 +21,34 @@
 
 #include "mlir/Pass/Pass.h"
 #include "PassDetail.h"
+#include "mlir/IR/Diagnostics.h"
 #include "mlir/IR/Module.h"
 #include "mlir/Pass/PassManager.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Mutex.h"
-#include "llvm/Support/Parallel.h"
-#include "llvm/Support/PrettyStackTrace.h"
 #include "llvm/Support/Threading.h"
 
 using namespace mlir;
 using namespace mlir::detail;
 
+#define DEBUG_TYPE "pass-manager"
+
+STATISTIC(NumAnalysisHits, "Number of analysis queries served from the cache");
+STATISTIC(NumAnalysisMisses, "Number of analysis queries that were computed");
+STATISTIC(NumAnalysisInvalidations, "Number of cached analyses invalidated");
+
 static llvm::cl::opt<bool> enableThreads(
     "experimental-mt-pm",
     llvm::cl::desc("Enable experimental multithreading in the pass manager"),
     llvm::cl::init(false));
 
+static llvm::cl::opt<unsigned> numPassThreads(
+    "pass-threads",
+    llvm::cl::desc("The number of threads used by the multithreaded pass "
+                   "manager, or 0 to use the hardware concurrency"),
+    llvm::cl::init(0));
+
 //===----------------------------------------------------------------------===//
 // Pass
 //===----------------------------------------------------------------------===//
@@ -88,8 +100,11 @@ LogicalResult ModulePassBase::run(Module *module, ModuleAnalysisManager &mam) {
   // Invoke the virtual runOnModule function.
   runOnModule();
 
-  // Invalidate any non preserved analyses.
-  mam.invalidate(passState->preservedAnalyses);
+  // Invalidate any non preserved analyses, limiting the function analyses to
+  // those of the changed functions if the pass reported them.
+  auto &changedFunctions = passState->changedFunctions;
+  mam.invalidate(passState->preservedAnalyses,
+                 changedFunctions ? changedFunctions.getPointer() : nullptr);
 
   // Instrument after the pass has run.
   bool passFailed = passState->irAndPassFailed.getInt();
@@ -176,187 +191,63 @@ void ModuleToFunctionPassAdaptor::runOnModule() {
   }
 }
 
-namespace {
-/// A utility class to ensure that diagnostics are emitted in a deterministic
-/// order when executing a pipeline asynchronously with
-/// ModuleToFunctionPassAdaptorParallel.
-struct ParallelDiagnosticHandler {
-  struct ThreadDiagnostic {
-    ThreadDiagnostic(size_t id, Location loc, StringRef msg,
-                     MLIRContext::DiagnosticKind kind)
-        : id(id), loc(loc), msg(msg), kind(kind) {}
-    bool operator<(const ThreadDiagnostic &rhs) const { return id < rhs.id; }
-
-    /// The function id for this diagnostic, this is used for ordering.
-    /// Note: This id corresponds to the ordered position of the current
-    ///       function within its parent module.
-    size_t id;
-
-    /// Information for the diagnostic.
-    Location loc;
-    std::string msg;
-    MLIRContext::DiagnosticKind kind;
-  };
-
-  ParallelDiagnosticHandler(MLIRContext &ctx)
-      : prevHandler(ctx.getDiagnosticHandler()), context(ctx) {
-    ctx.registerDiagnosticHandler([this](Location loc, StringRef message,
-                                         MLIRContext::DiagnosticKind kind) {
-      uint64_t tid = llvm::get_threadid();
-      llvm::sys::SmartScopedLock<true> lock(mutex);
-
-      // Append a new diagnostic.
-      diagnostics.emplace_back(threadToFuncID[tid], loc, message, kind);
-    });
-  }
-
-  ~ParallelDiagnosticHandler() {
-    // Restore the previous diagnostic handler.
-    context.registerDiagnosticHandler(prevHandler);
-
-    // Early exit if there are no diagnostics, this is the common case.
-    if (diagnostics.empty())
-      return;
-
-    // Emit the diagnostics back to the context.
-    emitDiagnostics(
-        [&](Location loc, StringRef message, MLIRContext::DiagnosticKind kind) {
-          return context.emitDiagnostic(loc, message, kind);
-        });
-  }
-
-  /// Utility method to emit any held diagnostics.
-  void emitDiagnostics(
-      std::function<void(Location, StringRef, MLIRContext::DiagnosticKind)>
-          emitFn) {
-    // Stable sort all of the diagnostics that were emitted. This creates a
-    // deterministic ordering for the diagnostics based upon which function they
-    // were emitted for.
-    std::stable_sort(diagnostics.begin(), diagnostics.end());
-
-    // Emit each diagnostic to the context again.
-    for (ThreadDiagnostic &diag : diagnostics)
-      emitFn(diag.loc, diag.msg, diag.kind);
-  }
-
-  /// Set the function id for the current thread.
-  void setFuncIDForThread(size_t funcID) {
-    uint64_t tid = llvm::get_threadid();
-    llvm::sys::SmartScopedLock<true> lock(mutex);
-    threadToFuncID[tid] = funcID;
-  }
-
-  /// The previous context diagnostic handler.
-  MLIRContext::DiagnosticHandlerTy prevHandler;
-
-  /// A smart mutex to lock access to the internal state.
-  llvm::sys::SmartMutex<true> mutex;
-
-  /// A mapping between the thread id and the current function id.
-  DenseMap<uint64_t, size_t> threadToFuncID;
-
-  /// An unordered list of diagnostics that were emitted.
-  std::vector<ThreadDiagnostic> diagnostics;
-
-  /// The context to emit the diagnostics to.
-  MLIRContext &context;
-};
-
-/// A utility stack trace entry that dumps any dangling diagnostics held by a
-/// ParallelDiagnosticHandler in the event of a crash.
-struct PrettyStackTraceParallelDiagnosticEntry
-    : public llvm::PrettyStackTraceEntry {
-  PrettyStackTraceParallelDiagnosticEntry(
-      ParallelDiagnosticHandler &parallelHandler)
-      : parallelHandler(parallelHandler) {}
-
-  void print(raw_ostream &os) const override {
-    // Early exit if there are no diagnostics, this is the common case.
-    if (parallelHandler.diagnostics.empty())
-      return;
-
-    os << "In-Flight Diagnostics:\n";
-    parallelHandler.emitDiagnostics(
-        [&](Location loc, StringRef message, MLIRContext::DiagnosticKind kind) {
-          os.indent(4);
-
-          // Print each diagnostic with the format:
-          //   "<location>: <kind>: <msg>"
-          if (!loc.isa<UnknownLoc>())
-            os << loc << ": ";
-          switch (kind) {
-          case MLIRContext::DiagnosticKind::Error:
-            os << "error: ";
-            break;
-          case MLIRContext::DiagnosticKind::Warning:
-            os << "warning: ";
-            break;
-          case MLIRContext::DiagnosticKind::Note:
-            os << "note: ";
-            break;
-          }
-          os << message << '\n';
-        });
-  }
-
-  // A reference to the parallel handler to dump on the event of a crash.
-  ParallelDiagnosticHandler &parallelHandler;
-};
-} // end anonymous namespace
-
-// Run the held function pipeline synchronously across the functions within
-// the module.
+/// Run the held function pipeline asynchronously across the functions within
+/// the module.
 void ModuleToFunctionPassAdaptorParallel::runOnModule() {
   ModuleAnalysisManager &mam = getAnalysisManager();
 
   // Create the async executors if they haven't been created, or if the main
-  // function pipeline has changed.
-  if (asyncExecutors.empty() || asyncExecutors.front().size() != fpe.size())
-    asyncExecutors = {llvm::hardware_concurrency(), fpe};
+  // function pipeline or the number of threads has changed.
+  unsigned numThreads = executor.getNumThreads();
+  if (asyncExecutors.size() != numThreads ||
+      asyncExecutors.front().size() != fpe.size())
+    asyncExecutors = {numThreads, fpe};
 
   // Run a prepass over the module to collect the functions to execute a over.
   // This ensures that an analysis manager exists for each function, as well as
-  // providing a queue of functions to execute over.
+  // providing a queue of functions to execute over. The size of each function,
+  // in number of operations, is recorded to order the execution.
   std::vector<std::pair<Function *, FunctionAnalysisManager>> funcAMPairs;
-  for (auto &func : getModule())
-    if (!func.isExternal())
-      funcAMPairs.emplace_back(&func, mam.slice(&func));
+  std::vector<std::pair<unsigned, unsigned>> funcSizes;
+  for (auto &func : getModule()) {
+    if (func.isExternal())
+      continue;
+    unsigned numOps = 0;
+    func.walk([&](Operation *) { ++numOps; });
+    funcSizes.emplace_back(numOps, funcAMPairs.size());
+    funcAMPairs.emplace_back(&func, mam.slice(&func));
+  }
+
+  // Execute the largest functions first, so that they don't end up serializing
+  // the tail of the execution. Ties are broken by module order.
+  std::stable_sort(funcSizes.begin(), funcSizes.end(),
+                   [](const std::pair<unsigned, unsigned> &lhs,
+                      const std::pair<unsigned, unsigned> &rhs) {
+                     return lhs.first > rhs.first;
+                   });
 
   // A parallel diagnostic handler that provides deterministic diagnostic
-  // ordering.
+  // ordering, and prints any dangling diagnostics in the event of a crash.
   ParallelDiagnosticHandler diagHandler(getContext());
 
-  // A pretty stack entry to print any dangling diagnostics in the event of a
-  // crash.
-  PrettyStackTraceParallelDiagnosticEntry diagCrashEntry(diagHandler);
-
-  // An index for the current function/analysis manager pair.
-  std::atomic<unsigned> funcIt(0);
-
   // An atomic failure variable for the async executors.
   std::atomic<bool> passFailed(false);
-  llvm::parallel::for_each(
-      llvm::parallel::par, asyncExecutors.begin(),
-      std::next(asyncExecutors.begin(),
-                std::min(asyncExecutors.size(), funcAMPairs.size())),
-      [&](FunctionPassExecutor &executor) {
-        for (auto e = funcAMPairs.size(); !passFailed && funcIt < e;) {
-          // Get the next available function index.
-          unsigned nextID = funcIt++;
-          if (nextID >= e)
-            break;
-
-          // Set the function id for this thread in the diagnostic handler.
-          diagHandler.setFuncIDForThread(nextID);
-
-          // Run the executor over the current function.
-          auto &it = funcAMPairs[nextID];
-          if (failed(runFunctionPipeline(executor, it.first, it.second))) {
-            passFailed = true;
-            break;
-          }
-        }
-      });
+  executor.run(funcSizes.size(), [&](unsigned threadIndex, size_t taskIndex) {
+    if (passFailed)
+      return;
+
+    // Set the function id for this thread in the diagnostic handler. The id is
+    // the position of the function within the module, regardless of the order
+    // of execution.
+    unsigned funcID = funcSizes[taskIndex].second;
+    diagHandler.setOrderIDForThread(funcID);
+
+    // Run the executor of this thread over the current function.
+    auto &it = funcAMPairs[funcID];
+    if (failed(runFunctionPipeline(asyncExecutors[threadIndex], it.first,
+                                   it.second)))
+      passFailed = true;
+  });
 
   // Signal a failure if any of the executors failed.
   if (passFailed)
@@ -388,15 +279,23 @@ class ModuleVerifier : public ModulePass<ModuleVerifier> {
 } // end anonymous namespace
 
 PassManager::PassManager(bool verifyPasses)
-    : mpe(new ModulePassExecutor()), verifyPasses(verifyPasses),
-      passTiming(false) {}
+    : mpe(new ModulePassExecutor()),
+      threadExecutor(new WorkStealingExecutor(numPassThreads)),
+      verifyPasses(verifyPasses), passTiming(false) {}
 
 PassManager::~PassManager() {}
 
 /// Run the passes within this manager on the provided module.
 LogicalResult PassManager::run(Module *module) {
   ModuleAnalysisManager mam(module, instrumentor.get());
-  return mpe->run(module, mam);
+  auto result = mpe->run(module, mam);
+
+  // Publish the analysis counters to the pass statistics.
+  auto &stats = mam.getStatistics();
+  NumAnalysisHits += stats.numHits;
+  NumAnalysisMisses += stats.numMisses;
+  NumAnalysisInvalidations += stats.numInvalidations;
+  return result;
 }
 
 /// Add an opaque pass pointer to the current manager. This takes ownership
@@ -432,7 +331,7 @@ void PassManager::addPass(FunctionPassBase *pass) {
     /// Create an executor adaptor for this pass.
     if (enableThreads && llvm::llvm_is_multithreaded()) {
       // If multi-threading is enabled, then create an asynchronous adaptor.
-      auto *adaptor = new ModuleToFunctionPassAdaptorParallel();
+      auto *adaptor = new ModuleToFunctionPassAdaptorParallel(*threadExecutor);
       addPass(adaptor);
       fpe = &adaptor->getFunctionExecutor();
     } else {
@@ -453,6 +352,12 @@ void PassManager::addPass(FunctionPassBase *pass) {
     fpe->addPass(new FunctionVerifier());
 }
 
+/// Set the number of threads used to run function pipelines in parallel. If
+/// 'numThreads' is zero, the hardware concurrency of the host is used.
+void PassManager::setNumThreads(unsigned numThreads) {
+  threadExecutor->setNumThreads(numThreads);
+}
+
 /// Add the provided instrumentation to the pass manager. This takes ownership
 /// over the given pointer.
 void PassManager::addInstrumentation(PassInstrumentation *pi) {
@@ -475,12 +380,14 @@ PassInstrumentor *FunctionAnalysisManager::getPassInstrumentor() const {
 FunctionAnalysisManager ModuleAnalysisManager::slice(Function *function) {
   assert(function->getModule() == moduleAnalyses.getIRUnit() &&
          "function has a different parent module");
-  auto it = functionAnalyses.try_emplace(function, function);
+  auto it = functionAnalyses.try_emplace(function, function, stats);
   return {this, &it.first->second};
 }
 
 /// Invalidate any non preserved analyses.
-void ModuleAnalysisManager::invalidate(const detail::PreservedAnalyses &pa) {
+void ModuleAnalysisManager::invalidate(
+    const detail::PreservedAnalyses &pa,
+    const SmallPtrSetImpl<Function *> *changedFunctions) {
   // If all analyses were preserved, then there is nothing to do here.
   if (pa.isAll())
     return;
@@ -488,9 +395,21 @@ void ModuleAnalysisManager::invalidate(const detail::PreservedAnalyses &pa) {
   // Invalidate the module analyses directly.
   moduleAnalyses.invalidate(pa);
 
+  // If the changed functions are known, only invalidate their analyses.
+  if (changedFunctions) {
+    for (Function *function : *changedFunctions) {
+      auto it = functionAnalyses.find(function);
+      if (it != functionAnalyses.end())
+        it->second.invalidate(pa);
+    }
+    return;
+  }
+
   // If no analyses were preserved, then just simply clear out the function
   // analysis results.
   if (pa.isNone()) {
+    for (auto &analysisPair : functionAnalyses)
+      stats.numInvalidations += analysisPair.second.size();
     functionAnalyses.clear();
     return;
   }
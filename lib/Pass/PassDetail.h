@@ -18,10 +18,70 @@
 #define MLIR_PASS_PASSDETAIL_H_
 
 #include "mlir/Pass/Pass.h"
+#include "llvm/ADT/STLExtras.h"
+#include <chrono>
 
 namespace mlir {
 namespace detail {
 
+//===----------------------------------------------------------------------===//
+// WorkStealingExecutor
+//===----------------------------------------------------------------------===//
+
+struct WorkStealingExecutorImpl;
+
+/// Utilization statistics for one of the threads of a WorkStealingExecutor.
+struct ThreadUtilization {
+  /// The time spent executing tasks.
+  std::chrono::nanoseconds busyTime = std::chrono::nanoseconds(0);
+
+  /// The number of tasks executed by the thread.
+  unsigned numTasks = 0;
+
+  /// The number of executed tasks that were stolen from other threads.
+  unsigned numStolenTasks = 0;
+};
+
+/// A pool of persistent threads that executes a batch of independent tasks.
+/// Tasks are dealt to the threads round-robin in the order given, and each
+/// thread executes its own tasks in that order. Threads that run out of work
+/// steal the remaining tasks of the other threads, starting with the last.
+/// Callers should thus order their tasks by decreasing cost, so that the most
+/// expensive tasks are started first and the cheap ones fill in the tail.
+class WorkStealingExecutor {
+public:
+  /// Create an executor with the given number of threads. If 'numThreads' is
+  /// zero, the hardware concurrency of the host is used. The threads are
+  /// started lazily on the first execution.
+  explicit WorkStealingExecutor(unsigned numThreads = 0);
+  ~WorkStealingExecutor();
+
+  /// Set the number of threads used by this executor. This must not be called
+  /// while the executor is running.
+  void setNumThreads(unsigned numThreads);
+
+  /// Returns the number of threads used by this executor, including the thread
+  /// calling 'run'.
+  unsigned getNumThreads() const;
+
+  /// Execute 'taskFn(threadIndex, taskIndex)' for each task index in the range
+  /// [0, numTasks), and wait for all of them to complete. 'threadIndex' is in
+  /// the range [0, getNumThreads()), and is unique to each concurrently
+  /// executing thread. The calling thread executes tasks as thread 0.
+  void run(size_t numTasks,
+           llvm::function_ref<void(unsigned threadIndex, size_t taskIndex)>
+               taskFn);
+
+  /// Returns the utilization of each thread during the last execution.
+  ArrayRef<ThreadUtilization> getThreadUtilization() const;
+
+  /// Returns the wall time taken by the last execution.
+  std::chrono::nanoseconds getWallTime() const;
+
+private:
+  std::unique_ptr<WorkStealingExecutorImpl> impl;
+};
+
 //===----------------------------------------------------------------------===//
 // PassExecutor
 //===----------------------------------------------------------------------===//
@@ -113,9 +173,14 @@ private:
 
 /// An adaptor module pass used to run function passes over all of the
 /// non-external functions of a module asynchronously across multiple threads.
+/// The functions are dispatched onto the threads of a work-stealing executor,
+/// largest function first.
 class ModuleToFunctionPassAdaptorParallel
     : public ModulePass<ModuleToFunctionPassAdaptorParallel> {
 public:
+  explicit ModuleToFunctionPassAdaptorParallel(WorkStealingExecutor &executor)
+      : executor(executor) {}
+
   /// Run the held function pipeline over all non-external functions within the
   /// module.
   void runOnModule() override;
@@ -123,10 +188,17 @@ public:
   /// Returns the function pass executor for this adaptor.
   FunctionPassExecutor &getFunctionExecutor() { return fpe; }
 
+  /// Returns the work-stealing executor that runs the function pipelines.
+  const WorkStealingExecutor &getThreadExecutor() const { return executor; }
+
 private:
   // The main function pass executor for this adaptor.
   FunctionPassExecutor fpe;
 
+  // The executor, owned by the pass manager, that runs the function pipelines
+  // on different threads.
+  WorkStealingExecutor &executor;
+
   // A set of executors, cloned from the main executor, that run asynchronously
   // on different threads.
   std::vector<FunctionPassExecutor> asyncExecutors;
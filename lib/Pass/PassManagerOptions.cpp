@@ -89,7 +89,10 @@ PassManagerOptions::PassManagerOptions()
               clEnumValN(PassTimingDisplayMode::List, "list",
                          "display the results in a list sorted by total time"),
               clEnumValN(PassTimingDisplayMode::Pipeline, "pipeline",
-                         "display the results with a nested pipeline view"))) {}
+                         "display the results with a nested pipeline view"),
+              clEnumValN(PassTimingDisplayMode::ChromeTrace, "trace",
+                         "export the results as a Chrome trace-event JSON "
+                         "document"))) {}
 
 /// Add an IR printing instrumentation if enabled by any 'print-ir' flags.
 void PassManagerOptions::addPrinterInstrumentation(PassManager &pm) {
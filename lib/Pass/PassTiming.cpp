@@ -16,14 +16,17 @@
 // =============================================================================
 
 #include "PassDetail.h"
+#include "mlir/IR/Function.h"
 #include "mlir/Pass/PassManager.h"
 #include "llvm/ADT/MapVector.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/Statistic.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/FormatVariadic.h"
+#include "llvm/Support/JSON.h"
 #include "llvm/Support/Threading.h"
 #include <chrono>
+#include <ctime>
 
 using namespace mlir;
 using namespace mlir::detail;
@@ -31,40 +34,91 @@ using namespace mlir::detail;
 constexpr llvm::StringLiteral kPassTimingDescription =
     "... Pass execution timing report ...";
 
+/// Returns the CPU time, user and system, consumed so far by the calling
+/// thread. If the platform doesn't provide a per-thread CPU clock, this falls
+/// back to the CPU time of the process.
+static std::chrono::nanoseconds getThreadCPUTime() {
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+  struct timespec time;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) == 0)
+    return std::chrono::seconds(time.tv_sec) +
+           std::chrono::nanoseconds(time.tv_nsec);
+#endif
+  return std::chrono::nanoseconds(uint64_t(std::clock()) * 1000000000 /
+                                  CLOCKS_PER_SEC);
+}
+
+/// Convert the given duration to seconds.
+static double toSeconds(std::chrono::nanoseconds time) {
+  return std::chrono::duration_cast<std::chrono::duration<double>>(time)
+      .count();
+}
+
 namespace {
 /// Simple record class to record timing information.
 struct TimeRecord {
-  TimeRecord(double wall = 0.0, double user = 0.0) : wall(wall), user(user) {}
+  TimeRecord(double wall = 0.0, double cpu = 0.0)
+      : wall(wall), cpu(cpu), thread(wall), idealWall(wall) {}
 
   TimeRecord &operator+=(const TimeRecord &other) {
     wall += other.wall;
-    user += other.user;
+    cpu += other.cpu;
+    thread += other.thread;
+    idealWall += other.idealWall;
     return *this;
   }
 
+  /// Returns true if any of the time in this record was spent in an execution
+  /// with multiple threads available.
+  bool isParallel() const { return thread != wall || idealWall != wall; }
+
+  /// Returns the speedup of the parallel execution over a serial execution
+  /// of the same work.
+  double getSpeedup() const { return wall ? thread / wall : 1.0; }
+
+  /// Returns the load imbalance of the parallel execution, i.e. how much
+  /// longer it took than if the work had been evenly spread over the threads,
+  /// as a percentage.
+  double getImbalance() const {
+    return idealWall ? 100.0 * (wall - idealWall) / idealWall : 0.0;
+  }
+
   /// Print the current time record to 'os', with a breakdown showing
   /// contributions to the give 'total' time record.
   void print(raw_ostream &os, const TimeRecord &total) {
-    if (total.user != total.wall)
-      os << llvm::format("  %7.4f (%5.1f%%)  ", user,
-                         100.0 * user / total.user);
+    os << llvm::format("  %7.4f (%5.1f%%)  ", cpu, 100.0 * cpu / total.cpu);
     os << llvm::format("  %7.4f (%5.1f%%)  ", wall, 100.0 * wall / total.wall);
+    if (total.isParallel())
+      os << llvm::format("  %10.2fx  %12.1f%%  ", getSpeedup(), getImbalance());
   }
 
-  double wall, user;
+  /// The wall time, and the CPU time summed over all threads.
+  double wall, cpu;
+
+  /// The wall time summed over all threads.
+  double thread;
+
+  /// The wall time the execution would have taken if the work had been evenly
+  /// spread over the threads.
+  double idealWall;
 };
 
 struct Timer {
   explicit Timer(std::string &&name) : name(std::move(name)) {}
 
   /// Start the timer.
-  void start() { startTime = std::chrono::system_clock::now(); }
+  void start() {
+    startTime = std::chrono::steady_clock::now();
+    startCPUTime = getThreadCPUTime();
+  }
 
   /// Stop the timer.
   void stop() {
-    auto newTime = std::chrono::system_clock::now() - startTime;
+    auto newTime = std::chrono::steady_clock::now() - startTime;
     wallTime += newTime;
-    userTime += newTime;
+    threadTime += newTime;
+    cpuTime += getThreadCPUTime() - startCPUTime;
+    numThreads = std::max(numThreads, 1u);
   }
 
   /// Get or create a child timer with the provided name and id.
@@ -80,11 +134,10 @@ struct Timer {
   TimeRecord getTotalTime() {
     // If we have a valid wall time, then we directly compute the seconds.
     if (wallTime.count()) {
-      return TimeRecord(
-          std::chrono::duration_cast<std::chrono::duration<double>>(wallTime)
-              .count(),
-          std::chrono::duration_cast<std::chrono::duration<double>>(userTime)
-              .count());
+      TimeRecord record(toSeconds(wallTime), toSeconds(cpuTime));
+      record.thread = toSeconds(threadTime);
+      record.idealWall = record.thread / numThreads;
+      return record;
     }
 
     // Otheriwse, accumulate the timing from each of the children.
@@ -97,14 +150,26 @@ struct Timer {
   /// A map of unique identifiers to child timers.
   using ChildrenMap = llvm::MapVector<const void *, std::unique_ptr<Timer>>;
 
-  /// Merge the timing data from 'other' into this timer.
+  /// Merge the timing data from 'other', recorded on a different thread, into
+  /// this timer.
   void merge(Timer &&other) {
     if (wallTime < other.wallTime)
       wallTime = other.wallTime;
-    userTime += other.userTime;
+    threadTime += other.threadTime;
+    cpuTime += other.cpuTime;
+    numThreads += other.numThreads;
     mergeChildren(std::move(other.children), /*isStructural=*/false);
   }
 
+  /// Set the number of threads available to this timer and its children, which
+  /// is used to compute the load imbalance of a parallel execution.
+  void setNumAvailableThreads(unsigned numAvailableThreads) {
+    if (numThreads)
+      numThreads = std::max(numThreads, numAvailableThreads);
+    for (auto &child : children)
+      child.second->setNumAvailableThreads(numAvailableThreads);
+  }
+
   /// Merge the timer chilren in 'otherChildren' with the children of this
   /// timer. If 'isStructural' is true, the children are merged lexographically
   /// and 'otherChildren' must have the same number of elements as the children
@@ -137,10 +202,18 @@ struct Timer {
     }
   }
 
-  /// Raw timing information.
-  std::chrono::time_point<std::chrono::system_clock> startTime;
+  /// Raw timing information. The wall time is the longest time recorded on any
+  /// of the threads that executed this timer, while the thread and CPU times
+  /// are summed over all of them.
+  std::chrono::time_point<std::chrono::steady_clock> startTime;
+  std::chrono::nanoseconds startCPUTime = std::chrono::nanoseconds(0);
   std::chrono::nanoseconds wallTime = std::chrono::nanoseconds(0);
-  std::chrono::nanoseconds userTime = std::chrono::nanoseconds(0);
+  std::chrono::nanoseconds threadTime = std::chrono::nanoseconds(0);
+  std::chrono::nanoseconds cpuTime = std::chrono::nanoseconds(0);
+
+  /// The number of threads that this timer was executed on, or that were
+  /// available to execute it.
+  unsigned numThreads = 0;
 
   /// A map of unique identifiers to child timers.
   ChildrenMap children;
@@ -149,25 +222,55 @@ struct Timer {
   std::string name;
 };
 
+/// A single complete event of a Chrome trace, i.e. the execution of a pass or
+/// the computation of an analysis on an IR unit.
+struct TraceEvent {
+  /// The name of the pass or analysis, and the kind of event.
+  std::string name;
+  StringRef category;
+
+  /// The name of the IR unit, e.g. the name of the function.
+  std::string irName;
+
+  /// The index of the thread that executed the event.
+  unsigned threadIndex;
+
+  /// The start and end time of the event.
+  std::chrono::time_point<std::chrono::steady_clock> startTime, endTime;
+};
+
 struct PassTiming : public PassInstrumentation {
-  PassTiming(PassTimingDisplayMode displayMode) : displayMode(displayMode) {}
+  PassTiming(PassTimingDisplayMode displayMode)
+      : displayMode(displayMode),
+        traceStartTime(std::chrono::steady_clock::now()) {}
   ~PassTiming() { print(); }
 
   /// Setup the instrumentation hooks.
-  void runBeforePass(Pass *pass, const llvm::Any &) override {
+  void runBeforePass(Pass *pass, const llvm::Any &ir) override {
     startPassTimer(pass);
+    if (displayMode == PassTimingDisplayMode::ChromeTrace)
+      startTraceEvent(getPassTimerName(pass), "pass", ir);
   }
   void runAfterPass(Pass *pass, const llvm::Any &) override;
   void runAfterPassFailed(Pass *pass, const llvm::Any &ir) override {
     runAfterPass(pass, ir);
   }
   void runBeforeAnalysis(llvm::StringRef name, AnalysisID *id,
-                         const llvm::Any &) override {
+                         const llvm::Any &ir) override {
     startAnalysisTimer(name, id);
+    if (displayMode == PassTimingDisplayMode::ChromeTrace)
+      startTraceEvent(name, "analysis", ir);
   }
   void runAfterAnalysis(llvm::StringRef, AnalysisID *,
                         const llvm::Any &) override;
 
+  /// Returns the name of the timer for the given pass.
+  static StringRef getPassTimerName(Pass *pass) {
+    if (isModuleToFunctionAdaptorPass(pass))
+      return "Function Pipeline";
+    return pass->getName();
+  }
+
   /// Print and clear the timing results.
   void print();
 
@@ -190,6 +293,16 @@ struct PassTiming : public PassInstrumentation {
   void printResultsAsPipeline(raw_ostream &os, Timer *root,
                               TimeRecord totalTime);
 
+  /// Start a new trace event for the given IR unit on the current thread.
+  void startTraceEvent(StringRef name, StringRef category,
+                       const llvm::Any &ir);
+
+  /// Complete the last started trace event of the current thread.
+  void stopTraceEvent();
+
+  /// Print the recorded trace events in the Chrome trace-event format.
+  void printResultsAsTrace(raw_ostream &os);
+
   /// Returns a timer for the provided identifier and name.
   Timer *getTimer(const void *id, std::function<std::string()> &&nameBuilder) {
     auto tid = llvm::get_threadid();
@@ -211,6 +324,12 @@ struct PassTiming : public PassInstrumentation {
     return timer;
   }
 
+  /// Accumulate the thread utilization of the given parallel adaptor pass.
+  void addThreadUtilization(ModuleToFunctionPassAdaptorParallel *pass);
+
+  /// Print the thread utilization of the parallel adaptor passes.
+  void printThreadUtilization(raw_ostream &os);
+
   /// The root top level timers for each thread.
   DenseMap<uint64_t, std::unique_ptr<Timer>> rootTimers;
 
@@ -219,16 +338,30 @@ struct PassTiming : public PassInstrumentation {
 
   /// The display mode to use when printing the timing results.
   PassTimingDisplayMode displayMode;
+
+  /// The accumulated utilization of each thread used to run function pipelines
+  /// in parallel, and the accumulated wall time of those parallel executions.
+  std::vector<ThreadUtilization> threadUtilization;
+  std::chrono::nanoseconds parallelWallTime = std::chrono::nanoseconds(0);
+
+  /// The completed trace events, and a stack of the active trace events per
+  /// thread, recorded in ChromeTrace mode.
+  std::vector<TraceEvent> traceEvents;
+  DenseMap<uint64_t, SmallVector<TraceEvent, 4>> activeThreadEvents;
+
+  /// A mapping from thread id to a dense index, in the order in which the
+  /// threads started their first trace event.
+  DenseMap<uint64_t, unsigned> traceThreadIndices;
+
+  /// The time that trace timestamps are relative to.
+  std::chrono::time_point<std::chrono::steady_clock> traceStartTime;
 };
 } // end anonymous namespace
 
 /// Start a new timer for the given pass.
 void PassTiming::startPassTimer(Pass *pass) {
-  Timer *timer = getTimer(pass, [pass] {
-    if (isModuleToFunctionAdaptorPass(pass))
-      return StringRef("Function Pipeline");
-    return pass->getName();
-  });
+  Timer *timer =
+      getTimer(pass, [pass] { return getPassTimerName(pass).str(); });
 
   // We don't actually want to time the adaptor passes, they gather their total
   // from their held passes.
@@ -242,8 +375,36 @@ void PassTiming::startAnalysisTimer(llvm::StringRef name, AnalysisID *id) {
   timer->start();
 }
 
+/// Start a new trace event for the given IR unit on the current thread.
+void PassTiming::startTraceEvent(StringRef name, StringRef category,
+                                 const llvm::Any &ir) {
+  auto tid = llvm::get_threadid();
+  unsigned nextThreadIndex = traceThreadIndices.size();
+  unsigned threadIndex =
+      traceThreadIndices.insert({tid, nextThreadIndex}).first->second;
+
+  std::string irName = "module";
+  if (llvm::any_isa<Function *>(ir))
+    irName = "@" + llvm::any_cast<Function *>(ir)->getName().str();
+
+  activeThreadEvents[tid].push_back({name.str(), category, std::move(irName),
+                                     threadIndex,
+                                     std::chrono::steady_clock::now(), {}});
+}
+
+/// Complete the last started trace event of the current thread.
+void PassTiming::stopTraceEvent() {
+  auto &activeEvents = activeThreadEvents[llvm::get_threadid()];
+  assert(!activeEvents.empty() && "expected active trace event");
+  traceEvents.push_back(activeEvents.pop_back_val());
+  traceEvents.back().endTime = std::chrono::steady_clock::now();
+}
+
 /// Stop a pass timer.
 void PassTiming::runAfterPass(Pass *pass, const llvm::Any &) {
+  if (displayMode == PassTimingDisplayMode::ChromeTrace)
+    stopTraceEvent();
+
   auto tid = llvm::get_threadid();
   auto &activeTimers = activeThreadTimers[tid];
   assert(!activeTimers.empty() && "expected active timer");
@@ -253,6 +414,8 @@ void PassTiming::runAfterPass(Pass *pass, const llvm::Any &) {
   // the timing data for the other threads.
   if (auto *asyncMTFPass =
           dyn_cast<ModuleToFunctionPassAdaptorParallel>(pass)) {
+    addThreadUtilization(asyncMTFPass);
+
     // The asychronous pipeline timers should exist as children of root timers
     // for other threads.
     for (auto &rootTimer : llvm::make_early_inc_range(rootTimers)) {
@@ -268,6 +431,11 @@ void PassTiming::runAfterPass(Pass *pass, const llvm::Any &) {
                            /*isStructural=*/true);
       rootTimers.erase(rootTimer.first);
     }
+
+    // Account for all of the threads of the executor when computing the load
+    // imbalance, including those that didn't get any work.
+    timer->setNumAvailableThreads(
+        asyncMTFPass->getThreadExecutor().getNumThreads());
     return;
   }
 
@@ -277,9 +445,28 @@ void PassTiming::runAfterPass(Pass *pass, const llvm::Any &) {
     timer->stop();
 }
 
+/// Accumulate the thread utilization of the given parallel adaptor pass.
+void PassTiming::addThreadUtilization(
+    ModuleToFunctionPassAdaptorParallel *pass) {
+  auto &executor = pass->getThreadExecutor();
+  auto utilization = executor.getThreadUtilization();
+  if (threadUtilization.size() < utilization.size())
+    threadUtilization.resize(utilization.size());
+
+  for (unsigned i = 0, e = utilization.size(); i != e; ++i) {
+    threadUtilization[i].busyTime += utilization[i].busyTime;
+    threadUtilization[i].numTasks += utilization[i].numTasks;
+    threadUtilization[i].numStolenTasks += utilization[i].numStolenTasks;
+  }
+  parallelWallTime += executor.getWallTime();
+}
+
 /// Stop a timer.
 void PassTiming::runAfterAnalysis(llvm::StringRef, AnalysisID *,
                                   const llvm::Any &) {
+  if (displayMode == PassTimingDisplayMode::ChromeTrace)
+    stopTraceEvent();
+
   auto &activeTimers = activeThreadTimers[llvm::get_threadid()];
   assert(!activeTimers.empty() && "expected active timer");
   Timer *timer = activeTimers.pop_back_val();
@@ -296,9 +483,10 @@ static void printTimerHeader(llvm::raw_ostream &os, TimeRecord total) {
 
   // Print the total time followed by the section headers.
   os << llvm::format("  Total Execution Time: %5.4f seconds\n\n", total.wall);
-  if (total.user != total.wall)
-    os << "   ---User Time---";
-  os << "   ---Wall Time---  --- Name ---\n";
+  os << "   ---CPU Time---      ---Wall Time---  ";
+  if (total.isParallel())
+    os << "  --Speedup--  --Imbalance--  ";
+  os << "--- Name ---\n";
 }
 
 /// Utility to print a single line entry in the timer output.
@@ -318,6 +506,15 @@ void PassTiming::print() {
   auto &rootTimer = rootTimers.begin()->second;
   auto os = llvm::CreateInfoOutputFile();
 
+  // The trace is printed on its own, as it must be a valid JSON document.
+  if (displayMode == PassTimingDisplayMode::ChromeTrace) {
+    printResultsAsTrace(*os);
+    os->flush();
+    rootTimers.clear();
+    activeThreadTimers.clear();
+    return;
+  }
+
   // Print the timer header.
   TimeRecord totalTime = rootTimer->getTotalTime();
   printTimerHeader(*os, totalTime);
@@ -330,13 +527,39 @@ void PassTiming::print() {
   case PassTimingDisplayMode::Pipeline:
     printResultsAsPipeline(*os, rootTimer.get(), totalTime);
     break;
+  case PassTimingDisplayMode::ChromeTrace:
+    llvm_unreachable("trace results are printed separately");
   }
   printTimeEntry(*os, 0, "Total", totalTime, totalTime);
+  printThreadUtilization(*os);
   os->flush();
 
   // Reset root timers.
   rootTimers.clear();
   activeThreadTimers.clear();
+  threadUtilization.clear();
+  parallelWallTime = std::chrono::nanoseconds(0);
+}
+
+/// Print the thread utilization of the parallel adaptor passes.
+void PassTiming::printThreadUtilization(raw_ostream &os) {
+  if (threadUtilization.empty())
+    return;
+
+  // Print the utilization of each thread as the fraction of the parallel wall
+  // time that it spent executing function pipelines.
+  double wallTime = toSeconds(parallelWallTime);
+  os << llvm::format("\n  Parallel Execution Time: %5.4f seconds\n\n",
+                     wallTime);
+  os << "   ---Busy Time---   ---Tasks---  ---Stolen---  --- Thread ---\n";
+  for (unsigned i = 0, e = threadUtilization.size(); i != e; ++i) {
+    auto &utilization = threadUtilization[i];
+    double busyTime = toSeconds(utilization.busyTime);
+    os << llvm::format("  %7.4f (%5.1f%%)  %12u  %12u  ", busyTime,
+                       wallTime ? 100.0 * busyTime / wallTime : 0.0,
+                       utilization.numTasks, utilization.numStolenTasks)
+       << "Thread " << i << "\n";
+  }
 }
 
 /// Print the timing result in list mode.
@@ -387,6 +610,49 @@ void PassTiming::printResultsAsPipeline(raw_ostream &os, Timer *root,
     printTimer(0, topLevelTimer.second.get());
 }
 
+/// Print the recorded trace events in the Chrome trace-event format, which can
+/// be loaded into a trace viewer such as chrome://tracing.
+void PassTiming::printResultsAsTrace(raw_ostream &os) {
+  // Returns the given time point in microseconds since the start of the trace.
+  using Microseconds = std::chrono::duration<double, std::micro>;
+  auto getTimestamp = [&](std::chrono::steady_clock::time_point time) {
+    return std::chrono::duration_cast<Microseconds>(time - traceStartTime)
+        .count();
+  };
+
+  llvm::json::Array events;
+  for (unsigned i = 0, e = traceThreadIndices.size(); i != e; ++i) {
+    events.push_back(llvm::json::Object{
+        {"name", "thread_name"},
+        {"ph", "M"},
+        {"pid", 0},
+        {"tid", i},
+        {"args", llvm::json::Object{{"name", "Thread " + std::to_string(i)}}}});
+  }
+  for (auto &event : traceEvents) {
+    double startTime = getTimestamp(event.startTime);
+    events.push_back(llvm::json::Object{
+        {"name", event.name},
+        {"cat", event.category},
+        {"ph", "X"},
+        {"pid", 0},
+        {"tid", event.threadIndex},
+        {"ts", startTime},
+        {"dur", getTimestamp(event.endTime) - startTime},
+        {"args", llvm::json::Object{{"ir", event.irName}}}});
+  }
+
+  os << llvm::formatv(
+            "{0:2}",
+            llvm::json::Value(llvm::json::Object{
+                {"traceEvents", std::move(events)}, {"displayTimeUnit", "ms"}}))
+     << "\n";
+
+  traceEvents.clear();
+  activeThreadEvents.clear();
+  traceThreadIndices.clear();
+}
+
 //===----------------------------------------------------------------------===//
 // PassManager
 //===----------------------------------------------------------------------===//
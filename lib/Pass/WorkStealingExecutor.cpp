@@ -0,0 +1,250 @@
+//===- WorkStealingExecutor.cpp - Work-stealing thread pool ---------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements the work-stealing executor used by the pass manager to
+// run function pipelines across multiple threads.
+//
+//===----------------------------------------------------------------------===//
+
+#include "PassDetail.h"
+#include "llvm/Support/Threading.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+using namespace mlir;
+using namespace mlir::detail;
+
+namespace {
+/// The queue of pending tasks dealt to a single thread.
+struct TaskQueue {
+  /// Pop the next task of the owning thread from the front of the queue.
+  bool pop(size_t &task) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (tasks.empty())
+      return false;
+    task = tasks.front();
+    tasks.pop_front();
+    return true;
+  }
+
+  /// Steal a task for another thread from the back of the queue.
+  bool steal(size_t &task) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (tasks.empty())
+      return false;
+    task = tasks.back();
+    tasks.pop_back();
+    return true;
+  }
+
+  std::mutex mutex;
+  std::deque<size_t> tasks;
+};
+} // end anonymous namespace
+
+namespace mlir {
+namespace detail {
+struct WorkStealingExecutorImpl {
+  WorkStealingExecutorImpl(unsigned numThreads) { setNumThreads(numThreads); }
+  ~WorkStealingExecutorImpl() { stopThreads(); }
+
+  /// Set the number of threads, stopping any running worker threads.
+  void setNumThreads(unsigned newNumThreads) {
+    stopThreads();
+    numThreads = newNumThreads ? newNumThreads : llvm::hardware_concurrency();
+    numThreads = std::max(numThreads, 1u);
+
+    queues.clear();
+    for (unsigned i = 0; i != numThreads; ++i)
+      queues.emplace_back(new TaskQueue());
+    utilization.assign(numThreads, ThreadUtilization());
+  }
+
+  /// Start the worker threads if they haven't been started yet. The thread
+  /// calling 'run' acts as thread 0, so only 'numThreads - 1' are needed.
+  void startThreads() {
+    if (!threads.empty() || numThreads == 1)
+      return;
+    // The generation isn't reset when the threads are stopped, so the new
+    // threads must start from the current one. Otherwise they would take the
+    // last execution for a new one, and process it before 'run' sets up the
+    // next execution.
+    uint64_t startGeneration;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      shutdown = false;
+      startGeneration = generation;
+    }
+    for (unsigned i = 1; i != numThreads; ++i)
+      threads.emplace_back(
+          [this, i, startGeneration] { workerLoop(i, startGeneration); });
+  }
+
+  /// Stop and join all of the worker threads.
+  void stopThreads() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      shutdown = true;
+    }
+    workAvailable.notify_all();
+    for (auto &thread : threads)
+      thread.join();
+    threads.clear();
+  }
+
+  /// The main loop of a worker thread, which waits for the next execution and
+  /// helps to process its tasks. 'lastGeneration' is the generation of the
+  /// last execution before the thread was started.
+  void workerLoop(unsigned threadIndex, uint64_t lastGeneration) {
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        workAvailable.wait(
+            lock, [&] { return shutdown || generation != lastGeneration; });
+        if (shutdown)
+          return;
+        lastGeneration = generation;
+      }
+
+      processTasks(threadIndex);
+
+      std::lock_guard<std::mutex> lock(mutex);
+      if (--numActiveWorkers == 0)
+        workDone.notify_all();
+    }
+  }
+
+  /// Process tasks on the given thread until no tasks are left, first from the
+  /// queue of the thread and then by stealing from the other queues.
+  void processTasks(unsigned threadIndex) {
+    ThreadUtilization &stats = utilization[threadIndex];
+    size_t task;
+    while (true) {
+      bool stolen = false;
+      if (!queues[threadIndex]->pop(task)) {
+        for (unsigned i = 1; i != numThreads && !stolen; ++i)
+          stolen = queues[(threadIndex + i) % numThreads]->steal(task);
+
+        // If there was nothing left to steal, we are done. No new tasks are
+        // added during an execution, so there is no need to check again.
+        if (!stolen)
+          return;
+      }
+
+      auto startTime = std::chrono::steady_clock::now();
+      taskFn(threadIndex, task);
+      stats.busyTime += std::chrono::steady_clock::now() - startTime;
+      ++stats.numTasks;
+      stats.numStolenTasks += stolen;
+    }
+  }
+
+  /// Execute the given number of tasks on the threads of this executor.
+  void run(size_t numTasks,
+           llvm::function_ref<void(unsigned, size_t)> newTaskFn) {
+    auto startTime = std::chrono::steady_clock::now();
+    utilization.assign(numThreads, ThreadUtilization());
+
+    // Deal the tasks to the threads round-robin, so that each thread starts
+    // with one of the first tasks.
+    for (size_t i = 0; i != numTasks; ++i)
+      queues[i % numThreads]->tasks.push_back(i);
+    taskFn = newTaskFn;
+
+    // Wake up the worker threads, and help out on this thread.
+    startThreads();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      numActiveWorkers = threads.size();
+      ++generation;
+    }
+    workAvailable.notify_all();
+    processTasks(/*threadIndex=*/0);
+
+    // Wait for the worker threads to finish their last task.
+    std::unique_lock<std::mutex> lock(mutex);
+    workDone.wait(lock, [&] { return numActiveWorkers == 0; });
+    wallTime = std::chrono::steady_clock::now() - startTime;
+  }
+
+  /// The number of threads used by this executor, including the thread
+  /// calling 'run'.
+  unsigned numThreads = 0;
+
+  /// The worker threads.
+  std::vector<std::thread> threads;
+
+  /// The pending tasks of each thread.
+  std::vector<std::unique_ptr<TaskQueue>> queues;
+
+  /// The function to execute for each task of the current execution.
+  llvm::function_ref<void(unsigned, size_t)> taskFn;
+
+  /// The utilization of each thread, and the wall time, of the last execution.
+  std::vector<ThreadUtilization> utilization;
+  std::chrono::nanoseconds wallTime = std::chrono::nanoseconds(0);
+
+  /// A mutex and condition variables used to signal the worker threads when
+  /// an execution starts, and the calling thread when they are done.
+  std::mutex mutex;
+  std::condition_variable workAvailable, workDone;
+
+  /// A counter bumped for each execution, used by the worker threads to detect
+  /// the start of a new execution.
+  uint64_t generation = 0;
+
+  /// The number of worker threads still processing the current execution.
+  unsigned numActiveWorkers = 0;
+
+  /// Set to signal the worker threads to exit.
+  bool shutdown = false;
+};
+} // end namespace detail
+} // end namespace mlir
+
+WorkStealingExecutor::WorkStealingExecutor(unsigned numThreads)
+    : impl(new WorkStealingExecutorImpl(numThreads)) {}
+WorkStealingExecutor::~WorkStealingExecutor() {}
+
+/// Set the number of threads used by this executor.
+void WorkStealingExecutor::setNumThreads(unsigned numThreads) {
+  impl->setNumThreads(numThreads);
+}
+
+/// Returns the number of threads used by this executor.
+unsigned WorkStealingExecutor::getNumThreads() const {
+  return impl->numThreads;
+}
+
+/// Execute the given function for each task, and wait for all of them to
+/// complete.
+void WorkStealingExecutor::run(
+    size_t numTasks, llvm::function_ref<void(unsigned, size_t)> taskFn) {
+  impl->run(numTasks, taskFn);
+}
+
+/// Returns the utilization of each thread during the last execution.
+ArrayRef<ThreadUtilization> WorkStealingExecutor::getThreadUtilization() const {
+  return impl->utilization;
+}
+
+/// Returns the wall time taken by the last execution.
+std::chrono::nanoseconds WorkStealingExecutor::getWallTime() const {
+  return impl->wallTime;
+}
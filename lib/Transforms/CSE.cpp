@@ -31,33 +31,76 @@
 #include "llvm/ADT/DenseMapInfo.h"
 #include "llvm/ADT/Hashing.h"
 #include "llvm/ADT/ScopedHashTable.h"
+#include "llvm/ADT/Statistic.h"
 #include "llvm/Support/Allocator.h"
 #include "llvm/Support/RecyclingAllocator.h"
+#include <algorithm>
 #include <deque>
 using namespace mlir;
 
+#define DEBUG_TYPE "cse"
+
+STATISTIC(numCSE, "Number of operations CSE'd");
+STATISTIC(numDCE, "Number of operations trivially DCE'd");
+
 namespace {
-// TODO(riverriddle) Handle commutative operations.
-struct SimpleOperationInfo : public llvm::DenseMapInfo<Operation *> {
-  static unsigned getHashValue(const Operation *opC) {
-    auto *op = const_cast<Operation *>(opC);
+/// An operation along with its hash value. The hash is computed once when the
+/// operation is visited, rather than each time the table of known values is
+/// probed or grown.
+struct HashedOperation {
+  Operation *op;
+  unsigned hash;
+};
+
+struct SimpleOperationInfo {
+  static HashedOperation getEmptyKey() {
+    return {llvm::DenseMapInfo<Operation *>::getEmptyKey(), 0};
+  }
+  static HashedOperation getTombstoneKey() {
+    return {llvm::DenseMapInfo<Operation *>::getTombstoneKey(), 0};
+  }
+
+  /// Collect the operands of a commutative operation in a canonical order,
+  /// so that operations that only differ in the order of their operands
+  /// compare equal.
+  static void getSortedOperands(Operation *op,
+                                SmallVectorImpl<Value *> &operands) {
+    operands.assign(op->operand_begin(), op->operand_end());
+    std::sort(operands.begin(), operands.end());
+  }
+
+  static unsigned computeHash(Operation *op) {
     // Hash the operations based upon their:
     //   - Operation Name
     //   - Attributes
     //   - Result Types
-    //   - Operands
+    //   - Operands, in a canonical order if the operation is commutative
+    llvm::hash_code operandHash;
+    if (op->isCommutative()) {
+      SmallVector<Value *, 4> operands;
+      getSortedOperands(op, operands);
+      operandHash =
+          llvm::hash_combine_range(operands.begin(), operands.end());
+    } else {
+      operandHash =
+          llvm::hash_combine_range(op->operand_begin(), op->operand_end());
+    }
     return hash_combine(
         op->getName(), op->getAttrs(),
         hash_combine_range(op->result_type_begin(), op->result_type_end()),
-        hash_combine_range(op->operand_begin(), op->operand_end()));
+        operandHash);
   }
-  static bool isEqual(const Operation *lhsC, const Operation *rhsC) {
-    auto *lhs = const_cast<Operation *>(lhsC);
-    auto *rhs = const_cast<Operation *>(rhsC);
+
+  static unsigned getHashValue(const HashedOperation &key) { return key.hash; }
+  static bool isEqual(const HashedOperation &lhsKey,
+                      const HashedOperation &rhsKey) {
+    auto *lhs = lhsKey.op, *rhs = rhsKey.op;
     if (lhs == rhs)
       return true;
-    if (lhs == getTombstoneKey() || lhs == getEmptyKey() ||
-        rhs == getTombstoneKey() || rhs == getEmptyKey())
+    if (lhs == getTombstoneKey().op || lhs == getEmptyKey().op ||
+        rhs == getTombstoneKey().op || rhs == getEmptyKey().op)
+      return false;
+    if (lhsKey.hash != rhsKey.hash)
       return false;
 
     // Compare the operation name.
@@ -70,10 +113,18 @@ struct SimpleOperationInfo : public llvm::DenseMapInfo<Operation *> {
     // Compare attributes.
     if (lhs->getAttrs() != rhs->getAttrs())
       return false;
-    // Compare operands.
-    if (!std::equal(lhs->operand_begin(), lhs->operand_end(),
-                    rhs->operand_begin()))
+    // Compare operands, in a canonical order if the operations are
+    // commutative.
+    if (lhs->isCommutative()) {
+      SmallVector<Value *, 4> lhsOperands, rhsOperands;
+      getSortedOperands(lhs, lhsOperands);
+      getSortedOperands(rhs, rhsOperands);
+      if (lhsOperands != rhsOperands)
+        return false;
+    } else if (!std::equal(lhs->operand_begin(), lhs->operand_end(),
+                           rhs->operand_begin())) {
       return false;
+    }
     // Compare result types.
     return std::equal(lhs->result_type_begin(), lhs->result_type_end(),
                       rhs->result_type_begin());
@@ -90,8 +141,8 @@ struct CSE : public FunctionPass<CSE> {
   /// Shared implementation of operation elimination and scoped map definitions.
   using AllocatorTy = llvm::RecyclingAllocator<
       llvm::BumpPtrAllocator,
-      llvm::ScopedHashTableVal<Operation *, Operation *>>;
-  using ScopedMapTy = llvm::ScopedHashTable<Operation *, Operation *,
+      llvm::ScopedHashTableVal<HashedOperation, Operation *>>;
+  using ScopedMapTy = llvm::ScopedHashTable<HashedOperation, Operation *,
                                             SimpleOperationInfo, AllocatorTy>;
 
   /// Represents a single entry in the depth first traversal of a CFG.
@@ -144,16 +195,19 @@ bool CSE::simplifyOperation(Operation *op) {
   // If the operation is already trivially dead just add it to the erase list.
   if (op->use_empty()) {
     opsToErase.push_back(op);
+    ++numDCE;
     return true;
   }
 
   // Look for an existing definition for the operation.
-  if (auto *existing = knownValues.lookup(op)) {
+  HashedOperation key = {op, SimpleOperationInfo::computeHash(op)};
+  if (auto *existing = knownValues.lookup(key)) {
     // If we find one then replace all uses of the current operation with the
     // existing one and mark it for deletion.
     for (unsigned i = 0, e = existing->getNumResults(); i != e; ++i)
       op->getResult(i)->replaceAllUsesWith(existing->getResult(i));
     opsToErase.push_back(op);
+    ++numCSE;
 
     // If the existing operation has an unknown location and the current
     // operation doesn't, then set the existing op's location to that of the
@@ -166,7 +220,7 @@ bool CSE::simplifyOperation(Operation *op) {
   }
 
   // Otherwise, we add this operation to the known values map.
-  knownValues.insert(op, op);
+  knownValues.insert(key, op);
   return false;
 }
 
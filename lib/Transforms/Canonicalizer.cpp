@@ -39,17 +39,13 @@ struct Canonicalizer : public FunctionPass<Canonicalizer> {
 } // end anonymous namespace
 
 void Canonicalizer::runOnFunction() {
-  OwningRewritePatternList patterns;
-  auto &func = getFunction();
-
-  // TODO: Instead of adding all known patterns from the whole system lazily add
-  // and cache the canonicalization patterns for ops we see in practice when
-  // building the worklist.  For now, we just grab everything.
-  auto *context = &getContext();
-  for (auto *op : context->getRegisteredOperations())
-    op->getCanonicalizationPatterns(patterns, context);
-
-  applyPatternsGreedily(func, std::move(patterns));
+  // The canonicalization patterns of all registered operations are built once
+  // and cached in the context, so that they are shared between all functions
+  // and threads.
+  // TODO: Lazily add and cache the canonicalization patterns for ops we see in
+  // practice when building the worklist. For now, we just grab everything.
+  applyPatternsGreedily(getFunction(),
+                        getContext().getCanonicalizationPatterns());
 }
 
 /// Create a Canonicalizer pass.
@@ -939,21 +939,16 @@ static unsigned getMaxLoopDepth(ArrayRef<Operation *> loadOpInsts,
 
   // Check dependences on all pairs of ops in 'ops' and store the minimum
   // loop depth at which a dependence is satisfied.
+  AffineDependenceGraph depGraph;
   for (unsigned i = 0, e = ops.size(); i < e; ++i) {
     auto *srcOpInst = ops[i];
-    MemRefAccess srcAccess(srcOpInst);
     for (unsigned j = 0; j < e; ++j) {
       auto *dstOpInst = ops[j];
-      MemRefAccess dstAccess(dstOpInst);
 
       unsigned numCommonLoops =
           getNumCommonSurroundingLoops(*srcOpInst, *dstOpInst);
       for (unsigned d = 1; d <= numCommonLoops + 1; ++d) {
-        FlatAffineConstraints dependenceConstraints;
-        // TODO(andydavis) Cache dependence analysis results, check cache here.
-        if (checkMemrefAccessDependence(srcAccess, dstAccess, d,
-                                        &dependenceConstraints,
-                                        /*dependenceComponents=*/nullptr)) {
+        if (depGraph.hasDependence(srcOpInst, dstOpInst, d)) {
           // Store minimum loop depth and break because we want the min 'd' at
           // which there is a dependence.
           loopDepth = std::min(loopDepth, d - 1);
@@ -990,20 +985,23 @@ computeLoopInterchangePermutation(ArrayRef<Operation *> ops,
   std::vector<llvm::SmallVector<DependenceComponent, 2>> depCompsVec;
   llvm::SmallVector<bool, 8> isParallelLoop(maxLoopDepth, true);
   unsigned numOps = ops.size();
+  // The access functions and domains are shared across the loop depths, and
+  // the checks are run up front, in parallel.
+  AffineDependenceGraph depGraph;
+  std::vector<DependenceQuery> queries;
+  for (unsigned d = 1; d <= maxLoopDepth; ++d)
+    for (auto *srcOpInst : ops)
+      for (auto *dstOpInst : ops)
+        queries.emplace_back(srcOpInst, dstOpInst, d, /*withComponents=*/true);
+  depGraph.computeDependences(queries);
   for (unsigned d = 1; d <= maxLoopDepth; ++d) {
     for (unsigned i = 0; i < numOps; ++i) {
       auto *srcOpInst = ops[i];
-      MemRefAccess srcAccess(srcOpInst);
       for (unsigned j = 0; j < numOps; ++j) {
         auto *dstOpInst = ops[j];
-        MemRefAccess dstAccess(dstOpInst);
 
-        FlatAffineConstraints dependenceConstraints;
         llvm::SmallVector<DependenceComponent, 2> depComps;
-        // TODO(andydavis,bondhugula) Explore whether it would be profitable
-        // to pre-compute and store deps instead of repeatidly checking.
-        if (checkMemrefAccessDependence(srcAccess, dstAccess, d,
-                                        &dependenceConstraints, &depComps)) {
+        if (depGraph.hasDependence(srcOpInst, dstOpInst, d, &depComps)) {
           isParallelLoop[d - 1] = false;
           depCompsVec.push_back(depComps);
         }
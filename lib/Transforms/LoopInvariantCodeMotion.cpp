@@ -0,0 +1,151 @@
+//===- LoopInvariantCodeMotion.cpp - Hoist invariant code out of loops ----===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+//
+// This file implements a pass that hoists loop invariant operations out of
+// the bodies of affine.for operations.
+//
+//===----------------------------------------------------------------------===//
+
+#include "mlir/AffineOps/AffineOps.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/Pass/Pass.h"
+#include "mlir/StandardOps/Ops.h"
+#include "mlir/Transforms/Passes.h"
+#include "llvm/ADT/Statistic.h"
+#include "llvm/Support/Debug.h"
+
+#define DEBUG_TYPE "affine-licm"
+
+STATISTIC(numHoisted, "Number of operations hoisted out of loops");
+
+using namespace mlir;
+
+namespace {
+
+/// Hoists the side effect free operations of affine.for bodies whose operands
+/// are all defined outside of the loop to just before the loop. Operations
+/// that may trap are only hoisted out of loops known to run at least once.
+/// Loops are visited innermost first, so an operation that is invariant in
+/// several enclosing loops moves out of all of them. Hoisted operations then
+/// dominate the loops, so a following CSE pass may merge the ones that are
+/// redundant.
+struct LoopInvariantCodeMotion
+    : public FunctionPass<LoopInvariantCodeMotion> {
+  void runOnFunction() override;
+
+  /// Hoist the invariant operations out of the given loop, returning the
+  /// number of operations hoisted.
+  unsigned hoistInvariantOps(AffineForOp forOp);
+};
+
+} // end anonymous namespace
+
+FunctionPassBase *mlir::createLoopInvariantCodeMotionPass() {
+  return new LoopInvariantCodeMotion();
+}
+
+/// Returns true if 'value' is defined outside of the regions of 'loop'.
+static bool isDefinedOutsideOfLoop(Value *value, Operation *loop) {
+  Block *block;
+  if (auto *arg = dyn_cast<BlockArgument>(value))
+    block = arg->getOwner();
+  else
+    block = value->getDefiningOp()->getBlock();
+
+  // Walk up the operations that enclose the definition.
+  while (auto *parentOp = block->getContainingOp()) {
+    if (parentOp == loop)
+      return false;
+    block = parentOp->getBlock();
+  }
+  return true;
+}
+
+/// Returns true if 'op' is free of side effects but may trap, e.g. on a
+/// division by zero.
+static bool mayTrap(Operation &op) {
+  return op.isa<DivISOp>() || op.isa<DivIUOp>() || op.isa<RemISOp>() ||
+         op.isa<RemIUOp>();
+}
+
+/// Returns true if 'forOp' is known to run at least one iteration.
+static bool runsAtLeastOnce(AffineForOp forOp) {
+  return forOp.hasConstantBounds() &&
+         forOp.getConstantLowerBound() < forOp.getConstantUpperBound();
+}
+
+/// Returns true if 'op', an operation of the body of 'forOp', may be hoisted
+/// out of it.
+static bool isLoopInvariant(Operation &op, AffineForOp forOp) {
+  // Only hoist operations without side effects or regions. Terminators must
+  // stay at the end of the body.
+  if (op.isKnownTerminator() || op.getNumRegions() != 0 ||
+      !op.hasNoSideEffect())
+    return false;
+
+  // Hoisting an operation that may trap out of a loop that doesn't run would
+  // execute it when the original program doesn't.
+  if (mayTrap(op) && !runsAtLeastOnce(forOp))
+    return false;
+
+  auto *loop = forOp.getOperation();
+  return llvm::all_of(op.getOperands(), [&](Value *operand) {
+    return isDefinedOutsideOfLoop(operand, loop);
+  });
+}
+
+unsigned LoopInvariantCodeMotion::hoistInvariantOps(AffineForOp forOp) {
+  auto *loop = forOp.getOperation();
+
+  // Operations are visited in order, so the users of a hoisted operation see
+  // it as being defined outside of the loop.
+  unsigned numOpsHoisted = 0;
+  for (auto it = forOp.getBody()->begin(), e = forOp.getBody()->end();
+       it != e;) {
+    auto &op = *it++;
+    if (!isLoopInvariant(op, forOp))
+      continue;
+    op.moveBefore(loop);
+    ++numOpsHoisted;
+  }
+  return numOpsHoisted;
+}
+
+void LoopInvariantCodeMotion::runOnFunction() {
+  // Collect the loops in postorder, so that inner loops are processed before
+  // the loops enclosing them.
+  std::vector<AffineForOp> loops;
+  getFunction().walkPostOrder<AffineForOp>(
+      [&](AffineForOp forOp) { loops.push_back(forOp); });
+
+  unsigned numOpsHoisted = 0;
+  for (auto forOp : loops)
+    numOpsHoisted += hoistInvariantOps(forOp);
+
+  LLVM_DEBUG(llvm::dbgs() << "Hoisted " << numOpsHoisted
+                          << " operations out of the loops of @"
+                          << getFunction().getName() << "\n");
+  numHoisted += numOpsHoisted;
+
+  if (numOpsHoisted == 0)
+    markAllAnalysesPreserved();
+}
+
+static PassRegistration<LoopInvariantCodeMotion>
+    pass("affine-loop-invariant-code-motion",
+         "Hoist loop invariant operations out of affine.for loops");
@@ -81,6 +81,7 @@ struct MemRefDataFlowOpt : public FunctionPass<MemRefDataFlowOpt> {
 
   DominanceInfo *domInfo = nullptr;
   PostDominanceInfo *postDomInfo = nullptr;
+  AffineDependenceGraph *depGraph = nullptr;
 };
 
 } // end anonymous namespace
@@ -125,15 +126,10 @@ void MemRefDataFlowOpt::forwardStoreToLoad(LoadOp loadOp) {
   // post-dominance on these. 'fwdingCandidates' are a subset of depSrcStores.
   SmallVector<Operation *, 8> depSrcStores;
   for (auto *storeOpInst : storeOps) {
-    MemRefAccess srcAccess(storeOpInst);
-    MemRefAccess destAccess(loadOpInst);
-    FlatAffineConstraints dependenceConstraints;
     unsigned nsLoops = getNumCommonSurroundingLoops(*loadOpInst, *storeOpInst);
     // Dependences at loop depth <= minSurroundingLoops do NOT matter.
     for (unsigned d = nsLoops + 1; d > minSurroundingLoops; d--) {
-      if (!checkMemrefAccessDependence(srcAccess, destAccess, d,
-                                       &dependenceConstraints,
-                                       /*dependenceComponents=*/nullptr))
+      if (!depGraph->hasDependence(storeOpInst, loadOpInst, d))
         continue;
       depSrcStores.push_back(storeOpInst);
       // Check if this store is a candidate for forwarding; we only forward if
@@ -219,6 +215,7 @@ void MemRefDataFlowOpt::runOnFunction() {
 
   domInfo = &getAnalysis<DominanceInfo>();
   postDomInfo = &getAnalysis<PostDominanceInfo>();
+  depGraph = &getAnalysis<AffineDependenceGraph>();
 
   loadOpsToErase.clear();
   memrefsToErase.clear();
@@ -20,30 +20,72 @@
 //===----------------------------------------------------------------------===//
 
 #include "mlir/IR/Builders.h"
+#include "mlir/IR/Diagnostics.h"
 #include "mlir/IR/Matchers.h"
+#include "mlir/IR/Module.h"
 #include "mlir/IR/PatternMatch.h"
 #include "mlir/StandardOps/Ops.h"
 #include "llvm/ADT/DenseMap.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/Parallel.h"
+#include "llvm/Support/Threading.h"
+#include "llvm/Support/raw_ostream.h"
+#include <atomic>
 using namespace mlir;
 
+#define DEBUG_TYPE "pattern-matcher"
+
 namespace {
 
+/// The worklist storage used by the GreedyPatternRewriteDriver. This is kept
+/// separate from the driver so that its allocations can be reused when a
+/// thread rewrites several functions in turn.
+struct GreedyRewriteWorklist {
+  /// Clear the held state, keeping the allocated storage for reuse.
+  void clear() {
+    worklist.clear();
+    worklistMap.clear();
+    uniquedConstants.clear();
+  }
+
+  /// The worklist for this transformation keeps track of the operations that
+  /// need to be revisited, plus their index in the worklist.  This allows us to
+  /// efficiently remove operations from the worklist when they are erased from
+  /// the function, even if they aren't the root of a pattern.
+  std::vector<Operation *> worklist;
+  DenseMap<Operation *, unsigned> worklistMap;
+
+  /// As part of canonicalization, we move constants to the top of the entry
+  /// block of the current function and de-duplicate them.  This keeps track of
+  /// constants we have done this for.
+  DenseMap<std::pair<Attribute, Type>, Operation *> uniquedConstants;
+};
+
 /// This is a worklist-driven driver for the PatternMatcher, which repeatedly
 /// applies the locally optimal patterns in a roughly "bottom up" way.
 class GreedyPatternRewriteDriver : public PatternRewriter {
 public:
-  explicit GreedyPatternRewriteDriver(Function &fn,
-                                      OwningRewritePatternList &&patterns)
+  explicit GreedyPatternRewriteDriver(
+      Function &fn, std::shared_ptr<const FrozenRewritePatternList> patterns,
+      GreedyRewriteWorklist &storage)
       : PatternRewriter(fn.getContext()), matcher(std::move(patterns), *this),
-        builder(&fn) {
+        builder(&fn), worklist(storage.worklist),
+        worklistMap(storage.worklistMap),
+        uniquedConstants(storage.uniquedConstants), storage(storage) {
     worklist.reserve(64);
 
     // Add all operations to the worklist.
     fn.walk([&](Operation *op) { addToWorklist(op); });
   }
 
-  /// Perform the rewrites.
-  void simplifyFunction();
+  /// Perform the rewrites, processing at most 'maxIterations' operations from
+  /// the worklist, or an unlimited number if it is zero. Returns true if the
+  /// worklist was drained, i.e. the rewrite converged, before reaching the
+  /// limit.
+  bool simplifyFunction(unsigned maxIterations);
+
+  /// Returns the number of operations that were processed from the worklist.
+  unsigned getNumIterations() const { return numIterations; }
 
   void addToWorklist(Operation *op) {
     // Check to see if the worklist already contains this op.
@@ -127,26 +169,25 @@ private:
   /// This builder is used to create new operations.
   FuncBuilder builder;
 
-  /// The worklist for this transformation keeps track of the operations that
-  /// need to be revisited, plus their index in the worklist.  This allows us to
-  /// efficiently remove operations from the worklist when they are erased from
-  /// the function, even if they aren't the root of a pattern.
-  std::vector<Operation *> worklist;
-  DenseMap<Operation *, unsigned> worklistMap;
+  /// The worklist and uniqued constants of this transformation, which live in
+  /// the storage provided by the caller.
+  std::vector<Operation *> &worklist;
+  DenseMap<Operation *, unsigned> &worklistMap;
+  DenseMap<std::pair<Attribute, Type>, Operation *> &uniquedConstants;
+  GreedyRewriteWorklist &storage;
 
-  /// As part of canonicalization, we move constants to the top of the entry
-  /// block of the current function and de-duplicate them.  This keeps track of
-  /// constants we have done this for.
-  DenseMap<std::pair<Attribute, Type>, Operation *> uniquedConstants;
+  /// The number of operations processed from the worklist.
+  unsigned numIterations = 0;
 };
 }; // end anonymous namespace
 
 /// Perform the rewrites.
-void GreedyPatternRewriteDriver::simplifyFunction() {
+bool GreedyPatternRewriteDriver::simplifyFunction(unsigned maxIterations) {
   // These are scratch vectors used in the constant folding loop below.
   SmallVector<Attribute, 8> operandConstants, resultConstants;
   SmallVector<Value *, 8> originalOperands, resultValues;
 
+  bool converged = true;
   while (!worklist.empty()) {
     auto *op = popFromWorklist();
 
@@ -154,6 +195,13 @@ void GreedyPatternRewriteDriver::simplifyFunction() {
     if (op == nullptr)
       continue;
 
+    // Stop if we have hit the iteration limit with work still remaining.
+    if (maxIterations && numIterations == maxIterations) {
+      converged = false;
+      break;
+    }
+    ++numIterations;
+
     // If we have a constant op, unique it into the entry block.
     if (auto constant = op->dyn_cast<ConstantOp>()) {
       // If this constant is dead, remove it, being careful to keep
@@ -293,7 +341,17 @@ void GreedyPatternRewriteDriver::simplifyFunction() {
     matcher.matchAndRewrite(op);
   }
 
-  uniquedConstants.clear();
+  // Clear the worklist state so that the storage may be reused.
+  storage.clear();
+
+  LLVM_DEBUG({
+    if (!converged)
+      llvm::dbgs() << "Pattern application did not converge within "
+                   << maxIterations << " iterations\n";
+    llvm::dbgs() << "Pattern application statistics:\n";
+    matcher.printStatistics(llvm::dbgs());
+  });
+  return converged;
 }
 
 /// Rewrite the specified function by repeatedly applying the highest benefit
@@ -301,6 +359,76 @@ void GreedyPatternRewriteDriver::simplifyFunction() {
 ///
 void mlir::applyPatternsGreedily(Function &fn,
                                  OwningRewritePatternList &&patterns) {
-  GreedyPatternRewriteDriver driver(fn, std::move(patterns));
-  driver.simplifyFunction();
+  applyPatternsGreedily(
+      fn, std::make_shared<FrozenRewritePatternList>(std::move(patterns)));
+}
+
+/// Rewrite the specified function by greedily applying the patterns from the
+/// given frozen pattern list.
+GreedyRewriteResult mlir::applyPatternsGreedily(
+    Function &fn, std::shared_ptr<const FrozenRewritePatternList> patterns,
+    unsigned maxIterations) {
+  GreedyRewriteWorklist storage;
+  GreedyPatternRewriteDriver driver(fn, std::move(patterns), storage);
+
+  GreedyRewriteResult result;
+  if (!driver.simplifyFunction(maxIterations))
+    result.nonConvergedFunctions.push_back(&fn);
+  result.numIterations = driver.getNumIterations();
+  return result;
+}
+
+/// Rewrite all of the non-external functions within the specified module by
+/// greedily applying the patterns from the given frozen pattern list, sharding
+/// the functions across multiple threads.
+GreedyRewriteResult mlir::applyPatternsGreedily(
+    Module &module, std::shared_ptr<const FrozenRewritePatternList> patterns,
+    unsigned maxIterations) {
+  // Collect the functions to rewrite. The position of a function within this
+  // list is used to order the diagnostics and the convergence results.
+  std::vector<Function *> functions;
+  for (auto &fn : module)
+    if (!fn.isExternal())
+      functions.push_back(&fn);
+
+  // Create the worklist storage for each of the threads, which is reused for
+  // every function that the thread rewrites.
+  std::vector<GreedyRewriteWorklist> worklists(
+      std::min<size_t>(llvm::hardware_concurrency(), functions.size()));
+
+  // A parallel diagnostic handler that provides deterministic diagnostic
+  // ordering, and prints any dangling diagnostics in the event of a crash.
+  ParallelDiagnosticHandler diagHandler(*module.getContext());
+
+  // An index for the next function to rewrite, and the results for each
+  // function. A vector<char> is used as vector<bool> may not be written to
+  // concurrently.
+  std::atomic<unsigned> funcIt(0), numIterations(0);
+  std::vector<char> convergedFunctions(functions.size(), true);
+  llvm::parallel::for_each(
+      llvm::parallel::par, worklists.begin(), worklists.end(),
+      [&](GreedyRewriteWorklist &storage) {
+        for (auto e = functions.size();;) {
+          // Get the next available function index.
+          unsigned nextID = funcIt++;
+          if (nextID >= e)
+            break;
+
+          // Set the function id for this thread in the diagnostic handler.
+          diagHandler.setOrderIDForThread(nextID);
+
+          GreedyPatternRewriteDriver driver(*functions[nextID], patterns,
+                                            storage);
+          convergedFunctions[nextID] = driver.simplifyFunction(maxIterations);
+          numIterations += driver.getNumIterations();
+        }
+      });
+
+  // Report the functions that didn't converge in module order.
+  GreedyRewriteResult result;
+  for (unsigned i = 0, e = functions.size(); i != e; ++i)
+    if (!convergedFunctions[i])
+      result.nonConvergedFunctions.push_back(functions[i]);
+  result.numIterations = numIterations;
+  return result;
 }
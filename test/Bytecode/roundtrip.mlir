@@ -0,0 +1,62 @@
+// RUN: mlir-opt %s -emit-bytecode -o %t && mlir-opt %t -mlir-print-debuginfo | FileCheck %s
+// RUN: mlir-translate -mlir-to-bytecode %s | mlir-translate -bytecode-to-mlir | FileCheck %s --check-prefix=TRANSLATE
+
+#map0 = (d0) -> (d0 + 1)
+#set0 = (d0) : (d0 - 1 >= 0)
+
+// CHECK-LABEL: func @external(i32, f32) -> i32
+// CHECK-NEXT: attributes {{ *}}{ext.attr: "value"}
+func @external(i32, f32) -> i32 attributes {ext.attr: "value"}
+
+// CHECK-LABEL: func @arg_attrs(%arg0: i32 {arg.attr: 42}) loc("file.cc":10:8)
+func @arg_attrs(%arg0: i32 {arg.attr: 42}) loc("file.cc":10:8) {
+  return loc(unknown)
+}
+
+// CHECK-LABEL: func @cfg(%arg0: i1, %arg1: i32) -> i32
+func @cfg(%arg0: i1, %arg1: i32) -> i32 {
+  // CHECK-NEXT: br ^bb2(%arg1 : i32)
+  br ^bb2(%arg1 : i32)
+// CHECK: ^bb1:
+^bb1:
+  // CHECK-NEXT: %0 = addi %1, %1 : i32
+  %0 = addi %1, %1 : i32
+  // CHECK-NEXT: return %0 : i32
+  return %0 : i32
+// CHECK: ^bb2(%1: i32):
+^bb2(%1 : i32):
+  // CHECK-NEXT: cond_br %arg0, ^bb1, ^bb2(%1 : i32)
+  cond_br %arg0, ^bb1, ^bb2(%1 : i32)
+}
+
+// CHECK-LABEL: func @regions
+func @regions(%arg0: memref<8xf32>) {
+  // CHECK-NEXT: %cst = constant 1.000000e-01 : f32 loc(callsite("foo" at "file.cc":1:2))
+  %cst = constant 1.000000e-01 : f32 loc(callsite("foo" at "file.cc":1:2))
+  // CHECK-NEXT: affine.for %i0 = 0 to 8 {
+  affine.for %i0 = 0 to 8 {
+    // CHECK-NEXT: %0 = affine.apply #map{{[0-9]+}}(%i0)
+    %0 = affine.apply #map0(%i0)
+    // CHECK-NEXT: affine.if #set0(%i0) {
+    affine.if #set0(%i0) {
+      // CHECK-NEXT: store %cst, %arg0[%0] : memref<8xf32>
+      store %cst, %arg0[%0] : memref<8xf32>
+    }
+  // CHECK: } loc(fused<"myPass">["foo", "file.cc":3:4])
+  } loc(fused<"myPass">["foo", "file.cc":3:4])
+  return
+}
+
+// CHECK-LABEL: func @attributes
+func @attributes() {
+  // CHECK-NEXT: "foo"() {array: [1, true, 2.500000e+00, "str", i64, @external : (i32, f32) -> i32], dense: dense<tensor<2x2xi8>, {{\[\[}}1, -2], [3, 4]]>, fdense: dense<vector<3xf32>, [1.000000e+00, 2.000000e+00, 3.000000e+00]>, map: #map{{[0-9]+}}, small: -7 : i16, splat: splat<tensor<4xi32>, 7>} : () -> ()
+  "foo"() {array: [1, true, 2.5 : f64, "str", i64, @external : (i32, f32) -> i32], dense: dense<tensor<2x2xi8>, [[1, -2], [3, 4]]>, fdense: dense<vector<3xf32>, [1.0, 2.0, 3.0]>, map: #map0, splat: splat<tensor<4xi32>, 7>, small: -7 : i16} : () -> ()
+  return
+}
+
+// TRANSLATE-LABEL: func @external
+// TRANSLATE-LABEL: func @arg_attrs
+// TRANSLATE-LABEL: func @cfg
+// TRANSLATE-LABEL: func @regions
+// TRANSLATE: affine.for
+// TRANSLATE-LABEL: func @attributes
@@ -0,0 +1,17 @@
+// RUN: mlir-opt -print-context-stats %s -o=/dev/null 2>&1 | FileCheck %s
+
+// CHECK-LABEL: Uniqued storage memory usage:
+// CHECK:         attributes: {{[0-9]+}} bytes in {{[0-9]+}} arena(s)
+// CHECK:         types: {{[0-9]+}} bytes in {{[0-9]+}} arena(s)
+
+// CHECK-LABEL: Uniquing table statistics:
+// CHECK:         affine maps: {{[1-9][0-9]*}} entries, {{[0-9]+}} buckets, {{[0-9]+}} bytes, load factor {{[0-9]\.[0-9]+}}
+// CHECK:         integer attrs: {{[1-9][0-9]*}} entries
+// CHECK:         float attrs: {{[1-9][0-9]*}} entries
+func @main() -> f32 {
+  %c0 = constant 1 : i32
+  %cf = constant 2.0 : f32
+  affine.for %i = 0 to 10 {
+  }
+  return %cf : f32
+}
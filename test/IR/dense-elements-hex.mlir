@@ -0,0 +1,25 @@
+// RUN: mlir-opt %s | FileCheck %s
+// RUN: mlir-opt %s -mlir-print-elementsattrs-hex-threshold=2 | FileCheck %s --check-prefix=HEX
+// RUN: mlir-opt %s -mlir-print-elementsattrs-hex-threshold=2 | mlir-opt | FileCheck %s
+
+// CHECK-LABEL: func @dense_hex
+func @dense_hex() {
+  // CHECK: "foo"() {bar: dense<tensor<2x2xi32>, {{\[\[}}1, -2], [3, 4]]>}
+  // HEX: "foo"() {bar: dense<tensor<2x2xi32>, "0x01000000FEFFFFFF0300000004000000">}
+  "foo"() {bar: dense<tensor<2x2xi32>, "0x01000000FEFFFFFF0300000004000000">} : () -> ()
+
+  // CHECK: "foo"() {bar: dense<tensor<4xf32>, [1.000000e+00, 2.000000e+00, -5.000000e-01, 0.000000e+00]>}
+  // HEX: "foo"() {bar: dense<tensor<4xf32>, "0x0000803F00000040000000BF00000000">}
+  "foo"() {bar: dense<tensor<4xf32>, [1.0, 2.0, -0.5, 0.0]>} : () -> ()
+
+  // Elements narrower than a byte are packed.
+  // CHECK: "foo"() {bar: dense<vector<4xi3>, [1, -2, 1, 2]>}
+  // HEX: "foo"() {bar: dense<vector<4xi3>, "0x7104">}
+  "foo"() {bar: dense<vector<4xi3>, "0x7104">} : () -> ()
+
+  // Attributes with no more elements than the threshold use the list form.
+  // CHECK: "foo"() {bar: dense<tensor<2xi64>, [5, 6]>}
+  // HEX: "foo"() {bar: dense<tensor<2xi64>, [5, 6]>}
+  "foo"() {bar: dense<tensor<2xi64>, [5, 6]>} : () -> ()
+  return
+}
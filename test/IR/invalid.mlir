@@ -1074,3 +1074,31 @@ func @bad_complex(complex memref<2x4xi8>>)
 
 // expected-error @+1 {{expected '>' in complex type}}
 func @bad_complex(complex<i32)
+
+// -----
+
+func @elementsattr_hex_missing_prefix() -> () {
+^bb0:
+  "foo"(){bar: dense<tensor<1xi8>, "FF">} : () -> () // expected-error {{hex elements literal should start with '0x'}}
+}
+
+// -----
+
+func @elementsattr_hex_wrong_size() -> () {
+^bb0:
+  "foo"(){bar: dense<tensor<2xi16>, "0x0100">} : () -> () // expected-error {{expected 4 bytes of hex data for elements literal}}
+}
+
+// -----
+
+func @elementsattr_hex_invalid_digit() -> () {
+^bb0:
+  "foo"(){bar: dense<tensor<1xi16>, "0x01QZ">} : () -> () // expected-error {{hex elements literal only contains hex digits}}
+}
+
+// -----
+
+func @elementsattr_hex_padding() -> () {
+^bb0:
+  "foo"(){bar: dense<tensor<2xi3>, "0xFF">} : () -> () // expected-error {{hex elements literal has bits set past the last element}}
+}
@@ -0,0 +1,24 @@
+// RUN: mlir-opt %s -mlir-parse-functions-in-parallel -verify
+
+// Function bodies parsed in parallel all report their errors, in the order of
+// the functions within the module.
+
+func @first() {
+  %0 = addi %undefined, %undefined : i32 // expected-error {{use of undeclared SSA value name}}
+  return
+}
+
+func @valid(%arg0: i32) -> i32 {
+  return %arg0 : i32
+}
+
+func @second() {
+  ^bb0:
+  br ^missing // expected-error {{reference to an undefined block}}
+}
+
+func @third() {
+  %0 = "foo"() : () -> i32 // expected-error {{prior use here}}
+  "bar"(%0) : (i64) -> () // expected-error {{expects different type than prior uses}}
+  return
+}
@@ -0,0 +1,39 @@
+// RUN: mlir-opt %s -mlir-parse-functions-in-parallel | FileCheck %s
+
+// Check that function bodies parsed in parallel see the definitions before
+// them, and may refer to functions defined after them.
+
+#map0 = (d0) -> (d0 + 1)
+!vec = type vector<4xf32>
+
+// CHECK-LABEL: func @skip_braces
+func @skip_braces() -> i32 {
+  // Braces in strings and comments don't end the body: }}
+  // CHECK-NEXT: "foo"() {str: "}}\22{"} : () -> ()
+  "foo"() {str: "}}\"{"} : () -> ()
+  // CHECK-NEXT: %0 = call @later() : () -> i32
+  %0 = call @later() : () -> i32
+  // CHECK-NEXT: return %0 : i32
+  return %0 : i32
+}
+
+// CHECK-LABEL: func @regions
+func @regions(%arg0: !vec) {
+  // CHECK-NEXT: affine.for %i0 = 0 to 10 {
+  affine.for %i0 = 0 to 10 {
+    // CHECK-NEXT: %0 = affine.apply #map2(%i0)
+    %0 = affine.apply #map0(%i0)
+  }
+  return
+}
+
+#map1 = (d0) -> (d0 * 2)
+
+// CHECK-LABEL: func @later() -> i32
+func @later() -> i32 {
+  %c0 = constant 0 : index
+  // CHECK: affine.apply #map3(%c0)
+  %0 = affine.apply #map1(%c0)
+  %c1 = constant 1 : i32
+  return %c1 : i32
+}
@@ -0,0 +1,43 @@
+// RUN: mlir-opt %s -mlir-print-debuginfo > %t.serial
+// RUN: mlir-opt %s -mlir-print-debuginfo -mlir-print-functions-in-parallel > %t.parallel
+// RUN: diff %t.serial %t.parallel
+// RUN: FileCheck %s < %t.parallel
+
+// Check that functions printed in parallel refer to the aliases and ids
+// collected for the whole module, and are written out in order.
+
+// CHECK: #map0 = (d0) -> (d0 * 2)
+// CHECK: #map3 = (d0) -> (d0 + 1)
+// CHECK: #set0 = (d0) : (d0 - 10 >= 0)
+
+// CHECK-LABEL: func @first
+// CHECK-SAME: (%arg0: memref<10xf32, #map0>)
+func @first(%arg0: memref<10xf32, (d0) -> (d0 * 2)>) {
+  affine.for %i0 = 0 to 10 {
+    // CHECK: affine.apply #map3(%i0)
+    %0 = affine.apply (d0) -> (d0 + 1)(%i0)
+  }
+  return
+}
+
+// CHECK-LABEL: func @second
+func @second(%arg0: index) -> i32 {
+  // CHECK: affine.if #set0(%arg0)
+  affine.if (d0) : (d0 - 10 >= 0)(%arg0) {
+    // CHECK: %0 = "foo"() : () -> memref<10xf32, #map0>
+    %0 = "foo"() : () -> memref<10xf32, (d0) -> (d0 * 2)>
+  }
+  %c1 = constant 1 : i32
+  return %c1 : i32
+}
+
+// CHECK-LABEL: func @external(i32)
+func @external(i32)
+
+// CHECK-LABEL: func @third
+func @third() {
+  // CHECK: %0 = affine.apply #map3(%c0)
+  %c0 = constant 0 : index
+  %0 = affine.apply (d0) -> (d0 + 1)(%c0)
+  return
+}
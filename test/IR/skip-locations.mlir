@@ -0,0 +1,24 @@
+// RUN: mlir-opt %s -mlir-print-debuginfo | FileCheck %s
+// RUN: mlir-opt %s -mlir-print-debuginfo -mlir-parse-skip-locations | FileCheck %s --check-prefix=SKIP
+
+// CHECK-LABEL: func @file_locations()
+// CHECK-SAME: loc("{{.*}}skip-locations.mlir":[[@LINE+3]]:6)
+// SKIP-LABEL: func @file_locations()
+// SKIP-SAME: loc(unknown)
+func @file_locations() {
+  // CHECK: "foo"() : () -> () loc("{{.*}}skip-locations.mlir":[[@LINE+2]]:3)
+  // SKIP: "foo"() : () -> () loc(unknown)
+  "foo"() : () -> ()
+  // CHECK: constant 1 : index loc("{{.*}}skip-locations.mlir":[[@LINE+2]]:12)
+  // SKIP: constant 1 : index loc(unknown)
+  %c1 =    constant 1 : index
+
+  // Explicit locations are kept.
+  // CHECK: "bar"() : () -> () loc("mysource.cc":10:8)
+  // SKIP: "bar"() : () -> () loc("mysource.cc":10:8)
+  "bar"() : () -> () loc("mysource.cc":10:8)
+
+  // CHECK: return loc("{{.*}}skip-locations.mlir":[[@LINE+2]]:3)
+  // SKIP: return loc(unknown)
+  return
+}
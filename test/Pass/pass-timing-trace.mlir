@@ -0,0 +1,24 @@
+// RUN: mlir-opt %s -verify-each=false -cse -pass-timing -pass-timing-display=trace 2>&1 | FileCheck %s
+// RUN: mlir-opt %s -experimental-mt-pm=true -pass-threads=2 -verify-each=false -cse -pass-timing -pass-timing-display=trace 2>&1 | FileCheck %s
+
+// CHECK: "traceEvents": [
+// CHECK-DAG: "name": "thread_name"
+// CHECK-DAG: "name": "Thread 0"
+// CHECK-DAG: "ir": "module"
+// CHECK-DAG: "name": "Function Pipeline"
+// CHECK-DAG: "ir": "@foo"
+// CHECK-DAG: "ir": "@bar"
+// CHECK-DAG: "cat": "pass"
+// CHECK-DAG: "cat": "analysis"
+// CHECK-DAG: "name": "DominanceInfo"
+// CHECK-DAG: "ph": "X"
+// CHECK-DAG: "dur":
+// CHECK-DAG: "ts":
+
+func @foo() {
+  return
+}
+
+func @bar() {
+  return
+}
@@ -2,10 +2,11 @@
 // RUN: mlir-opt %s -verify-each=true -cse -canonicalize -cse -pass-timing -pass-timing-display=pipeline 2>&1 | FileCheck -check-prefix=PIPELINE %s
 // RUN: mlir-opt %s -experimental-mt-pm=true -verify-each=true -cse -canonicalize -cse -pass-timing -pass-timing-display=list 2>&1 | FileCheck -check-prefix=MT_LIST %s
 // RUN: mlir-opt %s -experimental-mt-pm=true -verify-each=true -cse -canonicalize -cse -pass-timing -pass-timing-display=pipeline 2>&1 | FileCheck -check-prefix=MT_PIPELINE %s
+// RUN: mlir-opt %s -experimental-mt-pm=true -pass-threads=2 -verify-each=true -cse -canonicalize -cse -pass-timing -pass-timing-display=pipeline 2>&1 | FileCheck -check-prefix=MT_THREADS %s
 
 // LIST: Pass execution timing report
 // LIST: Total Execution Time:
-// LIST: Name
+// LIST: ---CPU Time---      ---Wall Time---  --- Name ---
 // LIST-DAG: Canonicalizer
 // LIST-DAG: FunctionVerifier
 // LIST-DAG: CSE
@@ -52,6 +53,20 @@
 // MT_PIPELINE-NEXT:   FunctionVerifier
 // MT_PIPELINE-NEXT: ModuleVerifier
 // MT_PIPELINE-NEXT: Total
+// MT_PIPELINE: Parallel Execution Time:
+// MT_PIPELINE: ---Busy Time---   ---Tasks---  ---Stolen---  --- Thread ---
+// MT_PIPELINE-NEXT: Thread 0
+
+// MT_THREADS: Pass execution timing report
+// MT_THREADS: ---CPU Time---      ---Wall Time---    --Speedup--  --Imbalance--  --- Name ---
+// MT_THREADS-NEXT: {{[0-9]+\.[0-9]+x +[0-9]+\.[0-9]%}}  Function Pipeline
+// MT_THREADS: {{1\.00x +0\.0%}}  {{.*}}ModuleVerifier
+// MT_THREADS-NEXT: Total
+// MT_THREADS: Parallel Execution Time:
+// MT_THREADS: --- Thread ---
+// MT_THREADS-NEXT: Thread 0
+// MT_THREADS-NEXT: Thread 1
+// MT_THREADS-NOT: Thread 2
 
 func @foo() {
   return
@@ -220,3 +220,28 @@ func @up_propagate_region() -> i32 {
   }
   return %0 : i32
 }
+
+// CHECK-LABEL: @commutative
+func @commutative(%a : i32, %b : i32) -> (i32, i32, i32, i32) {
+  // CHECK-NEXT: %0 = addi %arg0, %arg1 : i32
+  %0 = addi %a, %b : i32
+  %1 = addi %b, %a : i32
+
+  // CHECK-NEXT: %1 = muli %arg1, %arg0 : i32
+  %2 = muli %b, %a : i32
+  %3 = muli %a, %b : i32
+
+  // CHECK-NEXT: return %0, %0, %1, %1 : i32, i32, i32, i32
+  return %0, %1, %2, %3 : i32, i32, i32, i32
+}
+
+// CHECK-LABEL: @non_commutative
+func @non_commutative(%a : i32, %b : i32) -> (i32, i32) {
+  // CHECK-NEXT: %0 = subi %arg0, %arg1 : i32
+  %0 = subi %a, %b : i32
+  // CHECK-NEXT: %1 = subi %arg1, %arg0 : i32
+  %1 = subi %b, %a : i32
+
+  // CHECK-NEXT: return %0, %1 : i32, i32
+  return %0, %1 : i32, i32
+}
@@ -0,0 +1,53 @@
+// RUN: mlir-opt %s -test-emptiness-check -split-input-file -verify
+
+// The systems of the dependence and region checks of the existing tests. Both
+// procedures must agree on all of them.
+// RUN: mlir-opt %S/dma-generate.mlir -test-emptiness-check -split-input-file -o /dev/null
+// RUN: mlir-opt %S/loop-fusion.mlir -test-emptiness-check -split-input-file -o /dev/null
+// RUN: mlir-opt %S/loop-invariant-code-motion.mlir -test-emptiness-check -split-input-file -o /dev/null
+// RUN: mlir-opt %S/loop-tiling.mlir -test-emptiness-check -split-input-file -o /dev/null
+// RUN: mlir-opt %S/memref-bound-check.mlir -test-emptiness-check -split-input-file -o /dev/null
+// RUN: mlir-opt %S/memref-dataflow-opt.mlir -test-emptiness-check -split-input-file -o /dev/null
+// RUN: mlir-opt %S/memref-dependence-check.mlir -test-emptiness-check -split-input-file -o /dev/null
+// RUN: mlir-opt %S/parallelism-detection.mlir -test-emptiness-check -split-input-file -o /dev/null
+// RUN: mlir-opt %S/pipeline-data-transfer.mlir -test-emptiness-check -split-input-file -o /dev/null
+// RUN: mlir-opt %S/unroll.mlir -test-emptiness-check -split-input-file -o /dev/null
+// RUN: mlir-opt %S/../AffineOps/canonicalize.mlir -test-emptiness-check -split-input-file -o /dev/null
+
+// Even and odd elements are disjoint, so only the accesses to the same element
+// in the same iteration depend on each other.
+func @even_odd() {
+// expected-note@-1 {{10 constraint systems, 6 empty by Fourier-Motzkin, 6 empty by the simplex}}
+  %m = alloc() : memref<20xf32>
+  %cf0 = constant 0.0 : f32
+  affine.for %i = 0 to 10 {
+    %a0 = affine.apply (d0) -> (d0 * 2) (%i)
+    store %cf0, %m[%a0] : memref<20xf32>
+    %a1 = affine.apply (d0) -> (d0 * 2 + 1) (%i)
+    %v = load %m[%a1] : memref<20xf32>
+  }
+  return
+}
+
+// -----
+
+// Accesses to disjoint ranges only depend on themselves, in the same iteration.
+func @disjoint_ranges() {
+// expected-note@-1 {{10 constraint systems, 6 empty by Fourier-Motzkin, 6 empty by the simplex}}
+  %m = alloc() : memref<100xf32>
+  %cf0 = constant 0.0 : f32
+  affine.for %i = 0 to 50 {
+    store %cf0, %m[%i] : memref<100xf32>
+    %a = affine.apply (d0) -> (d0 + 50) (%i)
+    %v = load %m[%a] : memref<100xf32>
+  }
+  return
+}
+
+// -----
+
+// Functions without supported accesses are skipped.
+func @no_accesses(%m : memref<f32>) {
+  %v = load %m[] : memref<f32>
+  return
+}
@@ -0,0 +1,103 @@
+// RUN: mlir-opt %s -affine-loop-invariant-code-motion | FileCheck %s
+
+// CHECK-LABEL: func @hoist_chain
+func @hoist_chain(%arg0: index, %arg1: index) {
+  %m = alloc() : memref<10xindex>
+  // CHECK:      %1 = addi %arg0, %arg1 : index
+  // CHECK-NEXT: %2 = muli %1, %1 : index
+  // CHECK-NEXT: affine.for %i0 = 0 to 10 {
+  // CHECK-NEXT:   store %2, %0[%i0] : memref<10xindex>
+  // CHECK-NEXT: }
+  affine.for %i0 = 0 to 10 {
+    %0 = addi %arg0, %arg1 : index
+    %1 = muli %0, %0 : index
+    store %1, %m[%i0] : memref<10xindex>
+  }
+  return
+}
+
+// CHECK-LABEL: func @nested
+func @nested(%arg0: index) {
+  %m = alloc() : memref<10x10xindex>
+  // CHECK:      %c1 = constant 1 : index
+  // CHECK-NEXT: %1 = addi %arg0, %c1 : index
+  // CHECK-NEXT: affine.for %i0 = 0 to 10 {
+  // CHECK-NEXT:   %2 = addi %i0, %1 : index
+  // CHECK-NEXT:   affine.for %i1 = 0 to 10 {
+  // CHECK-NEXT:     store %2, %0[%i0, %i1] : memref<10x10xindex>
+  affine.for %i0 = 0 to 10 {
+    affine.for %i1 = 0 to 10 {
+      %c1 = constant 1 : index
+      %0 = addi %arg0, %c1 : index
+      %1 = addi %i0, %0 : index
+      store %1, %m[%i0, %i1] : memref<10x10xindex>
+    }
+  }
+  return
+}
+
+// CHECK-LABEL: func @not_hoisted
+func @not_hoisted(%arg0: index) {
+  %m = alloc() : memref<10xindex>
+  // CHECK:      affine.for %i0 = 0 to 10 {
+  // CHECK-NEXT:   %1 = load %0[%arg0] : memref<10xindex>
+  // CHECK-NEXT:   store %arg0, %0[%i0] : memref<10xindex>
+  // CHECK-NEXT:   %2 = addi %i0, %arg0 : index
+  // CHECK-NEXT:   affine.if #set0(%i0)
+  // CHECK-NEXT:     %3 = addi %arg0, %arg0 : index
+  affine.for %i0 = 0 to 10 {
+    // Operations with side effects, operations using the induction variable,
+    // and operations nested in other regions stay in the loop.
+    %0 = load %m[%arg0] : memref<10xindex>
+    store %arg0, %m[%i0] : memref<10xindex>
+    %1 = addi %i0, %arg0 : index
+    affine.if (d0) : (d0 - 5 >= 0)(%i0) {
+      %2 = addi %arg0, %arg0 : index
+    }
+  }
+  return
+}
+
+// CHECK-LABEL: func @hoist_trapping
+func @hoist_trapping(%arg0: index, %arg1: index) {
+  %m = alloc() : memref<10xindex>
+  // CHECK:      %1 = divis %arg0, %arg1 : index
+  // CHECK-NEXT: %2 = remis %arg0, %arg1 : index
+  // CHECK-NEXT: affine.for %i0 = 0 to 10 {
+  affine.for %i0 = 0 to 10 {
+    // The loop runs at least once, so the divisions are executed anyway.
+    %0 = divis %arg0, %arg1 : index
+    %1 = remis %arg0, %arg1 : index
+    store %0, %m[%i0] : memref<10xindex>
+    store %1, %m[%i0] : memref<10xindex>
+  }
+  return
+}
+
+// CHECK-LABEL: func @not_hoisted_trapping
+func @not_hoisted_trapping(%arg0: index, %arg1: index, %n: index) {
+  %m = alloc() : memref<10xindex>
+  // CHECK:      affine.for %i0 = 0 to 0 {
+  // CHECK-NEXT:   %1 = divis %arg0, %arg1 : index
+  // CHECK-NEXT:   %2 = remiu %arg0, %arg1 : index
+  affine.for %i0 = 0 to 0 {
+    // Operations that may trap stay in loops that may not run, here a loop
+    // without iterations.
+    %0 = divis %arg0, %arg1 : index
+    %1 = remiu %arg0, %arg1 : index
+    store %0, %m[%i0] : memref<10xindex>
+    store %1, %m[%i0] : memref<10xindex>
+  }
+  // CHECK:      %3 = addi %arg0, %arg1 : index
+  // CHECK-NEXT: affine.for %i1 = 0 to %arg2 {
+  // CHECK-NEXT:   %4 = diviu %arg0, %arg1 : index
+  affine.for %i1 = 0 to %n {
+    // A loop with a symbolic bound is not known to run either, but the
+    // operations that can't trap are still hoisted.
+    %2 = addi %arg0, %arg1 : index
+    %3 = diviu %arg0, %arg1 : index
+    store %2, %m[%i1] : memref<10xindex>
+    store %3, %m[%i1] : memref<10xindex>
+  }
+  return
+}
@@ -652,6 +652,29 @@ func @mod_deps() {
   return
 }
 
+// -----
+// The subscripts of the store and the load range over [0, 3] and [4, 7].
+// CHECK-LABEL: func @disjoint_subscript_ranges() {
+func @disjoint_subscript_ranges() {
+  %m = alloc() : memref<100xf32>
+  %c7 = constant 7.0 : f32
+  affine.for %i0 = 0 to 10 {
+    %a0 = affine.apply (d0) -> (d0 mod 4) (%i0)
+    store %c7, %m[%a0] : memref<100xf32>
+    // expected-note@-1 {{dependence from 0 to 0 at depth 1 = [4, 9]}}
+    // expected-note@-2 {{dependence from 0 to 0 at depth 2 = false}}
+    // expected-note@-3 {{dependence from 0 to 1 at depth 1 = false}}
+  }
+  affine.for %i1 = 0 to 8 {
+    %a1 = affine.apply (d0) -> (d0 floordiv 2 + 4) (%i1)
+    %v0 = load %m[%a1] : memref<100xf32>
+    // expected-note@-1 {{dependence from 1 to 0 at depth 1 = false}}
+    // expected-note@-2 {{dependence from 1 to 1 at depth 1 = false}}
+    // expected-note@-3 {{dependence from 1 to 1 at depth 2 = false}}
+  }
+  return
+}
+
 // -----
 // CHECK-LABEL: func @loop_nest_depth() {
 func @loop_nest_depth() {
@@ -22,6 +22,7 @@
 //===----------------------------------------------------------------------===//
 
 #include "mlir/Analysis/Passes.h"
+#include "mlir/Bytecode/Bytecode.h"
 #include "mlir/IR/Attributes.h"
 #include "mlir/IR/Function.h"
 #include "mlir/IR/Location.h"
@@ -68,6 +69,17 @@ static cl::opt<bool>
                  cl::desc("Run the verifier after each transformation pass"),
                  cl::init(true));
 
+static cl::opt<bool> printContextStats(
+    "print-context-stats",
+    cl::desc("Print the memory usage and uniquing table statistics of the "
+             "MLIRContext to stderr after processing each input"),
+    cl::init(false));
+
+static cl::opt<bool>
+    emitBytecode("emit-bytecode",
+                 cl::desc("Write the output module in the bytecode format"),
+                 cl::init(false));
+
 static std::vector<const mlir::PassRegistryEntry *> *passList;
 
 enum OptResult { OptSuccess, OptFailure };
@@ -121,7 +133,13 @@ static SMLoc getLocFromLineAndCol(MemoryBuffer &membuf, unsigned lineNo,
 /// passes, then prints the output.
 ///
 static OptResult performActions(SourceMgr &sourceMgr, MLIRContext *context) {
-  std::unique_ptr<Module> module(parseSourceFile(sourceMgr, context));
+  // The input is either in the textual form or in the bytecode format.
+  std::unique_ptr<Module> module;
+  auto *mainBuffer = sourceMgr.getMemoryBuffer(sourceMgr.getMainFileID());
+  if (isBytecode(mainBuffer->getBuffer()))
+    module.reset(parseBytecode(*mainBuffer, context));
+  else
+    module.reset(parseSourceFile(sourceMgr, context));
   if (!module)
     return OptFailure;
 
@@ -145,8 +163,14 @@ static OptResult performActions(SourceMgr &sourceMgr, MLIRContext *context) {
   }
 
   // Print the output.
-  module->print(output->os());
+  if (emitBytecode)
+    writeBytecode(module.get(), output->os());
+  else
+    module->print(output->os());
   output->keep();
+
+  if (printContextStats)
+    context->printMemoryUsage(llvm::errs());
   return OptSuccess;
 }
 
@@ -0,0 +1,228 @@
+//===- AffineStructuresTest.cpp - FlatAffineConstraints unit tests --------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/Analysis/AffineStructures.h"
+#include "mlir/Analysis/Simplex.h"
+#include "gtest/gtest.h"
+
+using namespace mlir;
+
+using EmptinessCheck = FlatAffineConstraints::EmptinessCheck;
+
+namespace {
+/// Build a system of 'numIds' dimensions from the given constraints, whose
+/// last coefficient is the constant term.
+FlatAffineConstraints makeSystem(unsigned numIds,
+                                 ArrayRef<SmallVector<int64_t, 4>> ineqs,
+                                 ArrayRef<SmallVector<int64_t, 4>> eqs = {}) {
+  FlatAffineConstraints cst(numIds);
+  for (auto &ineq : ineqs)
+    cst.addInequality(ineq);
+  for (auto &eq : eqs)
+    cst.addEquality(eq);
+  return cst;
+}
+
+/// Returns true if the system has no integer point in the box [-bound, bound]
+/// on every identifier, by enumerating the points of the box.
+bool isEmptyInBox(const FlatAffineConstraints &cst, int64_t bound) {
+  unsigned numIds = cst.getNumIds();
+  SmallVector<int64_t, 4> point(numIds, -bound);
+  auto evaluate = [&](ArrayRef<int64_t> coeffs) {
+    int64_t value = coeffs[numIds];
+    for (unsigned i = 0; i < numIds; ++i)
+      value += coeffs[i] * point[i];
+    return value;
+  };
+  while (true) {
+    bool satisfied = true;
+    for (unsigned r = 0, e = cst.getNumInequalities(); r < e && satisfied; ++r)
+      satisfied = evaluate(cst.getInequality(r)) >= 0;
+    for (unsigned r = 0, e = cst.getNumEqualities(); r < e && satisfied; ++r)
+      satisfied = evaluate(cst.getEquality(r)) == 0;
+    if (satisfied)
+      return false;
+
+    // Move to the next point of the box.
+    unsigned i = 0;
+    while (i < numIds && point[i] == bound)
+      point[i++] = -bound;
+    if (i == numIds)
+      return true;
+    ++point[i];
+  }
+}
+} // end anonymous namespace
+
+TEST(AffineStructuresTest, SimplexRationalAndIntegerEmptiness) {
+  // x >= 1, y >= 1, x + y <= 1 has no rational solution.
+  auto triangle = makeSystem(2, {{1, 0, -1}, {0, 1, -1}, {-1, -1, 1}});
+  EXPECT_EQ(Simplex(triangle).isRationalEmpty(), Simplex::Result::Empty);
+
+  // 1 <= 2x <= 1 has a rational solution, but tightening the inequalities on
+  // integers gives 1 <= x <= 0.
+  auto halfInteger = makeSystem(1, {{2, -1}, {-2, 1}});
+  EXPECT_EQ(Simplex(halfInteger).isRationalEmpty(), Simplex::Result::Empty);
+
+  // 9 <= 4x + 8y <= 11 with x = 4z only has rational solutions, which the
+  // tightening sees once x is substituted.
+  auto substituted = makeSystem(3, {{4, 8, 0, -9}, {-4, -8, 0, 11}},
+                                {{1, 0, -4, 0}});
+  EXPECT_EQ(Simplex(substituted).isRationalEmpty(), Simplex::Result::Empty);
+
+  // 27 <= 11x + 13y <= 45 and -10 <= 7x - 9y <= 4 has rational solutions but
+  // no integer ones, which takes branch and bound to prove.
+  auto pugh = makeSystem(
+      2, {{11, 13, -27}, {-11, -13, 45}, {7, -9, 10}, {-7, 9, 4}});
+  EXPECT_EQ(Simplex(pugh).isRationalEmpty(), Simplex::Result::NonEmpty);
+  EXPECT_EQ(Simplex(pugh).isIntegerEmpty(), Simplex::Result::Empty);
+  EXPECT_TRUE(isEmptyInBox(pugh, 10));
+
+  // An unbounded set: x - y >= 3 with equality 2x = 4y + 6.
+  auto unbounded = makeSystem(2, {{1, -1, -3}}, {{2, -4, -6}});
+  EXPECT_EQ(Simplex(unbounded).isIntegerEmpty(), Simplex::Result::NonEmpty);
+}
+
+TEST(AffineStructuresTest, SimplexIsExactOnIntegers) {
+  // Elimination only decides the emptiness of the rational set.
+  auto cst = makeSystem(
+      2, {{11, 13, -27}, {-11, -13, 45}, {7, -9, 10}, {-7, 9, 4}});
+  EXPECT_FALSE(cst.isEmpty(EmptinessCheck::FourierMotzkin));
+  EXPECT_TRUE(cst.isEmpty(EmptinessCheck::Simplex));
+}
+
+TEST(AffineStructuresTest, SimplexAgreesWithEnumeration) {
+  // Generate pseudo-random systems in a box, and check the simplex against
+  // the enumeration of the box. Elimination, which is only exact on rational
+  // sets, must never find a system empty that the simplex finds non-empty.
+  const int64_t bound = 4;
+  unsigned seed = 1;
+  auto next = [&](int64_t range) {
+    seed = seed * 1103515245 + 12345;
+    return static_cast<int64_t>((seed >> 8) % (2 * range + 1)) - range;
+  };
+  for (unsigned test = 0; test != 300; ++test) {
+    unsigned numIds = 1 + test % 3;
+    FlatAffineConstraints cst(numIds);
+    for (unsigned i = 0; i < numIds; ++i) {
+      SmallVector<int64_t, 4> lb(numIds + 1, 0), ub(numIds + 1, 0);
+      lb[i] = 1;
+      lb[numIds] = bound;
+      ub[i] = -1;
+      ub[numIds] = bound;
+      cst.addInequality(lb);
+      cst.addInequality(ub);
+    }
+    for (unsigned r = 0, e = 1 + test % 4; r < e; ++r) {
+      SmallVector<int64_t, 4> coeffs;
+      for (unsigned i = 0; i < numIds; ++i)
+        coeffs.push_back(next(5));
+      coeffs.push_back(next(8));
+      if (r == 0 && test % 5 == 0)
+        cst.addEquality(coeffs);
+      else
+        cst.addInequality(coeffs);
+    }
+
+    bool empty = isEmptyInBox(cst, bound);
+    EXPECT_EQ(cst.isEmpty(EmptinessCheck::Simplex), empty);
+    if (cst.isEmpty(EmptinessCheck::FourierMotzkin)) {
+      EXPECT_TRUE(empty);
+    }
+  }
+}
+
+TEST(AffineStructuresTest, RemoveRedundantInequalities) {
+  // 0 <= x <= 10, 0 <= y <= 10, x + y <= 30: the last one is redundant.
+  auto cst = makeSystem(2, {{1, 0, 0},
+                            {-1, 0, 10},
+                            {0, 1, 0},
+                            {0, -1, 10},
+                            {-1, -1, 30}});
+  for (auto check : {EmptinessCheck::FourierMotzkin, EmptinessCheck::Simplex}) {
+    FlatAffineConstraints tmpCst(cst);
+    tmpCst.removeRedundantInequalities(check);
+    EXPECT_EQ(tmpCst.getNumInequalities(), 4u);
+  }
+
+  // 2x >= 1 and x <= 5 imply x >= 1 on integers, but not on rationals.
+  auto integerCst = makeSystem(1, {{2, -1}, {-1, 5}, {1, -1}});
+  FlatAffineConstraints tmpCst(integerCst);
+  tmpCst.removeRedundantInequalities(EmptinessCheck::Simplex);
+  EXPECT_EQ(tmpCst.getNumInequalities(), 2u);
+}
+
+TEST(AffineStructuresTest, EliminationWithLargeCoefficients) {
+  // a * x = c * y, c * x + c * z + c = 0, 0 <= y <= a - 1 and z >= 0, with
+  // coprime a and c of about 2^40. Eliminating x from the second equality
+  // multiplies it by a, giving coefficients of about 2^80 that fit back in
+  // int64_t once divided by their gcd c.
+  const int64_t a = (1LL << 40) + 1, c = (1LL << 40) + 3;
+  auto cst = makeSystem(3, {{0, 1, 0, 0}, {0, -1, 0, a - 1}, {0, 0, 1, 0}},
+                        {{a, -c, 0, 0}, {c, 0, c, c}});
+  EXPECT_TRUE(cst.isEmpty());
+
+  // Without the bound on z, x = y = 0 and z = -1 is a solution.
+  auto nonEmpty =
+      makeSystem(3, {{0, 1, 0, 0}, {0, -1, 0, a - 1}}, {{a, -c, 0, 0},
+                                                         {c, 0, c, c}});
+  EXPECT_FALSE(nonEmpty.isEmpty());
+}
+
+TEST(AffineStructuresTest, EliminationDropsOverflowingConstraints) {
+  // Eliminating x from a * x + c * y >= 0 and -c * x + a * z >= 0 gives
+  // c^2 * y + a^2 * z >= 0, which doesn't fit in int64_t. The constraint is
+  // dropped, so the result still contains the projections of the points of
+  // the original set, unlike what wrapping around would give.
+  const int64_t a = (1LL << 40) + 1, c = (1LL << 40) + 3;
+  auto cst = makeSystem(3, {{a, c, 0, 0}, {-c, 0, a, 0}});
+  cst.projectOut(/*pos=*/0u);
+  ASSERT_EQ(cst.getNumIds(), 2u);
+  SmallVector<int64_t, 4> points[] = {{0, 0, 0}, {0, 5, 1}, {2, -1, 3}};
+  for (auto &point : points) {
+    ASSERT_GE(a * point[0] + c * point[1], 0);
+    ASSERT_GE(-c * point[0] + a * point[2], 0);
+    for (unsigned r = 0, e = cst.getNumInequalities(); r < e; ++r) {
+      auto ineq = cst.getInequality(r);
+      EXPECT_GE(ineq[0] * point[1] + ineq[1] * point[2] + ineq[2], 0);
+    }
+  }
+}
+
+TEST(AffineStructuresTest, GCDOfMinimumCoefficients) {
+  // The gcd of the coefficients of -2^63 * x + c is 2^63, which doesn't fit
+  // in int64_t. Projecting out y tightens and normalizes the constraints.
+  auto cst = makeSystem(2, {{INT64_MIN, 0, 5}, {INT64_MIN, 0, 0}});
+  cst.projectOut(/*pos=*/1u);
+  ASSERT_EQ(cst.getNumInequalities(), 2u);
+  EXPECT_EQ(cst.getInequality(0), ArrayRef<int64_t>({INT64_MIN, 5}));
+  EXPECT_EQ(cst.getInequality(1), ArrayRef<int64_t>({-1, 0}));
+
+  EXPECT_FALSE(makeSystem(1, {}, {{INT64_MIN, INT64_MIN}}).isEmptyByGCDTest());
+  EXPECT_TRUE(makeSystem(1, {}, {{INT64_MIN, 1}}).isEmptyByGCDTest());
+}
+
+TEST(AffineStructuresTest, EmptinessWithOverflowingConstraints) {
+  // An empty set, whose elimination produces constraints that don't fit in
+  // int64_t even after normalization. Dropping them isn't enough to find
+  // that the set is empty, which takes the slow path on wide integers.
+  auto cst = makeSystem(2, {{206158431990, 3, -776},
+                            {-171798691864, -17179869316, -855},
+                            {3, 68719477650, -6},
+                            {206158431324, 3, -201}});
+  EXPECT_TRUE(cst.isEmpty());
+}
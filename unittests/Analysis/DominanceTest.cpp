@@ -0,0 +1,174 @@
+//===- DominanceTest.cpp - Dominance unit tests ---------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/Analysis/Dominance.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Function.h"
+#include "gtest/gtest.h"
+
+using namespace mlir;
+
+namespace {
+/// A fixture holding a function whose blocks are terminated by unregistered
+/// branch operations, so that the CFG can be rewired freely.
+class DominanceTest : public ::testing::Test {
+protected:
+  DominanceTest()
+      : builder(&context),
+        function(new Function(builder.getUnknownLoc(), "test",
+                              builder.getFunctionType(llvm::None,
+                                                      llvm::None))) {}
+
+  /// Append 'numBlocks' blocks to the function, returning them.
+  std::vector<Block *> addBlocks(unsigned numBlocks) {
+    std::vector<Block *> blocks;
+    for (unsigned i = 0; i != numBlocks; ++i) {
+      blocks.push_back(new Block());
+      function->push_back(blocks.back());
+      setSuccessors(blocks.back(), {});
+    }
+    return blocks;
+  }
+
+  /// Replace the terminator of 'block' by a branch to 'successors'.
+  void setSuccessors(Block *block, ArrayRef<Block *> successors) {
+    if (!block->empty())
+      block->back().erase();
+
+    // The operand lists of the successors are separated by null operands.
+    SmallVector<Value *, 2> operands(successors.size(), nullptr);
+    block->push_back(Operation::create(
+        builder.getUnknownLoc(), OperationName("test.br", &context), operands,
+        /*resultTypes=*/llvm::None, /*attributes=*/llvm::None, successors,
+        /*numRegions=*/0,
+        /*resizableOperandList=*/false, &context));
+  }
+
+  /// Check that the given dominance info matches that computed from scratch.
+  void expectUpToDate(DominanceInfo &domInfo, PostDominanceInfo &postDomInfo) {
+    DominanceInfo freshDomInfo(function.get());
+    PostDominanceInfo freshPostDomInfo(function.get());
+    for (auto &a : *function) {
+      for (auto &b : *function) {
+        EXPECT_EQ(domInfo.properlyDominates(&a, &b),
+                  freshDomInfo.properlyDominates(&a, &b));
+        EXPECT_EQ(postDomInfo.properlyPostDominates(&a, &b),
+                  freshPostDomInfo.properlyPostDominates(&a, &b));
+      }
+    }
+  }
+
+  MLIRContext context;
+  Builder builder;
+  std::unique_ptr<Function> function;
+};
+} // end anonymous namespace
+
+TEST_F(DominanceTest, InsertEdge) {
+  // 0 -> 1 -> 2, then insert 0 -> 2 and an edge to a new block 3.
+  auto blocks = addBlocks(3);
+  setSuccessors(blocks[0], {blocks[1]});
+  setSuccessors(blocks[1], {blocks[2]});
+
+  DominanceInfo domInfo(function.get());
+  PostDominanceInfo postDomInfo(function.get());
+  EXPECT_TRUE(domInfo.properlyDominates(blocks[1], blocks[2]));
+
+  setSuccessors(blocks[0], {blocks[1], blocks[2]});
+  domInfo.insertEdge(blocks[0], blocks[2]);
+  postDomInfo.insertEdge(blocks[0], blocks[2]);
+  EXPECT_FALSE(domInfo.properlyDominates(blocks[1], blocks[2]));
+  expectUpToDate(domInfo, postDomInfo);
+
+  blocks.push_back(addBlocks(1).front());
+  setSuccessors(blocks[1], {blocks[2], blocks[3]});
+  domInfo.insertEdge(blocks[1], blocks[3]);
+  postDomInfo.insertEdge(blocks[1], blocks[3]);
+  EXPECT_TRUE(domInfo.properlyDominates(blocks[1], blocks[3]));
+  expectUpToDate(domInfo, postDomInfo);
+}
+
+TEST_F(DominanceTest, DeleteEdge) {
+  // A diamond 0 -> {1, 2} -> 3, then delete 2 -> 3.
+  auto blocks = addBlocks(4);
+  setSuccessors(blocks[0], {blocks[1], blocks[2]});
+  setSuccessors(blocks[1], {blocks[3]});
+  setSuccessors(blocks[2], {blocks[3]});
+
+  DominanceInfo domInfo(function.get());
+  PostDominanceInfo postDomInfo(function.get());
+  EXPECT_FALSE(domInfo.properlyDominates(blocks[1], blocks[3]));
+
+  setSuccessors(blocks[2], {});
+  domInfo.deleteEdge(blocks[2], blocks[3]);
+  postDomInfo.deleteEdge(blocks[2], blocks[3]);
+  EXPECT_TRUE(domInfo.properlyDominates(blocks[1], blocks[3]));
+  expectUpToDate(domInfo, postDomInfo);
+
+  // Make block 1 unreachable.
+  setSuccessors(blocks[0], {blocks[2]});
+  domInfo.deleteEdge(blocks[0], blocks[1]);
+  postDomInfo.deleteEdge(blocks[0], blocks[1]);
+  expectUpToDate(domInfo, postDomInfo);
+}
+
+TEST_F(DominanceTest, SplitBlock) {
+  // 0 -> 1 -> {2, 3} -> 4 -> 5, then split 1 and 4.
+  auto blocks = addBlocks(6);
+  setSuccessors(blocks[0], {blocks[1]});
+  setSuccessors(blocks[1], {blocks[2], blocks[3]});
+  setSuccessors(blocks[2], {blocks[4]});
+  setSuccessors(blocks[3], {blocks[4]});
+  setSuccessors(blocks[4], {blocks[5]});
+
+  DominanceInfo domInfo(function.get());
+  PostDominanceInfo postDomInfo(function.get());
+
+  for (auto *block : {blocks[1], blocks[4]}) {
+    auto *newBlock = block->splitBlock(&block->back());
+    setSuccessors(block, {newBlock});
+    domInfo.splitBlock(block, newBlock);
+    postDomInfo.splitBlock(block, newBlock);
+    EXPECT_TRUE(domInfo.properlyDominates(block, newBlock));
+    EXPECT_TRUE(postDomInfo.properlyPostDominates(newBlock, block));
+    expectUpToDate(domInfo, postDomInfo);
+  }
+
+  // Split the exit block.
+  auto *newBlock = blocks[5]->splitBlock(&blocks[5]->back());
+  setSuccessors(blocks[5], {newBlock});
+  domInfo.splitBlock(blocks[5], newBlock);
+  postDomInfo.splitBlock(blocks[5], newBlock);
+  expectUpToDate(domInfo, postDomInfo);
+}
+
+TEST_F(DominanceTest, RecalculateRegion) {
+  auto blocks = addBlocks(2);
+  setSuccessors(blocks[0], {blocks[1]});
+
+  DominanceInfo domInfo(function.get());
+  PostDominanceInfo postDomInfo(function.get());
+
+  // Restructure the CFG and recalculate only the function body.
+  blocks.push_back(addBlocks(1).front());
+  setSuccessors(blocks[0], {blocks[2]});
+  setSuccessors(blocks[2], {blocks[1]});
+  domInfo.recalculate(&function->getBody());
+  postDomInfo.recalculate(&function->getBody());
+  EXPECT_TRUE(domInfo.properlyDominates(blocks[2], blocks[1]));
+  expectUpToDate(domInfo, postDomInfo);
+}
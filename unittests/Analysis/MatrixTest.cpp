@@ -0,0 +1,96 @@
+//===- MatrixTest.cpp - Matrix unit tests ---------------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/Analysis/Matrix.h"
+#include "gtest/gtest.h"
+
+using namespace mlir;
+
+TEST(MatrixTest, InsertAndRemoveColumns) {
+  // Fill a 3x2 matrix with entries 10 * row + column.
+  Matrix mat(3, 2);
+  for (unsigned r = 0; r < 3; ++r)
+    for (unsigned c = 0; c < 2; ++c)
+      mat(r, c) = 10 * r + c;
+
+  // Insert columns one at a time in the middle, past the reserved space.
+  for (unsigned i = 0; i < 9; ++i)
+    mat.insertColumns(1, 1);
+  EXPECT_EQ(mat.getNumColumns(), 11u);
+  EXPECT_GE(mat.getNumReservedColumns(), 11u);
+  EXPECT_EQ(mat.getNumReservedColumns() % Matrix::kRowAlignment, 0u);
+  for (unsigned r = 0; r < 3; ++r) {
+    EXPECT_EQ(mat(r, 0), int64_t(10 * r));
+    for (unsigned c = 1; c < 10; ++c)
+      EXPECT_EQ(mat(r, c), 0);
+    EXPECT_EQ(mat(r, 10), int64_t(10 * r + 1));
+  }
+
+  mat.removeColumns(0, 10);
+  EXPECT_EQ(mat.getNumColumns(), 1u);
+  for (unsigned r = 0; r < 3; ++r)
+    EXPECT_EQ(mat(r, 0), int64_t(10 * r + 1));
+
+  // Columns appended after a removal must be zero.
+  mat.resizeHorizontally(3);
+  for (unsigned r = 0; r < 3; ++r) {
+    EXPECT_EQ(mat(r, 1), 0);
+    EXPECT_EQ(mat(r, 2), 0);
+  }
+}
+
+TEST(MatrixTest, AppendAndRemoveRows) {
+  Matrix mat(0, 3);
+  for (int64_t i = 0; i < 5; ++i)
+    mat.appendRow({i, i + 1, i + 2});
+  mat.removeRow(1);
+  mat.copyRow(3, 0);
+  mat.resizeVertically(3);
+  ASSERT_EQ(mat.getNumRows(), 3u);
+  EXPECT_EQ(mat.getRow(0), ArrayRef<int64_t>({4, 5, 6}));
+  EXPECT_EQ(mat.getRow(1), ArrayRef<int64_t>({2, 3, 4}));
+  EXPECT_EQ(mat.getRow(2), ArrayRef<int64_t>({3, 4, 5}));
+
+  unsigned pos = mat.appendExtraRow();
+  EXPECT_EQ(mat.getRow(pos), ArrayRef<int64_t>({0, 0, 0}));
+}
+
+TEST(MatrixTest, RowOperations) {
+  SmallVector<int64_t, 8> row = {-24, 0, 36, 12, -(3LL << 60)};
+  uint64_t gcd = getGCDOfAbsValues(row);
+  EXPECT_EQ(gcd, 12u);
+  divideExactly(row, gcd);
+  EXPECT_EQ(row, (SmallVector<int64_t, 8>{-2, 0, 3, 1, -(1LL << 58)}));
+  EXPECT_EQ(getGCDOfAbsValues({0, 0}), 0u);
+
+  // The gcd of a row whose only nonzero entries are INT64_MIN is 2^63.
+  SmallVector<int64_t, 4> minRow = {INT64_MIN, 0, INT64_MIN};
+  uint64_t minGCD = getGCDOfAbsValues(minRow);
+  EXPECT_EQ(minGCD, 1ULL << 63);
+  divideExactly(minRow, minGCD);
+  EXPECT_EQ(minRow, (SmallVector<int64_t, 4>{-1, 0, -1}));
+
+  SmallVector<int64_t, 4> lhs = {1, -2, 3}, rhs = {4, 5, -6};
+  EXPECT_TRUE(combineRows(2, lhs, -3, rhs, lhs));
+  EXPECT_EQ(lhs, (SmallVector<int64_t, 4>{-10, -19, 24}));
+
+  // Large magnitudes are refused, even when the result would fit.
+  SmallVector<int64_t, 4> large = {INT64_MAX, 0, 1}, result(3, 7);
+  EXPECT_FALSE(combineRows(1, large, 1, rhs, result));
+  EXPECT_EQ(result, (SmallVector<int64_t, 4>{7, 7, 7}));
+  EXPECT_FALSE(combineRows(INT64_MIN, rhs, 0, rhs, result));
+}
@@ -0,0 +1,215 @@
+//===- BytecodeReaderTest.cpp - Bytecode reader tests ---------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "../../lib/Bytecode/BytecodeDetail.h"
+#include "mlir/Bytecode/Bytecode.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/Module.h"
+#include "mlir/Parser.h"
+#include "llvm/Support/LEB128.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "gtest/gtest.h"
+
+using namespace mlir;
+
+namespace {
+/// A module with external functions, functions that call one another, and
+/// values used before they are defined.
+const char *kModule = R"mlir(
+func @external(i32) -> i32
+
+func @callee(%arg0: i32) -> i32 {
+  %0 = "test.op"(%arg0) : (i32) -> i32
+  "test.return"(%0) : (i32) -> ()
+}
+
+func @caller(%arg0: i1, %arg1: i32) -> i32 {
+  "test.br"(%arg0)[^bb2] : (i1) -> ()
+^bb1:
+  "test.return"(%0) : (i32) -> ()
+^bb2:
+  %0 = "test.call"(%arg1) {callee: @callee : (i32) -> i32} : (i32) -> i32
+  "test.br"()[^bb1] : () -> ()
+}
+)mlir";
+
+class BytecodeReaderTest : public ::testing::Test {
+protected:
+  BytecodeReaderTest() {
+    context.registerDiagnosticHandler(
+        [this](Location, StringRef message, MLIRContext::DiagnosticKind kind) {
+          if (kind == MLIRContext::DiagnosticKind::Error)
+            errors.push_back(message.str());
+        });
+  }
+
+  /// Returns the bytecode of the given module.
+  std::string write(Module *module) {
+    std::string bytecode;
+    llvm::raw_string_ostream os(bytecode);
+    writeBytecode(module, os);
+    return os.str();
+  }
+
+  /// Returns the bytecode of the test module.
+  std::string writeTestModule() {
+    std::unique_ptr<Module> module(parseSourceString(kModule, &context));
+    EXPECT_TRUE(module);
+    return module ? write(module.get()) : std::string();
+  }
+
+  /// Returns a reader of the given bytecode.
+  std::unique_ptr<BytecodeReader> createReader(StringRef bytecode) {
+    return llvm::make_unique<BytecodeReader>(
+        llvm::MemoryBuffer::getMemBufferCopy(bytecode), &context);
+  }
+
+  /// Read the given bytecode eagerly.
+  std::unique_ptr<Module> read(StringRef bytecode) {
+    return std::unique_ptr<Module>(createReader(bytecode)->readModule());
+  }
+
+  static std::string print(Module *module) {
+    std::string str;
+    llvm::raw_string_ostream os(str);
+    module->print(os);
+    return os.str();
+  }
+
+  MLIRContext context;
+  std::vector<std::string> errors;
+};
+} // end anonymous namespace
+
+TEST_F(BytecodeReaderTest, RoundTrip) {
+  std::unique_ptr<Module> module(parseSourceString(kModule, &context));
+  ASSERT_TRUE(module);
+  auto result = read(write(module.get()));
+  ASSERT_TRUE(result);
+  EXPECT_EQ(print(result.get()), print(module.get()));
+  EXPECT_TRUE(errors.empty());
+}
+
+TEST_F(BytecodeReaderTest, TruncatedFile) {
+  std::string bytecode = writeTestModule();
+
+  // The file ends with the body of the last function, so every proper prefix
+  // of it is malformed.
+  for (size_t size = 0; size != bytecode.size(); ++size) {
+    errors.clear();
+    EXPECT_FALSE(read(StringRef(bytecode).take_front(size))) << size;
+    EXPECT_FALSE(errors.empty()) << size;
+  }
+}
+
+TEST_F(BytecodeReaderTest, VersionMismatch) {
+  using detail::bytecode::kMagic;
+  using detail::bytecode::kVersion;
+  std::string bytecode = writeTestModule();
+  ASSERT_EQ(uint8_t(bytecode[sizeof(kMagic)]), kVersion);
+  bytecode[sizeof(kMagic)] = kVersion + 1;
+
+  EXPECT_FALSE(read(bytecode));
+  ASSERT_EQ(errors.size(), 1u);
+  EXPECT_EQ(errors[0], "malformed bytecode: unsupported version " +
+                           std::to_string(kVersion + 1) +
+                           ", expected version " + std::to_string(kVersion));
+}
+
+TEST_F(BytecodeReaderTest, OutOfRangeCount) {
+  // Replace the number of strings, which follows the header, with a count
+  // that is larger than the rest of the file.
+  size_t countOffset = sizeof(detail::bytecode::kMagic) + 1;
+  std::string bytecode = writeTestModule();
+  ASSERT_LT(uint8_t(bytecode[countOffset]), 0x80);
+
+  std::string count;
+  llvm::raw_string_ostream os(count);
+  uint64_t hugeCount = uint64_t(1) << 40;
+  llvm::encodeULEB128(hugeCount, os);
+  bytecode.replace(countOffset, 1, os.str());
+
+  EXPECT_FALSE(read(bytecode));
+  ASSERT_EQ(errors.size(), 1u);
+  EXPECT_EQ(errors[0],
+            "malformed bytecode: invalid count " + std::to_string(hugeCount));
+}
+
+TEST_F(BytecodeReaderTest, LazyMaterialization) {
+  std::string bytecode = writeTestModule();
+  auto eager = read(bytecode);
+  ASSERT_TRUE(eager);
+
+  auto reader = createReader(bytecode);
+  std::unique_ptr<Module> lazy(reader->readModule(/*lazy=*/true));
+  ASSERT_TRUE(lazy);
+
+  // Only the functions with a body are materializable, and their bodies are
+  // read on demand.
+  Function *external = lazy->getNamedFunction("external");
+  Function *callee = lazy->getNamedFunction("callee");
+  Function *caller = lazy->getNamedFunction("caller");
+  ASSERT_TRUE(external && callee && caller);
+  EXPECT_FALSE(reader->isMaterializable(external));
+  EXPECT_TRUE(reader->isMaterializable(callee));
+  EXPECT_TRUE(reader->isMaterializable(caller));
+  EXPECT_TRUE(caller->isExternal());
+
+  EXPECT_TRUE(succeeded(reader->materialize(caller)));
+  EXPECT_FALSE(reader->isMaterializable(caller));
+  EXPECT_TRUE(reader->isMaterializable(callee));
+  EXPECT_FALSE(caller->isExternal());
+
+  // Materializing twice is a no-op.
+  EXPECT_TRUE(succeeded(reader->materialize(caller)));
+  EXPECT_TRUE(succeeded(reader->materializeAll()));
+  EXPECT_FALSE(reader->isMaterializable(callee));
+
+  EXPECT_EQ(print(lazy.get()), print(eager.get()));
+  EXPECT_TRUE(errors.empty());
+}
+
+TEST_F(BytecodeReaderTest, MaterializeVerifiesBody) {
+  // Move the use of a value before its definition, which the writer accepts
+  // but the verifier rejects.
+  std::unique_ptr<Module> module(parseSourceString(kModule, &context));
+  ASSERT_TRUE(module);
+  Block &block = module->getNamedFunction("callee")->front();
+  Operation &def = block.front();
+  Operation &use = *std::next(block.begin());
+  use.moveBefore(&def);
+  std::string bytecode = write(module.get());
+
+  auto reader = createReader(bytecode);
+  std::unique_ptr<Module> lazy(reader->readModule(/*lazy=*/true));
+  ASSERT_TRUE(lazy);
+  Function *callee = lazy->getNamedFunction("callee");
+  EXPECT_TRUE(failed(reader->materialize(callee)));
+  ASSERT_EQ(errors.size(), 1u);
+  EXPECT_NE(errors[0].find("does not dominate this use"), std::string::npos);
+
+  // The invalid body is dropped.
+  EXPECT_TRUE(callee->isExternal());
+  EXPECT_FALSE(reader->isMaterializable(callee));
+
+  // The other functions can still be materialized.
+  errors.clear();
+  EXPECT_TRUE(
+      succeeded(reader->materialize(lazy->getNamedFunction("caller"))));
+  EXPECT_TRUE(errors.empty());
+}
@@ -0,0 +1,115 @@
+//===- BlockTest.cpp - Block unit tests -----------------------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/IR/Block.h"
+#include "mlir/IR/Operation.h"
+#include "gtest/gtest.h"
+
+using namespace mlir;
+
+namespace {
+Operation *createOp(MLIRContext *context) {
+  return Operation::create(UnknownLoc::get(context),
+                           OperationName("test.op", context), llvm::None,
+                           llvm::None, llvm::None, llvm::None, 0,
+                           /*resizableOperandList=*/false, context);
+}
+
+/// Check that isBeforeInBlock agrees with the order of the operations of the
+/// block, and that the ordering of the block is still valid.
+void expectOrdered(Block &block) {
+  for (auto it = block.begin(), e = block.end(); std::next(it) != e; ++it) {
+    auto *next = &*std::next(it);
+    EXPECT_TRUE(it->isBeforeInBlock(next));
+    EXPECT_FALSE(next->isBeforeInBlock(&*it));
+  }
+  EXPECT_TRUE(block.isInstOrderValid());
+  EXPECT_FALSE(block.verifyInstOrder());
+}
+} // end anonymous namespace
+
+TEST(BlockTest, InsertAtTheEnd) {
+  MLIRContext context;
+  Block block;
+  block.push_back(createOp(&context));
+  for (unsigned i = 0; i != 100; ++i) {
+    auto *op = createOp(&context);
+    block.push_back(op);
+    EXPECT_TRUE(block.front().isBeforeInBlock(op));
+  }
+  expectOrdered(block);
+}
+
+TEST(BlockTest, InsertAtTheSamePoint) {
+  MLIRContext context;
+  Block block;
+  block.push_back(createOp(&context));
+  block.push_back(createOp(&context));
+
+  // Inserting repeatedly between the same two operations exhausts the gap
+  // between their indices.
+  auto *back = &block.back();
+  for (unsigned i = 0; i != 1000; ++i) {
+    auto *op = createOp(&context);
+    block.getOperations().insert(Block::iterator(back), op);
+    EXPECT_TRUE(op->isBeforeInBlock(back));
+    EXPECT_TRUE(block.front().isBeforeInBlock(op));
+  }
+  expectOrdered(block);
+}
+
+TEST(BlockTest, InterleavedInsertAndQuery) {
+  MLIRContext context;
+  Block block;
+  std::vector<Operation *> ops;
+  for (unsigned i = 0; i != 64; ++i) {
+    ops.push_back(createOp(&context));
+    block.push_back(ops.back());
+  }
+
+  // Insert operations at pseudo-random positions, each followed by a query.
+  unsigned seed = 1;
+  for (unsigned i = 0; i != 2000; ++i) {
+    seed = seed * 1103515245 + 12345;
+    auto *before = ops[(seed >> 8) % ops.size()];
+    auto *op = createOp(&context);
+    block.getOperations().insert(Block::iterator(before), op);
+    ops.push_back(op);
+    EXPECT_TRUE(op->isBeforeInBlock(before));
+    EXPECT_FALSE(before->isBeforeInBlock(op));
+  }
+  expectOrdered(block);
+}
+
+TEST(BlockTest, MoveWithinBlock) {
+  MLIRContext context;
+  Block block;
+  for (unsigned i = 0; i != 16; ++i)
+    block.push_back(createOp(&context));
+  expectOrdered(block);
+
+  // Move the last half of the block in front of the first operation.
+  auto *front = &block.front(), *middle = &*std::next(block.begin(), 8);
+  block.getOperations().splice(Block::iterator(front), block.getOperations(),
+                               Block::iterator(middle), block.end());
+  EXPECT_TRUE(middle->isBeforeInBlock(front));
+  expectOrdered(block);
+
+  front->moveBefore(&block.back());
+  EXPECT_TRUE(front->isBeforeInBlock(&block.back()));
+  expectOrdered(block);
+}
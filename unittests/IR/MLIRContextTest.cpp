@@ -0,0 +1,127 @@
+//===- MLIRContextTest.cpp - MLIRContext unit tests -----------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/IR/MLIRContext.h"
+#include "mlir/IR/AffineExpr.h"
+#include "mlir/IR/Attributes.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Identifier.h"
+#include "mlir/IR/StandardTypes.h"
+#include "gtest/gtest.h"
+#include <thread>
+
+using namespace mlir;
+
+namespace {
+/// The uniqued instances created by a single thread.
+struct UniquedInstances {
+  std::vector<Type> types;
+  std::vector<Attribute> attrs;
+  std::vector<AffineExpr> exprs;
+  std::vector<Identifier> identifiers;
+};
+
+/// Get or create a set of uniqued instances of different kinds.
+void getOrCreateInstances(MLIRContext *context, UniquedInstances &instances) {
+  Builder builder(context);
+  for (int64_t i = 1; i <= 64; ++i) {
+    auto type = builder.getIntegerType(i);
+    instances.types.push_back(type);
+    instances.types.push_back(builder.getVectorType({4, i}, type));
+    instances.attrs.push_back(builder.getIntegerAttr(type, i));
+    instances.attrs.push_back(builder.getStringAttr(("str" + Twine(i)).str()));
+    instances.exprs.push_back(builder.getAffineDimExpr(i) +
+                              builder.getAffineConstantExpr(i));
+    instances.identifiers.push_back(builder.getIdentifier(("id" + Twine(i)).str()));
+  }
+}
+
+TEST(MLIRContextTest, ConcurrentUniquing) {
+  MLIRContext context;
+
+  // Race several threads uniquing the same instances.
+  const unsigned numThreads = 8;
+  std::vector<UniquedInstances> threadInstances(numThreads);
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i != numThreads; ++i)
+    threads.emplace_back(getOrCreateInstances, &context,
+                         std::ref(threadInstances[i]));
+  for (auto &thread : threads)
+    thread.join();
+
+  // Every thread must see the same instances as a serial lookup afterwards.
+  UniquedInstances expected;
+  getOrCreateInstances(&context, expected);
+  for (auto &instances : threadInstances) {
+    EXPECT_EQ(instances.types, expected.types);
+    EXPECT_EQ(instances.attrs, expected.attrs);
+    EXPECT_EQ(instances.exprs, expected.exprs);
+    EXPECT_EQ(instances.identifiers, expected.identifiers);
+  }
+}
+
+TEST(MLIRContextTest, ThreadLocalArenas) {
+  MLIRContext context;
+
+  // Return the number of arenas of the allocator with the given name.
+  auto getNumArenas = [&](StringRef name) -> size_t {
+    for (auto &usage : context.getAllocatorMemoryUsage())
+      if (usage.name == name)
+        return usage.arenaMemory.size();
+    return 0;
+  };
+  size_t numAttributeArenas = getNumArenas("attributes");
+
+  // Each thread that constructs uniqued storage allocates from its own arena.
+  const unsigned numThreads = 4;
+  std::vector<std::thread> threads;
+  for (unsigned i = 0; i != numThreads; ++i)
+    threads.emplace_back([&context, i] {
+      Builder builder(&context);
+      builder.getStringAttr(("thread" + Twine(i)).str());
+    });
+  for (auto &thread : threads)
+    thread.join();
+  EXPECT_EQ(getNumArenas("attributes"), numAttributeArenas + numThreads);
+}
+
+TEST(MLIRContextTest, UniquerStatistics) {
+  MLIRContext context;
+  Builder builder(&context);
+
+  // Return the statistics of the table with the given name.
+  auto getStatistics = [&](StringRef name) {
+    for (auto &stats : context.getUniquerStatistics())
+      if (stats.name == name)
+        return stats;
+    return MLIRContext::UniquerStatistics();
+  };
+  auto initialStats = getStatistics("integer attrs");
+
+  // Uniquing the same attribute twice only adds a single entry.
+  builder.getI64IntegerAttr(1);
+  builder.getI64IntegerAttr(2);
+  builder.getI64IntegerAttr(1);
+  auto stats = getStatistics("integer attrs");
+  EXPECT_EQ(stats.numEntries, initialStats.numEntries + 2);
+  EXPECT_GE(stats.numBuckets, stats.numEntries);
+  EXPECT_GT(stats.tableMemory, 0u);
+  EXPECT_GT(stats.getLoadFactor(), 0.0);
+  EXPECT_LE(stats.getLoadFactor(), 1.0);
+}
+
+} // end namespace
@@ -0,0 +1,193 @@
+//===- OperationArenaTest.cpp - Operation arena unit tests ----------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/IR/OperationArena.h"
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/Module.h"
+#include "mlir/IR/Operation.h"
+#include "mlir/IR/StandardTypes.h"
+#include "gtest/gtest.h"
+
+using namespace mlir;
+
+namespace {
+Operation *createOp(MLIRContext *context, ArrayRef<Value *> operands = {},
+                    ArrayRef<Type> resultTypes = {}, unsigned numRegions = 0) {
+  return Operation::create(UnknownLoc::get(context),
+                           OperationName("foo.bar", context), operands,
+                           resultTypes, llvm::None, llvm::None, numRegions,
+                           /*resizableOperandList=*/false, context);
+}
+
+/// Create a function in 'module' whose body holds a chain of operations, one
+/// of which has a region using the values defined above it.
+Function *createFunction(Module &module, StringRef name, unsigned numOps) {
+  auto *context = module.getContext();
+  Builder builder(context);
+  auto *function = new Function(UnknownLoc::get(context), name,
+                                builder.getFunctionType({}, {}));
+  module.getFunctions().push_back(function);
+  function->addEntryBlock();
+  Block *block = &function->front();
+
+  Operation *def = createOp(context, {}, builder.getIntegerType(32));
+  block->push_back(def);
+  for (unsigned i = 0; i != numOps; ++i) {
+    auto *op = createOp(context, def->getResult(0),
+                        builder.getIntegerType(32), /*numRegions=*/1);
+    block->push_back(op);
+    auto *nestedBlock = new Block();
+    op->getRegion(0).push_back(nestedBlock);
+    nestedBlock->push_back(createOp(context, def->getResult(0)));
+    def = op;
+  }
+  return function;
+}
+
+TEST(OperationArenaTest, AllocateInScope) {
+  MLIRContext context;
+  Builder builder(&context);
+  OperationArena arena;
+
+  // Operations created outside of a scope are allocated with malloc.
+  EXPECT_EQ(OperationArena::getCurrentArena(), nullptr);
+  Operation *mallocOp = createOp(&context);
+  EXPECT_EQ(arena.getNumLiveAllocations(), 0u);
+
+  {
+    OperationArena::Scope scope(arena);
+    EXPECT_EQ(OperationArena::getCurrentArena(), &arena);
+
+    Operation *def = createOp(&context, {}, builder.getIntegerType(32));
+    Operation *user =
+        createOp(&context, def->getResult(0), builder.getIntegerType(32));
+    EXPECT_EQ(arena.getNumLiveAllocations(), 2u);
+    EXPECT_NE(arena.getTotalMemory(), 0u);
+    EXPECT_EQ(user->getOperand(0), def->getResult(0));
+
+    user->destroy();
+    def->destroy();
+    EXPECT_EQ(arena.getNumLiveAllocations(), 0u);
+  }
+
+  // The previous arena is restored at the end of the scope.
+  EXPECT_EQ(OperationArena::getCurrentArena(), nullptr);
+  mallocOp->destroy();
+}
+
+TEST(OperationArenaTest, NestedScopes) {
+  OperationArena outer, inner;
+  OperationArena::Scope outerScope(outer);
+  {
+    OperationArena::Scope innerScope(inner);
+    EXPECT_EQ(OperationArena::getCurrentArena(), &inner);
+  }
+  EXPECT_EQ(OperationArena::getCurrentArena(), &outer);
+}
+
+TEST(OperationArenaTest, RecycleMemory) {
+  MLIRContext context;
+  OperationArena arena;
+  OperationArena::Scope scope(arena);
+
+  // The memory of an erased operation is reused for the next operation of the
+  // same size.
+  Operation *op = createOp(&context);
+  void *memory = op;
+  op->destroy();
+
+  size_t totalMemory = arena.getTotalMemory();
+  op = createOp(&context);
+  EXPECT_EQ(static_cast<void *>(op), memory);
+  EXPECT_EQ(arena.getTotalMemory(), totalMemory);
+  op->destroy();
+}
+
+TEST(OperationArenaTest, RecycleLargeAllocations) {
+  MLIRContext context;
+  Builder builder(&context);
+  OperationArena arena;
+  OperationArena::Scope scope(arena);
+
+  // Operations larger than the small size classes are recycled too.
+  Operation *def = createOp(&context, {}, builder.getIntegerType(32));
+  SmallVector<Value *, 128> operands(128, def->getResult(0));
+  Operation *op = createOp(&context, operands);
+  void *memory = op;
+  op->destroy();
+
+  size_t totalMemory = arena.getTotalMemory();
+  op = createOp(&context, operands);
+  EXPECT_EQ(static_cast<void *>(op), memory);
+  EXPECT_EQ(arena.getTotalMemory(), totalMemory);
+  op->destroy();
+  def->destroy();
+}
+
+TEST(OperationArenaTest, DestroyBody) {
+  MLIRContext context;
+  Module module(&context);
+  OperationArena arena;
+  Function *function;
+  {
+    OperationArena::Scope scope(arena);
+    function = createFunction(module, "fn", 1000);
+  }
+  EXPECT_EQ(arena.getNumLiveAllocations(), 2001u);
+  size_t totalMemory = arena.getTotalMemory();
+
+  // All of the operations are destroyed at once, and the slabs released.
+  arena.destroyBody(*function);
+  EXPECT_TRUE(function->isExternal());
+  EXPECT_EQ(arena.getNumLiveAllocations(), 0u);
+  EXPECT_LT(arena.getTotalMemory(), totalMemory);
+
+  // The arena may be used again.
+  {
+    OperationArena::Scope scope(arena);
+    createOp(&context)->destroy();
+  }
+  EXPECT_EQ(arena.getNumLiveAllocations(), 0u);
+}
+
+TEST(OperationArenaTest, DestroyBodyWithLiveOperations) {
+  MLIRContext context;
+  Module module(&context);
+  OperationArena arena;
+  Operation *liveOp;
+  {
+    OperationArena::Scope scope(arena);
+    createFunction(module, "fn0", 10);
+    createFunction(module, "fn1", 10);
+    liveOp = createOp(&context);
+  }
+  size_t totalMemory = arena.getTotalMemory();
+
+  // The slabs are kept while an operation allocated from the arena is alive
+  // outside of the module.
+  arena.destroyBody(module);
+  for (auto &function : module)
+    EXPECT_TRUE(function.isExternal());
+  EXPECT_EQ(arena.getNumLiveAllocations(), 1u);
+  EXPECT_EQ(arena.getTotalMemory(), totalMemory);
+
+  liveOp->destroy();
+  EXPECT_EQ(arena.getNumLiveAllocations(), 0u);
+}
+
+} // end anonymous namespace
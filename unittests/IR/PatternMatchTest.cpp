@@ -0,0 +1,140 @@
+//===- PatternMatchTest.cpp - Pattern matcher unit tests ------------------===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/IR/PatternMatch.h"
+#include "mlir/IR/Dialect.h"
+#include "mlir/IR/OpDefinition.h"
+#include "mlir/IR/Operation.h"
+#include "gtest/gtest.h"
+
+using namespace mlir;
+
+namespace {
+Operation *createOp(MLIRContext *context, StringRef name) {
+  return Operation::create(UnknownLoc::get(context),
+                           OperationName(name, context), llvm::None,
+                           llvm::None, llvm::None, llvm::None, 0,
+                           /*resizableOperandList=*/false, context);
+}
+
+/// A pattern that records the order in which it was attempted, and never
+/// matches.
+struct RecordingPattern : public RewritePattern {
+  RecordingPattern(StringRef rootName, PatternBenefit benefit,
+                   MLIRContext *context, std::vector<int> &trace, int id)
+      : RewritePattern(rootName, benefit, context), trace(trace), id(id) {}
+  RecordingPattern(PatternBenefit benefit, std::vector<int> &trace, int id)
+      : RewritePattern(benefit, MatchAnyOpTypeTag()), trace(trace), id(id) {}
+
+  PatternMatchResult match(Operation *op) const override {
+    trace.push_back(id);
+    return matchFailure();
+  }
+
+  std::vector<int> &trace;
+  int id;
+};
+
+/// A rewriter that should never be asked to create operations.
+struct TestRewriter : public PatternRewriter {
+  TestRewriter(MLIRContext *context) : PatternRewriter(context) {}
+  Operation *createOperation(const OperationState &state) override {
+    llvm_unreachable("unexpected operation creation");
+  }
+};
+
+TEST(RewritePatternMatcherTest, DispatchByRootKind) {
+  MLIRContext context;
+  std::vector<int> trace;
+
+  OwningRewritePatternList patterns;
+  patterns.emplace_back(
+      new RecordingPattern("test.foo", /*benefit=*/1, &context, trace, 0));
+  patterns.emplace_back(
+      new RecordingPattern("test.bar", /*benefit=*/1, &context, trace, 1));
+  patterns.emplace_back(new RecordingPattern(/*benefit=*/2, trace, 2));
+  patterns.emplace_back(
+      new RecordingPattern("test.foo", /*benefit=*/3, &context, trace, 3));
+
+  TestRewriter rewriter(&context);
+  RewritePatternMatcher matcher(std::move(patterns), rewriter);
+
+  // Only the patterns rooted at 'test.foo' and the root-agnostic pattern are
+  // attempted, in order of decreasing benefit.
+  Operation *fooOp = createOp(&context, "test.foo");
+  EXPECT_FALSE(matcher.matchAndRewrite(fooOp));
+  EXPECT_EQ(trace, std::vector<int>({3, 2, 0}));
+
+  // An operation kind without any rooted patterns only sees the root-agnostic
+  // pattern.
+  trace.clear();
+  Operation *bazOp = createOp(&context, "test.baz");
+  EXPECT_FALSE(matcher.matchAndRewrite(bazOp));
+  EXPECT_EQ(trace, std::vector<int>({2}));
+
+  // Check the collected statistics.
+  auto fooStats = matcher.getStatistics(fooOp->getName());
+  EXPECT_EQ(fooStats.numPatternsTried, 3u);
+  EXPECT_EQ(fooStats.numPatternsSucceeded, 0u);
+  auto barStats = matcher.getStatistics(OperationName("test.bar", &context));
+  EXPECT_EQ(barStats.numPatternsTried, 0u);
+  EXPECT_EQ(matcher.getStatistics(bazOp->getName()).numPatternsTried, 1u);
+
+  fooOp->destroy();
+  bazOp->destroy();
+}
+
+/// An operation with a single canonicalization pattern.
+struct CanonicalizedOp
+    : public Op<CanonicalizedOp, OpTrait::ZeroOperands, OpTrait::ZeroResult> {
+  using Op::Op;
+  static StringRef getOperationName() { return "test.canonicalized"; }
+
+  static void getCanonicalizationPatterns(OwningRewritePatternList &results,
+                                          MLIRContext *context) {
+    static std::vector<int> trace;
+    results.emplace_back(new RecordingPattern(getOperationName(),
+                                              /*benefit=*/1, context, trace,
+                                              /*id=*/0));
+  }
+};
+
+struct CanonicalizedDialect : public Dialect {
+  CanonicalizedDialect(MLIRContext *context) : Dialect("test", context) {
+    addOperations<CanonicalizedOp>();
+  }
+};
+
+TEST(RewritePatternMatcherTest, CachedCanonicalizationPatterns) {
+  MLIRContext context;
+
+  // The pattern list is cached by the context.
+  auto patterns = context.getCanonicalizationPatterns();
+  EXPECT_EQ(patterns, context.getCanonicalizationPatterns());
+
+  // Registering a new operation invalidates the cache, and the rebuilt list
+  // includes the patterns of the new operation.
+  new CanonicalizedDialect(&context);
+  auto newPatterns = context.getCanonicalizationPatterns();
+  EXPECT_NE(patterns, newPatterns);
+  OperationName opName(CanonicalizedOp::getOperationName(), &context);
+  EXPECT_EQ(newPatterns->size(), patterns->size() + 1);
+  EXPECT_EQ(newPatterns->getMatchingPatterns(opName).size(), 1u);
+  EXPECT_EQ(newPatterns, context.getCanonicalizationPatterns());
+}
+
+} // end namespace
@@ -33,6 +33,16 @@ struct OtherAnalysis {
   OtherAnalysis(Module *) {}
 };
 
+/// An analysis that depends upon OtherAnalysis.
+struct DependentAnalysis {
+  DependentAnalysis(Function *) {}
+  DependentAnalysis(Module *) {}
+
+  static void getDependentAnalyses(AnalysisDependencies &deps) {
+    deps.add<OtherAnalysis>();
+  }
+};
+
 TEST(AnalysisManagerTest, FineGrainModuleAnalysisPreservation) {
   MLIRContext context;
 
@@ -109,4 +119,103 @@ TEST(AnalysisManagerTest, FineGrainChildFunctionAnalysisPreservation) {
   EXPECT_FALSE(mam.getCachedFunctionAnalysis<OtherAnalysis>(func1).hasValue());
 }
 
+TEST(AnalysisManagerTest, DependentAnalysisInvalidation) {
+  MLIRContext context;
+
+  std::unique_ptr<Module> module(new Module(&context));
+  ModuleAnalysisManager mam(&*module, /*passInstrumentor=*/nullptr);
+
+  // Query an analysis along with its dependency, and preserve the analysis
+  // but not the dependency.
+  mam.getAnalysis<OtherAnalysis>();
+  mam.getAnalysis<DependentAnalysis>();
+  mam.getAnalysis<MyAnalysis>();
+
+  detail::PreservedAnalyses pa;
+  pa.preserve<DependentAnalysis, MyAnalysis>();
+  mam.invalidate(pa);
+
+  // Check that the dependent analysis was invalidated with its dependency.
+  EXPECT_FALSE(mam.getCachedAnalysis<OtherAnalysis>().hasValue());
+  EXPECT_FALSE(mam.getCachedAnalysis<DependentAnalysis>().hasValue());
+  EXPECT_TRUE(mam.getCachedAnalysis<MyAnalysis>().hasValue());
+  EXPECT_EQ(mam.getStatistics().numInvalidations, 2u);
+}
+
+TEST(AnalysisManagerTest, UncomputedDependencyInvalidation) {
+  MLIRContext context;
+
+  std::unique_ptr<Module> module(new Module(&context));
+  ModuleAnalysisManager mam(&*module, /*passInstrumentor=*/nullptr);
+
+  // Query an analysis without its dependency, along with an unrelated
+  // analysis.
+  mam.getAnalysis<DependentAnalysis>();
+  mam.getAnalysis<MyAnalysis>();
+
+  // The dependency was never computed, so invalidating the unrelated analysis
+  // preserves the dependent analysis.
+  detail::PreservedAnalyses pa;
+  pa.preserve<DependentAnalysis>();
+  mam.invalidate(pa);
+  EXPECT_TRUE(mam.getCachedAnalysis<DependentAnalysis>().hasValue());
+  EXPECT_FALSE(mam.getCachedAnalysis<MyAnalysis>().hasValue());
+  EXPECT_EQ(mam.getStatistics().numInvalidations, 1u);
+
+  // Once the dependency is computed, invalidating it invalidates the
+  // dependent analysis too.
+  mam.getAnalysis<OtherAnalysis>();
+  mam.invalidate(pa);
+  EXPECT_FALSE(mam.getCachedAnalysis<OtherAnalysis>().hasValue());
+  EXPECT_FALSE(mam.getCachedAnalysis<DependentAnalysis>().hasValue());
+  EXPECT_EQ(mam.getStatistics().numInvalidations, 3u);
+}
+
+TEST(AnalysisManagerTest, ChangedFunctionInvalidation) {
+  MLIRContext context;
+  Builder builder(&context);
+
+  // Create a module with two functions.
+  std::unique_ptr<Module> module(new Module(&context));
+  Function *func1 =
+      new Function(builder.getUnknownLoc(), "foo",
+                   builder.getFunctionType(llvm::None, llvm::None));
+  Function *func2 =
+      new Function(builder.getUnknownLoc(), "bar",
+                   builder.getFunctionType(llvm::None, llvm::None));
+  module->getFunctions().push_back(func1);
+  module->getFunctions().push_back(func2);
+
+  ModuleAnalysisManager mam(&*module, /*passInstrumentor=*/nullptr);
+  mam.getFunctionAnalysis<MyAnalysis>(func1);
+  mam.getFunctionAnalysis<MyAnalysis>(func2);
+
+  // Invalidate all analyses, but only of the changed function.
+  llvm::SmallPtrSet<Function *, 1> changedFunctions;
+  changedFunctions.insert(func1);
+  mam.invalidate(detail::PreservedAnalyses(), &changedFunctions);
+
+  EXPECT_FALSE(mam.getCachedFunctionAnalysis<MyAnalysis>(func1).hasValue());
+  EXPECT_TRUE(mam.getCachedFunctionAnalysis<MyAnalysis>(func2).hasValue());
+}
+
+TEST(AnalysisManagerTest, HitAndMissCounters) {
+  MLIRContext context;
+
+  std::unique_ptr<Module> module(new Module(&context));
+  ModuleAnalysisManager mam(&*module, /*passInstrumentor=*/nullptr);
+
+  // The first query computes the analysis, and the second hits the cache.
+  mam.getAnalysis<MyAnalysis>();
+  mam.getAnalysis<MyAnalysis>();
+  EXPECT_EQ(mam.getStatistics().numMisses, 1u);
+  EXPECT_EQ(mam.getStatistics().numHits, 1u);
+
+  // Once invalidated, the analysis is computed again.
+  mam.invalidate(detail::PreservedAnalyses());
+  mam.getAnalysis<MyAnalysis>();
+  EXPECT_EQ(mam.getStatistics().numMisses, 2u);
+  EXPECT_EQ(mam.getStatistics().numInvalidations, 1u);
+}
+
 } // end namespace
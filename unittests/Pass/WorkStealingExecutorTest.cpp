@@ -0,0 +1,57 @@
+//===- WorkStealingExecutorTest.cpp - WorkStealingExecutor unit tests -----===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "../../lib/Pass/PassDetail.h"
+#include "gtest/gtest.h"
+#include <atomic>
+#include <thread>
+
+using namespace mlir;
+using namespace mlir::detail;
+
+namespace {
+
+/// Runs 'numTasks' tasks that take a little while on 'executor', and checks
+/// that all of them completed by the time 'run' returns.
+void runAndCheckCompletion(WorkStealingExecutor &executor, size_t numTasks) {
+  std::atomic<size_t> numCompleted(0);
+  executor.run(numTasks, [&](unsigned, size_t) {
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+    ++numCompleted;
+  });
+  EXPECT_EQ(numCompleted, numTasks);
+}
+
+TEST(WorkStealingExecutorTest, RunCompletesAllTasks) {
+  WorkStealingExecutor executor(4);
+  for (unsigned i = 0; i < 4; ++i)
+    runAndCheckCompletion(executor, 32);
+}
+
+TEST(WorkStealingExecutorTest, RunAfterSetNumThreads) {
+  // Restarted worker threads must not mistake the previous execution for a
+  // new one.
+  WorkStealingExecutor executor(2);
+  for (unsigned numThreads : {4, 2, 8, 3, 4, 1, 6}) {
+    runAndCheckCompletion(executor, 24);
+    executor.setNumThreads(numThreads);
+    EXPECT_EQ(executor.getNumThreads(), numThreads);
+    runAndCheckCompletion(executor, 24);
+  }
+}
+
+} // end namespace
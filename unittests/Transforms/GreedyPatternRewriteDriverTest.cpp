@@ -0,0 +1,129 @@
+//===- GreedyPatternRewriteDriverTest.cpp - Greedy rewrite driver tests ---===//
+//
+// Copyright 2019 The MLIR Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+// =============================================================================
+
+#include "mlir/IR/Builders.h"
+#include "mlir/IR/Function.h"
+#include "mlir/IR/Module.h"
+#include "mlir/IR/OpDefinition.h"
+#include "mlir/IR/PatternMatch.h"
+#include "gtest/gtest.h"
+
+using namespace mlir;
+
+namespace {
+/// Operations without operands or results, which the patterns below turn into
+/// one another.
+struct TestAOp
+    : public Op<TestAOp, OpTrait::ZeroOperands, OpTrait::ZeroResult> {
+  using Op::Op;
+  static StringRef getOperationName() { return "test.a"; }
+  static void build(Builder *builder, OperationState *result) {}
+};
+struct TestBOp
+    : public Op<TestBOp, OpTrait::ZeroOperands, OpTrait::ZeroResult> {
+  using Op::Op;
+  static StringRef getOperationName() { return "test.b"; }
+  static void build(Builder *builder, OperationState *result) {}
+};
+
+/// A pattern that replaces operations of type 'FromOp' by operations of type
+/// 'ToOp'.
+template <typename FromOp, typename ToOp>
+struct ReplacePattern : public RewritePattern {
+  ReplacePattern(MLIRContext *context)
+      : RewritePattern(FromOp::getOperationName(), /*benefit=*/1, context) {}
+
+  PatternMatchResult match(Operation *op) const override {
+    return matchSuccess();
+  }
+
+  void rewrite(Operation *op, PatternRewriter &rewriter) const override {
+    rewriter.replaceOpWithNewOp<ToOp>(op);
+  }
+};
+
+/// Creates a function named 'name' in 'module', with a body made of an
+/// operation for each name in 'opNames'.
+Function *createFunction(Module &module, StringRef name,
+                         ArrayRef<StringRef> opNames) {
+  auto *context = module.getContext();
+  auto *fn = new Function(UnknownLoc::get(context), name,
+                          FunctionType::get({}, {}, context));
+  module.getFunctions().push_back(fn);
+  fn->addEntryBlock();
+  FuncBuilder builder(fn);
+  for (auto opName : opNames)
+    builder.createOperation(
+        OperationState(context, UnknownLoc::get(context), opName));
+  return fn;
+}
+
+/// Returns the names of the operations in the body of 'fn'.
+std::vector<std::string> getOpNames(Function *fn) {
+  std::vector<std::string> names;
+  for (auto &op : fn->front())
+    names.push_back(op.getName().getStringRef().str());
+  return names;
+}
+
+TEST(GreedyPatternRewriteDriverTest, RewritesEveryFunction) {
+  MLIRContext context;
+  Module module(&context);
+  std::vector<Function *> functions;
+  for (unsigned i = 0; i < 8; ++i)
+    functions.push_back(createFunction(module, "f" + std::to_string(i),
+                                       {"test.a", "test.c", "test.a"}));
+
+  OwningRewritePatternList patterns;
+  patterns.emplace_back(new ReplacePattern<TestAOp, TestBOp>(&context));
+  auto result = applyPatternsGreedily(
+      module,
+      std::make_shared<const FrozenRewritePatternList>(std::move(patterns)));
+
+  EXPECT_TRUE(result.converged());
+  EXPECT_TRUE(result.nonConvergedFunctions.empty());
+  std::vector<std::string> expectedNames = {"test.b", "test.c", "test.b"};
+  for (auto *fn : functions)
+    EXPECT_EQ(getOpNames(fn), expectedNames);
+}
+
+TEST(GreedyPatternRewriteDriverTest, IterationLimit) {
+  MLIRContext context;
+  Module module(&context);
+  // Only the functions with a 'test.a' operation never converge.
+  auto *f0 = createFunction(module, "f0", {"test.a"});
+  createFunction(module, "f1", {"test.c"});
+  auto *f2 = createFunction(module, "f2", {"test.c", "test.a"});
+  createFunction(module, "f3", {"test.c"});
+
+  // These patterns flip 'test.a' and 'test.b' back and forth forever.
+  OwningRewritePatternList patterns;
+  patterns.emplace_back(new ReplacePattern<TestAOp, TestBOp>(&context));
+  patterns.emplace_back(new ReplacePattern<TestBOp, TestAOp>(&context));
+  const unsigned maxIterations = 10;
+  auto result = applyPatternsGreedily(
+      module,
+      std::make_shared<const FrozenRewritePatternList>(std::move(patterns)),
+      maxIterations);
+
+  EXPECT_FALSE(result.converged());
+  EXPECT_EQ(result.nonConvergedFunctions, std::vector<Function *>({f0, f2}));
+  // The functions that don't converge stop after processing 'maxIterations'
+  // operations, and the others process their single operation once.
+  EXPECT_EQ(result.numIterations, 2 * maxIterations + 2);
+}
+} // end namespace